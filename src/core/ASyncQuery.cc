@@ -18,6 +18,7 @@
 #include "core/Paths.h"
 #include "core/ASyncQuery.h"
 #include "core/Database.h"
+#include "core/DatabaseWriter.h"
 
 #include <QtDebug>
 
@@ -44,6 +45,8 @@ bool ASyncQuery::exec(const QString &qString)
 	// Add us to the connection waiting queue, unless we
 	// are already active
 	if (!_active) {
+		// Training changes may still be waiting for the writer
+		DatabaseWriter::flushFor(qString);
 		_currentQuery = qString;
 		_active = true;
 		_dbConn->_waitingQueueMutex.lock();
@@ -172,9 +175,9 @@ ThreadedDatabaseConnection::~ThreadedDatabaseConnection()
 	_connection.close();
 }
 
-bool ThreadedDatabaseConnection::connect(const QString &dbFile)
+bool ThreadedDatabaseConnection::connect(const QString &dbFile, SQLite::Connection::OpenFlags flags)
 {
-	if (!_connection.connect(dbFile)) {
+	if (!_connection.connect(dbFile, flags)) {
 		qWarning("Cannot open database: %s", _connection.lastError().message().toLatin1().data());
 		return false;
 	}	
@@ -263,7 +266,7 @@ void DatabaseThread::run()
 	_connection = new ThreadedDatabaseConnection();
 
 	// Connect to the main database
-	connection()->connect(Database::instance()->userDBFile());
+	connection()->connect(Database::instance()->userDBFile(), Database::userDBFlags());
 
 	// Attach all databases
 	const QMap<QString, QString> &dbsToAttach(Database::attachedDBs());
@@ -167,7 +167,7 @@ public:
 	 * Connect to the database file given as parameter. Returns true in case
 	 * of success, false otherwise.
 	 */
-	bool connect(const QString &dbFile);
+	bool connect(const QString &dbFile, SQLite::Connection::OpenFlags flags = SQLite::Connection::None);
 	/**
 	 * Connect the database file given as parameter to alias. Returns true
 	 * in case of success, false otherwise.
@@ -22,6 +22,7 @@
 #include "sqlite/Connection.h"
 
 #include <QStringList>
+#include <QVector>
 
 /**
  * Represents how entries lists are actually recorded inside the DB.
@@ -77,14 +78,22 @@ private:
 	SQLite::Connection *_connection;
 
 	SQLite::Query getEntryQuery;
+	SQLite::Query getEntryWithChildrenQuery;
 	SQLite::Query insertEntryQuery;
+	SQLite::Query insertEntriesQuery;
 	SQLite::Query removeEntryQuery;
+	/// Number of entries inserted at once by insertEntriesQuery
+	int _chunkSize;
 
 	SQLite::Query newListQuery;
 	SQLite::Query getListQuery;
 	SQLite::Query insertListQuery;
 	SQLite::Query removeListQuery;
 
+	void bindEntry(SQLite::Query &query, const DBListEntry<T> &entry);
+	void readEntry(SQLite::Query &query, DBListEntry<T> &entry);
+	bool insertEntriesChunks(const QVector<DBListEntry<T> *> &entries);
+
 public:
 	DBList(const QString &tableName, SQLite::Connection *connection = 0);
 	const QString &tableName() const { return _tableName; }
@@ -98,9 +107,14 @@ public:
 	bool createTables(SQLite::Connection *connection);
 	/// Returns the entry list corresponding to the given row id
 	DBListEntry<T> getEntry(quint32 rowid);
+	/// Returns the entry corresponding to the given row id, along with its children, using a single query
+	QList<DBListEntry<T> > getEntryWithChildren(quint32 rowid);
 	/// Inserts the given entry into a list, returns the rowid
 	/// If the entry already exists, replaces it.
 	quint32 insertEntry(const DBListEntry<T> &entry);
+	/// Inserts all the given entries using multi-rows statements. Entries which
+	/// rowId is 0 are given a new rowid, which is written back into them.
+	bool insertEntries(const QVector<DBListEntry<T> *> &entries);
 	/// Removes the given entry from a list
 	bool removeEntry(quint32 rowid);
 
@@ -116,7 +130,7 @@ public:
 	SQLite::Connection *connection() { return _connection; }
 };
 
-template <class T> DBList<T>::DBList(const QString &tableName, SQLite::Connection *connection) : _tableName(tableName)
+template <class T> DBList<T>::DBList(const QString &tableName, SQLite::Connection *connection) : _tableName(tableName), _chunkSize(1)
 {
 	prepareForConnection(connection);
 }
@@ -134,7 +148,9 @@ template <class T> bool DBList<T>::prepareForConnection(SQLite::Connection *conn
 {
 	_connection = connection;
 	getEntryQuery.useWith(_connection);
+	getEntryWithChildrenQuery.useWith(_connection);
 	insertEntryQuery.useWith(_connection);
+	insertEntriesQuery.useWith(_connection);
 	removeEntryQuery.useWith(_connection);
 
 	newListQuery.useWith(_connection);
@@ -147,9 +163,18 @@ template <class T> bool DBList<T>::prepareForConnection(SQLite::Connection *conn
 	while (nbDataMembers-- > 0) dataHoldersList << "?";
 	QString dataHolders(dataHoldersList.join(", "));
 
+	// Multi-rows inserts are done using compound selects, so that older SQLite
+	// versions are supported. Stay within the default limits of SQLite for the
+	// number of compound terms (500) and bound variables (999).
+	_chunkSize = qMin(500, 999 / (6 + dataHoldersList.size()));
+	QStringList chunkHoldersList;
+	for (int i = 0; i < _chunkSize; i++) chunkHoldersList << QString("select ?, ?, ?, ?, ?, ?, %1").arg(dataHolders);
+
 	if (connection) {
 		if (!getEntryQuery.prepare(QString("select * from %1 where rowid = ?").arg(_tableName))) return false;
+		if (!getEntryWithChildrenQuery.prepare(QString("select * from %1 where rowid in (?1, (select left from %1 where rowid = ?1), (select right from %1 where rowid = ?1))").arg(_tableName))) return false;
 		if (!insertEntryQuery.prepare(QString("insert or replace into %1 values(?, ?, ?, ?, ?, ?, %2)").arg(_tableName).arg(dataHolders))) return false;
+		if (!insertEntriesQuery.prepare(QString("insert or replace into %1 %2").arg(_tableName).arg(chunkHoldersList.join(" union all ")))) return false;
 		if (!removeEntryQuery.prepare(QString("delete from %1 where rowid == ?").arg(_tableName))) return false;
 
 		if (!newListQuery.prepare(QString("insert into %1Roots values(NULL, 0, \"\")").arg(_tableName))) return false;
@@ -169,28 +194,54 @@ template <class T> DBListEntry<T> DBList<T>::getEntry(quint32 rowid)
 		ret.rowId = 0;
 		return ret;
 	}
-	ret.rowId = getEntryQuery.valueUInt(0);
-	ret.leftSize = getEntryQuery.valueUInt(1);
-	ret.red = getEntryQuery.valueBool(2);
-	ret.parent = getEntryQuery.valueUInt(3);
-	ret.left = getEntryQuery.valueUInt(4);
-	ret.right = getEntryQuery.valueUInt(5);
-
-	ret.readDataValues(getEntryQuery, 6);
+	readEntry(getEntryQuery, ret);
 	getEntryQuery.reset();
 	return ret;
 }
 
+template <class T> QList<DBListEntry<T> > DBList<T>::getEntryWithChildren(quint32 rowid)
+{
+	QList<DBListEntry<T> > ret;
+	getEntryWithChildrenQuery.bindValue(rowid, 1);
+	if (!getEntryWithChildrenQuery.exec()) {
+		getEntryWithChildrenQuery.reset();
+		return ret;
+	}
+	while (getEntryWithChildrenQuery.next()) {
+		DBListEntry<T> entry;
+		readEntry(getEntryWithChildrenQuery, entry);
+		ret << entry;
+	}
+	return ret;
+}
+
+template <class T> void DBList<T>::readEntry(SQLite::Query &query, DBListEntry<T> &entry)
+{
+	entry.rowId = query.valueUInt(0);
+	entry.leftSize = query.valueUInt(1);
+	entry.red = query.valueBool(2);
+	entry.parent = query.valueUInt(3);
+	entry.left = query.valueUInt(4);
+	entry.right = query.valueUInt(5);
+
+	entry.readDataValues(query, 6);
+}
+
+template <class T> void DBList<T>::bindEntry(SQLite::Query &query, const DBListEntry<T> &entry)
+{
+	if (entry.rowId == 0) query.bindNullValue();
+	else query.bindValue(entry.rowId);
+	query.bindValue(entry.leftSize);
+	query.bindValue(entry.red);
+	query.bindValue(entry.parent);
+	query.bindValue(entry.left);
+	query.bindValue(entry.right);
+	entry.bindDataValues(query);
+}
+
 template <class T> quint32 DBList<T>::insertEntry(const DBListEntry<T> &entry)
 {
-	if (entry.rowId == 0) insertEntryQuery.bindNullValue();
-	else insertEntryQuery.bindValue(entry.rowId);
-	insertEntryQuery.bindValue(entry.leftSize);
-	insertEntryQuery.bindValue(entry.red);
-	insertEntryQuery.bindValue(entry.parent);
-	insertEntryQuery.bindValue(entry.left);
-	insertEntryQuery.bindValue(entry.right);
-	entry.bindDataValues(insertEntryQuery);
+	bindEntry(insertEntryQuery, entry);
 
 	if (!insertEntryQuery.exec()) {
 		insertEntryQuery.reset();
@@ -198,6 +249,41 @@ template <class T> quint32 DBList<T>::insertEntry(const DBListEntry<T> &entry)
 	} else return insertEntryQuery.lastInsertId();
 }
 
+template <class T> bool DBList<T>::insertEntries(const QVector<DBListEntry<T> *> &entries)
+{
+	// New entries are inserted separately, so that the rowids they are given
+	// within a statement are guaranteed to be consecutive
+	QVector<DBListEntry<T> *> newEntries, oldEntries;
+	foreach (DBListEntry<T> *entry, entries) {
+		if (entry->rowId == 0) newEntries << entry;
+		else oldEntries << entry;
+	}
+	return insertEntriesChunks(newEntries) && insertEntriesChunks(oldEntries);
+}
+
+template <class T> bool DBList<T>::insertEntriesChunks(const QVector<DBListEntry<T> *> &entries)
+{
+	int i = 0;
+	for (; i + _chunkSize <= entries.size(); i += _chunkSize) {
+		for (int j = i; j < i + _chunkSize; j++) bindEntry(insertEntriesQuery, *entries[j]);
+		if (!insertEntriesQuery.exec()) {
+			insertEntriesQuery.reset();
+			return false;
+		}
+		quint32 rowId = insertEntriesQuery.lastInsertId();
+		for (int j = i + _chunkSize - 1; j >= i; j--) {
+			if (entries[j]->rowId == 0) entries[j]->rowId = rowId--;
+		}
+	}
+	// Remaining entries do not fill a chunk, insert them one by one
+	for (; i < entries.size(); i++) {
+		quint32 rowId = insertEntry(*entries[i]);
+		if (rowId == 0) return false;
+		entries[i]->rowId = rowId;
+	}
+	return true;
+}
+
 template <class T> bool DBList<T>::removeEntry(quint32 rowid)
 {
 	if (rowid == 0) return false;
@@ -17,12 +17,15 @@
 
 #include "sqlite3.h"
 #include "sqlite/SQLite.h"
+#include "sqlite/DictionaryCodec.h"
 
 #include "core/Paths.h"
 #include "core/TextTools.h"
 #include "core/Database.h"
 #include "core/ASyncQuery.h"
 #include "core/EntryListDB.h"
+#include "core/DatabaseMaintenance.h"
+#include "core/DatabaseWriter.h"
 
 #include <QtDebug>
 #include <QSemaphore>
@@ -36,6 +39,14 @@
 QString Database::_userDBFile;
 Database *Database::_instance = 0;
 QMap<QString, QString> Database::_attachedDBs;
+PreferenceItem<bool> Database::walMode("userDB", "walMode", false);
+
+SQLite::Connection::OpenFlags Database::userDBFlags()
+{
+	// Read once so that all the connections of a session agree
+	static const SQLite::Connection::OpenFlags flags = walMode.value() ? SQLite::Connection::WAL : SQLite::Connection::None;
+	return flags;
+}
 
 /**
  * Creates the user database. The database file on which
@@ -43,6 +54,8 @@ QMap<QString, QString> Database::_attachedDBs;
  */
 bool Database::createUserDB()
 {
+	// Must be set before any table is created
+	if (!DatabaseMaintenance::enableIncrementalVacuum(&_connection)) return false;
 	if (!_connection.transaction()) return false;
 	SQLite::Query query(&_connection);
 	// Versions table
@@ -339,7 +352,7 @@ bool Database::connectUserDB(QString filename, QStringList &errors)
 	// Connect to the user DB
 	if (filename.isEmpty()) filename = defaultDBFile(); 
 
-	if (!_connection.connect(filename)) {
+	if (!_connection.connect(filename, userDBFlags())) {
 		errors << tr("Cannot open database: %1").arg(_connection.lastError().message().toLatin1().data());
 		return false;
 	}
@@ -373,6 +386,12 @@ bool Database::init(const QString &userDBFile, bool temporary, QStringList &erro
 			errors << tr("Tagaini is working on a temporary database. This allows the program to work, but user data is unavailable and any change will be lost upon program exit. If you corrupted your database file, please recreate it from the preferences.");
 		}
 	}
+
+	if (userDBFlags() & SQLite::Connection::WAL) DatabaseWriter::start(_userDBFile, userDBFlags());
+
+	// Orphan tags and free pages are cleaned up while the program is running
+	_instance->_maintenance = new DatabaseMaintenance(&_instance->_connection);
+	_instance->_maintenance->start();
 	return true;
 }
 
@@ -380,24 +399,20 @@ void Database::stop()
 {
 	if (!_instance) return;
 
-	// The query must not live until the end of the method, as the connection is uses
-	// will be deleted before.
-	{
-		SQLite::Query query(&_instance->_connection);
-
-		// Remove unreferenced tags
-		if (!query.exec("delete from tags where docid not in (select tagId from taggedEntries)")) qWarning("Could not cleanup unused tags!");
+	// Pending maintenance work is resumed by the next session
+	if (_instance->_maintenance) _instance->_maintenance->stop();
+	// Commit the pending user data changes
+	DatabaseWriter::stop();
+	delete _instance->_maintenance;
+	_instance->_maintenance = 0;
 
-		// VACUUM the database
-		if (!query.exec("vacuum")) qWarning("Final VACUUM failed %s", query.lastError().message().toLatin1().data());
-	}
 	// Close the database
 	_instance->_connection.close();
 	delete _instance;
 	_instance = 0;
 }
 
-Database::Database(const QString &userDBFile) : _tFile(0)
+Database::Database(const QString &userDBFile) : _tFile(0), _maintenance(0)
 {
 	sqlite3ext_init();
 }
@@ -426,6 +441,8 @@ bool Database::attachDictionaryDB(const QString &file, const QString &alias, int
 	if (query.valueInt(0) != expectedVersion) goto errorDetach;
 	// More than one result, not good
 	if (query.next()) goto errorDetach;
+	// Compressed text of the database can only be read once its dictionaries are known
+	if (!SQLite::DictionaryCodec::registerDictionaries(&instance()->_connection, alias)) goto errorDetach;
 	_attachedDBs[alias] = file;
 
 	// Now attach the database on all other threaded connections
@@ -445,6 +462,22 @@ error:
 	return false;
 }
 
+bool Database::connectLoader(SQLite::Connection &connection, const QMap<QString, QString> &dbs)
+{
+	if (!connection.connect(userDBFile(), userDBFlags())) {
+		qWarning("Cannot open database: %s", connection.lastError().message().toLatin1().data());
+		return false;
+	}
+	foreach (const QString &alias, dbs.keys()) {
+		if (!connection.attach(dbs[alias], alias)) {
+			qWarning("Failed to attach dictionary file %s: %s", dbs[alias].toLatin1().data(), connection.lastError().message().toLatin1().data());
+			connection.close();
+			return false;
+		}
+	}
+	return true;
+}
+
 bool Database::detachDictionaryDB(const QString &alias)
 {
 	SQLite::Query query(&instance()->_connection);
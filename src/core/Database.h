@@ -31,6 +31,7 @@
 #include <QCoreApplication>
 
 struct sqlite3;
+class DatabaseMaintenance;
 
 class Database
 {
@@ -44,6 +45,7 @@ private:
 	static Database *_instance;
 
 	SQLite::Connection _connection;
+	DatabaseMaintenance *_maintenance;
 	Database(const QString &userDBFile = QString());
 	~Database();
 
@@ -59,6 +61,16 @@ public:
 	static void stop();
 	static Database *instance() { return _instance; }
 	static SQLite::Connection *connection() { return &_instance->_connection; }
+	/// Background maintenance of the user database, if it is running
+	static DatabaseMaintenance *maintenance() { return _instance ? _instance->_maintenance : 0; }
+
+	/**
+	 * Whether the user database uses write-ahead logging, with user data
+	 * changes applied by a DatabaseWriter. Takes effect at next startup.
+	 */
+	static PreferenceItem<bool> walMode;
+	/// Flags that all connections to the user database must be opened with
+	static SQLite::Connection::OpenFlags userDBFlags();
 
 	static const QString &userDBFile() { return _userDBFile; }
 	static const QString defaultDBFile() { return QDir(userProfile()).absoluteFilePath("user.db"); }
@@ -66,6 +78,14 @@ public:
 	static bool attachDictionaryDB(const QString &file, const QString &alias, int expectedVersion);
 	static bool detachDictionaryDB(const QString &alias);
 	static const QMap<QString, QString> &attachedDBs() { return _attachedDBs; }
+	/**
+	 * Connects connection to the user database and attaches the dictionaries
+	 * of dbs to it, like the connections of database threads. connection()
+	 * can only be used from the main thread, so data loaded in the background
+	 * must be loaded through such a dedicated connection. dbs should be a copy
+	 * of attachedDBs() taken from the main thread.
+	 */
+	static bool connectLoader(SQLite::Connection &connection, const QMap<QString, QString> &dbs);
 
 	static const SQLite::Error &lastError() { return _instance->_connection.lastError(); }
 };
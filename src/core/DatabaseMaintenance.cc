@@ -0,0 +1,157 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlite3.h"
+
+#include "core/DatabaseMaintenance.h"
+#include "core/Tag.h"
+
+#include <QtDebug>
+#include <QStringList>
+
+/// Delay between two maintenance slices, in milliseconds
+#define SLICE_INTERVAL 2000
+/// Delay before checking the database again once it is clean
+#define CHECK_INTERVAL 60000
+/// Maximum number of orphan tags deleted per slice
+#define TAGS_PER_SLICE 100
+/// Maximum number of pages released per slice
+#define PAGES_PER_SLICE 128
+
+#define AUTO_VACUUM_INCREMENTAL 2
+
+static int pragmaValue(SQLite::Connection *connection, const char *pragma)
+{
+	SQLite::Query query(connection);
+	if (!query.exec(QString("pragma %1").arg(pragma)) || !query.next()) return -1;
+	return query.valueInt(0);
+}
+
+DatabaseMaintenance::DatabaseMaintenance(SQLite::Connection *connection, QObject *parent) : QObject(parent), _connection(connection), _tagsCleaned(false)
+{
+	_timer.setInterval(SLICE_INTERVAL);
+	connect(&_timer, SIGNAL(timeout()), this, SLOT(onTimeout()));
+}
+
+void DatabaseMaintenance::start()
+{
+	_timer.start();
+}
+
+void DatabaseMaintenance::stop()
+{
+	_timer.stop();
+}
+
+void DatabaseMaintenance::onTimeout()
+{
+	// Do not interfere with transactions in progress, we will try again later
+	if (!sqlite3_get_autocommit(_connection->sqlite3Handler())) return;
+	_timer.setInterval(runSlice() ? SLICE_INTERVAL : CHECK_INTERVAL);
+}
+
+int DatabaseMaintenance::pageCount() const
+{
+	return pragmaValue(_connection, "page_count");
+}
+
+int DatabaseMaintenance::freelistCount() const
+{
+	return pragmaValue(_connection, "freelist_count");
+}
+
+double DatabaseMaintenance::freelistRatio() const
+{
+	int pages = pageCount();
+	if (pages <= 0) return 0.0;
+	return freelistCount() / (double)pages;
+}
+
+bool DatabaseMaintenance::incrementalVacuum() const
+{
+	return pragmaValue(_connection, "auto_vacuum") == AUTO_VACUUM_INCREMENTAL;
+}
+
+bool DatabaseMaintenance::enableIncrementalVacuum(SQLite::Connection *connection)
+{
+	return connection->exec("pragma auto_vacuum=INCREMENTAL");
+}
+
+bool DatabaseMaintenance::cleanupTags()
+{
+	SQLite::Query query(_connection);
+	QList<quint32> ids;
+	if (!query.exec(QString("select docid from tags where docid not in (select tagId from taggedEntries) limit %1").arg(TAGS_PER_SLICE))) {
+		qWarning("Could not cleanup unused tags: %s", query.lastError().message().toUtf8().constData());
+		return false;
+	}
+	while (query.next()) ids << query.valueUInt(0);
+	if (ids.isEmpty()) return false;
+	QStringList idsList;
+	foreach (quint32 id, ids) idsList << QString::number(id);
+	if (!query.exec(QString("delete from tags where docid in (%1)").arg(idsList.join(", ")))) {
+		qWarning("Could not cleanup unused tags: %s", query.lastError().message().toUtf8().constData());
+		return false;
+	}
+	// Do not let the index return the ids of the removed tags
+	Tag::index().tagsRemoved(ids);
+	return ids.size() == TAGS_PER_SLICE;
+}
+
+bool DatabaseMaintenance::needsVacuum() const
+{
+	int freePages = freelistCount();
+	return freePages >= MinFreelistPages && freelistRatio() * 100 >= MaxFreelistPercent;
+}
+
+bool DatabaseMaintenance::convertToIncrementalVacuum()
+{
+	if (!needsConversion()) return false;
+	// Changing the auto vacuum mode of an existing database requires a
+	// full VACUUM
+	if (!enableIncrementalVacuum(_connection) || !_connection->exec("vacuum")) {
+		qWarning("Could not enable incremental vacuum: %s", _connection->lastError().message().toUtf8().constData());
+		return false;
+	}
+	return true;
+}
+
+bool DatabaseMaintenance::vacuumSlice()
+{
+	// Old databases are converted by convertToIncrementalVacuum(), as a
+	// full VACUUM cannot be split into slices
+	if (!incrementalVacuum() || !needsVacuum()) return false;
+	int freePages = freelistCount();
+
+	// Pages are only released as the statement is being stepped
+	SQLite::Query query(_connection);
+	if (!query.exec(QString("pragma incremental_vacuum(%1)").arg(PAGES_PER_SLICE))) {
+		qWarning("Incremental vacuum failed: %s", query.lastError().message().toUtf8().constData());
+		return false;
+	}
+	while (query.next());
+	return freePages > PAGES_PER_SLICE;
+}
+
+bool DatabaseMaintenance::runSlice()
+{
+	if (!_tagsCleaned) {
+		_tagsCleaned = !cleanupTags();
+		return true;
+	}
+	return vacuumSlice();
+}
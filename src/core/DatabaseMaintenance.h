@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_DATABASEMAINTENANCE_H
+#define __CORE_DATABASEMAINTENANCE_H
+
+#include "sqlite/Connection.h"
+
+#include <QObject>
+#include <QTimer>
+
+/**
+ * Keeps the user database compact without blocking the program.
+ *
+ * Maintenance work is split into small slices that run from the event loop
+ * whenever the connection is not in the middle of a transaction:
+ * - orphan tags are deleted a few at a time,
+ * - free pages are returned to the file system with incremental vacuum
+ *   slices whenever they make up too large a part of the database.
+ *
+ * Databases created before incremental vacuum was enabled are not vacuumed
+ * by the slices, as they first need a full VACUUM that would freeze the
+ * program: the GUI runs convertToIncrementalVacuum() once at startup, in the
+ * background and behind a progress dialog.
+ *
+ * Stopping the maintenance never waits for any pending work, which is
+ * simply resumed by the next session.
+ */
+class DatabaseMaintenance : public QObject
+{
+	Q_OBJECT
+private:
+	SQLite::Connection *_connection;
+	QTimer _timer;
+	bool _tagsCleaned;
+
+	bool cleanupTags();
+	bool vacuumSlice();
+
+private slots:
+	void onTimeout();
+
+public:
+	/// Free pages are only reclaimed above this percentage of the database size...
+	static const int MaxFreelistPercent = 10;
+	/// ... and this number of pages, to not bother with small databases
+	static const int MinFreelistPages = 256;
+
+	DatabaseMaintenance(SQLite::Connection *connection, QObject *parent = 0);
+
+	/// Starts running slices from the event loop, until stop() is called
+	void start();
+	void stop();
+
+	/**
+	 * Runs one slice of maintenance work. Returns true if more work remains
+	 * to be done, false once the database is clean.
+	 */
+	bool runSlice();
+
+	int pageCount() const;
+	int freelistCount() const;
+	/// Ratio of unused pages in the database file
+	double freelistRatio() const;
+	/// Whether free pages can be reclaimed without a full VACUUM
+	bool incrementalVacuum() const;
+	/// Whether there are enough free pages to bother reclaiming them
+	bool needsVacuum() const;
+	/// Whether convertToIncrementalVacuum() has something to do
+	bool needsConversion() const { return !incrementalVacuum() && needsVacuum(); }
+
+	/**
+	 * Enables incremental vacuum on a database created without it, if it
+	 * needs to be vacuumed. This runs a full VACUUM, which takes a while on
+	 * large databases: it can run from another thread, provided nothing
+	 * else uses the connection in the meantime and the maintenance is
+	 * stopped. Returns true if the database has been converted.
+	 */
+	bool convertToIncrementalVacuum();
+
+	/**
+	 * Enables incremental vacuum on a database that does not contain any
+	 * table yet.
+	 */
+	static bool enableIncrementalVacuum(SQLite::Connection *connection);
+};
+
+#endif
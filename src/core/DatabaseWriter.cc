@@ -0,0 +1,185 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/DatabaseWriter.h"
+#include "core/Database.h"
+#include "core/ResultsCache.h"
+
+#include <QtDebug>
+
+/// Delay after which a checkpoint is run if nothing is written, in milliseconds
+#define CHECKPOINT_DELAY 2000
+/// Number of transactions after which a checkpoint is run anyway
+#define CHECKPOINT_TRANSACTIONS 100
+
+DatabaseWriter *DatabaseWriter::_instance = 0;
+
+DatabaseWriter::DatabaseWriter(const QString &dbFile, SQLite::Connection::OpenFlags flags) : _dbFile(dbFile), _flags(flags), _committing(0), _uncheckpointed(0), _stop(false)
+{
+}
+
+static bool bindVariant(SQLite::Query &query, const QVariant &value)
+{
+	if (value.isNull()) return query.bindNullValue();
+	switch (value.type()) {
+	case QVariant::Bool:
+		return query.bindValue(value.toBool());
+	case QVariant::Int:
+		return query.bindValue((qint32)value.toInt());
+	case QVariant::UInt:
+		return query.bindValue((quint32)value.toUInt());
+	case QVariant::LongLong:
+		return query.bindValue((qint64)value.toLongLong());
+	case QVariant::ULongLong:
+		return query.bindValue((quint64)value.toULongLong());
+	case QVariant::Double:
+		return query.bindValue(value.toDouble());
+	case QVariant::ByteArray:
+		return query.bindValue(value.toByteArray());
+	default:
+		return query.bindValue(value.toString());
+	}
+}
+
+bool DatabaseWriter::start(const QString &dbFile, SQLite::Connection::OpenFlags flags)
+{
+	if (_instance) return false;
+	_instance = new DatabaseWriter(dbFile, flags);
+	_instance->QThread::start();
+	return true;
+}
+
+void DatabaseWriter::stop()
+{
+	if (!_instance) return;
+	{
+		QMutexLocker locker(&_instance->_mutex);
+		_instance->_stop = true;
+		_instance->_queued.wakeAll();
+	}
+	_instance->wait();
+	delete _instance;
+	_instance = 0;
+}
+
+bool DatabaseWriter::exec(const QString &sql, const QVariantList &values, QString *error)
+{
+	if (!_instance) {
+		SQLite::Query query(Database::connection());
+		bool ok = query.prepare(sql);
+		foreach (const QVariant &value, values) ok = ok && bindVariant(query, value);
+		if (!ok || !query.exec()) {
+			if (error) *error = query.lastError().message();
+			return false;
+		}
+		return true;
+	}
+
+	Statement statement;
+	statement.sql = sql;
+	statement.values = values;
+	QMutexLocker locker(&_instance->_mutex);
+	_instance->_queue.enqueue(statement);
+	_instance->_queued.wakeAll();
+	return true;
+}
+
+void DatabaseWriter::flushFor(const QString &sql)
+{
+	if (_instance && ResultsCache::dependsOnUserData(sql)) flush();
+}
+
+void DatabaseWriter::flush()
+{
+	if (!_instance) return;
+	QMutexLocker locker(&_instance->_mutex);
+	while (!_instance->_queue.isEmpty() || _instance->_committing)
+		_instance->_committed.wait(&_instance->_mutex);
+}
+
+bool DatabaseWriter::apply(SQLite::Connection &connection, const QQueue<Statement> &statements)
+{
+	if (!connection.transaction()) {
+		qCritical("Database writer cannot start transaction: %s", connection.lastError().message().toUtf8().constData());
+		return false;
+	}
+	SQLite::Query query(&connection);
+	foreach (const Statement &statement, statements) {
+		bool ok = query.prepare(statement.sql);
+		foreach (const QVariant &value, statement.values) ok = ok && bindVariant(query, value);
+		// A failing statement does not prevent the others from being applied,
+		// as they would have been if executed directly
+		if (!ok || !query.exec()) qCritical("Database writer error: %s (%s)", query.lastError().message().toUtf8().constData(), statement.sql.toUtf8().constData());
+	}
+	query.clear();
+	if (!connection.commit()) {
+		qCritical("Database writer cannot commit: %s", connection.lastError().message().toUtf8().constData());
+		connection.rollback();
+		return false;
+	}
+	++_uncheckpointed;
+	return true;
+}
+
+void DatabaseWriter::checkpoint(SQLite::Connection &connection)
+{
+	// Passive checkpoints never wait for readers
+	if (!connection.exec("pragma wal_checkpoint(PASSIVE)"))
+		qWarning("Database writer checkpoint failed: %s", connection.lastError().message().toUtf8().constData());
+	_uncheckpointed = 0;
+}
+
+void DatabaseWriter::run()
+{
+	SQLite::Connection connection;
+	if (!connection.connect(_dbFile, _flags)) {
+		qCritical("Database writer cannot open database: %s", connection.lastError().message().toUtf8().constData());
+	}
+	// The writer checkpoints by itself between bursts, so its commits never
+	// have to. Other connections keep automatic checkpoints for their own
+	// writes.
+	else if (_flags & SQLite::Connection::WAL) connection.exec("pragma wal_autocheckpoint=0");
+
+	QMutexLocker locker(&_mutex);
+	while (true) {
+		if (_queue.isEmpty()) {
+			if (_stop) break;
+			if (!_queued.wait(&_mutex, CHECKPOINT_DELAY) && _uncheckpointed && (_flags & SQLite::Connection::WAL)) {
+				locker.unlock();
+				checkpoint(connection);
+				locker.relock();
+			}
+			continue;
+		}
+
+		QQueue<Statement> statements(_queue);
+		_queue.clear();
+		_committing = statements.size();
+		locker.unlock();
+		if (connection.connected()) apply(connection, statements);
+		if (_uncheckpointed >= CHECKPOINT_TRANSACTIONS && (_flags & SQLite::Connection::WAL)) checkpoint(connection);
+		locker.relock();
+		_committing = 0;
+		_committed.wakeAll();
+	}
+	locker.unlock();
+
+	if (connection.connected()) {
+		if (_uncheckpointed && (_flags & SQLite::Connection::WAL)) checkpoint(connection);
+		connection.close();
+	}
+}
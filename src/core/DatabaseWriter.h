@@ -0,0 +1,104 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_DATABASEWRITER_H
+#define __CORE_DATABASEWRITER_H
+
+#include "sqlite/Connection.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVariant>
+
+/**
+ * Single thread applying user data mutations to the user database, used
+ * when the database is in WAL mode.
+ *
+ * Statements are queued by exec() and applied in order by the writer
+ * thread on its own connection. All the statements queued at a given time
+ * are committed in a single transaction, so a burst of updates costs only
+ * one commit. Between bursts, the writer checkpoints the WAL back into the
+ * database file so it does not grow unbounded.
+ *
+ * Mutations are applied asynchronously: code that needs to read data it
+ * has just written from another connection must call flush() first.
+ */
+class DatabaseWriter : public QThread
+{
+	Q_OBJECT
+private:
+	struct Statement
+	{
+		QString sql;
+		QVariantList values;
+	};
+
+	static DatabaseWriter *_instance;
+
+	QString _dbFile;
+	SQLite::Connection::OpenFlags _flags;
+	QMutex _mutex;
+	/// Signaled when statements are queued or when stopping
+	QWaitCondition _queued;
+	/// Signaled when all the queued statements are committed
+	QWaitCondition _committed;
+	QQueue<Statement> _queue;
+	/// Number of statements being committed
+	int _committing;
+	/// Number of transactions committed since the last checkpoint
+	int _uncheckpointed;
+	bool _stop;
+
+	DatabaseWriter(const QString &dbFile, SQLite::Connection::OpenFlags flags);
+	bool apply(SQLite::Connection &connection, const QQueue<Statement> &statements);
+	void checkpoint(SQLite::Connection &connection);
+
+protected:
+	void run();
+
+public:
+	/**
+	 * Starts the writer on the database file given as parameter. flags
+	 * are the flags of the writer connection, and should match those of
+	 * the other connections to the database.
+	 */
+	static bool start(const QString &dbFile, SQLite::Connection::OpenFlags flags = SQLite::Connection::WAL);
+	/// Applies all pending statements and stops the writer
+	static void stop();
+	static bool running() { return _instance != 0; }
+
+	/**
+	 * Queues a statement to the writer, with the values to bind to its
+	 * parameters. If the writer is not running, the statement is executed
+	 * immediately on the main connection instead. Returns false if the
+	 * statement could not be executed, in which case error, if given, is
+	 * set to the error message - errors of queued statements are only
+	 * reported in the log.
+	 */
+	static bool exec(const QString &sql, const QVariantList &values = QVariantList(), QString *error = 0);
+	/// Blocks until all the queued statements are committed
+	static void flush();
+	/**
+	 * Flushes the writer if sql reads user data, so that it sees all the
+	 * changes queued so far. Must be called before running such queries.
+	 */
+	static void flushFor(const QString &sql);
+};
+
+#endif
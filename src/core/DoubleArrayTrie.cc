@@ -0,0 +1,393 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/DoubleArrayTrie.h"
+
+#include <QVector>
+#include <QSet>
+#include <QPair>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+#define TRIE_MAGIC "TJDA"
+#define TRIE_VERSION 2
+#define TRIE_BYTE_ORDER 0x01020304
+/// Check of the units that are not used by any node
+#define FREE_UNIT -1
+/// Check of the root, which is not the child of any node
+#define ROOT_UNIT -2
+
+/**
+ * Builds the arrays of a DoubleArrayTrie from a sorted list of keys.
+ */
+class DoubleArrayTrieBuilder
+{
+public:
+	QVector<DoubleArrayTrie::Unit> units;
+	QVector<quint32> values;
+	QVector<quint16> codes;
+	QVector<const QString *> keys;
+	QVector<const QList<quint32> *> keyValues;
+	/// Units before this one are all used
+	int nextCheckPos;
+	/// Highest unit used so far
+	int lastUsed;
+
+	DoubleArrayTrieBuilder() : codes(DoubleArrayTrie::AlphabetSize, 0), nextCheckPos(0), lastUsed(0) {}
+
+	void reserve(int size);
+	void assignCodes();
+	int findBase(const QVector<int> &children, int maxCode);
+	void insert(int node, int begin, int end, int depth);
+};
+
+void DoubleArrayTrieBuilder::reserve(int size)
+{
+	if (size <= units.size()) return;
+	int oldSize = units.size();
+	units.resize(qMax(size, oldSize * 2));
+	for (int i = oldSize; i < units.size(); i++) {
+		units[i].base = 0;
+		units[i].check = FREE_UNIT;
+	}
+}
+
+static bool countGreaterThan(const QPair<int, int> &c1, const QPair<int, int> &c2)
+{
+	return c1.first > c2.first;
+}
+
+/**
+ * Gives the smallest codes to the most frequent characters, so the
+ * children of busy nodes are packed together.
+ */
+void DoubleArrayTrieBuilder::assignCodes()
+{
+	QVector<int> counts(DoubleArrayTrie::AlphabetSize, 0);
+	foreach (const QString *key, keys)
+		for (int i = 0; i < key->size(); i++) ++counts[key->at(i).unicode()];
+	QList<QPair<int, int> > used;
+	for (int i = 0; i < counts.size(); i++)
+		if (counts[i]) used << QPair<int, int>(counts[i], i);
+	qStableSort(used.begin(), used.end(), countGreaterThan);
+	// Code 0 marks the end of keys
+	for (int i = 0; i < used.size(); i++) codes[used[i].second] = i + 1;
+}
+
+/**
+ * Finds a base for which all the children codes fall on free units.
+ */
+int DoubleArrayTrieBuilder::findBase(const QVector<int> &children, int maxCode)
+{
+	int pos = qMax(children[0] + 1, nextCheckPos) - 1;
+	int nonFree = 0;
+	bool first = true;
+	while (true) {
+		++pos;
+		reserve(pos + 1);
+		if (units[pos].check != FREE_UNIT) {
+			++nonFree;
+			continue;
+		}
+		else if (first) {
+			nextCheckPos = pos;
+			first = false;
+		}
+		int base = pos - children[0];
+		reserve(base + maxCode + 1);
+		bool ok = true;
+		for (int i = 1; i < children.size() && ok; i++)
+			if (units[base + children[i]].check != FREE_UNIT) ok = false;
+		if (!ok) continue;
+		// Skip the beginning of the array once it is almost full
+		if (nonFree >= (pos - nextCheckPos + 1) * 0.95) nextCheckPos = pos;
+		return base;
+	}
+}
+
+/**
+ * Inserts the keys of the range [begin, end), which share their first depth
+ * characters, as children of node.
+ */
+void DoubleArrayTrieBuilder::insert(int node, int begin, int end, int depth)
+{
+	// Keys being sorted, keys ending at depth come first and keys sharing
+	// their next character are contiguous
+	QVector<int> children, starts;
+	int maxCode = 0;
+	for (int i = begin; i < end; i++) {
+		const QString &key = *keys[i];
+		int code = depth < key.size() ? codes[key[depth].unicode()] : 0;
+		if (children.isEmpty() || children.last() != code) {
+			children << code;
+			starts << i;
+			maxCode = qMax(maxCode, code);
+		}
+	}
+	starts << end;
+
+	int base = findBase(children, maxCode);
+	units[node].base = base;
+	// Reserve all the children before inserting their own children
+	foreach (int code, children) {
+		units[base + code].check = node;
+		lastUsed = qMax(lastUsed, base + code);
+	}
+	for (int i = 0; i < children.size(); i++) {
+		int child = base + children[i];
+		if (children[i] == 0) {
+			const QList<quint32> &vals = *keyValues[starts[i]];
+			units[child].base = values.size();
+			values << vals.size();
+			foreach (quint32 val, vals) values << val;
+		}
+		else insert(child, starts[i], starts[i + 1], depth + 1);
+	}
+}
+
+DoubleArrayTrie::DoubleArrayTrie() : _header(0), _codes(0), _units(0), _values(0), _nbUnits(0), _nbValues(0)
+{
+}
+
+DoubleArrayTrie::~DoubleArrayTrie()
+{
+	clear();
+}
+
+void DoubleArrayTrie::clear()
+{
+	_header = 0;
+	_codes = 0;
+	_units = 0;
+	_values = 0;
+	_nbUnits = _nbValues = 0;
+	_data.clear();
+	if (_file.isOpen()) _file.close();
+}
+
+bool DoubleArrayTrie::setData(const uchar *data, qint64 size)
+{
+	if (size < (qint64)(sizeof(Header) + AlphabetSize * sizeof(quint16))) return false;
+	const Header *header = reinterpret_cast<const Header *>(data);
+	if (qstrncmp(header->magic, TRIE_MAGIC, 4) || header->version != TRIE_VERSION || header->byteOrder != TRIE_BYTE_ORDER) return false;
+	if (header->nbUnits == 0 || size != (qint64)(sizeof(Header) + AlphabetSize * sizeof(quint16) + header->nbUnits * sizeof(Unit) + header->nbValues * sizeof(quint32))) return false;
+	_header = header;
+	_codes = reinterpret_cast<const quint16 *>(data + sizeof(Header));
+	_units = reinterpret_cast<const Unit *>(_codes + AlphabetSize);
+	_values = reinterpret_cast<const quint32 *>(_units + header->nbUnits);
+	_nbUnits = header->nbUnits;
+	_nbValues = header->nbValues;
+	return true;
+}
+
+bool DoubleArrayTrie::build(const QMap<QString, QList<quint32> > &entries, quint32 revision, quint32 sourceVersion)
+{
+	clear();
+	DoubleArrayTrieBuilder builder;
+	// QMap keys are sorted by UTF-16 code units, as the builder expects
+	for (QMap<QString, QList<quint32> >::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+		if (it.key().isEmpty()) continue;
+		builder.keys << &it.key();
+		builder.keyValues << &it.value();
+	}
+	builder.assignCodes();
+	builder.reserve(1024);
+	builder.units[0].check = ROOT_UNIT;
+	builder.nextCheckPos = 1;
+	if (!builder.keys.isEmpty()) builder.insert(0, 0, builder.keys.size(), 0);
+	int nbUnits = builder.lastUsed + 1;
+
+	Header header;
+	memcpy(header.magic, TRIE_MAGIC, 4);
+	header.version = TRIE_VERSION;
+	header.byteOrder = TRIE_BYTE_ORDER;
+	header.nbKeys = builder.keys.size();
+	header.nbUnits = nbUnits;
+	header.nbValues = builder.values.size();
+	header.revision = revision;
+	header.sourceVersion = sourceVersion;
+	_data.reserve(sizeof(Header) + AlphabetSize * sizeof(quint16) + nbUnits * sizeof(Unit) + builder.values.size() * sizeof(quint32));
+	_data.append(reinterpret_cast<const char *>(&header), sizeof(Header));
+	_data.append(reinterpret_cast<const char *>(builder.codes.constData()), AlphabetSize * sizeof(quint16));
+	_data.append(reinterpret_cast<const char *>(builder.units.constData()), nbUnits * sizeof(Unit));
+	_data.append(reinterpret_cast<const char *>(builder.values.constData()), builder.values.size() * sizeof(quint32));
+	return setData(reinterpret_cast<const uchar *>(_data.constData()), _data.size());
+}
+
+qint64 DoubleArrayTrie::dataSize() const
+{
+	if (!_header) return 0;
+	return sizeof(Header) + AlphabetSize * sizeof(quint16) + _nbUnits * sizeof(Unit) + _nbValues * sizeof(quint32);
+}
+
+bool DoubleArrayTrie::save(const QString &fileName) const
+{
+	if (!_header) return false;
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+	qint64 size = dataSize();
+	return file.write(reinterpret_cast<const char *>(_header), size) == size;
+}
+
+bool DoubleArrayTrie::load(const QString &fileName, quint32 revision, quint32 sourceVersion)
+{
+	clear();
+	_file.setFileName(fileName);
+	if (!_file.open(QIODevice::ReadOnly)) return false;
+	uchar *data = _file.map(0, _file.size());
+	if (!data || !setData(data, _file.size()) || _header->revision != revision || _header->sourceVersion != sourceVersion) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Returns true if a key ends at node, in which case match is set.
+ */
+inline bool DoubleArrayTrie::terminal(quint32 node, int length, Match &match) const
+{
+	quint32 end = _units[node].base;
+	if (end >= _nbUnits || _units[end].check != (qint32)node) return false;
+	quint32 offset = _units[end].base;
+	// Values are checked to be within the array in case the file is corrupted
+	if (offset >= _nbValues || _values[offset] >= _nbValues - offset) return false;
+	match.length = length;
+	match.values = _values + offset + 1;
+	match.valuesCount = _values[offset];
+	return true;
+}
+
+int DoubleArrayTrie::commonPrefixSearch(const QChar *text, int length, Match *results, int maxResults) const
+{
+	if (!_header) return 0;
+	int count = 0;
+	quint32 node = 0;
+	for (int i = 0; i < length && count < maxResults; i++) {
+		quint16 code = _codes[text[i].unicode()];
+		if (!code) break;
+		quint32 next = (quint32)_units[node].base + code;
+		if (next >= _nbUnits || _units[next].check != (qint32)node) break;
+		node = next;
+		if (terminal(node, i + 1, results[count])) ++count;
+	}
+	return count;
+}
+
+bool DoubleArrayTrie::longestPrefixSearch(const QChar *text, int length, Match &result) const
+{
+	if (!_header) return false;
+	bool found = false;
+	quint32 node = 0;
+	for (int i = 0; i < length; i++) {
+		quint16 code = _codes[text[i].unicode()];
+		if (!code) break;
+		quint32 next = (quint32)_units[node].base + code;
+		if (next >= _nbUnits || _units[next].check != (qint32)node) break;
+		node = next;
+		if (terminal(node, i + 1, result)) found = true;
+	}
+	return found;
+}
+
+QList<quint32> DoubleArrayTrie::values(const QString &key) const
+{
+	QList<quint32> ret;
+	Match match;
+	if (key.isEmpty() || !longestPrefixSearch(key.constData(), key.size(), match) || match.length != key.size()) return ret;
+	for (int i = 0; i < match.valuesCount; i++) ret << match.values[i];
+	return ret;
+}
+
+struct DoubleArrayTrie::FuzzyWalk
+{
+	QString key;
+	int maxDistance;
+	/// Characters to follow, along with their codes
+	QVector<QPair<QChar, quint16> > alphabet;
+	/// Levenshtein distances of the prefix of each depth to all the prefixes of key
+	QVector<int> rows;
+	QString prefix;
+	int maxResults;
+	QList<FuzzyMatch> results;
+};
+
+void DoubleArrayTrie::fuzzyWalk(quint32 node, int depth, FuzzyWalk &walk) const
+{
+	int width = walk.key.size() + 1;
+	const int *row = walk.rows.constData() + depth * width;
+	Match match;
+	// Closer keys have been found by the previous walks
+	if (row[width - 1] == walk.maxDistance && terminal(node, depth, match)) {
+		FuzzyMatch fuzzyMatch;
+		fuzzyMatch.key = walk.prefix;
+		fuzzyMatch.distance = row[width - 1];
+		fuzzyMatch.values = match.values;
+		fuzzyMatch.valuesCount = match.valuesCount;
+		walk.results << fuzzyMatch;
+	}
+	// Keys longer than key + maxDistance are too far anyway
+	if (depth >= walk.key.size() + walk.maxDistance) return;
+
+	int *nextRow = walk.rows.data() + (depth + 1) * width;
+	for (int i = 0; i < walk.alphabet.size() && walk.results.size() < walk.maxResults; i++) {
+		quint32 next = (quint32)_units[node].base + walk.alphabet[i].second;
+		if (next >= _nbUnits || _units[next].check != (qint32)node) continue;
+		QChar c(walk.alphabet[i].first);
+		nextRow[0] = row[0] + 1;
+		int rowMin = nextRow[0];
+		for (int j = 1; j < width; j++) {
+			nextRow[j] = qMin(qMin(row[j] + 1, nextRow[j - 1] + 1), row[j - 1] + (walk.key[j - 1] == c ? 0 : 1));
+			rowMin = qMin(rowMin, nextRow[j]);
+		}
+		if (rowMin > walk.maxDistance) continue;
+		walk.prefix += c;
+		fuzzyWalk(next, depth + 1, walk);
+		walk.prefix.chop(1);
+	}
+}
+
+QList<DoubleArrayTrie::FuzzyMatch> DoubleArrayTrie::fuzzySearch(const QString &key, int maxDistance, const QString &alphabet, int maxResults) const
+{
+	if (!_header || key.isEmpty()) return QList<FuzzyMatch>();
+	FuzzyWalk walk;
+	walk.key = key;
+	walk.maxResults = maxResults;
+	// Characters that are not part of any key cannot be followed
+	QSet<QChar> seen;
+	for (int i = 0; i < alphabet.size(); i++) {
+		quint16 code = _codes[alphabet[i].unicode()];
+		if (!code || seen.contains(alphabet[i])) continue;
+		seen << alphabet[i];
+		walk.alphabet << QPair<QChar, quint16>(alphabet[i], code);
+	}
+	int width = key.size() + 1;
+	walk.rows.resize(width * (key.size() + maxDistance + 1));
+	for (int j = 0; j < width; j++) walk.rows[j] = j;
+	for (walk.maxDistance = 0; walk.maxDistance <= maxDistance && walk.results.size() < maxResults; walk.maxDistance++)
+		fuzzyWalk(0, 0, walk);
+	return walk.results;
+}
+
+QString DoubleArrayTrie::alphabet() const
+{
+	QString ret;
+	if (!_header) return ret;
+	for (int i = 0; i < AlphabetSize; i++) if (_codes[i]) ret += QChar((ushort)i);
+	return ret;
+}
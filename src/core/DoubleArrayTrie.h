@@ -0,0 +1,163 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_DOUBLEARRAYTRIE_H
+#define __CORE_DOUBLEARRAYTRIE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include <QList>
+#include <QFile>
+
+/**
+ * A read-only dictionary of strings stored as a double-array trie.
+ *
+ * Every key is associated with a list of 32-bit values. Keys are looked up
+ * by UTF-16 code units, which are first translated into a dense alphabet
+ * made of the characters actually used by the keys. The trie is built in
+ * its serialized form, which is used as-is: a trie saved into a file is
+ * memory-mapped by load() and can be queried without being parsed.
+ *
+ * Lookups are thread-safe.
+ */
+class DoubleArrayTrie
+{
+public:
+	/// A key found at the beginning of a text
+	struct Match
+	{
+		/// Length of the key, in UTF-16 code units
+		int length;
+		/// Values associated with the key
+		const quint32 *values;
+		int valuesCount;
+	};
+
+	/// A key found by fuzzySearch()
+	struct FuzzyMatch
+	{
+		QString key;
+		/// Edit distance between the key and the searched string
+		int distance;
+		const quint32 *values;
+		int valuesCount;
+	};
+
+private:
+	struct Header
+	{
+		char magic[4];
+		quint32 version;
+		quint32 byteOrder;
+		quint32 nbKeys;
+		quint32 nbUnits;
+		quint32 nbValues;
+		/// Given by the builder of the trie, to tell which data it was built from
+		quint32 revision;
+		quint32 sourceVersion;
+	};
+	/// A node of the trie. Children of a node are at base + code, and
+	/// are identified by their check being the index of their parent.
+	/// The child of code 0 marks the end of a key, its base being the
+	/// offset of the values of the key.
+	struct Unit
+	{
+		qint32 base;
+		qint32 check;
+	};
+
+	QByteArray _data;
+	QFile _file;
+	const Header *_header;
+	const quint16 *_codes;
+	const Unit *_units;
+	const quint32 *_values;
+	quint32 _nbUnits;
+	quint32 _nbValues;
+
+	bool setData(const uchar *data, qint64 size);
+	inline bool terminal(quint32 node, int length, Match &match) const;
+	struct FuzzyWalk;
+	void fuzzyWalk(quint32 node, int depth, FuzzyWalk &walk) const;
+
+	friend class DoubleArrayTrieBuilder;
+
+	DoubleArrayTrie(const DoubleArrayTrie &);
+	DoubleArrayTrie &operator=(const DoubleArrayTrie &);
+
+public:
+	/// Number of distinct UTF-16 code units
+	static const int AlphabetSize = 65536;
+
+	DoubleArrayTrie();
+	~DoubleArrayTrie();
+
+	/**
+	 * Builds the trie from the given keys and their values. Empty keys
+	 * are ignored. revision and sourceVersion identify the data the trie
+	 * is built from, and are stored with it.
+	 */
+	bool build(const QMap<QString, QList<quint32> > &entries, quint32 revision = 0, quint32 sourceVersion = 0);
+	/// Writes the trie into fileName, in the format expected by load()
+	bool save(const QString &fileName) const;
+	/**
+	 * Memory-maps a trie written by save(). Returns false if the file
+	 * cannot be mapped, is not a valid trie or has not been built with the
+	 * given revision and sourceVersion, leaving the trie empty. The trie
+	 * must then be rebuilt from its source.
+	 */
+	bool load(const QString &fileName, quint32 revision = 0, quint32 sourceVersion = 0);
+	void clear();
+
+	bool isEmpty() const { return !_header; }
+	/// Number of keys of the trie
+	int size() const { return _header ? _header->nbKeys : 0; }
+	quint32 revision() const { return _header ? _header->revision : 0; }
+	quint32 sourceVersion() const { return _header ? _header->sourceVersion : 0; }
+	/// Size of the serialized trie, in bytes
+	qint64 dataSize() const;
+
+	/**
+	 * Looks up all the keys that are prefixes of text, by increasing
+	 * length. At most maxResults matches are written into results and
+	 * their number is returned.
+	 */
+	int commonPrefixSearch(const QChar *text, int length, Match *results, int maxResults) const;
+	/// Looks up the longest key that is a prefix of text
+	bool longestPrefixSearch(const QChar *text, int length, Match &result) const;
+	/// Returns the values of key, or an empty list if it is not part of the trie
+	QList<quint32> values(const QString &key) const;
+
+	/// Returns the characters used by the keys of the trie
+	QString alphabet() const;
+
+	/**
+	 * Returns the keys that are within maxDistance insertions, deletions
+	 * or substitutions of key, by increasing distance. The trie is walked
+	 * depth-first while the Levenshtein distances of the current prefix
+	 * are computed incrementally, and branches that cannot get within
+	 * the distance anymore are pruned, like a Levenshtein automaton would.
+	 * Only the characters of alphabet are followed, which bounds the cost
+	 * of visiting a node. At most maxResults keys are returned: the trie
+	 * is walked once per distance, so that the closest keys are never
+	 * dropped in favor of farther ones.
+	 */
+	QList<FuzzyMatch> fuzzySearch(const QString &key, int maxDistance, const QString &alphabet, int maxResults = 1000) const;
+};
+
+#endif
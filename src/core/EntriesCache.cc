@@ -79,6 +79,26 @@ EntryLoader *EntriesCache::loaderFor(EntryType type)
 	return _loaders[type];
 }
 
+void EntriesCache::prefetch(const QList<EntryRef> &refs)
+{
+	// Prefetching is only a hint and is called from the GUI thread: if an entry
+	// is being loaded, skip it rather than waiting for the load to complete.
+	// Holding the lock ensures no entry gets loaded by the meantime.
+	if (refs.isEmpty() || !_loadedEntriesMutex.tryLock()) return;
+	EntryLoader *firstLoader = loaderFor(refs[0].type());
+	if (!_loadedEntries.contains(refs[0]) && firstLoader && !firstLoader->isPrefetched(refs[0].type(), refs[0].id())) {
+		QMap<EntryType, QList<EntryId> > ids;
+		foreach (const EntryRef &ref, refs)
+			if (!_loadedEntries.contains(ref)) ids[ref.type()] << ref.id();
+		QMap<EntryType, QList<EntryId> >::const_iterator it;
+		for (it = ids.constBegin(); it != ids.constEnd(); ++it) {
+			EntryLoader *loader = loaderFor(it.key());
+			if (loader) loader->prefetchMiscData(it.key(), it.value());
+		}
+	}
+	_loadedEntriesMutex.unlock();
+}
+
 EntryPointer EntriesCache::_get(EntryType type, EntryId id)
 {
 	EntryRef key(type, id);
@@ -90,6 +90,18 @@ public:
 	bool removeLoader(EntryType type);
 	EntryLoader *loaderFor(EntryType type);
 
+	/**
+	 * Fetches in advance the user data of the entries of refs that are not
+	 * loaded yet, so that loading them afterwards requires no user database
+	 * query. Useful before loading a page of results.
+	 *
+	 * Nothing is done if the first entry of refs is loaded or has already
+	 * been prefetched, so this can be called before loading every entry.
+	 * Nothing is done either while an entry is being loaded, so that this
+	 * never blocks the GUI thread.
+	 */
+	void prefetch(const QList<EntryRef> &refs);
+
 	/**
 	 * The size of the cache can be modified in real-time through this value.
 	 */
@@ -135,6 +147,7 @@ public:
 	friend QDataStream &operator>>(QDataStream &in, EntryRef &ref);
 };
 Q_DECLARE_METATYPE(EntryRef)
+Q_DECLARE_TYPEINFO(EntryRef, Q_MOVABLE_TYPE);
 
 inline uint qHash(const EntryRef &key)
 {
@@ -18,10 +18,13 @@
 #include "core/Tag.h"
 #include "core/Entry.h"
 #include "core/Database.h"
+#include "core/DatabaseWriter.h"
 #include "sqlite/Query.h"
 
 #include <QDebug>
 
+QAtomicInt Entry::_changesCount;
+
 Entry::Entry(EntryType type, EntryId id) : QObject(0), _type(type), _id(id), _dateAdded(), _dateLastTrain(), _dateLastMistake(), _nbTrained(0), _nbSuccess(0), _score(0), _frequency(-1)
 {
 }
@@ -48,11 +51,10 @@ void Entry::updateTrainingData()
 	QString qString;
 	if (!trained()) removeFromTraining();
 	else {
-	        SQLite::Query query(Database::connection());
-
 		qString = "insert or replace into training values(" + QString::number(type()) + ", " + QString::number(id()) + ", " + QString::number(score()) + ", " + dateToString(dateAdded()) + ", " + dateToString(dateLastTrain()) + ", " + QString::number(nbTrained()) + ", " + QString::number(nbSuccess()) + ", " + dateToString(dateLastMistake()) + ")";
-		if (!query.exec(qString)) qCritical() << "Error executing query: " << query.lastError().message();
-		emit entryChanged(this);
+		QString error;
+		if (!DatabaseWriter::exec(qString, QVariantList(), &error)) qCritical() << "Error executing query: " << error;
+		emitChanged();
 	}
 }
 
@@ -113,9 +115,9 @@ void Entry::removeFromTraining()
 	_score = 0;
 	// And delete the entry row from the training table
 	QString qString = QString("delete from training where type = %1 and id = %2").arg(type()).arg(id());
-	SQLite::Query query(Database::connection());
-	if (!query.exec(qString)) qCritical() << "Error executing query: " << query.lastError().message();
-	emit entryChanged(this);
+	QString error;
+	if (!DatabaseWriter::exec(qString, QVariantList(), &error)) qCritical() << "Error executing query: " << error;
+	emitChanged();
 }
 
 void Entry::setAlreadyKnown()
@@ -139,7 +141,7 @@ const Entry::Note &Entry::addNote(const QString &note)
 	Note newNote(note);
 	newNote.writeToDB(this);
 	_notes << newNote;
-	emit entryChanged(this);
+	emitChanged();
 	return _notes.last();
 }
 
@@ -147,14 +149,14 @@ void Entry::updateNote(Note &note, const QString &noteText)
 {
 	note.update(noteText);
 	note.writeToDB(this);
-	emit entryChanged(this);
+	emitChanged();
 }
 
 void Entry::deleteNote(Note &note)
 {
 	note.deleteFromDB(this);
 	_notes.removeOne(note);
-	emit entryChanged(this);
+	emitChanged();
 }
 
 void Entry::Note::update(const QString &newNote)
@@ -167,14 +169,14 @@ void Entry::addToList (quint64 listId)
 {
 	if (!_lists.contains(listId)) {
 		_lists << listId;
-		emit entryChanged(this);
+		emitChanged();
 	}
 }
 
 void Entry::removeFromList (quint64 listId)
 {
 	if (_lists.remove(listId))
-		emit entryChanged(this);
+		emitChanged();
 }
 
 void Entry::Note::writeToDB(const Entry *entry)
@@ -221,6 +223,7 @@ void Entry::setTags(const QStringList &tags)
 {
 	SQLite::Query query(Database::connection());
 	if (!query.exec(QString("delete from taggedEntries where type = %1 and id = %2").arg(type()).arg(id()))) qCritical() << "Error executing query: " << query.lastError().message();
+	else Tag::index().entryUntagged(type(), id());
 	_tags.clear();
 	addTags(tags);
 }
@@ -238,10 +241,14 @@ void Entry::addTags(const QStringList &tags)
 		// Do not add tags that we already have
 		if (_tags.contains(t)) continue;
 		query.bindValue(t.id());
-		if (!query.exec()) qCritical() << "Error executing query: " << query.lastError().message();
+		if (!query.exec()) {
+			qCritical() << "Error executing query: " << query.lastError().message();
+			continue;
+		}
+		Tag::index().entryTagged(type(), id(), t.id());
 		_tags << t;
 	}
-	emit entryChanged(this);
+	emitChanged();
 }
 
 bool Entry::Note::operator==(const Note &note)
@@ -24,6 +24,7 @@
 #include <QSet>
 #include <QObject>
 #include <QSharedPointer>
+#include <QAtomicInt>
 
 #include "core/Tag.h"
 
@@ -68,6 +69,8 @@ public:
 	};
 
 private:
+	static QAtomicInt _changesCount;
+
 	EntryType _type;
 	EntryId _id;
 	QDateTime _dateAdded;
@@ -125,7 +128,13 @@ public:
 	 * This may be needed if something around the entry has changed
 	 * that may affect it.
 	 */
-	void emitChanged() { emit entryChanged(this); }
+	void emitChanged() { _changesCount.ref(); emit entryChanged(this); }
+	/**
+	 * Number of times an entry has changed since the program started.
+	 * Useful to know whether data that depends on several entries is
+	 * still valid.
+	 */
+	static int changesCount() { return _changesCount; }
 	/**
 	 * An entry is considered to be under training if it has been added to the
 	 * training list at some point.
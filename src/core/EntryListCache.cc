@@ -19,19 +19,23 @@
 #include "Database.h"
 
 EntryListCache *EntryListCache::_instance = 0;
+PreferenceItem<int> EntryListCache::nodesCacheSize("", "listNodesCacheSize", 50000);
 
-EntryListCache::EntryListCache() : _dbAccess(LISTS_DB_TABLES_PREFIX)
+EntryListCache::EntryListCache() : _dbAccess(LISTS_DB_TABLES_PREFIX), _trimScheduled(false)
 {
-	if (!_connection.connect(Database::userDBFile())) {
+	if (!_connection.connect(Database::userDBFile(), Database::userDBFlags())) {
 		qFatal("EntryListCache cannot connect to user database!");
 	}
 	_dbAccess.prepareForConnection(&_connection);
 	ownerQuery.useWith(&_connection);
 	goUpQuery.useWith(&_connection);
 	listFromRootQuery.useWith(&_connection);
+	listsByLabelQuery.useWith(&_connection);
 	ownerQuery.prepare(QString("select rowid from %1 where type = 0 and id = ?").arg(_dbAccess.tableName()));
 	goUpQuery.prepare(QString("select parent, leftSize, right from %1 where rowid = ?").arg(_dbAccess.tableName()));
 	listFromRootQuery.prepare(QString("select listId from %1Roots where rootId = ?").arg(_dbAccess.tableName()));
+	listsByLabelQuery.prepare(QString("select listId from %1Roots where label = ? collate nocase").arg(_dbAccess.tableName()));
+	connect(&nodesCacheSize, SIGNAL(valueChanged(QVariant)), this, SLOT(_trimMemCache()));
 }
 
 EntryListCache::~EntryListCache()
@@ -61,6 +65,7 @@ EntryList *EntryListCache::_get(quint64 id)
 		// so no need to bother about non-existing entries
 		_cachedLists.insert(id, new EntryList(&_dbAccess, id));
 	}
+	scheduleTrim();
 	// Will always git (see above)
 	return _cachedLists[id];
 }
@@ -74,6 +79,30 @@ EntryList *EntryListCache::_newList()
 	return ret;
 }
 
+void EntryListCache::scheduleTrim()
+{
+	if (_trimScheduled || EntryList::TreeType::totalLoadedNodes() <= (quint32)nodesCacheSize.value()) return;
+	// Callers may still hold references to nodes, so trim from the event loop
+	_trimScheduled = true;
+	QMetaObject::invokeMethod(this, "_trimMemCache", Qt::QueuedConnection);
+}
+
+void EntryListCache::_trimMemCache()
+{
+	QMutexLocker ml(&_cacheLock);
+	_trimScheduled = false;
+	quint32 total = EntryList::TreeType::totalLoadedNodes();
+	quint32 maxNodes = qMax(nodesCacheSize.value(), 0);
+	if (total <= maxNodes) return;
+	// Leave some room so we do not need to trim again too soon, and spread
+	// the budget among the lists according to how much they use.
+	quint64 target = maxNodes * 3 / 4;
+	foreach (EntryList *list, _cachedLists) {
+		quint32 loaded = list->tree()->loadedNodes();
+		list->tree()->trimMemCache(loaded * target / total);
+	}
+}
+
 void EntryListCache::_clearListCache(quint64 id)
 {
 	_cachedLists.remove(id);
@@ -145,3 +174,14 @@ void EntryListCache::_clearOwnerCache()
 {
 	_cachedParents.clear();
 }
+
+QSet<quint32> EntryListCache::_listsByLabel(const QString &label)
+{
+	QSet<quint32> ret;
+	QMutexLocker ml(&_cacheLock);
+	listsByLabelQuery.bindValue(label);
+	if (!listsByLabelQuery.exec()) return ret;
+	while (listsByLabelQuery.next()) ret << listsByLabelQuery.valueUInt(0);
+	listsByLabelQuery.reset();
+	return ret;
+}
@@ -20,8 +20,10 @@
 
 #include "core/EntriesCache.h"
 #include "core/EntryListDB.h"
+#include "core/Preferences.h"
 
 #include <QPair>
+#include <QObject>
 
 /**
  * A cache class that is responsible for providing information about the
@@ -29,16 +31,22 @@
  * here.
  *
  * Methods of this class are thread-safe.
+ *
+ * The number of list nodes kept in memory is bounded by nodesCacheSize.
+ * When it is exceeded, the least recently used nodes are unloaded from
+ * the event loop, where no node can be referenced by the code.
  */
-class EntryListCache {
+class EntryListCache : public QObject {
+	Q_OBJECT
 private:
 	static EntryListCache *_instance;
 	SQLite::Connection _connection;
-	SQLite::Query ownerQuery, goUpQuery, listFromRootQuery;
+	SQLite::Query ownerQuery, goUpQuery, listFromRootQuery, listsByLabelQuery;
 	EntryListDBAccess _dbAccess;
 	QMap<quint64, EntryList *> _cachedLists;
 	QMap<quint64, QPair<const EntryList *, quint32> > _cachedParents;
 	QMutex _cacheLock;
+	bool _trimScheduled;
 
 	EntryListCache();
 	~EntryListCache();
@@ -51,6 +59,11 @@ private:
 	quint64 _getRowIdFromIndex(const QPair<const EntryList *, quint32> &idx);
 	void _clearOwnerCache(quint64 id);
 	void _clearOwnerCache();
+	QSet<quint32> _listsByLabel(const QString &label);
+	void scheduleTrim();
+
+private slots:
+	void _trimMemCache();
 
 public:
 	/// Returns a reference to the unique instance of this class.
@@ -68,8 +81,19 @@ public:
 	static quint64 getRowIdFromIndex(const QPair<const EntryList *, quint32> &idx) { return instance()._getRowIdFromIndex(idx); }
 	static void clearOwnerCache(quint64 id) { instance()._clearOwnerCache(id); }
 	static void clearOwnerCache() { instance()._clearOwnerCache(); }
+	/// Returns the index of the lists every entry belongs to
+	static EntryListMembership &membership() { return instance()._dbAccess.membership(); }
+	/// Returns the ids of the lists which label matches label, case-insensitively
+	static QSet<quint32> listsByLabel(const QString &label) { return instance()._listsByLabel(label); }
 	/// Returns the database connection used by the entry list system
 	static SQLite::Connection *connection() { return &instance()._connection; }
+	/// Unloads list nodes from memory until nodesCacheSize is honored
+	static void trimMemCache() { instance()._trimMemCache(); }
+
+	/**
+	 * Maximum number of list nodes kept in memory, for all lists.
+	 */
+	static PreferenceItem<int> nodesCacheSize;
 };
 
 #endif
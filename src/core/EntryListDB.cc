@@ -17,6 +17,7 @@
 
 #include "core/EntryListDB.h"
 #include "core/EntryListCache.h"
+#include "sqlite/Query.h"
 
 template <> QString DBListEntry<EntryListData>::tableDataMembers()
 {
@@ -38,10 +39,156 @@ template <> void DBListEntry<EntryListData>::readDataValues(SQLite::Query &query
 	data.id = query.valueUInt(start++);
 }
 
-EntryListDBAccess::EntryListDBAccess(const QString &tableName, SQLite::Connection *connection) : DBList<EntryListData>(tableName, connection)
+EntryListMembership::EntryListMembership(EntryListDBAccess *dbAccess) : _dbAccess(dbAccess), _loaded(false)
 {
 }
 
+void EntryListMembership::addNodes(quint64 rowid, quint32 listId, const QHash<quint64, QPair<quint64, quint64> > &children, const QHash<quint64, EntryRef> &refs)
+{
+	// Iterate on the left child, recurse on the right one, so that the
+	// recursion depth stays within the height of the tree
+	while (rowid) {
+		_index[refs.value(rowid)].insert(rowid, listId);
+		const QPair<quint64, quint64> &nodeChildren = children[rowid];
+		if (nodeChildren.second) addNodes(nodeChildren.second, listId, children, refs);
+		rowid = nodeChildren.first;
+	}
+}
+
+bool EntryListMembership::load()
+{
+	if (_loaded) return true;
+	SQLite::Connection *connection = _dbAccess->connection();
+	if (!connection) return false;
+	SQLite::Query query(connection);
+
+	// Fetch the whole structure of the lists in one pass, and then walk each
+	// list from its root to know which list every node belongs to.
+	QHash<quint64, QPair<quint64, quint64> > children;
+	QHash<quint64, EntryRef> refs;
+	if (!query.exec(QString("select rowid, left, right, type, id from %1").arg(_dbAccess->tableName()))) return false;
+	while (query.next()) {
+		quint64 rowid = query.valueUInt64(0);
+		children[rowid] = QPair<quint64, quint64>(query.valueUInt64(1), query.valueUInt64(2));
+		refs[rowid] = EntryRef(query.valueUInt(3), query.valueUInt(4));
+	}
+	query.reset();
+
+	_index.clear();
+	if (!query.exec(QString("select listId, rootId from %1Roots where rootId != 0").arg(_dbAccess->tableName()))) return false;
+	while (query.next()) addNodes(query.valueUInt64(1), query.valueUInt(0), children, refs);
+	_loaded = true;
+	return true;
+}
+
+void EntryListMembership::nodeInserted(const EntryRef &ref, quint64 rowid, quint32 listId)
+{
+	QMutexLocker ml(&_lock);
+	// Nothing to do if the index is not loaded yet - it will include the node
+	if (!_loaded) return;
+	_index[ref].insert(rowid, listId);
+}
+
+void EntryListMembership::nodeRemoved(const EntryRef &ref, quint64 rowid)
+{
+	QMutexLocker ml(&_lock);
+	if (!_loaded) return;
+	QHash<EntryRef, QHash<quint64, quint32> >::iterator it(_index.find(ref));
+	if (it == _index.end()) return;
+	it.value().remove(rowid);
+	if (it.value().isEmpty()) _index.erase(it);
+}
+
+void EntryListMembership::invalidate()
+{
+	QMutexLocker ml(&_lock);
+	_index.clear();
+	_loaded = false;
+}
+
+QSet<quint64> EntryListMembership::nodes(const EntryRef &ref)
+{
+	QMutexLocker ml(&_lock);
+	if (!load()) return QSet<quint64>();
+	return _index.value(ref).keys().toSet();
+}
+
+QSet<quint32> EntryListMembership::lists(const EntryRef &ref)
+{
+	QMutexLocker ml(&_lock);
+	if (!load()) return QSet<quint32>();
+	return _index.value(ref).values().toSet();
+}
+
+bool EntryListMembership::contains(const EntryRef &ref, quint32 listId)
+{
+	QMutexLocker ml(&_lock);
+	if (!load()) return false;
+	QHash<EntryRef, QHash<quint64, quint32> >::const_iterator it(_index.constFind(ref));
+	if (it == _index.constEnd()) return false;
+	foreach (quint32 id, it.value()) if (id == listId) return true;
+	return false;
+}
+
+QSet<quint32> EntryListMembership::withSubLists(const QSet<quint32> &lists)
+{
+	QMutexLocker ml(&_lock);
+	QSet<quint32> ret(lists);
+	if (!load()) return ret;
+	// Lists can only be contained once, so each pass adds at least one level
+	// of sub-lists until no new list is found
+	int prevSize;
+	do {
+		prevSize = ret.size();
+		QHash<EntryRef, QHash<quint64, quint32> >::const_iterator it;
+		for (it = _index.constBegin(); it != _index.constEnd(); ++it) {
+			if (it.key().type() != 0 || ret.contains(it.key().id())) continue;
+			foreach (quint32 id, it.value()) if (ret.contains(id)) {
+				ret << it.key().id();
+				break;
+			}
+		}
+	} while (ret.size() != prevSize);
+	return ret;
+}
+
+QSet<EntryId> EntryListMembership::entries(EntryType type, const QSet<quint32> &lists)
+{
+	QMutexLocker ml(&_lock);
+	QSet<EntryId> ret;
+	if (!load()) return ret;
+	QHash<EntryRef, QHash<quint64, quint32> >::const_iterator it;
+	for (it = _index.constBegin(); it != _index.constEnd(); ++it) {
+		if (it.key().type() != type) continue;
+		foreach (quint32 id, it.value()) if (lists.contains(id)) {
+			ret << it.key().id();
+			break;
+		}
+	}
+	return ret;
+}
+
+QSet<EntryId> EntryListMembership::entries(EntryType type)
+{
+	QMutexLocker ml(&_lock);
+	QSet<EntryId> ret;
+	if (!load()) return ret;
+	QHash<EntryRef, QHash<quint64, quint32> >::const_iterator it;
+	for (it = _index.constBegin(); it != _index.constEnd(); ++it)
+		if (it.key().type() == type) ret << it.key().id();
+	return ret;
+}
+
+EntryListDBAccess::EntryListDBAccess(const QString &tableName, SQLite::Connection *connection) : DBList<EntryListData>(tableName, connection), _membership(this)
+{
+}
+
+bool EntryListDBAccess::prepareForConnection(SQLite::Connection *connection)
+{
+	_membership.invalidate();
+	return DBList<EntryListData>::prepareForConnection(connection);
+}
+
 bool EntryListDBAccess::createDataIndexes(SQLite::Connection *connection)
 {
 	if (!connection->exec(QString("CREATE INDEX idx_%1_type_id ON %1(type,id)").arg(tableName()))) return false;
@@ -53,7 +200,8 @@ bool EntryList::remove(int index)
 {
 	TreeType::Node *node = getNode(index);
 	if (!node) return false;
-	const EntryListData &data = node->value();
+	const EntryListData data = node->value();
+	quint64 rowid = node->rowId();
 	// We have to recursively erase the child list
 	if (data.isList()) {
 		EntryList *list = EntryListCache::get(data.id);
@@ -67,5 +215,45 @@ bool EntryList::remove(int index)
 		// Finally, delete the list
 		list->tree()->removeList();
 	}
-	return OrderedRBTree<OrderedRBDBTree<EntryListData> >::remove(index);
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::remove(index)) return false;
+	_dbAccess->membership().nodeRemoved(data.entryRef(), rowid);
+	return true;
+}
+
+bool EntryList::insert(const EntryListData &val, int index)
+{
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::insert(val, index)) return false;
+	_dbAccess->membership().nodeInserted(val.entryRef(), getNode(index)->rowId(), listId());
+	return true;
+}
+
+bool EntryList::insertBatch(const QList<EntryListData> &vals, int index)
+{
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::insertBatch(vals, index)) return false;
+	for (int i = 0; i < vals.size(); i++)
+		_dbAccess->membership().nodeInserted(vals[i].entryRef(), getNode(index + i)->rowId(), listId());
+	return true;
+}
+
+bool EntryList::insertNode(TreeType::Node *node, int index)
+{
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::insertNode(node, index)) return false;
+	_dbAccess->membership().nodeInserted(node->value().entryRef(), node->rowId(), listId());
+	return true;
+}
+
+bool EntryList::removeNode(TreeType::Node *node)
+{
+	quint64 rowid = node->rowId();
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::removeNode(node)) return false;
+	_dbAccess->membership().nodeRemoved(node->value().entryRef(), rowid);
+	return true;
+}
+
+bool EntryList::clear()
+{
+	if (!OrderedRBTree<OrderedRBDBTree<EntryListData> >::clear()) return false;
+	// Cheaper than tracking every removed node
+	_dbAccess->membership().invalidate();
+	return true;
 }
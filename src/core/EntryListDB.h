@@ -31,6 +31,10 @@
 #include "core/OrderedRBDBNode.h"
 #include "core/EntriesCache.h"
 
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+
 #define LISTS_DB_TABLES_PREFIX "lists"
 
 struct EntryListData {
@@ -47,23 +51,85 @@ template <> void DBListEntry<EntryListData>::readDataValues(SQLite::Query &query
 
 // Hide the complexity of template classes behind simple names...
 typedef DBListEntry<EntryListData> EntryListEntry;
+class EntryListDBAccess;
+
+/**
+ * In-memory index of the lists every entry belongs to. It is loaded in a
+ * single pass over the lists table the first time it is needed, and then
+ * kept up-to-date by EntryList as nodes are inserted and removed.
+ *
+ * Sub-lists are indexed too, using EntryRef(0, listId) as their key.
+ *
+ * Methods of this class are thread-safe.
+ */
+class EntryListMembership
+{
+private:
+	EntryListDBAccess *_dbAccess;
+	bool _loaded;
+	/// For each entry, rowids of the nodes that reference it along with
+	/// the id of the list that contains them
+	QHash<EntryRef, QHash<quint64, quint32> > _index;
+	QMutex _lock;
+
+	bool load();
+	void addNodes(quint64 rowid, quint32 listId, const QHash<quint64, QPair<quint64, quint64> > &children, const QHash<quint64, EntryRef> &refs);
+
+public:
+	EntryListMembership(EntryListDBAccess *dbAccess);
+
+	/// Records that the node which rowid is given now references ref in listId
+	void nodeInserted(const EntryRef &ref, quint64 rowid, quint32 listId);
+	/// Records that the node which rowid is given has been removed
+	void nodeRemoved(const EntryRef &ref, quint64 rowid);
+	/// Drops the index, so it gets reloaded from the database the next time
+	/// it is used. Must be called when list changes are rolled back.
+	void invalidate();
+
+	/// Returns the rowids of all the list nodes referencing ref
+	QSet<quint64> nodes(const EntryRef &ref);
+	/// Returns the ids of the lists that directly contain ref
+	QSet<quint32> lists(const EntryRef &ref);
+	/// Returns true if ref is directly contained in the list listId
+	bool contains(const EntryRef &ref, quint32 listId);
+	/// Completes lists with all the lists they contain, recursively
+	QSet<quint32> withSubLists(const QSet<quint32> &lists);
+	/// Returns the ids of the entries of the given type that belong to any
+	/// of lists
+	QSet<EntryId> entries(EntryType type, const QSet<quint32> &lists);
+	/// Returns the ids of the entries of the given type that belong to any list
+	QSet<EntryId> entries(EntryType type);
+};
+
 class EntryListDBAccess : public DBList<EntryListData>
 {
+private:
+	EntryListMembership _membership;
+
 public:
 	EntryListDBAccess(const QString &tableName, SQLite::Connection *connection = 0);
 	/**
 	 * Create the database index that makes looking from data fast.
 	 */
 	bool createDataIndexes(SQLite::Connection *connection);
+	bool prepareForConnection(SQLite::Connection *connection);
+
+	EntryListMembership &membership() { return _membership; }
 };
 
+/**
+ * An entries list. Insertions and removals made through this class are
+ * reflected into the membership index of the database access it uses.
+ */
 class EntryList : public OrderedRBTree<OrderedRBDBTree<EntryListData> >
 {
 private:
-	EntryList() : OrderedRBTree<OrderedRBDBTree<EntryListData> >() { qCritical("Warning: initializing an EntryList from its default constructor (this should never happen)"); }
+	EntryListDBAccess *_dbAccess;
+
+	EntryList() : OrderedRBTree<OrderedRBDBTree<EntryListData> >(), _dbAccess(0) { qCritical("Warning: initializing an EntryList from its default constructor (this should never happen)"); }
 
 public:
-	EntryList(EntryListDBAccess *dbAccess, quint64 listId) : OrderedRBTree<OrderedRBDBTree<EntryListData> >()
+	EntryList(EntryListDBAccess *dbAccess, quint64 listId) : OrderedRBTree<OrderedRBDBTree<EntryListData> >(), _dbAccess(dbAccess)
 	{
 		tree()->setDBAccess(dbAccess);
 		tree()->setListId(listId);
@@ -84,6 +150,12 @@ public:
 	 * before calling this method.
 	 */
 	bool remove(int index);
+
+	bool insert(const EntryListData &val, int index);
+	bool insertBatch(const QList<EntryListData> &vals, int index);
+	bool insertNode(TreeType::Node *node, int index);
+	bool removeNode(TreeType::Node *node);
+	bool clear();
 // Needed because EntryListModel uses a QMap - but never called, actually.
 friend class QMap<quint64, EntryList>;
 };
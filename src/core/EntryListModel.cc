@@ -202,6 +202,8 @@ bool EntryListModel::insertRows(int row, int count, const QModelIndex & parent)
 
 failure_2:
 	EntryListCache::connection()->rollback();
+	// Changes that succeeded before the failure have been rolled back too
+	EntryListCache::membership().invalidate();
 failure_1:
 	return false;
 }
@@ -224,6 +226,8 @@ bool EntryListModel::removeRows(int row, int count, const QModelIndex &parent)
 
 failure_2:
 	EntryListCache::connection()->rollback();
+	// Changes that succeeded before the failure have been rolled back too
+	EntryListCache::membership().invalidate();
 failure_1:
 	return false;
 }
@@ -387,21 +391,26 @@ bool EntryListModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
 		beginInsertRows(_parent, row, row + entries.size() - 1);
 		if (!EntryListCache::connection()->transaction()) goto failure_1;
 		// Insert rows must be done on what the view thinks is the parent
-		int cpt = 0;
-		foreach (const EntryRef &entry, entries) {
-			EntryListData eData;
-			eData.type = entry.type();
-			eData.id = entry.id();
-			if (!list.insert(eData, row + cpt)) {
-				qWarning("Error inserting list item, aborting.");
+		{
+			QList<EntryListData> eDatas;
+			foreach (const EntryRef &entry, entries) {
+				EntryListData eData;
+				eData.type = entry.type();
+				eData.id = entry.id();
+				eDatas << eData;
+			}
+			if (!list.insertBatch(eDatas, row)) {
+				qWarning("Error inserting list items, aborting.");
 				goto failure_2;
 			}
+		}
 
-			// Add the list to the entry if it is loaded
+		// Add the list to the entries that are loaded
+		for (int i = 0; i < entries.size(); i++) {
+			const EntryRef &entry = entries[i];
 			if (entry.isLoaded()) {
-				entry.get()->addToList(EntryListCache::getRowIdFromIndex(QPair<const EntryList *, quint32>(&list, row + cpt)));
+				entry.get()->addToList(EntryListCache::getRowIdFromIndex(QPair<const EntryList *, quint32>(&list, row + i)));
 			}
-			cpt++;
 		}
 		if (!EntryListCache::connection()->commit()) goto failure_2;
 		EntryListCache::clearOwnerCache();
@@ -412,6 +421,8 @@ bool EntryListModel::dropMimeData(const QMimeData *data, Qt::DropAction action,
 
 failure_2:
 	EntryListCache::connection()->rollback();
+	// Changes that succeeded before the failure have been rolled back too
+	EntryListCache::membership().invalidate();
 failure_1:
 	return false;
 }
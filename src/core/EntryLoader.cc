@@ -17,22 +17,23 @@
 
 #include "core/EntryLoader.h"
 #include "core/Database.h"
+#include "core/EntryListCache.h"
 
-EntryLoader::EntryLoader()
+#include <QStringList>
+
+EntryLoader::EntryLoader() : _statementsCount(0)
 {
-	if (!connection.connect(Database::userDBFile())) {
+	if (!connection.connect(Database::userDBFile(), Database::userDBFlags())) {
 		qFatal("EntrySearcher cannot connect to user database!");
 	}
 	trainQuery.useWith(&connection);
 	tagsQuery.useWith(&connection);
 	notesQuery.useWith(&connection);
-	listsQuery.useWith(&connection);
 
 	// Cache queries
 	trainQuery.prepare("select dateAdded, dateLastTrain, nbTrained, nbSuccess, dateLastMistake, score from training where type = ? and id = ?");
 	tagsQuery.prepare("select tagId from taggedEntries where type = ? and id = ? order by date");
 	notesQuery.prepare("select noteId, dateAdded, dateLastChange, note from notes join notesText on notes.noteId == notesText.docid where type = ? and id = ? order by dateAdded ASC, noteId ASC");
-	listsQuery.prepare("select rowid from lists where type = ? and id = ?");
 }
 
 EntryLoader::~EntryLoader()
@@ -41,7 +42,6 @@ EntryLoader::~EntryLoader()
 	trainQuery.clear();
 	tagsQuery.clear();
 	notesQuery.clear();
-	listsQuery.clear();
 }
 
 static QDateTime variantToDate(const SQLite::Query &query, int col)
@@ -51,47 +51,97 @@ static QDateTime variantToDate(const SQLite::Query &query, int col)
 	else return QDateTime();
 }
 
-void EntryLoader::loadMiscData(Entry *entry)
+void EntryLoader::fetchMiscData(EntryType type, EntryId id, MiscData &data)
 {
 	// Load training data
-	trainQuery.bindValue(entry->type());
-	trainQuery.bindValue(entry->id());
+	trainQuery.bindValue(type);
+	trainQuery.bindValue(id);
 	trainQuery.exec();
 	// The entry is registered, so lets load its data
 	if (trainQuery.next()) {
-		entry->setDateAdded(variantToDate(trainQuery, 0));
-		entry->setDateLastTrained(variantToDate(trainQuery, 1));
-		entry->setNbTrained(trainQuery.valueInt(2));
-		entry->setNbSuccess(trainQuery.valueInt(3));
-		entry->setDateLastMistake(variantToDate(trainQuery, 4));
-		entry->_score = trainQuery.valueInt(5);
+		data.trained = true;
+		data.dateAdded = variantToDate(trainQuery, 0);
+		data.dateLastTrained = variantToDate(trainQuery, 1);
+		data.nbTrained = trainQuery.valueInt(2);
+		data.nbSuccess = trainQuery.valueInt(3);
+		data.dateLastMistake = variantToDate(trainQuery, 4);
+		data.score = trainQuery.valueInt(5);
 	}
 	trainQuery.reset();
 
 	// Tags data
-	tagsQuery.bindValue(entry->type());
-	tagsQuery.bindValue(entry->id());
+	tagsQuery.bindValue(type);
+	tagsQuery.bindValue(id);
 	tagsQuery.exec();
-	while (tagsQuery.next())
-		entry->_tags << Tag::getTag(tagsQuery.valueUInt(0));
+	while (tagsQuery.next()) data.tags << tagsQuery.valueUInt(0);
 	tagsQuery.reset();
 
 	// Notes data
-	notesQuery.bindValue(entry->type());
-	notesQuery.bindValue(entry->id());
+	notesQuery.bindValue(type);
+	notesQuery.bindValue(id);
 	notesQuery.exec();
 	while (notesQuery.next()) {
-		entry->_notes << Entry::Note(notesQuery.valueInt(0), QDateTime::fromTime_t(notesQuery.valueInt(1)), QDateTime::fromTime_t(notesQuery.valueInt(2)), notesQuery.valueString(3));
+		data.notes << Entry::Note(notesQuery.valueInt(0), QDateTime::fromTime_t(notesQuery.valueInt(1)), QDateTime::fromTime_t(notesQuery.valueInt(2)), notesQuery.valueString(3));
 	}
 	notesQuery.reset();
-	
-	// Lists data
-	listsQuery.bindValue(entry->type());
-	listsQuery.bindValue(entry->id());
-	listsQuery.exec();
-	while (listsQuery.next()) {
-		entry->_lists << listsQuery.valueUInt64(0);
+	_statementsCount += 3;
+}
+
+void EntryLoader::prefetchMiscData(EntryType type, const QList<EntryId> &ids)
+{
+	_prefetched.clear();
+	if (ids.isEmpty()) return;
+	QStringList idsList;
+	foreach (EntryId id, ids) {
+		// Entries without user data must be found too
+		_prefetched.insert(QPair<EntryType, EntryId>(type, id), MiscData());
+		idsList << QString::number(id);
+	}
+	QString idsString(idsList.join(", "));
+
+	// The same queries as fetchMiscData(), for all the entries at once
+	SQLite::Query query(&connection);
+	query.exec(QString("select id, dateAdded, dateLastTrain, nbTrained, nbSuccess, dateLastMistake, score from training where type = %1 and id in (%2)").arg(type).arg(idsString));
+	while (query.next()) {
+		MiscData &data = _prefetched[QPair<EntryType, EntryId>(type, query.valueUInt(0))];
+		data.trained = true;
+		data.dateAdded = variantToDate(query, 1);
+		data.dateLastTrained = variantToDate(query, 2);
+		data.nbTrained = query.valueInt(3);
+		data.nbSuccess = query.valueInt(4);
+		data.dateLastMistake = variantToDate(query, 5);
+		data.score = query.valueInt(6);
+	}
+	query.exec(QString("select id, tagId from taggedEntries where type = %1 and id in (%2) order by date").arg(type).arg(idsString));
+	while (query.next()) _prefetched[QPair<EntryType, EntryId>(type, query.valueUInt(0))].tags << query.valueUInt(1);
+	query.exec(QString("select id, noteId, dateAdded, dateLastChange, note from notes join notesText on notes.noteId == notesText.docid where type = %1 and id in (%2) order by dateAdded ASC, noteId ASC").arg(type).arg(idsString));
+	while (query.next()) {
+		_prefetched[QPair<EntryType, EntryId>(type, query.valueUInt(0))].notes << Entry::Note(query.valueInt(1), QDateTime::fromTime_t(query.valueInt(2)), QDateTime::fromTime_t(query.valueInt(3)), query.valueString(4));
 	}
-	listsQuery.reset();
+	_statementsCount += 3;
 }
 
+void EntryLoader::loadMiscData(Entry *entry)
+{
+	MiscData data;
+	QHash<QPair<EntryType, EntryId>, MiscData>::iterator it(_prefetched.find(QPair<EntryType, EntryId>(entry->type(), entry->id())));
+	if (it != _prefetched.end()) {
+		data = it.value();
+		_prefetched.erase(it);
+	}
+	else fetchMiscData(entry->type(), entry->id(), data);
+
+	if (data.trained) {
+		entry->setDateAdded(data.dateAdded);
+		entry->setDateLastTrained(data.dateLastTrained);
+		entry->setNbTrained(data.nbTrained);
+		entry->setNbSuccess(data.nbSuccess);
+		entry->setDateLastMistake(data.dateLastMistake);
+		entry->_score = data.score;
+	}
+	foreach (quint32 tagId, data.tags) entry->_tags << Tag::getTag(tagId);
+	entry->_notes = data.notes;
+
+	// Lists data
+	entry->_lists = EntryListCache::membership().nodes(EntryRef(entry->type(), entry->id()));
+}
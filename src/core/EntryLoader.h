@@ -22,13 +22,33 @@
 #include "sqlite/Query.h"
 #include "core/Entry.h"
 
+#include <QHash>
+#include <QPair>
+
 /**
  * Base class for loading entries of a given type.
  */
 class EntryLoader
 {
 private:
-	SQLite::Query trainQuery, tagsQuery, notesQuery, listsQuery;
+	SQLite::Query trainQuery, tagsQuery, notesQuery;
+
+	/// User data of an entry, as stored in the user database
+	struct MiscData
+	{
+		bool trained;
+		QDateTime dateAdded, dateLastTrained, dateLastMistake;
+		int nbTrained, nbSuccess, score;
+		QList<quint32> tags;
+		QList<Entry::Note> notes;
+
+		MiscData() : trained(false), nbTrained(0), nbSuccess(0), score(0) {}
+	};
+	/// Data fetched by the last call to prefetchMiscData() and not used yet
+	QHash<QPair<EntryType, EntryId>, MiscData> _prefetched;
+	quint32 _statementsCount;
+
+	void fetchMiscData(EntryType type, EntryId id, MiscData &data);
 
 protected:
 	/**
@@ -55,6 +75,19 @@ public:
 	 * case of problem, for instance if there is no other result.
 	 */
 	virtual Entry *loadEntry(EntryId id) = 0;
+
+	/**
+	 * Fetches the user data of all the given entries using a constant
+	 * number of statements. The data is used by loadMiscData() if the
+	 * entries are loaded before the next call to this method.
+	 */
+	void prefetchMiscData(EntryType type, const QList<EntryId> &ids);
+
+	/// Returns true if the user data of the given entry has been prefetched
+	bool isPrefetched(EntryType type, EntryId id) const { return _prefetched.contains(QPair<EntryType, EntryId>(type, id)); }
+
+	/// Number of statements executed to load user data so far
+	quint32 statementsCount() const { return _statementsCount; }
 };
 
 #endif
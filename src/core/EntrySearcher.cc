@@ -18,6 +18,7 @@
 #include "core/RelativeDate.h"
 #include "core/EntrySearcher.h"
 #include "core/EntryListCache.h"
+#include "core/Tag.h"
 
 #include <QtDebug>
 
@@ -34,7 +35,7 @@ EntrySearcher::EntrySearcher(EntryType entryType) :commandMatch(SearchCommand::c
 	QueryBuilder::Join::addTablePriority("taggedEntries", -50);
 	QueryBuilder::Join::addTablePriority("tags", -55);
 	QueryBuilder::Join::addTablePriority("tags", -55);
-	validCommands << "study" << "nostudy" << "note" << "lasttrained" << "mistaken" << "tag" << "untagged" << "score";
+	validCommands << "study" << "nostudy" << "note" << "lasttrained" << "mistaken" << "tag" << "untagged" << "score" << "inlist";
 }
 
 EntrySearcher::~EntrySearcher()
@@ -56,10 +57,18 @@ QPair<QDate, QDate> timeInterval(const QString &string, const QString &string2)
 	return QPair<QDate, QDate>(time, timeMax);
 }
 
+/// Restricts the results of statement to the entries which ids are given
+static void restrictToIds(QueryBuilder::Statement &statement, const QueryBuilder::Column &entryId, const QList<EntryId> &ids)
+{
+	QStringList idsList;
+	foreach (EntryId id, ids) idsList << QString::number(id);
+	statement.addJoin(entryId);
+	statement.addWhere(QString("%1 in (%2)").arg(entryId.toString()).arg(idsList.join(", ")));
+}
+
 void EntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBuilder::Statement &statement)
 {
 	QStringList notesSearch;
-	QStringList tagSearch;
 	foreach(const SearchCommand &command, commands) {
 		bool processed = true;
 		if (command.command() == "study") {
@@ -96,19 +105,27 @@ void EntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBuilder:
 			statement.setFirstTable("notes");
 		}
 		else if (command.command() == "tag") {
-			bool allTagsHandled = false;
-			statement.addJoin(QueryBuilder::Join(QueryBuilder::Column("taggedEntries", "id"), QString("taggedEntries.type = %1").arg(entryType()), QueryBuilder::Join::Left));
-			if (command.args().isEmpty()) { statement.addWhere(QString("taggedEntries.date not null")); allTagsHandled = true; }
-			else foreach(const QString &arg, command.args())
-				// We filter the "*" tag as FTS3 does not support it - but since the condition is added, all non-tagged entries will be filtered which is the desired result anyway.
-				if (arg != "*") tagSearch << "\"" + arg + "\"";
-				else if (!allTagsHandled) { statement.addWhere(QString("taggedEntries.date not null")); allTagsHandled = true; }
-			statement.setFirstTable("taggedEntries");
+			// Resolved using the in-memory tags index instead of joining the tags tables
+			IdBitmap ids;
+			if (command.args().isEmpty()) ids = Tag::index().entries(entryType());
+			else ids = Tag::index().entries(entryType(), command.args());
+			restrictToIds(statement, entryId(), ids.toList());
 		}
 		else if (command.command() == "untagged") {
 			statement.addJoin(QueryBuilder::Join(QueryBuilder::Column("taggedEntries", "id"), QString("taggedEntries.type = %1").arg(entryType()), QueryBuilder::Join::Left));
 			statement.addWhere(QString("taggedEntries.date is null"));
 		}
+		else if (command.command() == "inlist") {
+			// Resolved using the in-memory lists index instead of joining the lists table
+			QSet<EntryId> ids;
+			if (command.args().isEmpty()) ids = EntryListCache::membership().entries(entryType());
+			else {
+				QSet<quint32> lists;
+				foreach (const QString &arg, command.args()) lists += EntryListCache::listsByLabel(arg);
+				ids = EntryListCache::membership().entries(entryType(), EntryListCache::membership().withSubLists(lists));
+			}
+			restrictToIds(statement, entryId(), ids.toList());
+		}
 		else if (command.command() == "lasttrained") {
 			if (command.args().size() > 2) continue;
 
@@ -137,15 +154,6 @@ void EntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBuilder:
 	if (!notesSearch.isEmpty()) {
 		statement.addWhere(QString("notes.noteId in (select docid from notesText where note match '%1')").arg(notesSearch.join(" ")));
 	}
-	if (!tagSearch.isEmpty()) {
-		// Remove duplicates, case insensitively
-		QSet<QString> tmpSet;
-		foreach (const QString &string, tagSearch) tmpSet << string.toLower();
-		tagSearch.clear();
-		foreach (const QString &string, tmpSet) tagSearch << string;
-		statement.addWhere(QString("taggedEntries.id in (select id from taggedEntries where type = %1 and tagId in (select docid from tags where tag match '%2') group by id having count(id) == %3)").arg(entryType()).arg(tagSearch.join(" OR ")).arg(tagSearch.size()));
-//		statement.setGroupBy(QueryBuilder::GroupBy("taggedEntries.id", QString("count(taggedEntries.id) = %1").arg(tagSearch.size())));
-	}
 }
 
 QueryBuilder::Column EntrySearcher::canSort(const QString &sort, const QueryBuilder::Statement &statement)
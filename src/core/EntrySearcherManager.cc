@@ -27,6 +27,7 @@ EntrySearcherManager::EntrySearcherManager() : quotedWordsMatch(SearchCommand::q
 	validSearchCompoundMatch(SearchCommand::commandMatch().pattern() + "|" + SearchCommand::singleWordMatch().pattern() + "|" + SearchCommand::quotedWordsMatch().pattern()),
 	validSearchMatch(" *((" + validSearchCompoundMatch.pattern() + ") *)* *")
 {
+	QueryBuilder::Order::orderingWay["relevance"] = QueryBuilder::Order::DESC;
 	QueryBuilder::Order::orderingWay["jlpt"] = QueryBuilder::Order::DESC;
 }
 
@@ -87,7 +88,8 @@ bool EntrySearcherManager::buildQuery(const QString &search, QueryBuilder &query
 	// First filter ordering commands
 	QStringList orders;
 	if (studiedEntriesFirst.value()) orders << "study" << "score";
-	orders << "matchPos" << "jlpt" << "freq";
+	// Relevance of text searches first, then JLPT level and frequency for ties
+	orders << "relevance" << "jlpt" << "freq";
 
 	// Transform words into commands, if applicable
 	bool validQuery = false;
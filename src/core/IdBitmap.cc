@@ -0,0 +1,219 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/IdBitmap.h"
+
+#include <QtAlgorithms>
+
+/// Number of 32 bits words of a bitset chunk
+#define CHUNK_WORDS (65536 / 32)
+
+static inline int bitCount(quint32 v)
+{
+	v = v - ((v >> 1) & 0x55555555);
+	v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+	return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+bool IdBitmap::Chunk::contains(quint16 low) const
+{
+	if (isBitset()) return bits[low >> 5] & (1u << (low & 31));
+	return qBinaryFind(array.constBegin(), array.constEnd(), low) != array.constEnd();
+}
+
+void IdBitmap::Chunk::toBitset()
+{
+	bits.fill(0, CHUNK_WORDS);
+	foreach (quint16 low, array) bits[low >> 5] |= 1u << (low & 31);
+	array.clear();
+}
+
+void IdBitmap::Chunk::toArray()
+{
+	array.clear();
+	array.reserve(count);
+	for (int i = 0; i < CHUNK_WORDS; i++) {
+		quint32 word = bits[i];
+		for (int j = 0; word; j++, word >>= 1)
+			if (word & 1) array << (quint16)((i << 5) + j);
+	}
+	bits.clear();
+}
+
+void IdBitmap::Chunk::recount()
+{
+	count = 0;
+	for (int i = 0; i < CHUNK_WORDS; i++) count += bitCount(bits[i]);
+}
+
+void IdBitmap::Chunk::intersect(const Chunk &other)
+{
+	if (isBitset() && other.isBitset()) {
+		for (int i = 0; i < CHUNK_WORDS; i++) bits[i] &= other.bits[i];
+		recount();
+		if (count <= MaxArraySize) toArray();
+		return;
+	}
+	// At least one side is an array, so is the result
+	const QVector<quint16> &src = isBitset() ? other.array : array;
+	const Chunk &filter = isBitset() ? *this : other;
+	QVector<quint16> res;
+	if (filter.isBitset()) {
+		foreach (quint16 low, src) if (filter.contains(low)) res << low;
+	} else {
+		// Merge both sorted arrays
+		QVector<quint16>::const_iterator it1 = array.constBegin(), it2 = other.array.constBegin();
+		while (it1 != array.constEnd() && it2 != other.array.constEnd()) {
+			if (*it1 < *it2) ++it1;
+			else if (*it2 < *it1) ++it2;
+			else {
+				res << *it1;
+				++it1; ++it2;
+			}
+		}
+	}
+	bits.clear();
+	array = res;
+	count = array.size();
+}
+
+void IdBitmap::Chunk::unite(const Chunk &other)
+{
+	if (other.isBitset()) {
+		if (!isBitset()) toBitset();
+		for (int i = 0; i < CHUNK_WORDS; i++) bits[i] |= other.bits[i];
+		recount();
+		return;
+	}
+	if (isBitset()) {
+		foreach (quint16 low, other.array) bits[low >> 5] |= 1u << (low & 31);
+		recount();
+		return;
+	}
+	QVector<quint16> res;
+	res.reserve(array.size() + other.array.size());
+	QVector<quint16>::const_iterator it1 = array.constBegin(), it2 = other.array.constBegin();
+	while (it1 != array.constEnd() || it2 != other.array.constEnd()) {
+		if (it2 == other.array.constEnd() || (it1 != array.constEnd() && *it1 < *it2)) res << *it1++;
+		else if (it1 == array.constEnd() || *it2 < *it1) res << *it2++;
+		else {
+			res << *it1;
+			++it1; ++it2;
+		}
+	}
+	array = res;
+	count = array.size();
+	if (count > MaxArraySize) toBitset();
+}
+
+void IdBitmap::insert(quint32 id)
+{
+	Chunk &chunk = _chunks[id >> 16];
+	quint16 low = id & 0xffff;
+	if (chunk.isBitset()) {
+		quint32 &word = chunk.bits[low >> 5];
+		quint32 mask = 1u << (low & 31);
+		if (!(word & mask)) {
+			word |= mask;
+			++chunk.count;
+		}
+		return;
+	}
+	QVector<quint16>::iterator it = qLowerBound(chunk.array.begin(), chunk.array.end(), low);
+	if (it != chunk.array.end() && *it == low) return;
+	chunk.array.insert(it, low);
+	if (++chunk.count > MaxArraySize) chunk.toBitset();
+}
+
+void IdBitmap::remove(quint32 id)
+{
+	QMap<quint16, Chunk>::iterator cit = _chunks.find(id >> 16);
+	if (cit == _chunks.end()) return;
+	Chunk &chunk = cit.value();
+	quint16 low = id & 0xffff;
+	if (chunk.isBitset()) {
+		quint32 &word = chunk.bits[low >> 5];
+		quint32 mask = 1u << (low & 31);
+		if (!(word & mask)) return;
+		word &= ~mask;
+		// Do not convert back as soon as possible to avoid flip-flopping
+		if (--chunk.count <= MaxArraySize / 2) chunk.toArray();
+	} else {
+		QVector<quint16>::iterator it = qBinaryFind(chunk.array.begin(), chunk.array.end(), low);
+		if (it == chunk.array.end()) return;
+		chunk.array.erase(it);
+		--chunk.count;
+	}
+	if (!chunk.count) _chunks.erase(cit);
+}
+
+bool IdBitmap::contains(quint32 id) const
+{
+	QMap<quint16, Chunk>::const_iterator cit = _chunks.constFind(id >> 16);
+	if (cit == _chunks.constEnd()) return false;
+	return cit.value().contains(id & 0xffff);
+}
+
+int IdBitmap::size() const
+{
+	int ret = 0;
+	foreach (const Chunk &chunk, _chunks) ret += chunk.count;
+	return ret;
+}
+
+IdBitmap &IdBitmap::operator&=(const IdBitmap &other)
+{
+	QMap<quint16, Chunk>::iterator it = _chunks.begin();
+	while (it != _chunks.end()) {
+		QMap<quint16, Chunk>::const_iterator oit = other._chunks.constFind(it.key());
+		if (oit != other._chunks.constEnd()) it.value().intersect(oit.value());
+		if (oit == other._chunks.constEnd() || !it.value().count) it = _chunks.erase(it);
+		else ++it;
+	}
+	return *this;
+}
+
+IdBitmap &IdBitmap::operator|=(const IdBitmap &other)
+{
+	QMap<quint16, Chunk>::const_iterator oit;
+	for (oit = other._chunks.constBegin(); oit != other._chunks.constEnd(); ++oit) {
+		QMap<quint16, Chunk>::iterator it = _chunks.find(oit.key());
+		if (it == _chunks.end()) _chunks.insert(oit.key(), oit.value());
+		else it.value().unite(oit.value());
+	}
+	return *this;
+}
+
+QList<quint32> IdBitmap::toList() const
+{
+	QList<quint32> ret;
+	QMap<quint16, Chunk>::const_iterator it;
+	for (it = _chunks.constBegin(); it != _chunks.constEnd(); ++it) {
+		quint32 high = (quint32)it.key() << 16;
+		const Chunk &chunk = it.value();
+		if (!chunk.isBitset()) {
+			foreach (quint16 low, chunk.array) ret << (high | low);
+			continue;
+		}
+		for (int i = 0; i < CHUNK_WORDS; i++) {
+			quint32 word = chunk.bits[i];
+			for (int j = 0; word; j++, word >>= 1)
+				if (word & 1) ret << (high | ((i << 5) + j));
+		}
+	}
+	return ret;
+}
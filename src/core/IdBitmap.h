@@ -0,0 +1,74 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_IDBITMAP_H
+#define __CORE_IDBITMAP_H
+
+#include <QMap>
+#include <QVector>
+#include <QList>
+
+/**
+ * Compressed set of 32 bits ids, suitable for the sparse ranges of ids used
+ * by dictionary entries.
+ *
+ * Ids that share the same 16 high bits are stored into the same chunk.
+ * A chunk is a sorted array of the low bits of its ids while it holds at
+ * most MaxArraySize of them, and a 64k bits bitset beyond that. This keeps
+ * small sets small while allowing fast intersections of large ones.
+ */
+class IdBitmap
+{
+private:
+	struct Chunk
+	{
+		/// Sorted low bits of the ids, if the chunk is an array
+		QVector<quint16> array;
+		/// Bitset of the ids, if the chunk is dense
+		QVector<quint32> bits;
+		int count;
+
+		Chunk() : count(0) {}
+		bool isBitset() const { return !bits.isEmpty(); }
+		bool contains(quint16 low) const;
+		void toBitset();
+		void toArray();
+		void recount();
+		void intersect(const Chunk &other);
+		void unite(const Chunk &other);
+	};
+	QMap<quint16, Chunk> _chunks;
+
+public:
+	/// Maximum number of ids stored into a chunk before it becomes a bitset
+	static const int MaxArraySize = 4096;
+
+	void insert(quint32 id);
+	void remove(quint32 id);
+	bool contains(quint32 id) const;
+	bool isEmpty() const { return _chunks.isEmpty(); }
+	int size() const;
+	void clear() { _chunks.clear(); }
+
+	IdBitmap &operator&=(const IdBitmap &other);
+	IdBitmap &operator|=(const IdBitmap &other);
+
+	/// Returns all the ids of the set, in increasing order
+	QList<quint32> toList() const;
+};
+
+#endif
@@ -20,6 +20,10 @@
 #include "core/OrderedRBNode.h"
 
 #include <QSet>
+#include <QHash>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QtAlgorithms>
 
 template <class T> class OrderedRBDBTree;
 
@@ -27,7 +31,9 @@ template <class T> class OrderedRBDBTree;
  * Implements database storage for RB tree nodes.
  * When a node is created, all its data is loaded and cached.
  * When the left/right members are first accessed, the corresponding
- * node is created and loaded.
+ * node is created and loaded. Loaded nodes can be unloaded by their tree
+ * (see OrderedRBDBTree::trimMemCache()), in which case they will just be
+ * loaded again the next time they are accessed.
  */
 template <class T> class OrderedRBDBNode : public OrderedRBNodeBase<T>
 {
@@ -36,11 +42,14 @@ private:
 	mutable OrderedRBDBNode<T> * _left;
 	mutable OrderedRBDBNode<T> * _right;
 	mutable OrderedRBDBNode<T> * _parent;
+	/// Last time this node has been accessed from its parent
+	mutable quint32 _lastAccess;
 	DBListEntry<T> e;
 
 public:
-	OrderedRBDBNode(OrderedRBDBTree<T> *tree, const T &va) : OrderedRBNodeBase<T>(), _tree(tree), _left(0), _right(0), _parent(0), e()
+	OrderedRBDBNode(OrderedRBDBTree<T> *tree, const T &va) : OrderedRBNodeBase<T>(), _tree(tree), _left(0), _right(0), _parent(0), _lastAccess(0), e()
 	{
+		_tree->nodeLoaded();
 		// Here a new node is to be inserted in the tree - we need to insert it right now into
 		// the DB in order to get its ID.
 		setValue(va);
@@ -49,18 +58,29 @@ public:
 		updateDB();
 	}
 
-	OrderedRBDBNode(OrderedRBDBTree<T> *tree, quint32 rowid) : OrderedRBNodeBase<T>(), _tree(tree), _left(0), _right(0), _parent(0), e()
+	OrderedRBDBNode(OrderedRBDBTree<T> *tree, quint32 rowid) : OrderedRBNodeBase<T>(), _tree(tree), _left(0), _right(0), _parent(0), _lastAccess(0), e()
 	{
+		_tree->nodeLoaded();
 		// The new node is expected to exist in the DB with the given ID - just load it.
 		e = _tree->dbAccess()->getEntry(rowid);
-		setColor(e.red ?  OrderedRBNodeBase<T>::RED : OrderedRBNodeBase<T>::BLACK);
-		setLeftSize(e.leftSize);
+		// Loading a node does not change it, so bypass our own setters
+		OrderedRBNodeBase<T>::setColor(e.red ?  OrderedRBNodeBase<T>::RED : OrderedRBNodeBase<T>::BLACK);
+		OrderedRBNodeBase<T>::setLeftSize(e.leftSize);
+	}
+
+	OrderedRBDBNode(OrderedRBDBTree<T> *tree, const DBListEntry<T> &entry) : OrderedRBNodeBase<T>(), _tree(tree), _left(0), _right(0), _parent(0), _lastAccess(0), e(entry)
+	{
+		_tree->nodeLoaded();
+		// The node has already been fetched from or recorded into the DB.
+		OrderedRBNodeBase<T>::setColor(e.red ?  OrderedRBNodeBase<T>::RED : OrderedRBNodeBase<T>::BLACK);
+		OrderedRBNodeBase<T>::setLeftSize(e.leftSize);
 	}
 
 	~OrderedRBDBNode()
 	{
 		// This destructor should not remove the node from the database as it would break data persistency.
 		// In order to permanently remove nodes, removeNode() should be used instead.
+		_tree->nodeUnloaded();
 	}
 
 	void setColor(typename OrderedRBNodeBase<T>::Color col)
@@ -87,19 +107,23 @@ public:
 	OrderedRBDBNode<T> *left() const
 	{
 		// Load the node if not already done and return it
+		QMutexLocker ml(&_tree->_nodesLock);
 		if (!_left && e.left) {
-			_left = new OrderedRBDBNode<T>(_tree, e.left);
+			_left = _tree->loadNode(e.left);
 			_left->_parent = const_cast<OrderedRBDBNode<T> *>(this);
 		}
+		if (_left) _left->_lastAccess = ++_tree->_accessCounter;
 		return _left;
 	}
 	OrderedRBDBNode<T> *right() const
 	{
 		// Load the node if not already done and return it
+		QMutexLocker ml(&_tree->_nodesLock);
 		if (!_right && e.right) {
-			_right = new OrderedRBDBNode<T>(_tree, e.right);
+			_right = _tree->loadNode(e.right);
 			_right->_parent = const_cast<OrderedRBDBNode<T> *>(this);
 		}
+		if (_right) _right->_lastAccess = ++_tree->_accessCounter;
 		return _right;
 	}
 	OrderedRBDBNode<T> *parent() const
@@ -130,8 +154,12 @@ public:
 	void attachToTree(OrderedRBDBTree<T> *tree)
 	{
 		if (_tree == tree) return;
-		if (_tree) _tree->forgetNode(this);
+		if (_tree) {
+			_tree->forgetNode(this);
+			_tree->nodeUnloaded();
+		}
 		_tree = tree;
+		_tree->nodeLoaded();
 		_tree->nodeChanged(this);
 	}
 	OrderedRBDBTree<T> *tree() { return _tree; }
@@ -169,19 +197,41 @@ private:
 	mutable Node *_root;
 	bool mustUpdateRootTable;
 	QSet<Node *> _changedNodes;
+	/// Entries that have been read ahead but whose node is not loaded yet
+	QHash<quint32, DBListEntry<T> > _readAhead;
+	quint32 _loadedNodes;
+	quint32 _accessCounter;
+	/// Taken while nodes are loaded or unloaded, so the tree can be trimmed
+	/// while other threads walk it
+	QMutex _nodesLock;
+	/// Number of nodes loaded by all the trees of this type, which may
+	/// live in different threads
+	static QAtomicInt _totalLoadedNodes;
+
+	void nodeLoaded() { ++_loadedNodes; _totalLoadedNodes.ref(); }
+	void nodeUnloaded() { --_loadedNodes; _totalLoadedNodes.deref(); }
+
+	/**
+	 * Load the node which rowid is given, reading its children ahead
+	 * so they can be loaded without accessing the DB.
+	 */
+	Node *loadNode(quint32 rowid);
+	bool trimSubtree(Node *node, quint32 threshold);
+	void unloadSubtree(Node *node);
+	void collectAccesses(const Node *node, QVector<quint32> &accesses) const;
 
 protected:
 	DBList<T> *_ldb;
 
 public:
-	OrderedRBDBTree() : _listInfo(), _root(0), mustUpdateRootTable(false), _ldb(0) 
+	OrderedRBDBTree() : _listInfo(), _root(0), mustUpdateRootTable(false), _loadedNodes(0), _accessCounter(0), _ldb(0) 
 	{
 	}
 
 	/// Remove all the in-memory structures, leaving the database unchanged
 	~OrderedRBDBTree()
 	{
-		clearMemCache();
+		if (_root) unloadSubtree(_root);
 	}
 
 	Node *root() const { return _root; }
@@ -200,6 +250,33 @@ public:
 		return _ldb->connection()->transaction();
 	}
 
+	/**
+	 * Create nodes for all the given values and record them into the DB using
+	 * as few statements as possible. The nodes are not linked to anything.
+	 */
+	bool createNodes(const QList<T> &values, QVector<Node *> &nodes)
+	{
+		QVector<DBListEntry<T> > entries(values.size());
+		QVector<DBListEntry<T> *> entriesPtrs;
+		entriesPtrs.reserve(values.size());
+		for (int i = 0; i < values.size(); i++) {
+			DBListEntry<T> &entry = entries[i];
+			entry.rowId = 0;
+			entry.leftSize = 0;
+			entry.red = true;
+			entry.parent = entry.left = entry.right = 0;
+			entry.data = values[i];
+			entriesPtrs << &entry;
+		}
+		if (!_ldb->insertEntries(entriesPtrs)) return false;
+		foreach (const DBListEntry<T> &entry, entries) {
+			Node *node = new Node(this, entry);
+			nodeChanged(node);
+			nodes << node;
+		}
+		return true;
+	}
+
 	void nodeChanged(Node *n)
 	{
 		_changedNodes << n;
@@ -222,11 +299,13 @@ public:
 
 	bool commitChanges()
 	{
-		foreach (Node *n, _changedNodes) {
-			if (!n->updateDB()) {
-				_ldb->connection()->rollback();
-				return false;
-			}
+		// Write all changed nodes at once
+		QVector<DBListEntry<T> *> entries;
+		entries.reserve(_changedNodes.size());
+		foreach (Node *n, _changedNodes) entries << &n->e;
+		if (!_ldb->insertEntries(entries)) {
+			_ldb->connection()->rollback();
+			return false;
 		}
 		_changedNodes.clear();
 		if (!_ldb->connection()->commit()) {
@@ -302,11 +381,111 @@ public:
 	}
 
 	void clearMemCache();
+
+	/// Number of nodes of this tree currently loaded in memory
+	quint32 loadedNodes() const { return _loadedNodes; }
+	/// Number of nodes currently loaded in memory by all trees of this type
+	static quint32 totalLoadedNodes() { return (int)_totalLoadedNodes; }
+	/**
+	 * Unload the least recently accessed subtrees until no more than maxNodes nodes
+	 * remain in memory. Subtrees containing changed nodes are kept, as well as the root.
+	 * Any pointer to the nodes of this tree may become invalid after this call.
+	 * Nodes are unloaded under the same lock left() and right() take to load them,
+	 * and since every access refreshes the path leading to a node, a walk in progress
+	 * only holds recently accessed nodes, which are unloaded last.
+	 */
+	void trimMemCache(quint32 maxNodes);
+
+friend class OrderedRBDBNode<T>;
 };
 
+template <class T> QAtomicInt OrderedRBDBTree<T>::_totalLoadedNodes(0);
+
+template <class T>
+typename OrderedRBDBTree<T>::Node *OrderedRBDBTree<T>::loadNode(quint32 rowid)
+{
+	if (_readAhead.contains(rowid)) return new Node(this, _readAhead.take(rowid));
+
+	Node *ret = 0;
+	foreach (const DBListEntry<T> &entry, _ldb->getEntryWithChildren(rowid)) {
+		if (entry.rowId == rowid) ret = new Node(this, entry);
+		else _readAhead[entry.rowId] = entry;
+	}
+	// Should never happen unless the DB is inconsistent - fall back to the single node loading
+	// to get the same behavior as before
+	if (!ret) ret = new Node(this, rowid);
+	return ret;
+}
+
+template <class T>
+void OrderedRBDBTree<T>::collectAccesses(const Node *node, QVector<quint32> &accesses) const
+{
+	if (node->_left) {
+		accesses << node->_left->_lastAccess;
+		collectAccesses(node->_left, accesses);
+	}
+	if (node->_right) {
+		accesses << node->_right->_lastAccess;
+		collectAccesses(node->_right, accesses);
+	}
+}
+
+template <class T>
+void OrderedRBDBTree<T>::unloadSubtree(Node *node)
+{
+	if (node->_left) unloadSubtree(node->_left);
+	if (node->_right) unloadSubtree(node->_right);
+	// Children read ahead would never be used
+	if (!node->_left && node->e.left) _readAhead.remove(node->e.left);
+	if (!node->_right && node->e.right) _readAhead.remove(node->e.right);
+	delete node;
+}
+
+template <class T>
+bool OrderedRBDBTree<T>::trimSubtree(Node *node, quint32 threshold)
+{
+	bool clean = !_changedNodes.contains(node);
+	// Every access to a node goes through its ancestors, so a subtree which root has not been
+	// accessed recently has not been accessed at all.
+	if (node->_left) {
+		bool leftClean = trimSubtree(node->_left, threshold);
+		if (leftClean && node->_left->_lastAccess < threshold) {
+			unloadSubtree(node->_left);
+			node->_left = 0;
+		}
+		clean = clean && leftClean;
+	}
+	if (node->_right) {
+		bool rightClean = trimSubtree(node->_right, threshold);
+		if (rightClean && node->_right->_lastAccess < threshold) {
+			unloadSubtree(node->_right);
+			node->_right = 0;
+		}
+		clean = clean && rightClean;
+	}
+	return clean;
+}
+
+template <class T>
+void OrderedRBDBTree<T>::trimMemCache(quint32 maxNodes)
+{
+	QMutexLocker ml(&_nodesLock);
+	if (_loadedNodes <= maxNodes || !_root) return;
+
+	// Find the access time under which subtrees must be unloaded
+	QVector<quint32> accesses;
+	accesses.reserve(_loadedNodes);
+	collectAccesses(_root, accesses);
+	if (accesses.isEmpty()) return;
+	qSort(accesses);
+	int toUnload = qMin(accesses.size() - 1, (int)(_loadedNodes - maxNodes));
+	trimSubtree(_root, accesses[toUnload]);
+}
+
 template <class T>
 void OrderedRBDBTree<T>::clearMemCache()
 {
+	QMutexLocker ml(&_nodesLock);
 	Node *current = _root;
 	while (current) {
 		if (current->_left) current = current->_left;
@@ -328,6 +507,7 @@ void OrderedRBDBTree<T>::clearMemCache()
 			current = parent;
 		}
 	}
+	_readAhead.clear();
 	// Restore the root node, otherwise the tree will not work anymore
 	if (_listInfo.rootId != 0) _root = new Node(const_cast<OrderedRBDBTree<T> *>(this), _listInfo.rootId);
 }
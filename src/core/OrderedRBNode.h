@@ -25,6 +25,8 @@
 
 #include <QtDebug>
 #include <QtGlobal>
+#include <QList>
+#include <QVector>
 
 #include "tagaini_config.h"
 
@@ -159,6 +161,12 @@ public:
 	Node *root() const { return _root; }
 	void setRoot(Node *node) { _root = node; }
 
+	bool createNodes(const QList<T> &values, QVector<Node *> &nodes)
+	{
+		foreach (const T &value, values) nodes << new Node(this, value);
+		return true;
+	}
+
 	bool aboutToChange() { return true; }
 	bool commitChanges() { return true; }
 	void removeNode(Node *node) { delete node; }
@@ -215,6 +223,28 @@ private:
 	void removeCase5(typename TreeBase::Node *parent, Side side);
 	void removeCase6(typename TreeBase::Node *parent, Side side);
 
+	/**
+	 * Returns the number of black nodes between node and its leaves, node included.
+	 */
+	static int blackHeight(const typename TreeBase::Node *node);
+	/**
+	 * Links the nodes in [from, to[ into a perfectly balanced subtree and returns its
+	 * root. Nodes are colored so that the subtree is a valid RB tree. Complexity: O(n)
+	 */
+	static typename TreeBase::Node *buildBalanced(const QVector<typename TreeBase::Node *> &nodes, int from, int to, int depth, int redDepth);
+	/**
+	 * Join the independant subtrees left and right using middle as a separator,
+	 * and returns the root of the resulting subtree.
+	 * Complexity: O(log n)
+	 */
+	typename TreeBase::Node *join(typename TreeBase::Node *left, typename TreeBase::Node *middle, typename TreeBase::Node *right);
+	/**
+	 * Split the subtree which root is node into two independant subtrees, left
+	 * receiving the index first items and right the remaining ones.
+	 * Complexity: O(log^2 n)
+	 */
+	void split(typename TreeBase::Node *node, unsigned int index, typename TreeBase::Node *&left, typename TreeBase::Node *&right);
+
 
 
 	bool _isBlack(const typename TreeBase::Node *const node) const
@@ -253,6 +283,13 @@ public:
 	 * TODO No test to check whether we are inserting out of bounds! (both inferior and superior)
 	 */
 	bool insert(const typename TreeBase::Node::ValueType &val, int index);
+	/**
+	 * Insert all the values of vals at index, in the same order. This is much faster than
+	 * inserting values one by one, as all the new nodes are first built into a balanced subtree
+	 * which is then spliced into the tree, and all changes are committed at once.
+	 * Complexity: O(m + log^2 n), m being the number of inserted values
+	 */
+	bool insertBatch(const QList<typename TreeBase::Node::ValueType> &vals, int index);
 	/**
 	 * Remove the value at position index. Returns true on success, false otherwise.
 	 * Complexity: O(log n)
@@ -637,6 +674,125 @@ void OrderedRBTree<TreeBase>::removeCase6(typename TreeBase::Node *parent, Side
 	}
 }
 
+template <class TreeBase>
+int OrderedRBTree<TreeBase>::blackHeight(const typename TreeBase::Node *node)
+{
+	int ret = 0;
+	// All paths have the same number of black nodes, so just follow the left one
+	while (node) {
+		if (node->color() == TreeBase::Node::BLACK) ++ret;
+		node = node->left();
+	}
+	return ret;
+}
+
+template <class TreeBase>
+typename TreeBase::Node *OrderedRBTree<TreeBase>::buildBalanced(const QVector<typename TreeBase::Node *> &nodes, int from, int to, int depth, int redDepth)
+{
+	if (from >= to) return 0;
+	int middle = (from + to) / 2;
+	typename TreeBase::Node *node = nodes[middle];
+	node->setLeft(buildBalanced(nodes, from, middle, depth + 1, redDepth));
+	node->setRight(buildBalanced(nodes, middle + 1, to, depth + 1, redDepth));
+	node->setLeftSize(middle - from);
+	// All the leaves are at the same depth, or one level above. Coloring the
+	// deepest level in red (unless it is complete) keeps the black height
+	// constant.
+	node->setColor(depth == redDepth ? TreeBase::Node::RED : TreeBase::Node::BLACK);
+	return node;
+}
+
+template <class TreeBase>
+typename TreeBase::Node *OrderedRBTree<TreeBase>::join(typename TreeBase::Node *left, typename TreeBase::Node *middle, typename TreeBase::Node *right)
+{
+	int lHeight = blackHeight(left), rHeight = blackHeight(right);
+
+	// Same black height, middle can just become the root
+	if (lHeight == rHeight) {
+		middle->setLeft(left);
+		middle->setRight(right);
+		middle->setLeftSize(size(left));
+		middle->setColor(TreeBase::Node::BLACK);
+		return middle;
+	}
+
+	typename TreeBase::Node *parent = 0, *current;
+	// Left tree is higher, follow its right spine until we find a black node
+	// which black height is the same as the right tree and put middle there
+	if (lHeight > rHeight) {
+		current = left;
+		while (current && !(current->color() == TreeBase::Node::BLACK && lHeight == rHeight)) {
+			if (current->color() == TreeBase::Node::BLACK) --lHeight;
+			parent = current;
+			current = current->right();
+		}
+		middle->setLeft(current);
+		middle->setRight(right);
+		middle->setLeftSize(size(current));
+		parent->setRight(middle);
+	}
+	// Right tree is higher, follow its left spine. The nodes we go through
+	// will have all the left tree and middle added to their left side.
+	else {
+		quint32 addedSize = size(left) + 1;
+		current = right;
+		while (current && !(current->color() == TreeBase::Node::BLACK && lHeight == rHeight)) {
+			if (current->color() == TreeBase::Node::BLACK) --rHeight;
+			current->setLeftSize(current->leftSize() + addedSize);
+			parent = current;
+			current = current->left();
+		}
+		middle->setLeft(left);
+		middle->setRight(current);
+		middle->setLeftSize(addedSize - 1);
+		parent->setLeft(middle);
+	}
+	// middle is attached as a red node, so the only property that can be
+	// violated is the red parent one - balance just as for insertion
+	middle->setColor(TreeBase::Node::RED);
+	insertCase1(middle);
+
+	// Rotations may have changed the root of the subtree
+	typename TreeBase::Node *root = middle;
+	while (root->parent()) root = root->parent();
+	return root;
+}
+
+template <class TreeBase>
+void OrderedRBTree<TreeBase>::split(typename TreeBase::Node *node, unsigned int index, typename TreeBase::Node *&left, typename TreeBase::Node *&right)
+{
+	if (!node) {
+		left = right = 0;
+		return;
+	}
+
+	// Detach both children from node and make them valid trees
+	typename TreeBase::Node *nLeft = node->left(), *nRight = node->right();
+	unsigned int leftSize = node->leftSize();
+	if (nLeft) {
+		node->setLeft(0);
+		nLeft->setParent(0);
+		nLeft->setColor(TreeBase::Node::BLACK);
+	}
+	if (nRight) {
+		node->setRight(0);
+		nRight->setParent(0);
+		nRight->setColor(TreeBase::Node::BLACK);
+	}
+	node->setLeftSize(0);
+
+	typename TreeBase::Node *sLeft, *sRight;
+	if (index <= leftSize) {
+		split(nLeft, index, sLeft, sRight);
+		left = sLeft;
+		right = join(sRight, node, nRight);
+	} else {
+		split(nRight, index - leftSize - 1, sLeft, sRight);
+		left = join(nLeft, node, sLeft);
+		right = sRight;
+	}
+}
+
 template <class TreeBase>
 const typename TreeBase::Node *OrderedRBTree<TreeBase>::getNode(int index) const
 {
@@ -775,6 +931,47 @@ bool OrderedRBTree<TreeBase>::insert(const typename TreeBase::Node::ValueType &v
 	return true;
 }
 
+template <class TreeBase>
+bool OrderedRBTree<TreeBase>::insertBatch(const QList<typename TreeBase::Node::ValueType> &vals, int index)
+{
+	if (vals.isEmpty()) return true;
+	if (index < 0 || (unsigned int)index > size()) return false;
+	if (!_tree.aboutToChange()) return false;
+
+	QVector<typename TreeBase::Node *> nodes;
+	nodes.reserve(vals.size());
+	if (!_tree.createNodes(vals, nodes)) {
+		_tree.abortChanges();
+		return false;
+	}
+
+	// Split the tree where the values must be inserted
+	typename TreeBase::Node *left, *right;
+	split(_tree.root(), index, left, right);
+
+	// The first and last new nodes are used to join the balanced subtree made of the
+	// other new nodes with both parts of the tree
+	typename TreeBase::Node *root;
+	if (nodes.size() == 1) root = join(left, nodes.first(), right);
+	else {
+		int count = nodes.size() - 2;
+		// Depth of the deepest level of the balanced subtree, which is colored red if incomplete
+		int redDepth = 0;
+		while ((2 << redDepth) - 1 < count) ++redDepth;
+		if ((2 << redDepth) - 1 == count) redDepth = -1;
+		typename TreeBase::Node *middle = buildBalanced(nodes, 1, nodes.size() - 1, 0, redDepth);
+		root = join(join(left, nodes.first(), middle), nodes.last(), right);
+	}
+	setRoot(root);
+
+	if (!_tree.commitChanges()) {
+		_tree.abortChanges();
+		return false;
+	}
+	CHECK_VALID
+	return true;
+}
+
 template <class TreeBase>
 bool OrderedRBTree<TreeBase>::remove(int index)
 {
@@ -17,6 +17,11 @@
 
 #include "core/Preferences.h"
 
+#include <QCoreApplication>
+#include <QtConcurrentRun>
+
+QAtomicInt PreferenceRoot::_changesCount;
+
 QMutex &_settingsMutex() {
 	static QMutex settingsMutex;
 	return settingsMutex;
@@ -26,3 +31,114 @@ QSettings &_prefsSettings() {
 	static QSettings prefsSettings(__ORGANIZATION_NAME, __APPLICATION_NAME);
 	return prefsSettings;
 }
+
+PreferencesStore::PreferencesStore() : QObject(), _notifyScheduled(false), _writesCount(0)
+{
+	_writeTimer.setSingleShot(true);
+	_writeTimer.setInterval(WriteDelay);
+	connect(&_writeTimer, SIGNAL(timeout()), this, SLOT(startWrite()));
+}
+
+PreferencesStore &PreferencesStore::instance()
+{
+	// Never deleted, as preferences may still be changed during static destruction
+	static PreferencesStore *store = new PreferencesStore();
+	return *store;
+}
+
+void PreferencesStore::write(const QString &key, const QVariant &value)
+{
+	if (!QCoreApplication::instance()) {
+		QMutexLocker locker(&_settingsMutex());
+		if (value.isValid()) _prefsSettings().setValue(key, value);
+		else _prefsSettings().remove(key);
+		++_writesCount;
+		return;
+	}
+
+	QMutexLocker locker(&_mutex);
+	bool scheduled = !_pending.isEmpty();
+	_pending[key] = value;
+	// The timer can only be started from the thread of the store
+	if (!scheduled) QMetaObject::invokeMethod(this, "scheduleWrite", Qt::AutoConnection);
+}
+
+bool PreferencesStore::pendingValue(const QString &key, QVariant &value)
+{
+	QMutexLocker locker(&_mutex);
+	if (!_pending.contains(key)) return false;
+	value = _pending[key];
+	return true;
+}
+
+void PreferencesStore::scheduleWrite()
+{
+	_writeTimer.start();
+}
+
+void PreferencesStore::startWrite()
+{
+	_writing = QtConcurrent::run(this, &PreferencesStore::writePending);
+}
+
+void PreferencesStore::writePending()
+{
+	// Hold the settings mutex from the moment values leave _pending so that
+	// readers see them either there or in the settings
+	QMutexLocker settingsLocker(&_settingsMutex());
+	QMap<QString, QVariant> values;
+	{
+		QMutexLocker locker(&_mutex);
+		values = _pending;
+		_pending.clear();
+	}
+	if (values.isEmpty()) return;
+	for (QMap<QString, QVariant>::const_iterator it = values.constBegin(); it != values.constEnd(); ++it) {
+		if (it.value().isValid()) _prefsSettings().setValue(it.key(), it.value());
+		else _prefsSettings().remove(it.key());
+	}
+	_prefsSettings().sync();
+	_writesCount += values.size();
+}
+
+void PreferencesStore::flush()
+{
+	_writing.waitForFinished();
+	writePending();
+}
+
+int PreferencesStore::writesCount()
+{
+	QMutexLocker locker(&_settingsMutex());
+	return _writesCount;
+}
+
+void PreferencesStore::changed(PreferenceRoot *pref)
+{
+	if (!QCoreApplication::instance()) {
+		pref->notifyChanged();
+		return;
+	}
+
+	QMutexLocker locker(&_mutex);
+	if (pref->_notifyPending) return;
+	pref->_notifyPending = true;
+	_changed << pref;
+	if (!_notifyScheduled) {
+		_notifyScheduled = true;
+		QMetaObject::invokeMethod(this, "notifyChanged", Qt::QueuedConnection);
+	}
+}
+
+void PreferencesStore::notifyChanged()
+{
+	QList<QPointer<PreferenceRoot> > changed;
+	{
+		QMutexLocker locker(&_mutex);
+		changed = _changed;
+		_changed.clear();
+		_notifyScheduled = false;
+		foreach (const QPointer<PreferenceRoot> &pref, changed) if (pref) pref->_notifyPending = false;
+	}
+	foreach (const QPointer<PreferenceRoot> &pref, changed) if (pref) pref->notifyChanged();
+}
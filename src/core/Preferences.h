@@ -23,6 +23,11 @@
 #include <QObject>
 #include <QSettings>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QMap>
+#include <QPointer>
+#include <QTimer>
+#include <QFuture>
 
 #define __ORGANIZATION_NAME "tagaini.net"
 #define __APPLICATION_NAME "Tagaini Jisho"
@@ -42,23 +47,98 @@ extern QSettings &_prefsSettings();
 class PreferenceRoot : public QObject
 {
 	Q_OBJECT
+private:
+	/// Set while a change notification is queued by PreferencesStore
+	bool _notifyPending;
+	void notifyChanged() { emit valueChanged(variantValue()); }
+
 protected:
+	static QAtomicInt _changesCount;
+
 	const QString _group;
 	const QString _name;
 	bool _isDefault;
 	
 public:
-	PreferenceRoot(const QString &group, const QString &name) : QObject(),  _group(group), _name(name) {}
+	PreferenceRoot(const QString &group, const QString &name) : QObject(), _notifyPending(false), _group(group), _name(name) {}
 	virtual ~PreferenceRoot() {}
 	const QString &group() const { return _group; }
 	const QString &name() const { return _name; }
+	/// Key of the preference in the settings file
+	QString key() const { return _group.isEmpty() ? _name : _group + "/" + _name; }
 	virtual QVariant variantValue() const = 0;
+	/**
+	 * Number of times a preference has changed since the program started.
+	 * Allows to know whether data computed from preferences is still valid.
+	 */
+	static int changesCount() { return _changesCount; }
 
 public slots:
 	virtual void setValue(QVariant newValue) = 0;
 
 signals:
+	/**
+	 * Emitted at most once per event loop iteration, whatever the number
+	 * of changes made to the preference during it.
+	 */
 	void valueChanged(QVariant newValue);
+
+	friend class PreferencesStore;
+};
+
+/**
+ * Coalesces the changes made to preferences.
+ *
+ * Preference values are cached by their PreferenceItem, so reading them
+ * never locks. Changes are recorded here and written to the settings
+ * file in batches by a background thread after WriteDelay milliseconds,
+ * so a preference changed many times in a row (e.g. by a slider) is only
+ * written once. Change notifications are also delayed to the next event
+ * loop iteration and emitted only once for all the changes made until
+ * then.
+ *
+ * When no application object exists, changes are written and notified
+ * immediately.
+ */
+class PreferencesStore : public QObject
+{
+	Q_OBJECT
+private:
+	QMutex _mutex;
+	/// Values waiting to be written, an invalid value meaning removal
+	QMap<QString, QVariant> _pending;
+	QList<QPointer<PreferenceRoot> > _changed;
+	bool _notifyScheduled;
+	QTimer _writeTimer;
+	QFuture<void> _writing;
+	int _writesCount;
+
+	PreferencesStore();
+	void writePending();
+
+private slots:
+	void scheduleWrite();
+	void startWrite();
+	void notifyChanged();
+
+public:
+	static const int WriteDelay = 500;
+
+	static PreferencesStore &instance();
+
+	/// Records the new value of the preference at key. An invalid value removes it.
+	void write(const QString &key, const QVariant &value);
+	/**
+	 * Returns true and sets value if a value is waiting to be written
+	 * for key. Must be called with _settingsMutex() held.
+	 */
+	bool pendingValue(const QString &key, QVariant &value);
+	/// Queues the emission of valueChanged() by pref
+	void changed(PreferenceRoot *pref);
+	/// Synchronously writes all the pending values to the settings file
+	void flush();
+	/// Number of values written to the settings file so far
+	int writesCount();
 };
 
 /**
@@ -73,13 +153,17 @@ private:
 
 public:
 	PreferenceItem(const QString &group, const QString &name, const T &defaultValue, bool persistent = false) : PreferenceRoot(group, name), _defaultValue(defaultValue) {
+		QVariant v;
 		_settingsMutex().lock();
-		_prefsSettings().beginGroup(_group);
-		QVariant v = _prefsSettings().value(_name, _defaultValue);
-		_value = v.value<T>();
-		_isDefault = !_prefsSettings().contains(name);
-		_prefsSettings().endGroup();
+		if (PreferencesStore::instance().pendingValue(key(), v)) _isDefault = !v.isValid();
+		else {
+			_prefsSettings().beginGroup(_group);
+			v = _prefsSettings().value(_name);
+			_isDefault = !_prefsSettings().contains(name);
+			_prefsSettings().endGroup();
+		}
 		_settingsMutex().unlock();
+		_value = _isDefault ? _defaultValue : v.value<T>();
 		if (_isDefault && persistent) set(value());
 	}
 	const T &value() const { return _value; }
@@ -90,28 +174,26 @@ public:
 	 */
 	void set(const T &newVal) {
 		bool toEmit(value() != newVal);
-		_settingsMutex().lock();
-		_prefsSettings().beginGroup(_group);
-		_prefsSettings().setValue(_name, newVal);
-		_prefsSettings().endGroup();
 		_value = newVal;
 		_isDefault = false;
-		_settingsMutex().unlock();
-		if (toEmit) emit valueChanged(value());
+		PreferencesStore::instance().write(key(), newVal);
+		if (toEmit) {
+			_changesCount.ref();
+			PreferencesStore::instance().changed(this);
+		}
 	}
 	/**
 	 * Reset the preference to its default value.
 	 */
 	void reset() {
 		bool toEmit(value() != defaultValue());
-		_settingsMutex().lock();
-		_prefsSettings().beginGroup(_group);
-		_prefsSettings().remove(_name);
-		_prefsSettings().endGroup();
 		_value = _defaultValue;
 		_isDefault = true;
-		_settingsMutex().unlock();
-		if (toEmit) emit valueChanged(value());
+		PreferencesStore::instance().write(key(), QVariant());
+		if (toEmit) {
+			_changesCount.ref();
+			PreferencesStore::instance().changed(this);
+		}
 	}
 
 	void setValue(QVariant newValue) {
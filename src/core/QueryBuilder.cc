@@ -54,7 +54,13 @@ bool QueryBuilder::Join::operator<(const Join &join) const
 
 bool QueryBuilder::Join::operator==(const Join &j) const
 {
-	return column1() == j.column1() && column2() == j.column2() && additionalCondition() == j.additionalCondition();
+	return column1() == j.column1() && column2() == j.column2() && additionalCondition() == j.additionalCondition() && subquery() == j.subquery();
+}
+
+QString QueryBuilder::Join::tableExpression() const
+{
+	if (subquery().isEmpty()) return table1();
+	return "(" + subquery() + ") AS " + table1();
 }
 
 QString QueryBuilder::Join::toString(const Column &with) const
@@ -68,7 +74,7 @@ QString QueryBuilder::Join::toString(const Column &with) const
 		res += "LEFT JOIN ";
 		break;
 	}
-	res += table1() + " ON (" + column1().toString() + " = ";
+	res += tableExpression() + " ON (" + column1().toString() + " = ";
 	if (!hasRightPart()) res += with.toString();
 	else res += column2().toString();
 	res += ")";
@@ -184,7 +190,7 @@ QString QueryBuilder::Statement::sqlStatementRightPart() const
 		res += " FROM ";
 
 		leftJoin = &jList[0];
-		res += leftJoin->column1().table();
+		res += leftJoin->tableExpression();
 
 		for (int i = 1; i < jList.size(); i++) {
 			const Join &j = jList[i];
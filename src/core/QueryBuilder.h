@@ -62,6 +62,7 @@ public:
 		Column _column1;
 		Column _column2;
 		QString _additionalCondition;
+		QString _subquery;
 		static QHash<QString, int> _tablePriority;
 
 	public:
@@ -87,6 +88,16 @@ public:
 		bool hasAdditionalCondition() const { return !_additionalCondition.isEmpty(); }
 		const QString &additionalCondition() const { return _additionalCondition; }
 
+		/**
+		 * Joins the result of a SELECT statement instead of a table. table1()
+		 * is then the alias of the subquery, through which its columns are
+		 * referred to.
+		 */
+		void setSubquery(const QString &subquery) { _subquery = subquery; }
+		const QString &subquery() const { return _subquery; }
+		/// Table or aliased subquery to use in the FROM or JOIN clause
+		QString tableExpression() const;
+
 		/**
 		 * Records a given priority for a database table. Tables priority
 		 * determines the order in which tables joins occur within a request -
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/ResultsCache.h"
+
+#include <QRegExp>
+
+ResultsCache::ResultsCache(int maxSets, int maxRefs) : _maxSets(maxSets), _maxRefs(maxRefs), _refsCount(0), _hits(0), _misses(0), _invalidations(0), _restoreTime(0)
+{
+}
+
+ResultsCache &ResultsCache::instance()
+{
+	static ResultsCache _instance;
+	return _instance;
+}
+
+QString ResultsCache::normalize(const QString &sql)
+{
+	return sql.simplified();
+}
+
+bool ResultsCache::dependsOnUserData(const QString &sql)
+{
+	static QRegExp userTables("\\b(training|notes|taggedEntries|tags|lists)\\b", Qt::CaseInsensitive);
+	return userTables.indexIn(sql) != -1;
+}
+
+void ResultsCache::remove(const QString &sql)
+{
+	QHash<QString, Results>::iterator it(_results.find(sql));
+	if (it == _results.end()) return;
+	_refsCount -= it->refs.size();
+	_results.erase(it);
+	_lru.removeOne(sql);
+}
+
+bool ResultsCache::lookup(const QString &sql, QVector<EntryRef> &refs, int &position)
+{
+	QString key(normalize(sql));
+	QHash<QString, Results>::const_iterator it(_results.constFind(key));
+	if (it == _results.constEnd()) {
+		++_misses;
+		return false;
+	}
+	if (it->changesCount != -1 && it->changesCount != Entry::changesCount()) {
+		remove(key);
+		++_invalidations;
+		++_misses;
+		return false;
+	}
+	refs = it->refs;
+	position = it->position;
+	_lru.removeOne(key);
+	_lru << key;
+	++_hits;
+	return true;
+}
+
+void ResultsCache::insert(const QString &sql, const QVector<EntryRef> &refs, int changesCount)
+{
+	// Sets that would take a large part of the cache are not worth it
+	if (refs.size() > _maxRefs / 2) return;
+	QString key(normalize(sql));
+	remove(key);
+	Results results;
+	results.refs = refs;
+	results.changesCount = dependsOnUserData(key) ? changesCount : -1;
+	results.position = 0;
+	_results.insert(key, results);
+	_lru << key;
+	_refsCount += refs.size();
+	while (_results.size() > _maxSets || _refsCount > _maxRefs) remove(_lru.first());
+}
+
+void ResultsCache::setPosition(const QString &sql, int position)
+{
+	QHash<QString, Results>::iterator it(_results.find(normalize(sql)));
+	if (it != _results.end()) it->position = position;
+}
+
+void ResultsCache::clear()
+{
+	_results.clear();
+	_lru.clear();
+	_refsCount = 0;
+}
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_RESULTSCACHE_H
+#define __CORE_RESULTSCACHE_H
+
+#include "core/EntriesCache.h"
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+/**
+ * Keeps the results of the last completed searches, so that going back
+ * and forth in the search history or running the same search again does
+ * not require running its query again.
+ *
+ * Results are identified by the normalized SQL statement that produced
+ * them. Results of statements that use user data (training, notes, tags)
+ * are dropped as soon as any entry changes, as they may not be accurate
+ * anymore. The number of stored result sets and the total number of
+ * results they contain are bounded, least recently used sets being
+ * evicted first.
+ *
+ * This class is not thread-safe and is meant to be used from the GUI
+ * thread only.
+ */
+class ResultsCache
+{
+private:
+	struct Results
+	{
+		QVector<EntryRef> refs;
+		/// Value of Entry::changesCount() when the results were stored,
+		/// or -1 if they do not depend on user data
+		int changesCount;
+		/// Row that was at the top of the view when leaving the results
+		int position;
+	};
+
+	QHash<QString, Results> _results;
+	/// Keys of _results, least recently used first
+	QList<QString> _lru;
+	int _maxSets;
+	int _maxRefs;
+	int _refsCount;
+
+	int _hits;
+	int _misses;
+	int _invalidations;
+	int _restoreTime;
+
+	void remove(const QString &sql);
+
+public:
+	static const int DefaultMaxSets = 20;
+	static const int DefaultMaxRefs = 500000;
+
+	ResultsCache(int maxSets = DefaultMaxSets, int maxRefs = DefaultMaxRefs);
+
+	static ResultsCache &instance();
+
+	/// Returns the key under which the results of sql are stored
+	static QString normalize(const QString &sql);
+	/// Returns true if the results of sql depend on the user database
+	static bool dependsOnUserData(const QString &sql);
+
+	/**
+	 * Looks up the results of sql. Returns true and sets refs and position
+	 * if they are stored and still valid.
+	 */
+	bool lookup(const QString &sql, QVector<EntryRef> &refs, int &position);
+	/**
+	 * Stores the complete results of sql. changesCount is the value of
+	 * Entry::changesCount() when the query of sql was issued, so that
+	 * results that missed changes made while it was running are dropped.
+	 */
+	void insert(const QString &sql, const QVector<EntryRef> &refs, int changesCount);
+	/// Remembers the top row of the view displaying the results of sql, if stored
+	void setPosition(const QString &sql, int position);
+	/// Records the time it took to display restored results, in milliseconds
+	void recordRestore(int msecs) { _restoreTime += msecs; }
+	void clear();
+
+	int size() const { return _results.size(); }
+	int refsCount() const { return _refsCount; }
+	int hits() const { return _hits; }
+	int misses() const { return _misses; }
+	/// Number of lookups that found results made invalid by user data changes
+	int invalidations() const { return _invalidations; }
+	/// Average time taken to display restored results, in milliseconds
+	qreal averageRestoreTime() const { return _hits ? _restoreTime / (qreal)_hits : 0.0; }
+};
+
+#endif
@@ -16,19 +16,29 @@
  */
 
 #include "core/ResultsList.h"
+#include "core/ResultsCache.h"
 
+#include <QTime>
 #include <QtDebug>
 
-ResultsList::ResultsList(QObject *parent) : QAbstractListModel(parent), entries(), displayedUntil(0), dbThread(), query(&dbThread)
+/// Number of results which user data is fetched at once
+#define PREFETCH_SIZE 50
+/// Maximum number of rows inserted at once while results are being received
+#define INSERT_CHUNK_SIZE 5000
+
+ResultsList::ResultsList(QObject *parent) : QAbstractListModel(parent), entries(), displayedUntil(0), _rowsIndexed(0), dbThread(), query(&dbThread), _currentChangesCount(0)
 {
 	connect(&timer, SIGNAL(timeout()),
 		this, SLOT(updateViews()));
 	timer.setInterval(100);
+	_changesTimer.setSingleShot(true);
+	_changesTimer.setInterval(0);
+	connect(&_changesTimer, SIGNAL(timeout()), this, SLOT(emitChanges()));
 	
 	// Results emitted by a query are added to us
 	connect(&query, SIGNAL(result(EntryRef)), this, SLOT(addResult(EntryRef)));
 	connect(&query, SIGNAL(firstResult()), this, SLOT(startReceive()));
-	connect(&query, SIGNAL(completed()), this, SLOT(endReceive()));
+	connect(&query, SIGNAL(completed()), this, SLOT(onQueryCompleted()));
 	connect(&query, SIGNAL(aborted()), this, SLOT(endReceive()));
 	connect(&query, SIGNAL(error(QString)), this, SLOT(endReceive()));
 }
@@ -46,8 +56,18 @@ QVariant ResultsList::data(const QModelIndex &index, int role) const
 	if (index.row() >= entries.size()) return QVariant();
 
 	if (role == Entry::EntryRefRole) return QVariant::fromValue(entries[index.row()]);
-	EntryPointer entry(entries[index.row()].get());
+	const EntryRef &ref = entries[index.row()];
+	// Views display the results in order, so fetch the user data of the
+	// following ones along with this one
+	if (!ref.isLoaded()) {
+		QList<EntryRef> refs;
+		int end = qMin(index.row() + PREFETCH_SIZE, entries.size());
+		for (int i = index.row(); i < end; i++) refs << entries[i];
+		EntriesCache::instance().prefetch(refs);
+	}
+	EntryPointer entry(ref.get());
 //	EntryPointer entry(0);
+	if (entry.data()) connect(entry.data(), SIGNAL(entryChanged(Entry *)), const_cast<ResultsList *>(this), SLOT(onEntryChanged(Entry *)), Qt::UniqueConnection);
 
 	switch (role) {
 	case Qt::BackgroundRole:
@@ -75,22 +95,52 @@ void ResultsList::addResult(EntryRef entry)
 	entries << entry;
 }
 
-void ResultsList::onEntryChanged(const EntryPointer &entry)
+int ResultsList::rowOf(const EntryRef &ref) const
+{
+	// Results are only appended until the list is cleared, so the index
+	// only needs to be completed with the new ones
+	for (; _rowsIndexed < entries.size(); _rowsIndexed++)
+		if (!_rows.contains(entries[_rowsIndexed])) _rows.insert(entries[_rowsIndexed], _rowsIndexed);
+	return _rows.value(ref, -1);
+}
+
+void ResultsList::onEntryChanged(Entry *entry)
+{
+	int row = rowOf(EntryRef(entry->type(), entry->id()));
+	// Rows not displayed yet will be up-to-date when they are inserted
+	if (row < 0 || row >= displayedUntil) return;
+	if (_changedRows.isEmpty()) _changesTimer.start();
+	_changedRows << row;
+}
+
+void ResultsList::emitChanges()
+{
+	qSort(_changedRows);
+	int i = 0;
+	while (i < _changedRows.size()) {
+		int first = _changedRows[i], last = first;
+		while (++i < _changedRows.size() && _changedRows[i] <= last + 1) last = _changedRows[i];
+		emit dataChanged(index(first), index(last));
+	}
+	_changedRows.clear();
+}
+
+void ResultsList::displayResults(int maxRows)
 {
-	int idx = entries.indexOf(EntryRef(entry));
-	QModelIndex itemIndex = createIndex(idx, 0);
-	emit dataChanged(itemIndex, itemIndex);
+	if (displayedUntil >= entries.size()) return;
+	int last = qMin(entries.size() - displayedUntil, maxRows) + displayedUntil - 1;
+	beginInsertRows(QModelIndex(), displayedUntil, last);
+	displayedUntil = last + 1;
+	endInsertRows();
 }
 
 void ResultsList::updateViews()
 {
 	// TODO Acquire mutex on entries to ensure consistency despite of
 	// multithreading?
-	if (displayedUntil < entries.size()) {
-		beginInsertRows(QModelIndex(), displayedUntil, entries.size());
-		endInsertRows();
-		displayedUntil = entries.size();
-	}
+	// Inserting the results by chunks keeps the views responsive while
+	// large queries are running
+	displayResults(INSERT_CHUNK_SIZE);
 }
 
 void ResultsList::startReceive()
@@ -101,21 +151,39 @@ void ResultsList::startReceive()
 void ResultsList::endReceive()
 {
 	timer.stop();
-	updateViews();
+	displayResults(entries.size());
 	emit queryEnded();	
 }
 
+void ResultsList::onQueryCompleted()
+{
+	endReceive();
+	if (!_currentSql.isEmpty()) ResultsCache::instance().insert(_currentSql, entries, _currentChangesCount);
+}
+
+void ResultsList::setPosition(int row)
+{
+	if (!_currentSql.isEmpty()) ResultsCache::instance().setPosition(_currentSql, qMax(row, 0));
+}
+
 void ResultsList::clear()
 {
+	_currentSql.clear();
 	if (entries.isEmpty()) return;
 
 	timer.stop();
-	beginRemoveRows(QModelIndex(), 0, entries.size() - 1);
-	// This is preferred to clear() because lists memory
-	// usage never shrinks
-	entries = QList<EntryRef>();
-	endRemoveRows();
-	displayedUntil = 0;
+	_changesTimer.stop();
+	_changedRows.clear();
+	if (displayedUntil > 0) beginRemoveRows(QModelIndex(), 0, displayedUntil - 1);
+	// This is preferred to clear() because the memory of vectors never
+	// shrinks
+	entries = QVector<EntryRef>();
+	_rows = QHash<EntryRef, int>();
+	_rowsIndexed = 0;
+	if (displayedUntil > 0) {
+		displayedUntil = 0;
+		endRemoveRows();
+	}
 }
 
 Qt::ItemFlags ResultsList::flags(const QModelIndex &index) const
@@ -150,9 +218,29 @@ void ResultsList::search(const QueryBuilder &qBuilder)
 	
 	// Clear the current set of results
 	clear();
+
+	QString sql(qBuilder.buildSqlStatement());
+	_currentSql = ResultsCache::normalize(sql);
+	// Changes made while the query runs may not be part of its results
+	_currentChangesCount = Entry::changesCount();
+
+	// Restore the results if the same search has been performed recently
+	QTime time;
+	time.start();
+	QVector<EntryRef> refs;
+	int position;
+	if (ResultsCache::instance().lookup(_currentSql, refs, position)) {
+		emit queryStarted();
+		entries = refs;
+		displayResults(entries.size());
+		ResultsCache::instance().recordRestore(time.elapsed());
+		emit queryEnded();
+		emit resultsRestored(position);
+		return;
+	}
 	
 	// And start the query!
-	query.exec(qBuilder.buildSqlStatement());
+	query.exec(sql);
 	emit queryStarted();
 }
 
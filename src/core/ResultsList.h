@@ -25,6 +25,8 @@
 
 #include <QAbstractListModel>
 #include <QList>
+#include <QVector>
+#include <QHash>
 #include <QTimer>
 #include <QMimeData>
 
@@ -36,24 +38,44 @@ class ResultsList : public QAbstractListModel
 {
 	Q_OBJECT
 private:
-	QList<EntryRef> entries;
+	QVector<EntryRef> entries;
 	QTimer timer;
+	/// Number of results that views know about
 	int displayedUntil;
 
+	/// Row of every result, built lazily by rowOf()
+	mutable QHash<EntryRef, int> _rows;
+	/// Number of results already indexed into _rows
+	mutable int _rowsIndexed;
+	/// Rows changed since dataChanged() has last been emitted
+	QList<int> _changedRows;
+	QTimer _changesTimer;
+
 	DatabaseThread dbThread;
 	ASyncEntryFinder query;
+	/// Normalized statement of the current results, used as their key in ResultsCache
+	QString _currentSql;
+	/// Value of Entry::changesCount() when the current query was issued
+	int _currentChangesCount;
 
 	void startPreparedQuery();
+	/// Makes at most maxRows more results visible to the views
+	void displayResults(int maxRows);
+	/// Returns the row of ref, or -1 if it is not part of the results
+	int rowOf(const EntryRef &ref) const;
 	
 protected slots:
 	void updateViews();
-	void onEntryChanged(const EntryPointer &entry);
+	/// Emits dataChanged() for the rows changed so far, merging adjacent ones
+	void emitChanges();
+	/// Stores the complete results of the query into ResultsCache
+	void onQueryCompleted();
 
 public:
 	ResultsList(QObject *parent = 0);
 	~ResultsList();
 
-	int rowCount(const QModelIndex &parent = QModelIndex()) const { return nbResults(); }
+	int rowCount(const QModelIndex &parent = QModelIndex()) const { return displayedUntil; }
 	int nbResults() const { return entries.size(); }
 	QVariant data(const QModelIndex &index, int role) const;
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
@@ -69,10 +91,27 @@ public slots:
 	void endReceive();
 	void addResult(EntryRef entry);
 	void clear();
+	/**
+	 * Updates the row of entry, if it is part of the results. Changes are
+	 * notified to the views once control returns to the event loop, so
+	 * bulk changes result in a few dataChanged() signals.
+	 */
+	void onEntryChanged(Entry *entry);
+	/**
+	 * Remembers the row at the top of the view displaying the results, so
+	 * it can be restored if the same search is performed again.
+	 */
+	void setPosition(int row);
 
 signals:
 	void queryStarted();
 	void queryEnded();
+	/**
+	 * Emitted when the results of a search have been restored from
+	 * ResultsCache instead of running its query. position is the row that
+	 * was at the top of the view when the results were left.
+	 */
+	void resultsRestored(int position);
 };
 
 #endif
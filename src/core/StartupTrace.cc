@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/StartupTrace.h"
+
+#include <QThread>
+#include <QCoreApplication>
+#include <QMutexLocker>
+
+#include <stdio.h>
+
+bool StartupTrace::_enabled = false;
+QTime StartupTrace::_start;
+int StartupTrace::_last = 0;
+QMutex StartupTrace::_mutex;
+
+void StartupTrace::enable()
+{
+	_start.start();
+	_last = 0;
+	_enabled = true;
+}
+
+void StartupTrace::phase(const char *name)
+{
+	if (!_enabled) return;
+	QMutexLocker locker(&_mutex);
+	int now = _start.elapsed();
+	bool mainThread = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+	fprintf(stderr, "Startup: %6d ms (+%5d ms) %s%s\n", now, now - _last, name, mainThread ? "" : " [background]");
+	_last = now;
+}
@@ -0,0 +1,45 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_STARTUPTRACE_H
+#define __CORE_STARTUPTRACE_H
+
+#include <QTime>
+#include <QMutex>
+
+/**
+ * Prints a timeline of the startup phases on the standard error output
+ * when the --startup-trace option is given. Phases may be reported from
+ * background initialization tasks as well.
+ */
+class StartupTrace
+{
+private:
+	static bool _enabled;
+	static QTime _start;
+	static int _last;
+	static QMutex _mutex;
+
+public:
+	/// Starts the timeline. Must be called as early as possible.
+	static void enable();
+	static bool enabled() { return _enabled; }
+	/// Reports that the phase named name has just completed.
+	static void phase(const char *name);
+};
+
+#endif
@@ -19,16 +19,67 @@
 #include "core/Database.h"
 #include "core/Tag.h"
 #include "core/Entry.h"
+#include "core/StartupTrace.h"
+
+#include "sqlite/Query.h"
+
+#include <QtConcurrentRun>
+#include <QtAlgorithms>
+#include <QRegExp>
+#include <QMutexLocker>
+#include <QSet>
 
 Tag Tag::_invalid(0, "");
 TagsListModel Tag::knownTags;
+bool Tag::_knownTagsLoaded = false;
+TagsIndex Tag::_index;
+SQLite::Connection Tag::_indexConnection;
+QFuture<void> Tag::_indexLoading;
+
+static bool caseInsensitiveLessThan(const QString &s1, const QString &s2)
+{
+	return s1.compare(s2, Qt::CaseInsensitive) < 0;
+}
+
+bool TagsListModel::contains(const QString &str) const
+{
+	QStringList::const_iterator it(qLowerBound(_data.constBegin(), _data.constEnd(), str, caseInsensitiveLessThan));
+	return it != _data.constEnd() && !it->compare(str, Qt::CaseInsensitive);
+}
+
+bool TagsListModel::containsMatch(const QString &str) const
+{
+	// Prefix patterns are looked up using the sort order
+	QString prefix(str.left(str.size() - 1));
+	if (str.endsWith('*') && !prefix.contains(QRegExp("[*?\\[]"))) {
+		QStringList::const_iterator it(qLowerBound(_data.constBegin(), _data.constEnd(), prefix, caseInsensitiveLessThan));
+		return it != _data.constEnd() && it->startsWith(prefix, Qt::CaseInsensitive);
+	}
+	return _data.indexOf(QRegExp(str, Qt::CaseInsensitive, QRegExp::Wildcard)) != -1;
+}
 
 void TagsListModel::operator<<(const QString &str)
 {
-	 if (!_data.contains(str)) {
-		 _data << str;
-		 qSort(_data.begin(), _data.end());
-	 }
+	QStringList::iterator it(qLowerBound(_data.begin(), _data.end(), str, caseInsensitiveLessThan));
+	if (it != _data.end() && !it->compare(str, Qt::CaseInsensitive)) return;
+	int row = it - _data.begin();
+	beginInsertRows(QModelIndex(), row, row);
+	_data.insert(row, str);
+	endInsertRows();
+}
+
+void TagsListModel::operator<<(const QStringList &strs)
+{
+	QSet<QString> known;
+	foreach (const QString &str, _data) known << str.toLower();
+	foreach (const QString &str, strs) {
+		QString lower(str.toLower());
+		if (known.contains(lower)) continue;
+		known << lower;
+		_data << str;
+	}
+	qSort(_data.begin(), _data.end(), caseInsensitiveLessThan);
+	reset();
 }
 
 QVariant TagsListModel::data(const QModelIndex &index, int role) const
@@ -37,35 +88,201 @@ QVariant TagsListModel::data(const QModelIndex &index, int role) const
 	return QVariant();
 }
 
-void Tag::init()
+TagsIndex::TagsIndex(SQLite::Connection *connection) : _connection(connection), _loaded(0)
 {
-	SQLite::Query query(Database::connection());
-	query.exec("select tag from tags");
+}
+
+void TagsIndex::setConnection(SQLite::Connection *connection)
+{
+	QMutexLocker ml(&_lock);
+	_connection = connection;
+	_names.clear();
+	_ids.clear();
+	_entries.clear();
+	_loaded = 0;
+}
+
+void TagsIndex::ensureLoaded()
+{
+	if (_loaded) return;
+	QMutexLocker ml(&_lock);
+	if (!_loaded) load();
+}
+
+void TagsIndex::load()
+{
+	_names.clear();
+	_ids.clear();
+	_entries.clear();
+	if (!_connection) return;
+
+	SQLite::Query query(_connection);
+	if (!query.exec("select docid, tag from tags")) return;
 	while (query.next()) {
-		knownTags << query.valueString(0);
+		quint32 id = query.valueUInt(0);
+		QString name(query.valueString(1));
+		_names[id] = name;
+		_ids[name.toLower()] = id;
+	}
+	if (!query.exec("select type, id, tagId from taggedEntries")) return;
+	while (query.next()) _entries[query.valueUInt(2)][query.valueUInt(0)].insert(query.valueUInt(1));
+	_loaded = 1;
+}
+
+void TagsIndex::invalidate()
+{
+	QMutexLocker ml(&_lock);
+	_names.clear();
+	_ids.clear();
+	_entries.clear();
+	_loaded = 0;
+}
+
+QString TagsIndex::name(quint32 id)
+{
+	ensureLoaded();
+	QMutexLocker ml(&_lock);
+	return _names.value(id);
+}
+
+quint32 TagsIndex::id(const QString &name)
+{
+	ensureLoaded();
+	QMutexLocker ml(&_lock);
+	return _ids.value(name.toLower());
+}
+
+QStringList TagsIndex::names()
+{
+	ensureLoaded();
+	QMutexLocker ml(&_lock);
+	return _names.values();
+}
+
+void TagsIndex::tagCreated(quint32 id, const QString &name)
+{
+	QMutexLocker ml(&_lock);
+	// Nothing to do if the index is not loaded yet - it will include the tag
+	if (!_loaded) return;
+	_names[id] = name;
+	_ids[name.toLower()] = id;
+}
+
+void TagsIndex::tagsRemoved(const QList<quint32> &ids)
+{
+	QMutexLocker ml(&_lock);
+	if (!_loaded) return;
+	foreach (quint32 id, ids) {
+		QString lower(_names.take(id).toLower());
+		if (_ids.value(lower) == id) _ids.remove(lower);
+		_entries.remove(id);
+	}
+}
+
+void TagsIndex::entryTagged(quint8 type, quint32 id, quint32 tagId)
+{
+	QMutexLocker ml(&_lock);
+	if (!_loaded) return;
+	_entries[tagId][type].insert(id);
+}
+
+void TagsIndex::entryUntagged(quint8 type, quint32 id)
+{
+	QMutexLocker ml(&_lock);
+	if (!_loaded) return;
+	QHash<quint32, QHash<quint8, IdBitmap> >::iterator it;
+	for (it = _entries.begin(); it != _entries.end(); ++it) {
+		QHash<quint8, IdBitmap>::iterator bit(it.value().find(type));
+		if (bit != it.value().end()) bit.value().remove(id);
+	}
+}
+
+QList<quint32> TagsIndex::matchingTags(const QString &pattern) const
+{
+	QList<quint32> ret;
+	if (!pattern.contains(QRegExp("[*?\\[]"))) {
+		quint32 id = _ids.value(pattern.toLower());
+		if (id) ret << id;
+		return ret;
+	}
+	QRegExp regExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+	QHash<quint32, QString>::const_iterator it;
+	for (it = _names.constBegin(); it != _names.constEnd(); ++it)
+		if (regExp.exactMatch(it.value())) ret << it.key();
+	return ret;
+}
+
+IdBitmap TagsIndex::entries(quint8 type, const QStringList &patterns)
+{
+	ensureLoaded();
+	QMutexLocker ml(&_lock);
+	IdBitmap ret;
+	for (int i = 0; i < patterns.size(); i++) {
+		IdBitmap matches;
+		foreach (quint32 tagId, matchingTags(patterns[i])) matches |= _entries.value(tagId).value(type);
+		if (i == 0) ret = matches;
+		else ret &= matches;
+		if (ret.isEmpty()) break;
+	}
+	return ret;
+}
+
+IdBitmap TagsIndex::entries(quint8 type)
+{
+	ensureLoaded();
+	QMutexLocker ml(&_lock);
+	IdBitmap ret;
+	QHash<quint32, QHash<quint8, IdBitmap> >::const_iterator it;
+	for (it = _entries.constBegin(); it != _entries.constEnd(); ++it) ret |= it.value().value(type);
+	return ret;
+}
+
+void Tag::loadIndex()
+{
+	_index.preload();
+	StartupTrace::phase("Tags index loaded");
+}
+
+void Tag::init()
+{
+	// Database::connection() cannot be used from the loading thread
+	if (!Database::connectLoader(_indexConnection, QMap<QString, QString>())) {
+		_index.setConnection(Database::connection());
+		return;
 	}
+	_index.setConnection(&_indexConnection);
+	_indexLoading = QtConcurrent::run(&Tag::loadIndex);
+}
+
+TagsListModel *Tag::knownTagsModel()
+{
+	if (!_knownTagsLoaded) {
+		knownTags << _index.names();
+		_knownTagsLoaded = true;
+	}
+	return &knownTags;
 }
 
 void Tag::cleanup()
 {
+	_indexLoading.waitForFinished();
+	_indexLoading = QFuture<void>();
+	_index.setConnection(0);
+	if (_indexConnection.connected()) _indexConnection.close();
 }
 
 Tag Tag::getTag(const QString &tagString)
 {
-	SQLite::Query query(Database::connection());
-
-	query.exec(QString("select docid, tag from tags where tag match '%1'").arg(tagString));
-	if (!query.next()) return _invalid;
-	return Tag(query.valueInt(0), query.valueString(1));
+	quint32 id = _index.id(tagString);
+	if (!id) return _invalid;
+	return Tag(id, _index.name(id));
 }
 
 Tag Tag::getTag(quint32 id)
 {
-	SQLite::Query query(Database::connection());
-
-	query.exec(QString("select docid, tag from tags where docid = %1").arg(id));
-	if (!query.next()) return _invalid;
-	return Tag(query.valueInt(0), query.valueString(1));
+	QString name(_index.name(id));
+	if (name.isNull()) return _invalid;
+	return Tag(id, name);
 }
 
 Tag Tag::getOrCreateTag(const QString &tagString)
@@ -74,17 +291,16 @@ Tag Tag::getOrCreateTag(const QString &tagString)
 	if (tag.isValid()) return tag;
 
 	SQLite::Query query(Database::connection());
-	if (!query.exec(QString("insert into tags values('%1')").arg(tagString))) {
-		qCritical() << "Error executing query: " << query.lastError().message();
-		return _invalid;
-	}
-	if (!query.exec(QString("select docid from tags where tag match '%1'").arg(tagString))) {
+	query.prepare("insert into tags values(?)");
+	query.bindValue(tagString);
+	if (!query.exec()) {
 		qCritical() << "Error executing query: " << query.lastError().message();
 		return _invalid;
 	}
-	query.next();
-	int id = query.valueInt(0);
-	knownTags << tagString;
+	quint32 id = query.lastInsertId();
+	_index.tagCreated(id, tagString);
+	// Otherwise the new tag will be loaded along with the others
+	if (_knownTagsLoaded) knownTags << tagString;
 	return Tag(id, tagString);
 }
 
@@ -25,6 +25,15 @@
 #include <QStringList>
 #include <QAbstractItemModel>
 #include <QCoreApplication>
+#include <QFuture>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include "core/IdBitmap.h"
+
+namespace SQLite {
+class Connection;
+}
 
 /**
  * Provides a model of all the tags that we met so far for the completer.
@@ -40,15 +49,86 @@ public:
 	virtual ~TagsListModel() {}
 	int rowCount(const QModelIndex &parent = QModelIndex()) const { return _data.size(); }
 	QVariant data(const QModelIndex &index, int role) const;
-	bool contains(const QString &str) const { return _data.contains(str, Qt::CaseInsensitive); }
-	bool containsMatch(const QString &str) const { return _data.indexOf(QRegExp(str, Qt::CaseInsensitive, QRegExp::Wildcard)) != -1; }
+	/// Tags are kept sorted case-insensitively, so lookups and completions
+	/// can be done by binary search
+	bool contains(const QString &str) const;
+	bool containsMatch(const QString &str) const;
 	const QStringList &contents() const { return _data; }
 
 	void operator<<(const QString &str);
+	void operator<<(const QStringList &strs);
 };
 
 class Entry;
 
+/**
+ * In-memory registry of all the tags of the user database, along with the
+ * entries each of them is applied to.
+ *
+ * The whole registry is loaded in a single pass the first time it is used,
+ * and then kept up-to-date incrementally as tags are created, applied and
+ * removed. Tag names are matched case-insensitively, like the FTS index of
+ * the tags table does.
+ *
+ * Methods of this class are thread-safe.
+ */
+class TagsIndex
+{
+private:
+	SQLite::Connection *_connection;
+	QAtomicInt _loaded;
+	QHash<quint32, QString> _names;
+	/// Ids of the tags, by lowercase name
+	QHash<QString, quint32> _ids;
+	/// For each tag, the ids of the entries it applies to, by entry type
+	QHash<quint32, QHash<quint8, IdBitmap> > _entries;
+	QMutex _lock;
+
+	void ensureLoaded();
+	void load();
+	/// Returns the ids of the tags matching pattern, which may contain wildcards
+	QList<quint32> matchingTags(const QString &pattern) const;
+
+public:
+	/**
+	 * Creates an index of the tags of connection. The connection is only
+	 * used while the index is locked, so it may be loaded from any thread
+	 * if the connection is dedicated to the index.
+	 */
+	TagsIndex(SQLite::Connection *connection = 0);
+
+	void setConnection(SQLite::Connection *connection);
+	/// Loads the index right now instead of waiting for it to be needed
+	void preload() { ensureLoaded(); }
+	/// Drops the index, so it gets reloaded from the database the next time
+	/// it is used
+	void invalidate();
+
+	/// Returns the name of the tag which id is given, or a null string
+	QString name(quint32 id);
+	/// Returns the id of the tag named name, or 0 if no such tag exists
+	quint32 id(const QString &name);
+	QStringList names();
+
+	/// Records that a new tag has been inserted into the database
+	void tagCreated(quint32 id, const QString &name);
+	/// Records that the given tags have been removed from the database
+	void tagsRemoved(const QList<quint32> &ids);
+	/// Records that an entry has been tagged with tagId
+	void entryTagged(quint8 type, quint32 id, quint32 tagId);
+	/// Records that all the tags of an entry have been removed
+	void entryUntagged(quint8 type, quint32 id);
+
+	/**
+	 * Returns the ids of the entries of the given type that have, for each
+	 * of the patterns, at least one tag matching it. Patterns may contain
+	 * wildcards.
+	 */
+	IdBitmap entries(quint8 type, const QStringList &patterns);
+	/// Returns the ids of the entries of the given type that have any tag
+	IdBitmap entries(quint8 type);
+};
+
 /**
  * A tag that can be applied to entries, giving a way to group them
  * according to the user's preference.
@@ -60,6 +140,13 @@ private:
 	static Tag _invalid;
 	/// A set of all the tags we know, used for auto-completion
 	static TagsListModel knownTags;
+	static bool _knownTagsLoaded;
+	static TagsIndex _index;
+	/// Connection the index is loaded from, so that it can be loaded outside of the main thread
+	static SQLite::Connection _indexConnection;
+	/// Index being loaded in the background by init()
+	static QFuture<void> _indexLoading;
+	static void loadIndex();
 
 	quint32 _id;
 	QString _name;
@@ -68,9 +155,14 @@ private:
 	Tag(quint32 id, const QString &name) : _id(id), _name(name) {}
 
 public:
+	/**
+	 * Starts loading the tags index in the background. Methods that need
+	 * the index block until it is loaded.
+	 */
 	static void init();
 	static void cleanup();
-	static TagsListModel *knownTagsModel() { return &knownTags; }
+	static TagsListModel *knownTagsModel();
+	static TagsIndex &index() { return _index; }
 
 	quint32 id() const { return _id; }
 	const QString &name() const { return _name; }
@@ -93,6 +185,11 @@ public:
 	 */
 	static Tag getTag(const QString &tagString);
 
+	/**
+	 * Returns the tag which id is given, or the invalid tag if none
+	 * exists. This method never accesses the database once the index
+	 * is loaded.
+	 */
 	static Tag getTag(quint32 id);
 
 	/**
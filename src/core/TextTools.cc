@@ -358,6 +358,21 @@ QString hiragana2Katakana(const QString &hira)
 	return kata;
 }
 
+QChar katakanaChar2Hiragana(const QChar kata)
+{
+	ushort code(kata.unicode());
+	// Only katakana that have a hiragana counterpart are converted
+	if (code < 0x30a1 || code > 0x30f6) return kata;
+	return QChar(code - 0x60);
+}
+
+QString katakana2Hiragana(const QString &kata)
+{
+	QString hira(kata.size());
+	for (int i = 0; i < kata.size(); i++) hira[i] = katakanaChar2Hiragana(kata[i]);
+	return hira;
+}
+
 QString unicodeToSingleChar(unsigned int unicode)
 {
 	QString ret;
@@ -562,4 +577,22 @@ QString romajiToKana(const QString &src)
 	return ret;
 }
 
+QStringList ftsTokens(const QString &text)
+{
+	QStringList ret;
+	QString token;
+	for (int i = 0; i <= text.size(); i++) {
+		ushort c = i < text.size() ? text[i].unicode() : 0;
+		// Only ASCII characters are case-folded
+		if (c >= 0x80) token += text[i];
+		else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) token += QChar(c);
+		else if (c >= 'A' && c <= 'Z') token += QChar(c - 'A' + 'a');
+		else if (!token.isEmpty()) {
+			ret << token;
+			token.clear();
+		}
+	}
+	return ret;
+}
+
 }
@@ -20,6 +20,7 @@
 
 #include <QChar>
 #include <QString>
+#include <QStringList>
 
 namespace TextTools {
 	/**
@@ -66,12 +67,22 @@ namespace TextTools {
 
 	QChar hiraganaChar2Katakana(const QChar hira);
 	QString hiragana2Katakana(const QString &hira);
+	QChar katakanaChar2Hiragana(const QChar kata);
+	QString katakana2Hiragana(const QString &kata);
 
 	QString unicodeToSingleChar(unsigned int unicode);
 	unsigned int singleCharToUnicode(const QString &chr, int pos = 0);
 
 	QString romajiToKana(const QString &src);
 
+	/**
+	 * Splits text into words the way the simple full-text search tokenizer
+	 * does: ASCII letters and digits, as well as all non-ASCII characters,
+	 * are part of words, other characters separate them. ASCII letters
+	 * are lowercased.
+	 */
+	QStringList ftsTokens(const QString &text);
+
 	class KanaInfo  {
 	public:
 		typedef enum { Small, Normal } Size;
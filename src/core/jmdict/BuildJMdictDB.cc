@@ -18,7 +18,9 @@
 #include "sqlite/Connection.h"
 #include "sqlite/Query.h"
 #include "sqlite/SQLite.h"
+#include "sqlite/DictionaryCodec.h"
 #include "core/TextTools.h"
+#include "core/DoubleArrayTrie.h"
 #include "core/jmdict/JMdictParser.h"
 #include "core/jmdict/JMdictEntry.h"
 
@@ -55,6 +57,7 @@ public:
 	bool createLanguagesDatabases();
 	bool createLanguagesTables();
 	bool createLanguagesIndexes();
+	bool compressGlosses();
 	bool finalizeLanguagesDatabases();
 	bool prepareLanguagesQueries();
 	bool clearLanguagesQueries();
@@ -63,7 +66,9 @@ public:
 	bool parseJMF(const QString &fname, const QString &lang);
 	bool insertJLPTLevel(const QString& fName, int level);
 	bool insertJLPTLevels();
+	bool createKanjiWordsTable();
 	bool populateEntitiesTable();
+	bool writeWordsIndex();
 private:
 	QMap<QString, SQLite::Connection> connections;
 	QString dstDir, srcDir;
@@ -81,6 +86,10 @@ private:
 	QMap<QString, SQLite::Query> insertGlossesQueries;
 	// lang ; id ; pri ; str
 	QMap<QString, QMap<int, QMap<int, QStringList> > > jmf;
+	// writing or reading ; ids of the entries using it
+	QMap<QString, QList<quint32> > words;
+	// lang ; gloss term ; number of occurrences
+	QMap<QString, QMap<QString, QList<quint32> > > glossTerms;
 	
 	bool openDatabase(QString databaseName, QString handle);
 	bool closeDatabase(QString handle);
@@ -100,6 +109,7 @@ bool JMdictDBParser::onItemParsed(const JMdictItem &entry)
 		BIND(insertKanjiQuery, rowId);
 		AUTO_BIND(insertKanjiQuery, kWriting.frequency, 0);
 		EXEC(insertKanjiQuery);
+		if (!words[kWriting.writing].contains(entry.id)) words[kWriting.writing] << entry.id;
 		
 		// Insert kanji mappings
 		for (int i = 0; i < kWriting.writing.size(); ) {
@@ -134,6 +144,7 @@ bool JMdictDBParser::onItemParsed(const JMdictItem &entry)
 		foreach (quint8 res, kReading.restrictedTo) restrictedToList << QString::number(res);
 		AUTO_BIND(insertKanaQuery, restrictedToList.join(","), "");
 		EXEC(insertKanaQuery);
+		if (!words[kReading.reading].contains(entry.id)) words[kReading.reading] << entry.id;
 		++idx;
 	}
 	
@@ -168,20 +179,27 @@ bool JMdictDBParser::onItemParsed(const JMdictItem &entry)
 				continue;
 			}
 			allGlosses[lang] << glosses.join("\n");
+			foreach (const QString &term, TextTools::ftsTokens(glosses.join(", "))) {
+				QList<quint32> &count = glossTerms[lang][term];
+				if (count.isEmpty()) count << 0;
+				++count[0];
+			}
 			BIND(insertGlossTextQueries[lang], glosses.join(", "));
 			EXEC(insertGlossTextQueries[lang]);
 			BIND(insertGlossQueries[lang], entry.id);
+			BIND(insertGlossQueries[lang], idx);
 			BIND(insertGlossQueries[lang], insertGlossTextQueries[lang].lastInsertId());
 			EXEC(insertGlossQueries[lang]);
 		}
 		++idx;
 	}
-	// For every language, insert all glosses of an entry (load table)
+	// For every language, insert all glosses of an entry (load table). They
+	// are compressed by compressGlosses() once all entries are known.
 	foreach (const QString &lang, languages) {
 		QString all(allGlosses[lang].join("\n\n"));
 		if (all.split("\n", QString::SkipEmptyParts).empty()) continue;
 		BIND(insertGlossesQueries[lang], entry.id);
-		BIND(insertGlossesQueries[lang], qCompress(all.toUtf8(), 9));
+		BIND(insertGlossesQueries[lang], all.toUtf8());
 		EXEC(insertGlossesQueries[lang])
 	}
 	
@@ -232,6 +250,49 @@ bool JMdictDBParser::insertJLPTLevels()
 	return true;	
 }
 
+/**
+ * Materializes the words using each kanji, in the order they are displayed
+ * by the kanji detailed view. The rank column being the rowid, the words of
+ * a given kanji are inserted by decreasing JLPT level and frequency so that
+ * the runtime only has to sort them against the training data. The misc
+ * field of the first sense is kept so that filtered words can be skipped.
+ * Must be run after the JLPT levels have been inserted.
+ */
+bool JMdictDBParser::createKanjiWordsTable()
+{
+	SQLite::Query query(&connections["main"]);
+	EXEC_STMT(query, "insert into kanjiWords(kanji, id, misc) "
+		"select kanjiChar.kanji, entries.id, senses.misc from kanjiChar "
+		"join entries on kanjiChar.id = entries.id "
+		"join senses on senses.id = entries.id and senses.priority = 0 "
+		"left join jlpt on jlpt.id = entries.id "
+		"where kanjiChar.priority = 0 "
+		"group by kanjiChar.kanji, entries.id, senses.misc "
+		"order by kanjiChar.kanji, jlpt.level DESC, entries.frequency DESC");
+	return true;
+}
+
+/**
+ * Writes the trie of all writings and readings used by the text analyzer
+ * next to the main database, so it can be memory-mapped at runtime.
+ */
+bool JMdictDBParser::writeWordsIndex()
+{
+	// Stamped with the dictionary version, so the program can tell whether
+	// the files match the database
+	quint32 sourceVersion = jmdictVersionNumber(dictVersion());
+	DoubleArrayTrie trie;
+	ASSERT(trie.build(words, JMDICTDB_REVISION, sourceVersion));
+	ASSERT(trie.save(QDir(dstDir).absoluteFilePath("jmdict.trie")));
+	// Vocabulary of the glosses of every language, for fuzzy searches
+	foreach (const QString &lang, languages) {
+		DoubleArrayTrie terms;
+		ASSERT(terms.build(glossTerms[lang], JMDICTDB_REVISION, sourceVersion));
+		ASSERT(terms.save(QDir(dstDir).absoluteFilePath(QString("jmdict-%1.terms").arg(lang))));
+	}
+	return true;
+}
+
 bool JMdictDBParser::openDatabase(QString databaseName, QString handle)
 {	
 	QString dbFile = QDir(dstDir).absoluteFilePath(QString(databaseName));
@@ -311,6 +372,7 @@ bool JMdictDBParser::createMainTables()
 	EXEC_STMT(query, "create table senses(id INTEGER SECONDARY KEY REFERENCES entries, priority TINYINT, pos INT, misc INT, dial INT, field INT, restrictedToKanji TEXT, restrictedToKana TEXT)");
 	EXEC_STMT(query, "create table kanjiChar(kanji INTEGER, id INTEGER SECONDARY KEY REFERENCES entries, priority INT)");
 	EXEC_STMT(query, "create table jlpt(id INTEGER PRIMARY KEY, level TINYINT)");
+	EXEC_STMT(query, "create table kanjiWords(rank INTEGER PRIMARY KEY, kanji INTEGER, id INTEGER REFERENCES entries, misc INT)");
 	EXEC_STMT(query, "create table deletedEntries(id INTEGER PRIMARY KEY, movedTo INTEGER REFERENCES entries)");
 	return true;
 }
@@ -325,6 +387,7 @@ bool JMdictDBParser::createMainIndexes()
 	EXEC_STMT(query, "create index idx_kanjichar on kanjiChar(kanji)");
 	EXEC_STMT(query, "create index idx_kanjichar_id on kanjiChar(id)");
 	EXEC_STMT(query, "create index idx_jlpt on jlpt(level)");
+	EXEC_STMT(query, "create index idx_kanjiwords on kanjiWords(kanji)");
 	return true;
 }
 
@@ -338,7 +401,7 @@ bool JMdictDBParser::prepareLanguagesQueries()
 	foreach (const QString &lang, languages) {
 #define PREPQUERY(query, text) query.useWith(&connections[lang]); ASSERT(query.prepare(text))
 		PREPQUERY(insertGlossTextQueries[lang], "insert into glossText values(?)");
-		PREPQUERY(insertGlossQueries[lang], "insert into gloss values(?, ?)");
+		PREPQUERY(insertGlossQueries[lang], "insert into gloss values(?, ?, ?)");
 		PREPQUERY(insertGlossesQueries[lang], "insert into glosses values(?, ?)");
 #undef PREPQUERY
 	}
@@ -371,13 +434,40 @@ bool JMdictDBParser::createLanguagesTables()
 	foreach (const QString &lang, languages) {
 		SQLite::Query query(&connections[lang]);
 		EXEC_STMT(query, "create table info(version INT, JMdictVersion TEXT)");
-		EXEC_STMT(query, "create table gloss(id INTEGER SECONDARY KEY, docid INTEGER PRIMARY KEY)");
+		EXEC_STMT(query, "create table gloss(id INTEGER SECONDARY KEY, priority TINYINT, docid INTEGER PRIMARY KEY)");
 		EXEC_STMT(query, "create virtual table glossText using fts4(reading)");
 		EXEC_STMT(query, "create table glosses(id INTEGER PRIMARY KEY, glosses BLOB)");
 	}	
 	return true;
 }
 
+/**
+ * Compresses the glosses of each language with a dictionary trained on all
+ * of them.
+ */
+bool JMdictDBParser::compressGlosses()
+{
+	foreach (const QString &lang, languages) {
+		SQLite::Query query(&connections[lang]);
+		QList<quint32> ids;
+		QList<QByteArray> glosses;
+		EXEC_STMT(query, "select id, glosses from glosses");
+		while (query.next()) {
+			ids << query.valueUInt(0);
+			glosses << query.valueBlob(1);
+		}
+		SQLite::DictionaryCodec codec(SQLite::DictionaryCodec::train(glosses));
+		ASSERT(codec.store(&connections[lang]));
+		ASSERT(query.prepare("update glosses set glosses = ? where id = ?"));
+		for (int i = 0; i < ids.size(); i++) {
+			BIND(query, codec.compress(glosses[i]));
+			BIND(query, ids[i]);
+			EXEC(query);
+		}
+	}
+	return true;
+}
+
 bool JMdictDBParser::createLanguagesIndexes()
 {
 	foreach (const QString &lang, languages) {
@@ -519,10 +609,13 @@ bool buildDB(const QStringList &languages, const QString &srcDir, const QString
 
 	parser.fillMainInfoTable();
 	parser.fillLanguagesInfoTable();
+	parser.compressGlosses();
 	parser.insertJLPTLevels();
+	parser.createKanjiWordsTable();
 	parser.populateEntitiesTable();
 	parser.createMainIndexes();
 	parser.createLanguagesIndexes();
+	parser.writeWordsIndex();
 
 	parser.clearMainQueries();
 	parser.finalizeMainDatabase();
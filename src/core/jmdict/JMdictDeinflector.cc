@@ -0,0 +1,358 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/jmdict/JMdictDeinflector.h"
+
+#include <QHash>
+
+#define V1 JMdictDeinflector::Ichidan
+#define V5 JMdictDeinflector::Godan
+#define ADJ JMdictDeinflector::AdjectiveI
+#define VK JMdictDeinflector::Kuru
+#define VS JMdictDeinflector::Suru
+#define VSN JMdictDeinflector::SuruNoun
+#define MASU JMdictDeinflector::Masu
+#define TE JMdictDeinflector::Te
+#define INF JMdictDeinflector::Inflected
+
+/**
+ * Conjugation rules. Forms that conjugate themselves (negative, desire,
+ * passive, causative...) are given the class they conjugate like, so that
+ * the rules of this class apply to them in turn.
+ */
+static const JMdictDeinflector::Rule _rules[] = {
+	// Negative, conjugating like an i-adjective
+	{ "ない", "る", ADJ, V1 },
+	{ "わない", "う", ADJ, V5 },
+	{ "かない", "く", ADJ, V5 },
+	{ "がない", "ぐ", ADJ, V5 },
+	{ "さない", "す", ADJ, V5 },
+	{ "たない", "つ", ADJ, V5 },
+	{ "なない", "ぬ", ADJ, V5 },
+	{ "ばない", "ぶ", ADJ, V5 },
+	{ "まない", "む", ADJ, V5 },
+	{ "らない", "る", ADJ, V5 },
+	{ "こない", "くる", ADJ, VK },
+	{ "来ない", "来る", ADJ, VK },
+	{ "しない", "する", ADJ, VS },
+	// Classical negative
+	{ "ず", "る", INF, V1 },
+	{ "わず", "う", INF, V5 },
+	{ "かず", "く", INF, V5 },
+	{ "がず", "ぐ", INF, V5 },
+	{ "さず", "す", INF, V5 },
+	{ "たず", "つ", INF, V5 },
+	{ "なず", "ぬ", INF, V5 },
+	{ "ばず", "ぶ", INF, V5 },
+	{ "まず", "む", INF, V5 },
+	{ "らず", "る", INF, V5 },
+	{ "こず", "くる", INF, VK },
+	{ "来ず", "来る", INF, VK },
+	{ "せず", "する", INF, VS },
+	// Past
+	{ "た", "る", INF, V1 },
+	{ "った", "う", INF, V5 },
+	{ "った", "つ", INF, V5 },
+	{ "った", "る", INF, V5 },
+	{ "いた", "く", INF, V5 },
+	{ "いだ", "ぐ", INF, V5 },
+	{ "した", "す", INF, V5 },
+	{ "んだ", "ぬ", INF, V5 },
+	{ "んだ", "ぶ", INF, V5 },
+	{ "んだ", "む", INF, V5 },
+	{ "行った", "行く", INF, V5 },
+	{ "いった", "いく", INF, V5 },
+	{ "きた", "くる", INF, VK },
+	{ "来た", "来る", INF, VK },
+	{ "した", "する", INF, VS },
+	{ "かった", "い", INF, ADJ },
+	// Conditional and alternative forms, built on the past
+	{ "たら", "た", INF, INF },
+	{ "だら", "だ", INF, INF },
+	{ "たり", "た", INF, INF },
+	{ "だり", "だ", INF, INF },
+	// Te form
+	{ "て", "る", INF | TE, V1 },
+	{ "って", "う", INF | TE, V5 },
+	{ "って", "つ", INF | TE, V5 },
+	{ "って", "る", INF | TE, V5 },
+	{ "いて", "く", INF | TE, V5 },
+	{ "いで", "ぐ", INF | TE, V5 },
+	{ "して", "す", INF | TE, V5 },
+	{ "んで", "ぬ", INF | TE, V5 },
+	{ "んで", "ぶ", INF | TE, V5 },
+	{ "んで", "む", INF | TE, V5 },
+	{ "行って", "行く", INF | TE, V5 },
+	{ "いって", "いく", INF | TE, V5 },
+	{ "きて", "くる", INF | TE, VK },
+	{ "来て", "来る", INF | TE, VK },
+	{ "して", "する", INF | TE, VS },
+	{ "くて", "い", INF | TE, ADJ },
+	// Auxiliaries following the te form
+	{ "ている", "て", V1, TE },
+	{ "でいる", "で", V1, TE },
+	{ "てる", "て", V1, TE },
+	{ "でる", "で", V1, TE },
+	{ "てしまう", "て", V5, TE },
+	{ "でしまう", "で", V5, TE },
+	{ "ておく", "て", V5, TE },
+	{ "でおく", "で", V5, TE },
+	// Polite forms
+	{ "ません", "ます", INF, MASU },
+	{ "ました", "ます", INF, MASU },
+	{ "ませんでした", "ます", INF, MASU },
+	{ "ましょう", "ます", INF, MASU },
+	{ "まして", "ます", INF, MASU },
+	{ "ましたら", "ます", INF, MASU },
+	{ "ます", "る", MASU, V1 },
+	{ "います", "う", MASU, V5 },
+	{ "きます", "く", MASU, V5 },
+	{ "ぎます", "ぐ", MASU, V5 },
+	{ "します", "す", MASU, V5 },
+	{ "ちます", "つ", MASU, V5 },
+	{ "にます", "ぬ", MASU, V5 },
+	{ "びます", "ぶ", MASU, V5 },
+	{ "みます", "む", MASU, V5 },
+	{ "ります", "る", MASU, V5 },
+	{ "きます", "くる", MASU, VK },
+	{ "来ます", "来る", MASU, VK },
+	{ "します", "する", MASU, VS },
+	// Desire, conjugating like an i-adjective
+	{ "たい", "る", ADJ, V1 },
+	{ "いたい", "う", ADJ, V5 },
+	{ "きたい", "く", ADJ, V5 },
+	{ "ぎたい", "ぐ", ADJ, V5 },
+	{ "したい", "す", ADJ, V5 },
+	{ "ちたい", "つ", ADJ, V5 },
+	{ "にたい", "ぬ", ADJ, V5 },
+	{ "びたい", "ぶ", ADJ, V5 },
+	{ "みたい", "む", ADJ, V5 },
+	{ "りたい", "る", ADJ, V5 },
+	{ "きたい", "くる", ADJ, VK },
+	{ "来たい", "来る", ADJ, VK },
+	{ "したい", "する", ADJ, VS },
+	// Volitional
+	{ "よう", "る", INF, V1 },
+	{ "おう", "う", INF, V5 },
+	{ "こう", "く", INF, V5 },
+	{ "ごう", "ぐ", INF, V5 },
+	{ "そう", "す", INF, V5 },
+	{ "とう", "つ", INF, V5 },
+	{ "のう", "ぬ", INF, V5 },
+	{ "ぼう", "ぶ", INF, V5 },
+	{ "もう", "む", INF, V5 },
+	{ "ろう", "る", INF, V5 },
+	{ "こよう", "くる", INF, VK },
+	{ "来よう", "来る", INF, VK },
+	{ "しよう", "する", INF, VS },
+	// Imperative
+	{ "ろ", "る", INF, V1 },
+	{ "よ", "る", INF, V1 },
+	{ "え", "う", INF, V5 },
+	{ "け", "く", INF, V5 },
+	{ "げ", "ぐ", INF, V5 },
+	{ "せ", "す", INF, V5 },
+	{ "て", "つ", INF, V5 },
+	{ "ね", "ぬ", INF, V5 },
+	{ "べ", "ぶ", INF, V5 },
+	{ "め", "む", INF, V5 },
+	{ "れ", "る", INF, V5 },
+	{ "こい", "くる", INF, VK },
+	{ "来い", "来る", INF, VK },
+	{ "しろ", "する", INF, VS },
+	{ "せよ", "する", INF, VS },
+	// Provisional conditional
+	{ "れば", "る", INF, V1 | V5 },
+	{ "えば", "う", INF, V5 },
+	{ "けば", "く", INF, V5 },
+	{ "げば", "ぐ", INF, V5 },
+	{ "せば", "す", INF, V5 },
+	{ "てば", "つ", INF, V5 },
+	{ "ねば", "ぬ", INF, V5 },
+	{ "べば", "ぶ", INF, V5 },
+	{ "めば", "む", INF, V5 },
+	{ "くれば", "くる", INF, VK },
+	{ "来れば", "来る", INF, VK },
+	{ "すれば", "する", INF, VS },
+	{ "ければ", "い", INF, ADJ },
+	// Potential and passive, conjugating like ichidan verbs
+	{ "られる", "る", V1, V1 },
+	{ "える", "う", V1, V5 },
+	{ "ける", "く", V1, V5 },
+	{ "げる", "ぐ", V1, V5 },
+	{ "せる", "す", V1, V5 },
+	{ "てる", "つ", V1, V5 },
+	{ "ねる", "ぬ", V1, V5 },
+	{ "べる", "ぶ", V1, V5 },
+	{ "める", "む", V1, V5 },
+	{ "れる", "る", V1, V5 },
+	{ "われる", "う", V1, V5 },
+	{ "かれる", "く", V1, V5 },
+	{ "がれる", "ぐ", V1, V5 },
+	{ "される", "す", V1, V5 },
+	{ "たれる", "つ", V1, V5 },
+	{ "なれる", "ぬ", V1, V5 },
+	{ "ばれる", "ぶ", V1, V5 },
+	{ "まれる", "む", V1, V5 },
+	{ "られる", "る", V1, V5 },
+	{ "こられる", "くる", V1, VK },
+	{ "来られる", "来る", V1, VK },
+	{ "される", "する", V1, VS },
+	// Causative, conjugating like ichidan verbs
+	{ "させる", "る", V1, V1 },
+	{ "わせる", "う", V1, V5 },
+	{ "かせる", "く", V1, V5 },
+	{ "がせる", "ぐ", V1, V5 },
+	{ "させる", "す", V1, V5 },
+	{ "たせる", "つ", V1, V5 },
+	{ "なせる", "ぬ", V1, V5 },
+	{ "ばせる", "ぶ", V1, V5 },
+	{ "ませる", "む", V1, V5 },
+	{ "らせる", "る", V1, V5 },
+	{ "こさせる", "くる", V1, VK },
+	{ "来させる", "来る", V1, VK },
+	{ "させる", "する", V1, VS },
+	// Adjective forms
+	{ "くない", "い", ADJ, ADJ },
+	{ "く", "い", INF, ADJ },
+	{ "さ", "い", INF, ADJ },
+	{ "そう", "い", INF, ADJ },
+	{ "すぎる", "い", V1, ADJ },
+	// Verbal nouns
+	{ "する", "", VS, VSN },
+	{ 0, 0, 0, 0 }
+};
+
+#undef V1
+#undef V5
+#undef ADJ
+#undef VK
+#undef VS
+#undef VSN
+#undef MASU
+#undef TE
+#undef INF
+
+const JMdictDeinflector::Rule *JMdictDeinflector::rules()
+{
+	return _rules;
+}
+
+static QString reversed(const QString &str)
+{
+	QString ret(str.size(), QChar());
+	for (int i = 0; i < str.size(); i++) ret[str.size() - 1 - i] = str[i];
+	return ret;
+}
+
+/// Returns the part of speech mask of the given comma-separated entities, ignoring the undefined ones
+static quint64 posOf(const QMap<QString, quint8> &posBitShifts, const char *entities)
+{
+	quint64 ret = 0;
+	foreach (const QString &entity, QString(entities).split(',')) {
+		QMap<QString, quint8>::const_iterator it(posBitShifts.constFind(entity));
+		if (it != posBitShifts.constEnd()) ret |= 1ULL << it.value();
+	}
+	return ret;
+}
+
+JMdictDeinflector::JMdictDeinflector(const QMap<QString, quint8> &posBitShifts)
+{
+	QMap<QString, QList<quint32> > suffixes;
+	for (int i = 0; _rules[i].from; i++) {
+		QString from(QString::fromUtf8(_rules[i].from));
+		_to << QString::fromUtf8(_rules[i].to);
+		_fromClasses << _rules[i].fromClasses;
+		_toClasses << _rules[i].toClasses;
+		suffixes[reversed(from)] << i;
+	}
+	_suffixes.build(suffixes);
+
+	for (int i = 0; i < NbClasses; i++) _classPos[i] = 0;
+	_classPos[0] = posOf(posBitShifts, "v1,v1-s");
+	_classPos[2] = posOf(posBitShifts, "adj-i,adj-ix");
+	_classPos[3] = posOf(posBitShifts, "vk");
+	_classPos[4] = posOf(posBitShifts, "vs-i,vs-s");
+	_classPos[5] = posOf(posBitShifts, "vs");
+	// Godan verbs are told apart by the last character of their dictionary form
+	static const char *godanPos[][2] = {
+		{ "う", "v5u,v5u-s" }, { "く", "v5k,v5k-s" }, { "ぐ", "v5g" },
+		{ "す", "v5s" }, { "つ", "v5t" }, { "ぬ", "v5n" }, { "ぶ", "v5b" },
+		{ "む", "v5m" }, { "る", "v5r,v5r-i,v5aru" }
+	};
+	for (unsigned int i = 0; i < sizeof(godanPos) / sizeof(godanPos[0]); i++)
+		_godanPos[QString::fromUtf8(godanPos[i][0]).at(0)] = posOf(posBitShifts, godanPos[i][1]);
+}
+
+quint64 JMdictDeinflector::posMask(const QString &word, int classes) const
+{
+	quint64 ret = 0;
+	for (int i = 0; i < NbClasses; i++)
+		if (classes & (1 << i)) ret |= _classPos[i];
+	if ((classes & Godan) && !word.isEmpty()) ret |= _godanPos.value(word[word.size() - 1]);
+	return ret;
+}
+
+QList<JMdictDeinflector::Candidate> JMdictDeinflector::deinflect(const QString &word) const
+{
+	// Classes of all the words met so far, the input word included
+	QHash<QString, int> seen;
+	// Words to process, along with the classes they have not been processed for yet
+	QList<QPair<QString, int> > queue;
+	QList<QString> order;
+	seen[word] = AllClasses;
+	queue << QPair<QString, int>(word, AllClasses);
+
+	DoubleArrayTrie::Match matches[16];
+	for (int q = 0; q < queue.size() && order.size() < MaxCandidates; q++) {
+		const QString current(queue[q].first);
+		int classes = queue[q].second;
+		const QString suffixes(reversed(current));
+		int nbMatches = _suffixes.commonPrefixSearch(suffixes.constData(), suffixes.size(), matches, 16);
+		for (int m = 0; m < nbMatches; m++) {
+			for (int v = 0; v < matches[m].valuesCount; v++) {
+				int rule = matches[m].values[v];
+				if (!(_fromClasses[rule] & classes)) continue;
+				QString result(current.left(current.size() - matches[m].length) + _to[rule]);
+				if (result.isEmpty()) continue;
+				int resultClasses = _toClasses[rule];
+				QHash<QString, int>::iterator it(seen.find(result));
+				if (it == seen.end()) {
+					seen.insert(result, resultClasses);
+					order << result;
+				}
+				// Only process the classes the word has not been processed for yet
+				else if ((resultClasses & ~it.value()) == 0) continue;
+				else {
+					resultClasses &= ~it.value();
+					it.value() |= resultClasses;
+				}
+				queue << QPair<QString, int>(result, resultClasses);
+			}
+		}
+	}
+
+	QList<Candidate> ret;
+	foreach (const QString &w, order) {
+		Candidate candidate;
+		candidate.word = w;
+		candidate.classes = seen[w];
+		candidate.posMask = posMask(w, candidate.classes);
+		if (candidate.posMask) ret << candidate;
+	}
+	return ret;
+}
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_JMDICT_DEINFLECTOR_H
+#define __CORE_JMDICT_DEINFLECTOR_H
+
+#include "core/DoubleArrayTrie.h"
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+/**
+ * Finds the dictionary forms an inflected Japanese word may come from.
+ *
+ * Deinflection is driven by a table of conjugation rules, each one
+ * replacing a suffix of the word by another and turning a word class into
+ * another (e.g. "なかった" into "ない", and an i-adjective form into an
+ * ichidan verb). The suffixes of all the rules are compiled into a trie
+ * of reversed strings, so the rules applying to a word are found with a
+ * single lookup. Rules are applied repeatedly, so that chained
+ * inflections such as 食べられなかった are reduced to 食べる.
+ *
+ * Every candidate comes with the mask of the parts of speech, as stored
+ * in jmdict.senses.pos, that an entry must have for the candidate to be
+ * a valid dictionary form.
+ */
+class JMdictDeinflector
+{
+public:
+	/// Word classes the rules operate on
+	typedef enum {
+		Ichidan = 1 << 0,
+		Godan = 1 << 1,
+		AdjectiveI = 1 << 2,
+		Kuru = 1 << 3,
+		Suru = 1 << 4,
+		/// Noun becoming a verb with する
+		SuruNoun = 1 << 5,
+		/// Polite forms ending with ます
+		Masu = 1 << 6,
+		/// Forms ending with て or で
+		Te = 1 << 7,
+		/// Forms that cannot be inflected further, only given as input
+		Inflected = 1 << 8,
+		AllClasses = (1 << 9) - 1
+	} WordClass;
+
+	/// A possible dictionary form of a word
+	struct Candidate
+	{
+		QString word;
+		/// Mask of WordClass values
+		int classes;
+		/// Parts of speech of the entries this candidate can match
+		quint64 posMask;
+	};
+
+	struct Rule
+	{
+		const char *from;
+		const char *to;
+		/// Classes the inflected word may belong to
+		int fromClasses;
+		/// Classes of the resulting word
+		int toClasses;
+	};
+
+	/// Maximum number of candidates returned for a single word
+	static const int MaxCandidates = 256;
+
+private:
+	static const int NbClasses = 9;
+	QVector<QString> _to;
+	QVector<int> _fromClasses;
+	QVector<int> _toClasses;
+	/// Reversed suffixes of the rules, associated to the rules indexes
+	DoubleArrayTrie _suffixes;
+	/// Part of speech masks of each class, godan verbs being handled apart
+	quint64 _classPos[NbClasses];
+	/// Part of speech masks of godan verbs, by last character of their dictionary form
+	QMap<QChar, quint64> _godanPos;
+
+	quint64 posMask(const QString &word, int classes) const;
+
+public:
+	/**
+	 * Builds a deinflector using the built-in rules. posBitShifts associates
+	 * the names of the part of speech entities to their bit shift, as given
+	 * by JMdictPlugin::posBitShifts().
+	 */
+	JMdictDeinflector(const QMap<QString, quint8> &posBitShifts);
+
+	/// The built-in rules, terminated by a rule which from member is null
+	static const Rule *rules();
+
+	/**
+	 * Returns the possible dictionary forms of word, not including word
+	 * itself. Only candidates that can be dictionary forms, i.e. which
+	 * part of speech mask is not null, are returned.
+	 */
+	QList<Candidate> deinflect(const QString &word) const;
+};
+
+#endif
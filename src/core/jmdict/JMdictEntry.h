@@ -25,7 +25,13 @@
 #include "core/EntriesCache.h"
 
 #define JMDICTENTRY_GLOBALID 1
-#define JMDICTDB_REVISION 4
+#define JMDICTDB_REVISION 7
+
+/// Turns a JMdict version (YYYY-MM-DD) into an integer (YYYYMMDD)
+inline quint32 jmdictVersionNumber(const QString &version)
+{
+	return QString(version.mid(0, 4) + version.mid(5, 2) + version.mid(8, 2)).toUInt();
+}
 
 class QFont;
 class KanaReading;
@@ -18,6 +18,7 @@
 #include "core/Lang.h"
 #include "core/jmdict/JMdictEntryLoader.h"
 #include "core/jmdict/JMdictPlugin.h"
+#include "sqlite/DictionaryCodec.h"
 
 JMdictEntryLoader::JMdictEntryLoader() : EntryLoader(), kanjiQuery(&connection), kanaQuery(&connection), sensesQuery(&connection), jlptQuery(&connection)
 {
@@ -104,7 +105,7 @@ Entry *JMdictEntryLoader::loadEntry(EntryId id)
 		glossQuery.bindValue(entry->id());
 		glossQuery.exec();
 		if (glossQuery.next()) {
-			QStringList glosses(QString::fromUtf8(qUncompress(glossQuery.valueBlob(0))).split("\n\n"));
+			QStringList glosses(QString::fromUtf8(SQLite::DictionaryCodec::uncompress(glossQuery.valueBlob(0))).split("\n\n"));
 			for (int i = 0; i < glosses.size(); i++) {
 				// Skip empty glosses
 				if (glosses[i].isEmpty()) continue;
@@ -19,6 +19,7 @@
 #include "core/jmdict/JMdictEntrySearcher.h"
 #include "core/jmdict/JMdictEntry.h"
 #include "core/jmdict/JMdictPlugin.h"
+#include "core/jmdict/JMdictDeinflector.h"
 #include "sqlite/SQLite.h"
 
 PreferenceItem<QString> JMdictEntrySearcher::miscPropertiesFilter("jmdict", "miscPropertiesFilter", "arch,obs");
@@ -27,7 +28,7 @@ quint64 JMdictEntrySearcher::_explicitlyRequestedMiscs = 0;
 
 JMdictEntrySearcher::JMdictEntrySearcher() : EntrySearcher(JMDICTENTRY_GLOBALID)
 {
-	connect(&JMdictEntrySearcher::miscPropertiesFilter, SIGNAL(valueChanged(QVariant)), this, SLOT(updateMiscFilterMask()));
+	connect(&JMdictEntrySearcher::miscPropertiesFilter, SIGNAL(valueChanged(QVariant)), this, SLOT(onMiscPropertiesFilterChanged()));
 
 	QueryBuilder::Join::addTablePriority("jmdict.entries", 50);
 	QueryBuilder::Join::addTablePriority("jmdict.kanjiChar", 45);
@@ -42,15 +43,16 @@ JMdictEntrySearcher::JMdictEntrySearcher() : EntrySearcher(JMDICTENTRY_GLOBALID)
 	}
 	QueryBuilder::Join::addTablePriority("jmdict.senses", 10);
 	QueryBuilder::Join::addTablePriority("jmdict.jlpt", 8);
+	QueryBuilder::Join::addTablePriority("jmdict_relevance", 5);
 
 	QueryBuilder::Order::orderingWay["freq"] = QueryBuilder::Order::DESC;
 
 	// Register text search commands
-	validCommands << "romaji" << "mean" << "kana" << "kanji" << "jmdict" << "haskanji" << "jlpt" << "withstudiedkanjis" << "hascomponent" << "withkanaonly";
+	validCommands << "romaji" << "mean" << "kana" << "kanji" << "jmdict" << "haskanji" << "jlpt" << "withstudiedkanjis" << "hascomponent" << "withkanaonly" << "fuzzy";
 	// Also register commands that are sense properties
 	validCommands << "pos" << "misc" << "dial" << "field";
 
-	updateMiscFilterMask();
+	// The filter mask is computed once the JMdict entities are loaded
 }
 
 SearchCommand JMdictEntrySearcher::commandFromWord(const QString &word) const
@@ -85,7 +87,7 @@ static QString buildTextSearchCondition(const QStringList &words, const QString
 	static QRegExp regExpChars = QRegExp("[\\?\\*]");
 	static QString ftsMatch("jmdict%3.%2Text.reading MATCH '%1'");
 	static QString regexpMatch("jmdict%3.%2Text.reading REGEXP '%1'");
-	static QString glossRegexpMatch("{{leftcolumn}} in (select id from jmdict_%2.glosses where FTSUNCOMPRESS(glosses) REGEXP '%1')");
+	static QString glossRegexpMatch("{{leftcolumn}} in (select id from jmdict_%2.glosses where DICTUNCOMPRESS(glosses) REGEXP '%1')");
 	static QString globalMatch("{{leftcolumn}} IN (SELECT id FROM jmdict%3.%2 JOIN jmdict%3.%2Text ON jmdict%3.%2.docid = jmdict%3.%2Text.docid WHERE %1)");
 
 	QStringList globalMatches;
@@ -118,6 +120,186 @@ static QString buildTextSearchCondition(const QStringList &words, const QString
 	return globalMatches.join(" OR ");
 }
 
+/**
+ * Returns the queries selecting the id and relevance score of the entries
+ * which text table matches words, one per language for glosses. Words
+ * starting with a wildcard do not contribute to the score.
+ */
+static QStringList buildRelevanceSearches(const QStringList &words, const QString &table)
+{
+	static QRegExp regExpChars = QRegExp("[\\?\\*]");
+	static QString relevanceSearch("SELECT jmdict%1.%2.id AS id, FTSRANK(matchinfo(jmdict%1.%2Text, 'pcnalx'), %3, jmdict%1.%2.priority, jmdict.entries.frequency) AS score "
+		"FROM jmdict%1.%2 JOIN jmdict%1.%2Text ON jmdict%1.%2.docid = jmdict%1.%2Text.docid JOIN jmdict.entries ON jmdict.entries.id = jmdict%1.%2.id "
+		"WHERE jmdict%1.%2Text.reading MATCH '%4'");
+
+	QStringList fts;
+	foreach (const QString &w, words) {
+		int wildcardIdx = w.indexOf(regExpChars);
+		if (wildcardIdx == -1) fts << "\"" + w + "\"";
+		else if (wildcardIdx > 0) fts << "\"" + w.left(wildcardIdx) + "*\"";
+	}
+	if (fts.isEmpty()) return QStringList();
+
+	QStringList ret;
+	if (table == "gloss") {
+		QStringList langs(JMdictPlugin::instance()->attachedDBs().keys());
+		langs.removeAll("");
+		// Senses made of the searched words only are considered exact matches
+		foreach (const QString &lang, langs) ret << relevanceSearch.arg("_" + lang, table, "NULL", fts.join(" "));
+	}
+	else {
+		QString exact("NULL");
+		if (words.size() == 1 && !words[0].contains(regExpChars)) exact = QString("jmdict.%1Text.reading = '%2'").arg(table, words[0]);
+		ret << relevanceSearch.arg("", table, exact, fts.join(" "));
+	}
+	return ret;
+}
+
+/**
+ * Joins the relevance of the entries matched by full-text searches so
+ * results can be sorted by it. Entries matched several times keep their
+ * best score.
+ */
+static void addRelevanceJoin(QueryBuilder::Statement &statement, const QStringList &searches)
+{
+	if (searches.isEmpty()) return;
+	QueryBuilder::Join join(QueryBuilder::Column("jmdict_relevance", "id"), "", QueryBuilder::Join::Left);
+	join.setSubquery(searches.join(" UNION ALL "));
+	statement.addJoin(join);
+}
+
+/// Maximum number of known terms a fuzzy searched word is replaced by
+#define MAX_FUZZY_TERMS 20
+
+/// Terms closest to the searched word first, then the most common ones
+static bool fuzzyMatchByCountLessThan(const DoubleArrayTrie::FuzzyMatch &m1, const DoubleArrayTrie::FuzzyMatch &m2)
+{
+	if (m1.distance != m2.distance) return m1.distance < m2.distance;
+	return m1.values[0] > m2.values[0];
+}
+
+/// Terms closest to the searched word first, then the ones used by the most entries
+static bool fuzzyMatchByEntriesLessThan(const DoubleArrayTrie::FuzzyMatch &m1, const DoubleArrayTrie::FuzzyMatch &m2)
+{
+	if (m1.distance != m2.distance) return m1.distance < m2.distance;
+	return m1.valuesCount > m2.valuesCount;
+}
+
+/**
+ * Returns the keys of terms that are within maxDistance edits of word, or
+ * within a distance depending on its length if maxDistance is 0. If
+ * valuesAreCounts is true, the value of each key is its number of
+ * occurrences, otherwise its values are the entries using it.
+ */
+static QStringList fuzzyTerms(const DoubleArrayTrie &terms, const QString &word, int maxDistance, const QString &alphabet, bool valuesAreCounts)
+{
+	if (!maxDistance) maxDistance = word.size() <= 4 ? 1 : 2;
+	QList<DoubleArrayTrie::FuzzyMatch> matches(terms.fuzzySearch(word, maxDistance, alphabet + word));
+	qSort(matches.begin(), matches.end(), valuesAreCounts ? fuzzyMatchByCountLessThan : fuzzyMatchByEntriesLessThan);
+	QStringList ret;
+	for (int i = 0; i < matches.size() && i < MAX_FUZZY_TERMS; i++) ret << matches[i].key;
+	return ret;
+}
+
+/**
+ * Returns a condition matching the entries which text table contains, for
+ * every group of terms, one of its terms.
+ */
+static QString buildTermsCondition(const QList<QStringList> &groups, const QString &table, const QString &lang = QString())
+{
+	static QString globalMatch("{{leftcolumn}} IN (SELECT id FROM jmdict%3.%2 JOIN jmdict%3.%2Text ON jmdict%3.%2.docid = jmdict%3.%2Text.docid WHERE jmdict%3.%2Text.reading MATCH '%1')");
+
+	QStringList match;
+	foreach (const QStringList &group, groups) match << "(\"" + group.join("\" OR \"") + "\")";
+	return globalMatch.arg(match.join(" ")).arg(table).arg(lang.isEmpty() ? "" : "_" + lang);
+}
+
+/**
+ * Replaces every word by the terms of the glosses vocabulary that are
+ * close to it. Returns an empty string if some word has no close term
+ * in any language.
+ */
+static QString buildFuzzyGlossCondition(const QStringList &words, int maxDistance)
+{
+	QStringList globalMatches;
+	QStringList langs(JMdictPlugin::instance()->attachedDBs().keys());
+	langs.removeAll("");
+	foreach (const QString &lang, langs) {
+		const DoubleArrayTrie &terms(JMdictPlugin::glossTerms(lang));
+		// Includes the accented letters of the language
+		QString alphabet(terms.alphabet());
+		QList<QStringList> groups;
+		foreach (const QString &w, words) {
+			QStringList group(fuzzyTerms(terms, w.toLower(), maxDistance, alphabet, true));
+			if (group.isEmpty()) break;
+			groups << group;
+		}
+		if (groups.size() == words.size()) globalMatches << buildTermsCondition(groups, "gloss", lang);
+	}
+	return globalMatches.join(" OR ");
+}
+
+/**
+ * Replaces a kana word by the readings that are close to it, looking for
+ * hiragana and katakana readings separately. Returns an empty string if
+ * there are none.
+ */
+static QString buildFuzzyKanaCondition(const QString &word, int maxDistance)
+{
+	static QString hiraganaAlphabet, katakanaAlphabet;
+	if (hiraganaAlphabet.isEmpty()) {
+		for (ushort c = 0x3041; c <= 0x3096; c++) hiraganaAlphabet += QChar(c);
+		hiraganaAlphabet += QChar(0x30fc);
+		katakanaAlphabet = TextTools::hiragana2Katakana(hiraganaAlphabet);
+	}
+	const DoubleArrayTrie &index(JMdictPlugin::wordsIndex());
+	QStringList group(fuzzyTerms(index, TextTools::katakana2Hiragana(word), maxDistance, hiraganaAlphabet, false));
+	group += fuzzyTerms(index, TextTools::hiragana2Katakana(word), maxDistance, katakanaAlphabet, false);
+	if (group.isEmpty()) return QString();
+	return buildTermsCondition(QList<QStringList>() << group, "kana");
+}
+
+/**
+ * Returns a condition matching the entries which dictionary form word may
+ * be an inflection of, or an empty string if there are none. Candidate
+ * forms are looked up in the words index, and entries are only kept if
+ * one of their senses has a part of speech the inflection applies to.
+ */
+static QString buildDeinflectionCondition(const QString &word)
+{
+	if (word.contains(QRegExp("[\\?\\*]"))) return QString();
+	QList<JMdictDeinflector::Candidate> candidates(JMdictPlugin::deinflector().deinflect(word));
+	if (candidates.isEmpty()) return QString();
+
+	// Group the entries by part of speech mask
+	QMap<quint64, QStringList> idsByPos;
+	const DoubleArrayTrie &index(JMdictPlugin::wordsIndex());
+	foreach (const JMdictDeinflector::Candidate &candidate, candidates) {
+		foreach (quint32 id, index.values(candidate.word)) idsByPos[candidate.posMask] << QString::number(id);
+	}
+	if (idsByPos.isEmpty()) return QString();
+
+	QStringList conds;
+	foreach (quint64 posMask, idsByPos.keys())
+		conds << QString("(id in (%1) and pos & %2 != 0)").arg(idsByPos[posMask].join(", ")).arg(posMask);
+	return QString("{{leftcolumn}} in (select id from jmdict.senses where %1)").arg(conds.join(" or "));
+}
+
+/// Searches for words, also matching the dictionary forms of a single inflected word
+static void addReadingsCondition(QueryBuilder::Statement &statement, const QStringList &words, const QString &table)
+{
+	QString deinflected;
+	if (words.size() == 1) deinflected = buildDeinflectionCondition(words[0]);
+	if (deinflected.isEmpty()) {
+		statement.addWhere(buildTextSearchCondition(words, table));
+		return;
+	}
+	QueryBuilder::Where where("OR");
+	where.addWhere(buildTextSearchCondition(words, table));
+	where.addWhere(deinflected);
+	statement.addWhere(where);
+}
+
 void JMdictEntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBuilder::Statement &statement)
 {
 	// First delegate to the parent
@@ -131,6 +313,9 @@ void JMdictEntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBu
 	QStringList hasKanjiSearch;
 	QStringList hasComponentSearch;
 	quint64 posFilter(0), miscFilter(0), dialectFilter(0), fieldFilter(0);
+	// Maximum edit distance of fuzzy searches, 0 meaning depending on the length of words
+	bool fuzzy(false);
+	int fuzzyDistance(0);
 
 	QSet<QString> allCommands;
 	// First build the global list of all commands
@@ -156,6 +341,12 @@ void JMdictEntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBu
 			foreach(const QString &arg, command.args()) romajiSearch << arg;
 			commands.removeOne(command);
 		}
+		else if (commandLabel == "fuzzy") {
+			if (command.args().size() > 1) continue;
+			fuzzy = true;
+			if (command.args().size() == 1) fuzzyDistance = qBound(1, command.args()[0].toInt(), 3);
+			commands.removeOne(command);
+		}
 		else if (commandLabel == "jmdict") {
 			statement.addJoin(QueryBuilder::Column("jmdict.entries", "id"));
 			if (command.args().size() >= 1) {
@@ -311,20 +502,52 @@ void JMdictEntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBu
 		}
 	}
 
-	// Add where statements for text search
+	// Add where statements for text search. Fuzzy searches do not apply to
+	// words containing wildcards, which are matched as usual.
+	// Non-fuzzy text searches also score the matched entries by relevance.
+	static QRegExp wildcards("[\\?\\*]");
+	QStringList relevanceSearches;
 	foreach (const QString &rword, romajiSearch) {
 		QueryBuilder::Where where("OR");
 		QString kword(TextTools::romajiToKana(rword));
 		if (kword.isEmpty()) transReadingsMatch << rword;
 		else {
-			where.addWhere(buildTextSearchCondition(QStringList() << kword, "kana"));
-			where.addWhere(buildTextSearchCondition(QStringList() << rword, "gloss"));
+			QString kanaCondition, glossCondition;
+			if (fuzzy && !rword.contains(wildcards)) {
+				kanaCondition = buildFuzzyKanaCondition(kword, fuzzyDistance);
+				glossCondition = buildFuzzyGlossCondition(QStringList() << rword, fuzzyDistance);
+			}
+			if (kanaCondition.isEmpty()) {
+				where.addWhere(buildTextSearchCondition(QStringList() << kword, "kana"));
+				relevanceSearches << buildRelevanceSearches(QStringList() << kword, "kana");
+			}
+			else where.addWhere(kanaCondition);
+			if (glossCondition.isEmpty()) {
+				where.addWhere(buildTextSearchCondition(QStringList() << rword, "gloss"));
+				relevanceSearches << buildRelevanceSearches(QStringList() << rword, "gloss");
+			}
+			else where.addWhere(glossCondition);
 			statement.addWhere(where);
 		}
 	}
-	if (!kanjiReadingsMatch.isEmpty()) statement.addWhere(buildTextSearchCondition(kanjiReadingsMatch, "kanji"));
-	if (!kanaReadingsMatch.isEmpty()) statement.addWhere(buildTextSearchCondition(kanaReadingsMatch, "kana"));
-	if (!transReadingsMatch.isEmpty()) statement.addWhere(buildTextSearchCondition(transReadingsMatch, "gloss"));
+	if (!kanjiReadingsMatch.isEmpty()) {
+		addReadingsCondition(statement, kanjiReadingsMatch, "kanji");
+		relevanceSearches << buildRelevanceSearches(kanjiReadingsMatch, "kanji");
+	}
+	if (!kanaReadingsMatch.isEmpty()) {
+		addReadingsCondition(statement, kanaReadingsMatch, "kana");
+		relevanceSearches << buildRelevanceSearches(kanaReadingsMatch, "kana");
+	}
+	if (!transReadingsMatch.isEmpty()) {
+		QString glossCondition;
+		if (fuzzy && transReadingsMatch.filter(wildcards).isEmpty()) glossCondition = buildFuzzyGlossCondition(transReadingsMatch, fuzzyDistance);
+		if (glossCondition.isEmpty()) {
+			statement.addWhere(buildTextSearchCondition(transReadingsMatch, "gloss"));
+			relevanceSearches << buildRelevanceSearches(transReadingsMatch, "gloss");
+		}
+		else statement.addWhere(glossCondition);
+	}
+	addRelevanceJoin(statement, relevanceSearches);
 
 	// Add where statements for sense filters
 	// Cancel misc filters that have explicitly been required
@@ -381,10 +604,22 @@ void JMdictEntrySearcher::buildStatement(QList<SearchCommand> &commands, QueryBu
 	}
 }
 
-void JMdictEntrySearcher::updateMiscFilterMask()
+quint64 JMdictEntrySearcher::miscFilterMask()
+{
+	JMdictPlugin::waitForEntities();
+	return _miscFilterMask;
+}
+
+void JMdictEntrySearcher::updateMiscFilterMask(const QMap<QString, quint8> &miscBitShifts)
+{
+	quint64 mask = 0;
+	foreach (const QString &str, miscPropertiesFilter.value().split(',')) if (miscBitShifts.contains(str)) mask |= 1ULL << miscBitShifts[str];
+	_miscFilterMask = mask;
+}
+
+void JMdictEntrySearcher::onMiscPropertiesFilterChanged()
 {
-	_miscFilterMask = 0;
-	foreach (const QString &str, miscPropertiesFilter.value().split(',')) if (JMdictPlugin::miscBitShifts().contains(str)) _miscFilterMask |= 1ULL << JMdictPlugin::miscBitShifts()[str];
+	updateMiscFilterMask(JMdictPlugin::miscBitShifts());
 }
 
 QueryBuilder::Column JMdictEntrySearcher::canSort(const QString &sort, const QueryBuilder::Statement &statement)
@@ -392,14 +627,9 @@ QueryBuilder::Column JMdictEntrySearcher::canSort(const QString &sort, const Que
 	QueryBuilder::Column res(EntrySearcher::canSort(sort, statement));
 	if (res.column() != "0") return res;
 
-	if (sort == "matchPos") {
+	if (sort == "relevance") {
 		foreach(const QueryBuilder::Join &join, statement.joins()) {
-			const QString &t1 = join.column1().table();
-			const QString &t2 = join.column2().table();
-			// TODO Update matching pattern, replace by sense.priority?
-			//if (t1 == "jmdict.gloss" || t2 == "jmdict.gloss") return QueryBuilder::Column("jmdict.gloss", "sensePriority", "min");
-			if (t1 == "jmdict.kana" || t2 == "jmdict.kana") return QueryBuilder::Column("jmdict.kana", "priority", "min");
-			if (t1 == "jmdict.kanji" || t2 == "jmdict.kanji") return QueryBuilder::Column("jmdict.kanji", "priority", "min");
+			if (join.table1() == "jmdict_relevance") return QueryBuilder::Column("jmdict_relevance", "score", "max");
 		}
 	}
 	else if (sort == "freq") return QueryBuilder::Column("jmdict.entries", "frequency");
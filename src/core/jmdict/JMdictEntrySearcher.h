@@ -34,10 +34,12 @@ private:
 	static quint64 _explicitlyRequestedMiscs;
 
 protected slots:
-	void updateMiscFilterMask();
+	void onMiscPropertiesFilterChanged();
 
 public:
-	static quint64 miscFilterMask() { return _miscFilterMask; }
+	/// Blocks until the JMdict entities are loaded
+	static quint64 miscFilterMask();
+	static void updateMiscFilterMask(const QMap<QString, quint8> &miscBitShifts);
 	static quint64 explicitlyRequestedMiscs() { return _explicitlyRequestedMiscs; }
 
 	JMdictEntrySearcher();
@@ -20,16 +20,22 @@
 #include "core/Paths.h"
 #include "core/Lang.h"
 #include "core/Database.h"
+#include "core/Tag.h"
 #include "core/EntrySearcherManager.h"
 #include "core/EntryListModel.h"
 #include "core/jmdict/JMdictPlugin.h"
 #include "core/jmdict/JMdictEntry.h"
 #include "core/jmdict/JMdictEntrySearcher.h"
 #include "core/jmdict/JMdictEntryLoader.h"
+#include "core/jmdict/JMdictDeinflector.h"
+#include "core/StartupTrace.h"
+#include "core/TextTools.h"
 
 #include <QtDebug>
 #include <QFile>
 #include <QDir>
+#include <QMutexLocker>
+#include <QtConcurrentRun>
 
 #define dictFileConfigString "jmdict/database"
 #define dictFileConfigDefault "jmdict.db"
@@ -45,10 +51,18 @@ QMap<QString, quint8> JMdictPlugin::_posBitShift;
 QMap<QString, quint8> JMdictPlugin::_miscBitShift;
 QMap<QString, quint8> JMdictPlugin::_dialectBitShift;
 QMap<QString, quint8> JMdictPlugin::_fieldBitShift;
+QFuture<void> JMdictPlugin::_entitiesLoading;
+DoubleArrayTrie JMdictPlugin::_wordsIndex;
+QAtomicInt JMdictPlugin::_wordsIndexLoaded;
+QMutex JMdictPlugin::_wordsIndexMutex;
+QMap<QString, DoubleArrayTrie *> JMdictPlugin::_glossTerms;
+JMdictDeinflector *JMdictPlugin::_deinflector = 0;
+QMutex JMdictPlugin::_deinflectorMutex;
 
 QList<const QPair<QString, QString> *> JMdictPlugin::posEntitiesList(quint64 mask)
 {
 	QList<const QPair<QString, QString> *> res;
+	waitForEntities();
 	int cpt(0);
 	while (mask != 0 && cpt < _posEntities.size()) {
 		if (mask & 1) res << &_posEntities[cpt];
@@ -60,6 +74,7 @@ QList<const QPair<QString, QString> *> JMdictPlugin::posEntitiesList(quint64 mas
 QList<const QPair<QString, QString> *> JMdictPlugin::miscEntitiesList(quint64 mask)
 {
 	QList<const QPair<QString, QString> *> res;
+	waitForEntities();
 	int cpt(0);
 	while (mask != 0 && cpt < _miscEntities.size()) {
 		if (mask & 1) res << &_miscEntities[cpt];
@@ -71,6 +86,7 @@ QList<const QPair<QString, QString> *> JMdictPlugin::miscEntitiesList(quint64 ma
 QList<const QPair<QString, QString> *> JMdictPlugin::dialectEntitiesList(quint64 mask)
 {
 	QList<const QPair<QString, QString> *> res;
+	waitForEntities();
 	int cpt(0);
 	while (mask != 0 && cpt < _dialectEntities.size()) {
 		if (mask & 1) res << &_dialectEntities[cpt];
@@ -82,6 +98,7 @@ QList<const QPair<QString, QString> *> JMdictPlugin::dialectEntitiesList(quint64
 QList<const QPair<QString, QString> *> JMdictPlugin::fieldEntitiesList(quint64 mask)
 {
 	QList<const QPair<QString, QString> *> res;
+	waitForEntities();
 	int cpt(0);
 	while (mask != 0 && cpt < _fieldEntities.size()) {
 		if (mask & 1) res << &_fieldEntities[cpt];
@@ -110,7 +127,7 @@ bool JMdictPlugin::checkForMovedEntries()
 {
 #define CHECK(x) if (!(x)) goto errorOccured
 	// Turn the version into an integer and check whether we should look for deleted/moved entries in the user data
-	unsigned int curVersion =  QString(_dictVersion.mid(0, 4) + _dictVersion.mid(5, 2) + _dictVersion.mid(8, 2)).toInt();
+	unsigned int curVersion = jmdictVersionNumber(_dictVersion);
 	unsigned int lastVersion = 0;
 	SQLite::Query query(Database::connection());
 	CHECK(query.exec("select version from versions where id=\"JMdictDB\""));
@@ -219,6 +236,8 @@ bool JMdictPlugin::checkForMovedEntries()
 				}
 			}*/
 		}
+		// The tags index may have been loaded with the removed rows
+		if (!rowIds.isEmpty()) Tag::index().invalidate();
 		rowIds.clear();
 		// Check the notes table
 		CHECK(query.exec(QString("select notes.id, noteId from notes left join jmdict.entries on notes.type = %1 and notes.id = entries.id where notes.type = %1 and entries.id is null").arg(JMDICTENTRY_GLOBALID)));
@@ -329,23 +348,11 @@ void JMdictPlugin::detachAllDatabases()
 	_attachedDBs.clear();
 }
 
-bool JMdictPlugin::onRegister()
+void JMdictPlugin::loadEntities(const QMap<QString, QString> &dbs)
 {
-	if (!attachAllDatabases()) {
-		return false;
-	}
-
-	SQLite::Query query(Database::connection());
-	// Get the dictionary version
-	query.exec("select JMdictVersion from jmdict.info");
-	if (query.next()) _dictVersion = query.valueString(0);
-	query.clear();
-	
-	if (!checkForMovedEntries()) {
-		qCritical("%s", QCoreApplication::translate("JMdictPlugin", "An error seems to have occured while updating the JMdict database records - the program might crash during usage. Please report this bug.").toUtf8().constData());
-	}
-
-	// Populate the entities tables
+	SQLite::Connection connection;
+	if (!Database::connectLoader(connection, dbs)) return;
+	SQLite::Query query(&connection);
 	query.exec("select bitShift, name, description from jmdict.posEntities order by bitShift");
 	while (query.next()) {
 		QString name(query.valueString(1));
@@ -370,11 +377,110 @@ bool JMdictPlugin::onRegister()
 		_fieldEntities << QPair<QString, QString>(name, query.valueString(2));
 		_fieldBitShift[name] = query.valueInt(0);
 	}
+	query.clear();
+	connection.close();
+	// Accessors cannot be used here as they wait for this function to complete
+	JMdictEntrySearcher::updateMiscFilterMask(_miscBitShift);
+	StartupTrace::phase("JMdict entities loaded");
+}
+
+/// Version of the dictionary the words index and glosses vocabularies must be built from
+static quint32 indexSourceVersion()
+{
+	return JMdictPlugin::instance() ? jmdictVersionNumber(JMdictPlugin::instance()->dictVersion()) : 0;
+}
+
+void JMdictPlugin::loadWordsIndex()
+{
+	QString trieFile(lookForFile("jmdict.trie"));
+	if (!trieFile.isEmpty() && _wordsIndex.load(trieFile, JMDICTDB_REVISION, indexSourceVersion())) return;
+	qWarning("JMdict words index not found, invalid or outdated, building it from the database");
+
+	QMap<QString, QList<quint32> > words;
+	SQLite::Query query(Database::connection());
+	query.exec("select kanjiText.reading, kanji.id from jmdict.kanji join jmdict.kanjiText on kanjiText.docid = kanji.docid "
+		"union all select kanaText.reading, kana.id from jmdict.kana join jmdict.kanaText on kanaText.docid = kana.docid");
+	while (query.next()) {
+		QList<quint32> &ids = words[query.valueString(0)];
+		quint32 id = query.valueUInt(1);
+		if (!ids.contains(id)) ids << id;
+	}
+	_wordsIndex.build(words, JMDICTDB_REVISION, indexSourceVersion());
+}
+
+const DoubleArrayTrie &JMdictPlugin::wordsIndex()
+{
+	if (!_wordsIndexLoaded) {
+		QMutexLocker ml(&_wordsIndexMutex);
+		if (!_wordsIndexLoaded) {
+			loadWordsIndex();
+			_wordsIndexLoaded = 1;
+		}
+	}
+	return _wordsIndex;
+}
+
+void JMdictPlugin::loadGlossTerms(const QString &lang, DoubleArrayTrie &terms)
+{
+	QString termsFile(lookForFile(QString("jmdict-%1.terms").arg(lang)));
+	if (!termsFile.isEmpty() && terms.load(termsFile, JMDICTDB_REVISION, indexSourceVersion())) return;
+	if (!instance() || !instance()->attachedDBs().contains(lang)) return;
+	qWarning("JMdict %s glosses vocabulary not found, invalid or outdated, building it from the database", lang.toLatin1().constData());
+
+	QMap<QString, QList<quint32> > words;
+	SQLite::Query query(Database::connection());
+	query.exec(QString("select reading from jmdict_%1.glossText").arg(lang));
+	while (query.next()) {
+		foreach (const QString &term, TextTools::ftsTokens(query.valueString(0))) {
+			QList<quint32> &count = words[term];
+			if (count.isEmpty()) count << 0;
+			++count[0];
+		}
+	}
+	terms.build(words, JMDICTDB_REVISION, indexSourceVersion());
+}
+
+const DoubleArrayTrie &JMdictPlugin::glossTerms(const QString &lang)
+{
+	QMutexLocker ml(&_wordsIndexMutex);
+	DoubleArrayTrie *&terms = _glossTerms[lang];
+	if (!terms) {
+		terms = new DoubleArrayTrie();
+		loadGlossTerms(lang, *terms);
+	}
+	return *terms;
+}
+
+const JMdictDeinflector &JMdictPlugin::deinflector()
+{
+	QMutexLocker ml(&_deinflectorMutex);
+	if (!_deinflector) _deinflector = new JMdictDeinflector(posBitShifts());
+	return *_deinflector;
+}
+
+bool JMdictPlugin::onRegister()
+{
+	if (!attachAllDatabases()) {
+		return false;
+	}
+
+	SQLite::Query query(Database::connection());
+	// Get the dictionary version
+	query.exec("select JMdictVersion from jmdict.info");
+	if (query.next()) _dictVersion = query.valueString(0);
+	query.clear();
 	
+	if (!checkForMovedEntries()) {
+		qCritical("%s", QCoreApplication::translate("JMdictPlugin", "An error seems to have occured while updating the JMdict database records - the program might crash during usage. Please report this bug.").toUtf8().constData());
+	}
+
 	// Register our entry searcher
 	searcher = new JMdictEntrySearcher();
 	EntrySearcherManager::instance().addInstance(searcher);
 
+	// Entities are only needed once the GUI is set up
+	_entitiesLoading = QtConcurrent::run(&JMdictPlugin::loadEntities, Database::attachedDBs());
+
 	// Register our entry loader
 	loader = new JMdictEntryLoader();
 	if (!EntriesCache::instance().addLoader(JMDICTENTRY_GLOBALID, loader)) return false;
@@ -393,10 +499,26 @@ bool JMdictPlugin::onUnregister()
 	delete searcher;
 
 	// Clear all entities tables
+	waitForEntities();
 	_posEntities.clear();
 	_miscEntities.clear();
 	_dialectEntities.clear();
 	_fieldEntities.clear();
+
+	// Drop the words index and the glosses vocabularies
+	{
+		QMutexLocker ml(&_wordsIndexMutex);
+		_wordsIndex.clear();
+		_wordsIndexLoaded = 0;
+		qDeleteAll(_glossTerms);
+		_glossTerms.clear();
+	}
+	// And the deinflector, which depends on the entities
+	{
+		QMutexLocker ml(&_deinflectorMutex);
+		delete _deinflector;
+		_deinflector = 0;
+	}
 	
 	// Detach our databases
 	detachAllDatabases();
@@ -19,13 +19,18 @@
 #define __CORE_JMDICT_PLUGIN_H
 
 #include "core/Plugin.h"
+#include "core/DoubleArrayTrie.h"
 
 #include <QVector>
 #include <QPair>
 #include <QMap>
+#include <QFuture>
+#include <QMutex>
+#include <QAtomicInt>
 
 class JMdictEntrySearcher;
 class JMdictEntryLoader;
+class JMdictDeinflector;
 
 class JMdictPlugin : public Plugin
 {
@@ -47,6 +52,23 @@ private:
 	static QMap<QString, quint8> _miscBitShift;
 	static QMap<QString, quint8> _dialectBitShift;
 	static QMap<QString, quint8> _fieldBitShift;
+	/// Entities tables being loaded in the background by onRegister()
+	static QFuture<void> _entitiesLoading;
+	/// Loads the entities from a dedicated connection to dbs, as it runs in the background
+	static void loadEntities(const QMap<QString, QString> &dbs);
+
+	/// Writings and readings of all entries, loaded by wordsIndex()
+	static DoubleArrayTrie _wordsIndex;
+	static QAtomicInt _wordsIndexLoaded;
+	static QMutex _wordsIndexMutex;
+	static void loadWordsIndex();
+	/// Vocabulary of the glosses of each language, loaded by glossTerms()
+	static QMap<QString, DoubleArrayTrie *> _glossTerms;
+	static void loadGlossTerms(const QString &lang, DoubleArrayTrie &terms);
+
+	/// Deinflection rules, created by deinflector()
+	static JMdictDeinflector *_deinflector;
+	static QMutex _deinflectorMutex;
 
 	/**
 	 * If the version if the JMdict database has been updated, this
@@ -68,21 +90,41 @@ public:
 	const QString &dictVersion() const { return _dictVersion; }
 	virtual QString pluginInfo() const;
 	const QMap<QString, QString> &attachedDBs() const { return _attachedDBs; }
+
+	/// Blocks until the entities tables are loaded
+	static void waitForEntities() { _entitiesLoading.waitForFinished(); }
+
+	/**
+	 * Returns the trie of the writings and readings of all entries, each
+	 * one being associated with the ids of the entries using it. The trie
+	 * built along with the database is memory-mapped when first needed.
+	 * If it cannot be found, it is built from the database instead.
+	 */
+	static const DoubleArrayTrie &wordsIndex();
+	/**
+	 * Returns the trie of the distinct words used by the glosses of lang,
+	 * each one being associated with its number of occurrences. Like the
+	 * words index, it is memory-mapped from the file built along with the
+	 * database, or built from the database if it cannot be found.
+	 */
+	static const DoubleArrayTrie &glossTerms(const QString &lang);
+	/// Returns the deinflector matching the part of speech entities of the database
+	static const JMdictDeinflector &deinflector();
 	
 	static QList<const QPair<QString, QString> *> posEntitiesList(quint64 mask);
 	static QList<const QPair<QString, QString> *> miscEntitiesList(quint64 mask);
 	static QList<const QPair<QString, QString> *> dialectEntitiesList(quint64 mask);
 	static QList<const QPair<QString, QString> *> fieldEntitiesList(quint64 mask);
 	
-	static const QVector<QPair<QString, QString> > &posEntities() { return _posEntities; }
-	static const QVector<QPair<QString, QString> > &miscEntities() { return _miscEntities; }
-	static const QVector<QPair<QString, QString> > &dialectEntities() { return _dialectEntities; }
-	static const QVector<QPair<QString, QString> > &fieldEntities() { return _fieldEntities; }
+	static const QVector<QPair<QString, QString> > &posEntities() { waitForEntities(); return _posEntities; }
+	static const QVector<QPair<QString, QString> > &miscEntities() { waitForEntities(); return _miscEntities; }
+	static const QVector<QPair<QString, QString> > &dialectEntities() { waitForEntities(); return _dialectEntities; }
+	static const QVector<QPair<QString, QString> > &fieldEntities() { waitForEntities(); return _fieldEntities; }
 	
-	static const QMap<QString, quint8> &posBitShifts() { return _posBitShift; }
-	static const QMap<QString, quint8> &miscBitShifts() { return _miscBitShift; }
-	static const QMap<QString, quint8> &dialectBitShifts() { return _dialectBitShift; }
-	static const QMap<QString, quint8> &fieldBitShifts() { return _fieldBitShift; }
+	static const QMap<QString, quint8> &posBitShifts() { waitForEntities(); return _posBitShift; }
+	static const QMap<QString, quint8> &miscBitShifts() { waitForEntities(); return _miscBitShift; }
+	static const QMap<QString, quint8> &dialectBitShifts() { waitForEntities(); return _dialectBitShift; }
+	static const QMap<QString, quint8> &fieldBitShifts() { waitForEntities(); return _fieldBitShift; }
 };
 
 #endif
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/jmdict/JMdictTextAnalyzer.h"
+#include "core/jmdict/JMdictPlugin.h"
+#include "core/jmdict/JMdictEntry.h"
+#include "core/TextTools.h"
+
+#include <QSet>
+
+JMdictTextAnalyzer::JMdictTextAnalyzer() : _index(JMdictPlugin::wordsIndex()), _deinflector(&JMdictPlugin::deinflector())
+{
+}
+
+JMdictTextAnalyzer::JMdictTextAnalyzer(const DoubleArrayTrie &index, const JMdictDeinflector *deinflector) : _index(index), _deinflector(deinflector)
+{
+}
+
+int JMdictTextAnalyzer::addInflectedWord(const QString &text, int pos, int minLength, QVector<Word> &words) const
+{
+	// Conjugation suffixes are written in hiragana
+	int end = pos + qMax(minLength, 1);
+	while (end < text.size() && end - pos < MaxInflectedLength && TextTools::isHiraganaChar(text[end])) ++end;
+	for (int length = end - pos; length > minLength; length--) {
+		QList<quint32> ids;
+		foreach (const JMdictDeinflector::Candidate &candidate, _deinflector->deinflect(text.mid(pos, length))) {
+			foreach (quint32 id, _index.values(candidate.word)) {
+				if (ids.contains(id)) continue;
+				ids << id;
+				Word word;
+				word.position = pos;
+				word.length = length;
+				word.id = id;
+				words << word;
+			}
+		}
+		if (!ids.isEmpty()) return length;
+	}
+	return 0;
+}
+
+QVector<JMdictTextAnalyzer::Word> JMdictTextAnalyzer::analyze(const QString &text, Mode mode) const
+{
+	QVector<Word> ret;
+	DoubleArrayTrie::Match matches[MaxWordLength];
+	const QChar *data = text.constData();
+	int size = text.size();
+	int pos = 0;
+	while (pos < size) {
+		int nbMatches = 0;
+		if (mode == LongestMatch) nbMatches = _index.longestPrefixSearch(data + pos, qMin(size - pos, MaxWordLength), matches[0]) ? 1 : 0;
+		else nbMatches = _index.commonPrefixSearch(data + pos, qMin(size - pos, MaxWordLength), matches, MaxWordLength);
+		// Inflected words are longer than the dictionary words they start
+		// with, if any. Otherwise their stem must start with a kanji.
+		int inflectedLength = 0;
+		if (_deinflector && (nbMatches || TextTools::isKanjiChar(text, pos)))
+			inflectedLength = addInflectedWord(text, pos, nbMatches ? matches[nbMatches - 1].length : 0, ret);
+		if (mode == LongestMatch && inflectedLength) {
+			pos += inflectedLength;
+			continue;
+		}
+		// Matches are given by increasing length
+		for (int i = nbMatches - 1; i >= 0; i--) {
+			Word word;
+			word.position = pos;
+			word.length = matches[i].length;
+			for (int j = 0; j < matches[i].valuesCount; j++) {
+				word.id = matches[i].values[j];
+				ret << word;
+			}
+		}
+		if (mode == LongestMatch && nbMatches) pos += matches[0].length;
+		else ++pos;
+	}
+	return ret;
+}
+
+QList<EntryRef> JMdictTextAnalyzer::entries(const QVector<Word> &words)
+{
+	QList<EntryRef> ret;
+	QSet<EntryId> seen;
+	foreach (const Word &word, words) {
+		if (seen.contains(word.id)) continue;
+		seen << word.id;
+		ret << EntryRef(JMDICTENTRY_GLOBALID, word.id);
+	}
+	return ret;
+}
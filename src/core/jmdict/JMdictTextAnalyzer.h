@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_JMDICT_TEXTANALYZER_H
+#define __CORE_JMDICT_TEXTANALYZER_H
+
+#include "core/DoubleArrayTrie.h"
+#include "core/EntriesCache.h"
+#include "core/jmdict/JMdictDeinflector.h"
+
+#include <QString>
+#include <QVector>
+#include <QList>
+
+/**
+ * Finds the JMdict words contained in a Japanese text.
+ *
+ * The trie of all the writings and readings of JMdict is looked up at
+ * every position of the text, so that no query is run on the database.
+ * If a deinflector is given, inflected words are also recognized: after a
+ * dictionary word or a kanji, the following hiragana are tried as
+ * conjugation suffixes, and the longest span which has a dictionary form in the trie
+ * is kept. As the parts of speech of entries are not part of the trie,
+ * such words are not filtered by part of speech.
+ */
+class JMdictTextAnalyzer
+{
+public:
+	/// A dictionary word found in the text
+	struct Word
+	{
+		/// Position and length of the word in the text, in UTF-16 code units
+		int position;
+		int length;
+		EntryId id;
+	};
+
+	typedef enum {
+		/// Only keep the longest word starting at a given position, and
+		/// continue after it
+		LongestMatch,
+		/// Keep all the words starting at every position of the text
+		AllMatches
+	} Mode;
+
+private:
+	const DoubleArrayTrie &_index;
+	const JMdictDeinflector *_deinflector;
+
+	/**
+	 * Looks for an inflected word longer than minLength at position pos of
+	 * text, and appends its entries to words. Returns the length of the
+	 * word found, or 0.
+	 */
+	int addInflectedWord(const QString &text, int pos, int minLength, QVector<Word> &words) const;
+
+public:
+	/// Maximum length of the words looked up, in UTF-16 code units
+	static const int MaxWordLength = 64;
+	/// Maximum length of inflected words, in UTF-16 code units
+	static const int MaxInflectedLength = 16;
+
+	/// Uses the words index and the deinflector of the JMdict plugin
+	JMdictTextAnalyzer();
+	JMdictTextAnalyzer(const DoubleArrayTrie &index, const JMdictDeinflector *deinflector = 0);
+
+	/**
+	 * Returns the words of text by order of position. Words starting at
+	 * the same position are given longest first.
+	 */
+	QVector<Word> analyze(const QString &text, Mode mode = LongestMatch) const;
+
+	/// Returns the entries of words, in order of appearance and without duplicates
+	static QList<EntryRef> entries(const QVector<Word> &words);
+};
+
+Q_DECLARE_TYPEINFO(JMdictTextAnalyzer::Word, Q_PRIMITIVE_TYPE);
+
+#endif
@@ -17,6 +17,7 @@
 
 #include "sqlite/Connection.h"
 #include "sqlite/Query.h"
+#include "sqlite/DictionaryCodec.h"
 #include "core/Database.h"
 #include "core/TextTools.h"
 #include "core/kanjidic2/Kanjidic2Parser.h"
@@ -108,7 +109,7 @@ bool Kanjidic2DBParser::onItemParsed(Kanjidic2Item &kanji)
 				EXEC(mtQuery);
 				BIND(mQuery, mtQuery.lastInsertId());
 				BIND(mQuery, kanji.id);
-				BIND(mQuery, qCompress(meaning.toUtf8(), 9));
+				BIND(mQuery, meaning.toUtf8());
 				EXEC(mQuery);
 			}
 		}
@@ -225,15 +226,14 @@ bool KanjiVGDBParser::onItemParsed(KanjiVGItem &kanji)
 		EXEC(insertStrokeGroupQuery);
 	}
 	
-	// Insert strokes
-	QStringList paths;
+	// Insert strokes, parsed so the SVG paths do not need to be processed at runtime
+	QList<KanjiStrokePath> paths;
 	foreach (const KanjiVGStrokeItem &stroke, kanji.strokes) {
-		paths << stroke.path;
+		paths << KanjiStrokePath::fromSVG(stroke.path);
 	}
-	QByteArray compressedPaths(paths.join("|").toLatin1());
 	if (!paths.isEmpty()) {
 		BIND(updatePathsString, paths.size());
-		BIND(updatePathsString, qCompress(compressedPaths, 9));
+		BIND(updatePathsString, qCompress(KanjiStrokePath::encode(paths), 9));
 		BIND(updatePathsString, kanji.id);
 		EXEC(updatePathsString);
 	}
@@ -282,6 +282,7 @@ public:
 	bool clearQueries();
 	bool createRadicalsTable(const QString &fName);
 	bool createRootComponentsTable();
+	bool createComponentKanjiTable();
 	bool createTables();
 	bool createIndexes();
 	bool finalize();
@@ -293,6 +294,7 @@ public:
 
 	bool updateTranslations(const QStringList &supportedLanguages);
 	bool updateTranslation(const QString &fName, const QString &lang);
+	bool compressMeanings();
 
 private:
 	QStringList languages;
@@ -406,6 +408,26 @@ bool KanjiDB::createRootComponentsTable()
 	return true;
 }
 
+/**
+ * Materializes the kanji using each component, in the order they are
+ * displayed by the detailed view. The rank column being the rowid, the
+ * kanji of a given component are inserted by increasing stroke count and
+ * decreasing JLPT level so that the runtime only has to sort them against
+ * the training data. Must be run after the JLPT levels have been set.
+ */
+bool KanjiDB::createComponentKanjiTable()
+{
+	SQLite::Query query(&connections["main"]);
+	EXEC_STMT(query, "insert into componentKanji(component, kanji) "
+		"select c.component, c.kanji from ("
+			"select element as component, kanji from strokeGroups where isRoot = 1 and element not null and kanji != element "
+			"union "
+			"select original as component, kanji from strokeGroups where isRoot = 1 and original not null and kanji != original"
+		") as c join entries on c.kanji = entries.id "
+		"order by c.component, entries.strokeCount, entries.jlpt DESC");
+	return true;
+}
+
 bool KanjiDB::createRadicalsTable(const QString &fName)
 {
 	QFile file(fName);
@@ -441,6 +463,7 @@ bool KanjiDB::createTables()
 	EXEC_STMT(query, "create virtual table nanoriText using fts4(reading, TOKENIZE katakana)");
 	EXEC_STMT(query, "create table strokeGroups(kanji INTEGER, element INTEGER, original INTEGER, isRoot BOOLEAN, pathsRefs BLOB)");
 	EXEC_STMT(query, "create table rootComponents(kanji INTEGER PRIMARY KEY)");
+	EXEC_STMT(query, "create table componentKanji(rank INTEGER PRIMARY KEY, component INTEGER, kanji INTEGER)");
 	EXEC_STMT(query, "create table skip(entry INTEGER, type TINYINT, c1 TINYINT, c2 TINYINT)");
 	EXEC_STMT(query, "create table fourCorner(entry INTEGER, topLeft TINYINT, topRight TINYINT, botLeft TINYINT, botRight TINYINT, extra TINYINT)");
 	EXEC_STMT(query, "create table radicalsList(kanji INTEGER REFERENCES entries, number SHORTINT)");
@@ -466,6 +489,7 @@ bool KanjiDB::createIndexes()
 	EXEC_STMT(query, "create index idx_strokeGroups_kanji on strokeGroups(kanji)");
 	EXEC_STMT(query, "create index idx_strokeGroups_element on strokeGroups(element)");
 	EXEC_STMT(query, "create index idx_strokeGroups_original on strokeGroups(original)");
+	EXEC_STMT(query, "create index idx_componentKanji on componentKanji(component)");
 	EXEC_STMT(query, "create index idx_skip on skip(entry)");
 	EXEC_STMT(query, "create index idx_skip_type on skip(type, c1, c2)");
 	EXEC_STMT(query, "create index idx_fourCorner on fourCorner(entry)");
@@ -564,7 +588,7 @@ bool KanjiDB::updateTranslation(const QString &fName, const QString &lang)
 		EXEC(mtQuery);
 		BIND(mQuery, mtQuery.lastInsertId());
 		BIND(mQuery, kanji);
-		BIND(mQuery, qCompress(meaning.toUtf8(), 9));
+		BIND(mQuery, meaning.toUtf8());
 		EXEC(mQuery);
 
 		line = in.readLine();
@@ -572,6 +596,33 @@ bool KanjiDB::updateTranslation(const QString &fName, const QString &lang)
 	return true;
 }
 
+/**
+ * Compresses the meanings of each language with a dictionary trained on all
+ * of them.
+ */
+bool KanjiDB::compressMeanings()
+{
+	foreach (const QString &lang, languages) {
+		SQLite::Query query(&connections[lang]);
+		QList<quint32> ids;
+		QList<QByteArray> meanings;
+		EXEC_STMT(query, "select docid, meanings from meaning");
+		while (query.next()) {
+			ids << query.valueUInt(0);
+			meanings << query.valueBlob(1);
+		}
+		SQLite::DictionaryCodec codec(SQLite::DictionaryCodec::train(meanings));
+		ASSERT(codec.store(&connections[lang]));
+		ASSERT(query.prepare("update meaning set meanings = ? where docid = ?"));
+		for (int i = 0; i < ids.size(); i++) {
+			BIND(query, codec.compress(meanings[i]));
+			BIND(query, ids[i]);
+			EXEC(query);
+		}
+	}
+	return true;
+}
+
 bool KanjiDB::parse()
 {
 	// Parse and insert kanjidic2
@@ -600,6 +651,7 @@ bool KanjiDB::parse()
 	ASSERT(fillMainInfoTable());	
 	ASSERT(fillLanguagesInfoTable());	
 	ASSERT(kdicParser->updateJLPTLevels());
+	ASSERT(createComponentKanjiTable());
 	return true;
 }
 
@@ -620,6 +672,7 @@ bool buildDB(const QStringList &languages, const QString &srcDir, const QString
 	ASSERT(kanjiDB.prepareQueries());
 	ASSERT(kanjiDB.parse());
 	ASSERT(kanjiDB.updateTranslations(languages));
+	ASSERT(kanjiDB.compressMeanings());
 	ASSERT(kanjiDB.createIndexes());
 	ASSERT(kanjiDB.clearQueries());
 	ASSERT(kanjiDB.finalize());
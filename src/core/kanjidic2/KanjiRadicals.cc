@@ -19,12 +19,16 @@
 
 #include "sqlite/Query.h"
 #include "core/Database.h"
+#include "core/StartupTrace.h"
 #include <QVariant>
+#include <QtConcurrentRun>
 
-KanjiRadicals::KanjiRadicals()
+QFuture<void> KanjiRadicals::_loading;
+
+KanjiRadicals::KanjiRadicals(SQLite::Connection *connection)
 {
 	// Get all the radical information!
-	SQLite::Query query(Database::connection());
+	SQLite::Query query(connection);
 	query.exec("select kanji, number from kanjidic2.radicalsList order by rowid");
 	while (query.next()) {
 		uint kanji = query.valueUInt(0);
@@ -35,8 +39,31 @@ KanjiRadicals::KanjiRadicals()
 	}
 }
 
-const KanjiRadicals &KanjiRadicals::instance()
+const KanjiRadicals &KanjiRadicals::load(SQLite::Connection *connection)
 {
-	static KanjiRadicals _instance;
+	// Never called concurrently, as instance() waits for the preloading
+	static KanjiRadicals _instance(connection);
 	return _instance;
 }
+
+void KanjiRadicals::preloadInstance(const QMap<QString, QString> &dbs)
+{
+	SQLite::Connection connection;
+	if (!Database::connectLoader(connection, dbs)) return;
+	load(&connection);
+	connection.close();
+	StartupTrace::phase("Radicals tables loaded");
+}
+
+void KanjiRadicals::preload()
+{
+	if (_loading.isRunning()) return;
+	_loading = QtConcurrent::run(&KanjiRadicals::preloadInstance, Database::attachedDBs());
+}
+
+const KanjiRadicals &KanjiRadicals::instance()
+{
+	_loading.waitForFinished();
+	// Loads from the main connection if preloading failed
+	return load(Database::connection());
+}
@@ -20,6 +20,13 @@
 
 #include <QHash>
 #include <QList>
+#include <QFuture>
+#include <QMap>
+#include <QString>
+
+namespace SQLite {
+class Connection;
+}
 
 /**
  * Provides a singleton that gives the list of kanji related
@@ -31,9 +38,20 @@ private:
 	/// Sometimes a radical can have additional kanjis representing it.
 	QHash<quint8, QList<uint> > rad2kanji;
 
-	KanjiRadicals();
+	KanjiRadicals(SQLite::Connection *connection);
+	static QFuture<void> _loading;
+	/// Returns the instance, building it from connection the first time
+	static const KanjiRadicals &load(SQLite::Connection *connection);
+	static void preloadInstance(const QMap<QString, QString> &dbs);
 
 public:
+	/**
+	 * Starts loading the radicals tables in the background, so that
+	 * instance() does not have to wait for them. The tables are read
+	 * from a dedicated connection, as the main one is not thread-safe.
+	 */
+	static void preload();
+	/// Blocks until the radicals tables are loaded
 	static const KanjiRadicals &instance();
 	quint8 kanji2Rad(uint kanji) const { return kanji2rad[kanji]; }
 	const QList<uint> rad2Kanji(quint8 rad) const { return rad2kanji[rad]; }
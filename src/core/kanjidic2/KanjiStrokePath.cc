@@ -0,0 +1,253 @@
+/*
+ *  Copyright (C) 2008  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/kanjidic2/KanjiStrokePath.h"
+
+#include <QDataStream>
+#include <QPointF>
+#include <QtDebug>
+
+/// Number of segments used to measure cubic curves
+#define CURVE_SEGMENTS 16
+
+KanjiStrokePath::KanjiStrokePath() : _length(0)
+{
+	for (int i = 0; i < 4; i++) _numberLine[i] = 0;
+}
+
+static void appendPoint(QVector<qint16> &coords, const QPointF &point)
+{
+	coords << (qint16)qBound(-32768, qRound(point.x() * KanjiStrokePath::Scale), 32767);
+	coords << (qint16)qBound(-32768, qRound(point.y() * KanjiStrokePath::Scale), 32767);
+}
+
+static bool isSeparator(const QChar &c)
+{
+	return c.isSpace() || c == ',';
+}
+
+static bool readNumber(const QString &str, int &pos, qreal &ret)
+{
+	while (pos < str.size() && isSeparator(str[pos])) pos++;
+	int start = pos;
+	if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) pos++;
+	// A second dot starts a new number, i.e. "1.5.5" is "1.5 .5"
+	bool gotDot = false;
+	while (pos < str.size() && (str[pos].isDigit() || (str[pos] == '.' && !gotDot))) {
+		if (str[pos] == '.') gotDot = true;
+		pos++;
+	}
+	if (pos == start) return false;
+	bool ok;
+	ret = str.mid(start, pos - start).toDouble(&ok);
+	return ok;
+}
+
+static bool readPoint(const QString &str, int &pos, QPointF &ret)
+{
+	qreal x, y;
+	if (!readNumber(str, pos, x) || !readNumber(str, pos, y)) return false;
+	ret = QPointF(x, y);
+	return true;
+}
+
+KanjiStrokePath KanjiStrokePath::fromSVG(const QString &svgPath)
+{
+	KanjiStrokePath ret;
+	QChar command;
+	QPointF current, subpathStart, lastControl;
+	QPointF p1, p2, dest;
+	int pos = 0;
+	while (true) {
+		while (pos < svgPath.size() && isSeparator(svgPath[pos])) pos++;
+		if (pos >= svgPath.size()) break;
+		if (svgPath[pos].isLetter()) {
+			command = svgPath[pos++];
+			if (command == 'z' || command == 'Z') {
+				ret._commands.append((char)Close);
+				current = lastControl = subpathStart;
+			}
+			continue;
+		}
+		// Coordinates of relative commands are relative to the current point
+		QPointF origin(command.isLower() ? current : QPointF());
+		bool ok = true;
+		switch (command.toUpper().toLatin1()) {
+			case 'M':
+				if (!(ok = readPoint(svgPath, pos, dest))) break;
+				current = lastControl = subpathStart = origin + dest;
+				ret._commands.append((char)MoveTo);
+				appendPoint(ret._coords, current);
+				// Additional coordinates are implicit lineto commands
+				command = command.isLower() ? 'l' : 'L';
+				break;
+			case 'L':
+				if (!(ok = readPoint(svgPath, pos, dest))) break;
+				current = lastControl = origin + dest;
+				ret._commands.append((char)LineTo);
+				appendPoint(ret._coords, current);
+				break;
+			case 'C':
+			case 'S':
+				if (command.toUpper() == 'C') {
+					if (!(ok = readPoint(svgPath, pos, p1))) break;
+					p1 += origin;
+				}
+				// Smooth curves use the reflection of the previous control point
+				else p1 = current * 2 - lastControl;
+				if (!(ok = readPoint(svgPath, pos, p2) && readPoint(svgPath, pos, dest))) break;
+				p2 += origin;
+				current = origin + dest;
+				lastControl = p2;
+				ret._commands.append((char)CubicTo);
+				appendPoint(ret._coords, p1);
+				appendPoint(ret._coords, p2);
+				appendPoint(ret._coords, current);
+				break;
+			default:
+				ok = false;
+				break;
+		}
+		if (!ok) {
+			qWarning("Invalid kanji drawing path!");
+			break;
+		}
+	}
+	ret.computeMetrics();
+	return ret;
+}
+
+void KanjiStrokePath::computeMetrics()
+{
+	// Flatten the path into segments
+	QList<QLineF> segments;
+	QPointF current, subpathStart;
+	int c = 0;
+	for (int i = 0; i < _commands.size(); i++) {
+		switch (_commands[i]) {
+			case MoveTo:
+				current = subpathStart = QPointF(coord(c), coord(c + 1));
+				c += 2;
+				break;
+			case LineTo:
+			{
+				QPointF dest(coord(c), coord(c + 1));
+				segments << QLineF(current, dest);
+				current = dest;
+				c += 2;
+				break;
+			}
+			case CubicTo:
+			{
+				QPointF p1(coord(c), coord(c + 1)), p2(coord(c + 2), coord(c + 3)), dest(coord(c + 4), coord(c + 5));
+				QPointF prev(current);
+				for (int j = 1; j <= CURVE_SEGMENTS; j++) {
+					qreal t = j / (qreal)CURVE_SEGMENTS, u = 1 - t;
+					QPointF point(current * (u * u * u) + p1 * (3 * u * u * t) + p2 * (3 * u * t * t) + dest * (t * t * t));
+					segments << QLineF(prev, point);
+					prev = point;
+				}
+				current = dest;
+				c += 6;
+				break;
+			}
+			case Close:
+				segments << QLineF(current, subpathStart);
+				current = subpathStart;
+				break;
+		}
+	}
+
+	qreal length = 0.0;
+	foreach (const QLineF &segment, segments) length += segment.length();
+	_length = qMin(qRound(length * Scale), 65535);
+
+	// The number of the stroke is drawn before its start, in the direction of its beginning
+	QPointF start(_coords.size() >= 2 ? QPointF(coord(0), coord(1)) : QPointF());
+	QPointF numberPoint(start);
+	qreal remaining = length * 0.1;
+	foreach (const QLineF &segment, segments) {
+		if (segment.length() >= remaining) {
+			if (segment.length() > 0.0) numberPoint = segment.pointAt(remaining / segment.length());
+			else numberPoint = segment.p2();
+			break;
+		}
+		remaining -= segment.length();
+	}
+	QVector<qint16> line;
+	appendPoint(line, start);
+	appendPoint(line, numberPoint);
+	for (int i = 0; i < 4; i++) _numberLine[i] = line[i];
+}
+
+static int coordsCount(const QByteArray &commands)
+{
+	int ret = 0;
+	for (int i = 0; i < commands.size(); i++) {
+		switch (commands[i]) {
+			case KanjiStrokePath::MoveTo:
+			case KanjiStrokePath::LineTo:
+				ret += 2;
+				break;
+			case KanjiStrokePath::CubicTo:
+				ret += 6;
+				break;
+			default:
+				break;
+		}
+	}
+	return ret;
+}
+
+QByteArray KanjiStrokePath::encode(const QList<KanjiStrokePath> &paths)
+{
+	QByteArray ret;
+	QDataStream ds(&ret, QIODevice::WriteOnly);
+	ds << (quint8)paths.size();
+	foreach (const KanjiStrokePath &path, paths) {
+		ds << (quint16)path._commands.size() << path._length;
+		for (int i = 0; i < 4; i++) ds << path._numberLine[i];
+		ds.writeRawData(path._commands.constData(), path._commands.size());
+		foreach (qint16 coord, path._coords) ds << coord;
+	}
+	return ret;
+}
+
+QList<KanjiStrokePath> KanjiStrokePath::decode(const QByteArray &data)
+{
+	QList<KanjiStrokePath> ret;
+	QDataStream ds(data);
+	quint8 nbPaths;
+	ds >> nbPaths;
+	for (int i = 0; i < nbPaths && ds.status() == QDataStream::Ok; i++) {
+		KanjiStrokePath path;
+		quint16 nbCommands;
+		ds >> nbCommands >> path._length;
+		for (int j = 0; j < 4; j++) ds >> path._numberLine[j];
+		path._commands.resize(nbCommands);
+		if (ds.readRawData(path._commands.data(), nbCommands) != nbCommands) break;
+		int nbCoords = coordsCount(path._commands);
+		path._coords.resize(nbCoords);
+		for (int j = 0; j < nbCoords; j++) ds >> path._coords[j];
+		ret << path;
+	}
+	if (ds.status() != QDataStream::Ok || ret.size() != nbPaths) {
+		qWarning("Invalid kanji strokes data!");
+		ret.clear();
+	}
+	return ret;
+}
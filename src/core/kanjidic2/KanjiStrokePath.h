@@ -0,0 +1,82 @@
+/*
+ *  Copyright (C) 2008  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CORE_KANJIDIC2_KANJISTROKEPATH_H
+#define __CORE_KANJIDIC2_KANJISTROKEPATH_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+#include <QString>
+#include <QLineF>
+
+/**
+ * Pre-parsed geometry of a kanji stroke, as stored into the kanjidic2
+ * database.
+ *
+ * The SVG path of the stroke is parsed once when the database is built:
+ * relative and smooth curve commands are resolved, so that only absolute
+ * moves, lines, cubic curves and subpath closings remain. Coordinates
+ * are quantized to 1/Scale of a unit of the KanjiVG drawing area. The
+ * length of the stroke and the line along which its number is drawn are
+ * also precomputed so that displaying a kanji requires no parsing and
+ * no path measurement.
+ */
+class KanjiStrokePath
+{
+public:
+	typedef enum { MoveTo = 0, LineTo, CubicTo, Close } Command;
+	/// Fixed-point factor of the stored coordinates
+	static const int Scale = 100;
+
+private:
+	QByteArray _commands;
+	QVector<qint16> _coords;
+	quint16 _length;
+	qint16 _numberLine[4];
+
+	void computeMetrics();
+
+public:
+	KanjiStrokePath();
+
+	/**
+	 * Parses an SVG path. Only the commands used by KanjiVG (M, L, C, S,
+	 * Z and their relative versions) are supported.
+	 */
+	static KanjiStrokePath fromSVG(const QString &svgPath);
+
+	/// Encodes the paths of all the strokes of a kanji
+	static QByteArray encode(const QList<KanjiStrokePath> &paths);
+	/// Decodes the output of encode(). Returns an empty list if data is invalid.
+	static QList<KanjiStrokePath> decode(const QByteArray &data);
+
+	bool isEmpty() const { return _commands.isEmpty(); }
+	/// Commands of the path, each one being a value of Command
+	const QByteArray &commands() const { return _commands; }
+	/// Quantized coordinates used by the commands, in order: 2 for MoveTo and LineTo, 6 for CubicTo and none for Close
+	const QVector<qint16> &coords() const { return _coords; }
+	/// Returns the coordinate at index idx, in KanjiVG units
+	qreal coord(int idx) const { return _coords[idx] / (qreal)Scale; }
+
+	/// Length of the stroke, in KanjiVG units
+	qreal length() const { return _length / (qreal)Scale; }
+	/// Line going from the start of the stroke to the point at 10% of its length
+	QLineF numberLine() const { return QLineF(_numberLine[0] / (qreal)Scale, _numberLine[1] / (qreal)Scale, _numberLine[2] / (qreal)Scale, _numberLine[3] / (qreal)Scale); }
+};
+
+#endif
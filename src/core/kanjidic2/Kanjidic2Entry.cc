@@ -39,7 +39,7 @@ unsigned int KanjiComponent::unicode(bool simplified) const {
 	return TextTools::singleCharToUnicode(repr(simplified));
 }
 
-KanjiStroke::KanjiStroke(const QChar& type, const QString& path) : _type(type), _path(path)
+KanjiStroke::KanjiStroke(const QChar& type, const KanjiStrokePath& path) : _type(type), _path(path)
 {
 }
 
@@ -59,7 +59,7 @@ KanjiComponent *Kanjidic2Entry::addComponent(const QString& element, const QStri
 	return &_components.last();
 }
 
-KanjiStroke *Kanjidic2Entry::addStroke(const QChar &type, const QString &path)
+KanjiStroke *Kanjidic2Entry::addStroke(const QChar &type, const KanjiStrokePath &path)
 {
 	_strokes << KanjiStroke(type, path);
 	return &_strokes.last();
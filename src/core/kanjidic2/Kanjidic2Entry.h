@@ -20,11 +20,12 @@
 
 #include "core/EntriesCache.h"
 #include "core/TextTools.h"
+#include "core/kanjidic2/KanjiStrokePath.h"
 
 #include <QStack>
 
 #define KANJIDIC2ENTRY_GLOBALID 2
-#define KANJIDIC2DB_REVISION 5
+#define KANJIDIC2DB_REVISION 8
 
 class KanjiStroke;
 
@@ -60,14 +61,14 @@ class KanjiStroke
 {
 private:
 	QChar _type;
-	QString _path;
+	KanjiStrokePath _path;
 
 public:
-	KanjiStroke(const QChar &type, const QString &path);
+	KanjiStroke(const QChar &type, const KanjiStrokePath &path);
 	virtual ~KanjiStroke();
 
 	const QChar &type() const { return _type; }
-	const QString &path() const { return _path; }
+	const KanjiStrokePath &path() const { return _path; }
 };
 
 class Kanjidic2Entry : public Entry
@@ -130,7 +131,7 @@ private:
 
 protected:
 	KanjiComponent *addComponent(const QString &element, const QString &original, bool isRoot = false);
-	KanjiStroke *addStroke(const QChar &type, const QString &path);
+	KanjiStroke *addStroke(const QChar &type, const KanjiStrokePath &path);
 
 protected:
 	Kanjidic2Entry(const QString &kanji, bool inDB, int grade = -1, int strokeCount = -1, qint32 kanjiFrequency = -1, int jlpt = -1, int heisig = -1);
@@ -19,6 +19,7 @@
 #include "core/kanjidic2/Kanjidic2EntryLoader.h"
 #include "core/kanjidic2/Kanjidic2Entry.h"
 #include "core/kanjidic2/Kanjidic2Plugin.h"
+#include "sqlite/DictionaryCodec.h"
 
 Kanjidic2EntryLoader::Kanjidic2EntryLoader() : EntryLoader(), kanjiQuery(&connection), variationsQuery(&connection), readingsQuery(&connection), nanoriQuery(&connection), componentsQuery(&connection), radicalsQuery(&connection), skipQuery(&connection), fourCornerQuery(&connection)
 {
@@ -62,7 +63,7 @@ QList<Kanjidic2Entry::KanjiMeaning> Kanjidic2EntryLoader::getMeanings(int id)
 		meaningsQuery.bindValue(id);
 		meaningsQuery.exec();
 		while(meaningsQuery.next()) {
-			ret << Kanjidic2Entry::KanjiMeaning(lang, QString::fromUtf8(qUncompress(meaningsQuery.valueBlob(0))));
+			ret << Kanjidic2Entry::KanjiMeaning(lang, QString::fromUtf8(SQLite::DictionaryCodec::uncompress(meaningsQuery.valueBlob(0))));
 		}
 		meaningsQuery.reset();
 		if (lang != "en" && !ret.isEmpty()) nonEnglishLoaded = true;
@@ -89,7 +90,7 @@ Entry *Kanjidic2EntryLoader::loadEntry(EntryId id)
 	kanjiQuery.bindValue(id);
 	kanjiQuery.exec();
 	Kanjidic2Entry *entry;
-	QStringList paths;
+	QList<KanjiStrokePath> paths;
 	// We have no information about this kanji! This is probably an unknown radical
 	if (!kanjiQuery.next()) {
 		entry = new Kanjidic2Entry(character, false);
@@ -102,7 +103,7 @@ Entry *Kanjidic2EntryLoader::loadEntry(EntryId id)
 		int heisig = kanjiQuery.valueIsNull(4) ? -1 : kanjiQuery.valueInt(4);
 		// Get the strokes paths for later processing
 		QByteArray pathsBA(kanjiQuery.valueBlob(5));
-		if (!pathsBA.isEmpty()) paths = QString(qUncompress(pathsBA)).split('|');
+		if (!pathsBA.isEmpty()) paths = KanjiStrokePath::decode(qUncompress(pathsBA));
 
 		entry = new Kanjidic2Entry(character, true, grade, strokeCount, frequency, jlpt, heisig);
 	}
@@ -149,7 +150,7 @@ Entry *Kanjidic2EntryLoader::loadEntry(EntryId id)
 	nanoriQuery.reset();
 
 	// Insert the strokes
-	foreach (const QString &path, paths) entry->addStroke(0, path);
+	foreach (const KanjiStrokePath &path, paths) entry->addStroke(0, path);
 
 	// Load components
 	componentsQuery.bindValue(id);
@@ -64,7 +64,7 @@ static QString buildTextSearchCondition(const QStringList &words, const QString
 	static QRegExp regExpChars = QRegExp("[\\?\\*]");
 	static QString ftsMatch("kanjidic2%3.%2Text.reading MATCH '%1'");
 	static QString regexpMatch("kanjidic2%3.%2Text.reading REGEXP '%1'");
-	static QString glossRegexpMatch("{{leftcolumn}} in (select entry from kanjidic2_%2.meaning where FTSUNCOMPRESS(meanings) REGEXP '%1')");
+	static QString glossRegexpMatch("{{leftcolumn}} in (select entry from kanjidic2_%2.meaning where DICTUNCOMPRESS(meanings) REGEXP '%1')");
 	static QString globalMatch("{{leftcolumn}} IN (SELECT entry FROM kanjidic2%3.%2 JOIN kanjidic2%3.%2Text ON kanjidic2%3.%2.docid = kanjidic2%3.%2Text.docid WHERE %1)");
 
 	QStringList globalMatches;
@@ -24,6 +24,7 @@
 #include "core/kanjidic2/Kanjidic2EntrySearcher.h"
 #include "core/kanjidic2/Kanjidic2Plugin.h"
 #include "core/kanjidic2/Kanjidic2Entry.h"
+#include "core/kanjidic2/KanjiRadicals.h"
 
 #include <QtDebug>
 #include <QFile>
@@ -114,6 +115,9 @@ bool Kanjidic2Plugin::onRegister()
 	loader = new Kanjidic2EntryLoader();
 	if (!EntriesCache::instance().addLoader(KANJIDIC2ENTRY_GLOBALID, loader)) return false;
 
+	// Only needed by the radical search
+	KanjiRadicals::preload();
+
 	return true;
 }
 
@@ -127,6 +131,9 @@ bool Kanjidic2Plugin::onUnregister()
 	EntrySearcherManager::instance().removeInstance(searcher);
 	delete searcher;
 
+	// The radicals tables must not be loading anymore when detaching
+	KanjiRadicals::instance();
+
 	// Detach our databases
 	detachAllDatabases();
 
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseMaintenanceTests.h"
+#include "core/DatabaseMaintenance.h"
+#include "sqlite/Query.h"
+
+#include <QFileInfo>
+
+#define CHURN_ROUNDS 20
+#define CHURN_ROWS 5000
+
+void DatabaseMaintenanceTests::initTestCase()
+{
+	QVERIFY(dbFile.open());
+	QVERIFY(connection.connect(dbFile.fileName()));
+	QVERIFY(DatabaseMaintenance::enableIncrementalVacuum(&connection));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("CREATE VIRTUAL TABLE tags USING fts4(tag)"));
+	QVERIFY(query.exec("CREATE TABLE taggedEntries(type INT, id INTEGER SECONDARY KEY, tagId INTEGER SECONDARY KEY REFERENCES tags, date UNSIGNED INT)"));
+	QVERIFY(query.exec("CREATE TABLE notes(id INTEGER PRIMARY KEY, type INT, entryId INTEGER, dateAdded UNSIGNED INT, dateLastChange UNSIGNED INT, note TEXT)"));
+}
+
+void DatabaseMaintenanceTests::cleanupTestCase()
+{
+	QVERIFY(connection.close());
+}
+
+/// Runs maintenance slices until there is nothing left to do
+int DatabaseMaintenanceTests::runAllSlices()
+{
+	DatabaseMaintenance maintenance(&connection);
+	int slices = 1;
+	while (maintenance.runSlice()) slices++;
+	return slices;
+}
+
+void DatabaseMaintenanceTests::tagsCleanup()
+{
+	SQLite::Query query(&connection);
+	QVERIFY(connection.transaction());
+	for (int i = 0; i < 250; i++) QVERIFY(query.exec(QString("insert into tags values('tag%1')").arg(i)));
+	// Only even tags are used
+	QVERIFY(query.exec("insert into taggedEntries select 1, docid, docid, 0 from tags where docid % 2 = 0"));
+	QVERIFY(connection.commit());
+
+	// Tags are deleted by several small slices
+	QVERIFY(runAllSlices() > 1);
+	QVERIFY(query.exec("select count(*) from tags"));
+	QVERIFY(query.next());
+	QCOMPARE(query.valueInt(0), 125);
+	QVERIFY(query.exec("select count(*) from tags where docid % 2 = 1"));
+	QVERIFY(query.next());
+	QCOMPARE(query.valueInt(0), 0);
+}
+
+void DatabaseMaintenanceTests::churn()
+{
+	DatabaseMaintenance maintenance(&connection);
+	QVERIFY(maintenance.incrementalVacuum());
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("pragma page_size"));
+	QVERIFY(query.next());
+	qint64 pageSize = query.valueInt(0);
+	for (int round = 0; round < CHURN_ROUNDS; round++) {
+		// Add a lot of notes, then remove most of them
+		QVERIFY(connection.transaction());
+		QVERIFY(query.prepare("insert into notes values(null, 1, ?, 0, 0, ?)"));
+		for (int i = 0; i < CHURN_ROWS; i++) {
+			query.bindValue(i);
+			query.bindValue(QString(200 + qrand() % 800, QChar('a' + round)));
+			QVERIFY(query.exec());
+			query.reset();
+		}
+		QVERIFY(query.exec("delete from notes where id % 10 != 0"));
+		QVERIFY(connection.commit());
+		qint64 peakSize = QFileInfo(dbFile.fileName()).size();
+		QVERIFY(maintenance.freelistCount() >= DatabaseMaintenance::MinFreelistPages);
+
+		runAllSlices();
+		int pages = maintenance.pageCount();
+		int freePages = maintenance.freelistCount();
+		QVERIFY(freePages < DatabaseMaintenance::MinFreelistPages || freePages * 100 < pages * DatabaseMaintenance::MaxFreelistPercent);
+		// The file only keeps the space used by the remaining notes, plus
+		// the tolerated free pages
+		qint64 size = QFileInfo(dbFile.fileName()).size();
+		QCOMPARE(size, pages * pageSize);
+		QVERIFY(size < peakSize);
+	}
+}
+
+void DatabaseMaintenanceTests::oldDatabase()
+{
+	// Database created before incremental vacuum was enabled
+	QTemporaryFile oldDBFile;
+	QVERIFY(oldDBFile.open());
+	SQLite::Connection oldConnection;
+	QVERIFY(oldConnection.connect(oldDBFile.fileName()));
+	SQLite::Query query(&oldConnection);
+	QVERIFY(query.exec("CREATE VIRTUAL TABLE tags USING fts4(tag)"));
+	QVERIFY(query.exec("CREATE TABLE taggedEntries(type INT, id INTEGER SECONDARY KEY, tagId INTEGER SECONDARY KEY REFERENCES tags, date UNSIGNED INT)"));
+	QVERIFY(query.exec("CREATE TABLE notes(id INTEGER PRIMARY KEY, type INT, entryId INTEGER, dateAdded UNSIGNED INT, dateLastChange UNSIGNED INT, note TEXT)"));
+	QVERIFY(oldConnection.transaction());
+	QVERIFY(query.prepare("insert into notes values(null, 1, ?, 0, 0, ?)"));
+	for (int i = 0; i < CHURN_ROWS; i++) {
+		query.bindValue(i);
+		query.bindValue(QString(500, QChar('a')));
+		QVERIFY(query.exec());
+		query.reset();
+	}
+	QVERIFY(query.exec("delete from notes where id % 10 != 0"));
+	QVERIFY(oldConnection.commit());
+
+	DatabaseMaintenance maintenance(&oldConnection);
+	QVERIFY(!maintenance.incrementalVacuum());
+	QVERIFY(maintenance.needsVacuum());
+	// Slices never run the full VACUUM required by the conversion
+	int freePages = maintenance.freelistCount();
+	while (maintenance.runSlice());
+	QVERIFY(!maintenance.incrementalVacuum());
+	QCOMPARE(maintenance.freelistCount(), freePages);
+
+	QVERIFY(maintenance.convertToIncrementalVacuum());
+	QVERIFY(maintenance.incrementalVacuum());
+	QVERIFY(!maintenance.needsVacuum());
+	// Nothing to do once converted
+	QVERIFY(!maintenance.convertToIncrementalVacuum());
+	query.clear();
+	QVERIFY(oldConnection.close());
+}
+
+QTEST_MAIN(DatabaseMaintenanceTests)
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseWriterTests.h"
+#include "core/DatabaseWriter.h"
+#include "sqlite/Connection.h"
+#include "sqlite/Query.h"
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QThread>
+#include <QTime>
+
+#include <stdio.h>
+#include <string.h>
+
+/// Rows committed by the child process before it is killed
+#define CRASH_MIN_ROWS 2000
+#define LATENCY_BATCHES 50
+#define LATENCY_BATCH_SIZE 500
+
+static bool createTables(const QString &dbFile, SQLite::Connection::OpenFlags flags)
+{
+	SQLite::Connection connection;
+	if (!connection.connect(dbFile, flags)) return false;
+	SQLite::Query query(&connection);
+	if (!query.exec("CREATE TABLE rows(id INTEGER PRIMARY KEY, data TEXT)")) return false;
+	if (!query.exec("CREATE TABLE training(type INT NOT NULL, id INTEGER SECONDARY KEY NOT NULL, score INT NOT NULL, dateAdded UNSIGNED INT NOT NULL, dateLastTrain UNSIGNED INT, nbTrained UNSIGNED INT NOT NULL, nbSuccess UNSIGNED INT NOT NULL, dateLastMistake UNSIGNED INT, CONSTRAINT training_unique_ids UNIQUE(type, id))")) return false;
+	if (!query.exec("CREATE INDEX idx_training_score ON training(score)")) return false;
+	query.clear();
+	return connection.close();
+}
+
+/**
+ * Run in a child process by the crash test: writes sequential rows through
+ * the writer until killed, and reports the rows known to be committed on
+ * its standard output.
+ */
+static int writerChild(const QString &dbFile)
+{
+	if (!DatabaseWriter::start(dbFile)) return 1;
+	QString data(200, 'x');
+	for (int i = 1; ; i++) {
+		DatabaseWriter::exec("insert into rows values(?, ?)", QVariantList() << i << data);
+		if (i % 100 == 0) {
+			DatabaseWriter::flush();
+			printf("%d\n", i);
+			fflush(stdout);
+		}
+	}
+	return 0;
+}
+
+void DatabaseWriterTests::crash()
+{
+	QTemporaryFile dbFile;
+	QVERIFY(dbFile.open());
+	QVERIFY(createTables(dbFile.fileName(), SQLite::Connection::WAL));
+
+	QProcess child;
+	child.start(QCoreApplication::applicationFilePath(), QStringList() << "--writer-child" << dbFile.fileName());
+	QVERIFY(child.waitForStarted());
+	int committed = 0;
+	while (committed < CRASH_MIN_ROWS) {
+		QVERIFY(child.waitForReadyRead());
+		while (child.canReadLine()) committed = child.readLine().trimmed().toInt();
+	}
+	// Kill the writer in the middle of its transactions
+	child.kill();
+	QVERIFY(child.waitForFinished());
+
+	SQLite::Connection connection;
+	QVERIFY(connection.connect(dbFile.fileName(), SQLite::Connection::WAL));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("pragma integrity_check"));
+	QVERIFY(query.next());
+	QCOMPARE(query.valueString(0), QString("ok"));
+	query.reset();
+	// Transactions are either entirely applied or not at all
+	QVERIFY(query.exec("select count(*), max(id) from rows"));
+	QVERIFY(query.next());
+	QCOMPARE(query.valueInt(0), query.valueInt(1));
+	QVERIFY(query.valueInt(0) >= committed);
+	query.clear();
+	QVERIFY(connection.close());
+}
+
+/**
+ * Bulk training update (e.g. the import of a study list), run in its own
+ * thread so that searches can be issued while it takes place. Without the
+ * writer, updates are made synchronously on a connection of their own, like
+ * the other users of the shared cache do.
+ */
+class BulkUpdater : public QThread
+{
+private:
+	QString _dbFile;
+	SQLite::Connection::OpenFlags _flags;
+	bool _useWriter;
+	bool _succeeded;
+
+	bool update(SQLite::Query &write, int batch)
+	{
+		for (int j = 0; j < LATENCY_BATCH_SIZE; j++) {
+			QString sql(QString("insert or replace into training values(1, %1, %2, 0, null, 1, 1, null)").arg(batch * LATENCY_BATCH_SIZE + j).arg(j % 100));
+			if (_useWriter) DatabaseWriter::exec(sql);
+			else if (!write.exec(sql)) return false;
+		}
+		return true;
+	}
+
+protected:
+	void run()
+	{
+		SQLite::Connection connection;
+		if (!_useWriter && !connection.connect(_dbFile, _flags)) return;
+		SQLite::Query write(&connection);
+		for (int i = 0; i < LATENCY_BATCHES; i++) {
+			if (_useWriter) {
+				update(write, i);
+				DatabaseWriter::flush();
+				continue;
+			}
+			if (!connection.transaction()) return;
+			if (!update(write, i) || !connection.commit()) {
+				connection.rollback();
+				return;
+			}
+		}
+		write.clear();
+		if (connection.connected()) connection.close();
+		_succeeded = true;
+	}
+
+public:
+	BulkUpdater(const QString &dbFile, SQLite::Connection::OpenFlags flags, bool useWriter) : _dbFile(dbFile), _flags(flags), _useWriter(useWriter), _succeeded(false) {}
+	bool succeeded() const { return _succeeded; }
+};
+
+void DatabaseWriterTests::searchLatency_data()
+{
+	QTest::addColumn<bool>("wal");
+
+	QTest::newRow("Shared cache, synchronous writes") << false;
+	QTest::newRow("WAL, writer thread") << true;
+}
+
+/**
+ * Runs searches from the main thread while a bulk training update takes
+ * place in another thread, and measures how long each search keeps the
+ * main thread busy. Only the searches issued while the update runs are
+ * timed.
+ */
+void DatabaseWriterTests::searchLatency()
+{
+	QFETCH(bool, wal);
+	SQLite::Connection::OpenFlags flags(wal ? SQLite::Connection::WAL : SQLite::Connection::None);
+
+	QTemporaryFile dbFile;
+	QVERIFY(dbFile.open());
+	QVERIFY(createTables(dbFile.fileName(), flags));
+	SQLite::Connection connection;
+	QVERIFY(connection.connect(dbFile.fileName(), flags));
+	if (wal) QVERIFY(DatabaseWriter::start(dbFile.fileName(), flags));
+
+	SQLite::Query search(&connection);
+	BulkUpdater updater(dbFile.fileName(), flags, wal);
+	int maxLatency = 0, totalLatency = 0, searches = 0;
+	updater.start();
+	while (updater.isRunning()) {
+		QTime step;
+		step.start();
+		QVERIFY(search.exec(QString("select id from training where score > %1 order by score limit 100").arg(searches % 100)));
+		while (search.next());
+		search.reset();
+		int latency = step.elapsed();
+		// The update may have completed while the search was running
+		if (!updater.isRunning()) break;
+		maxLatency = qMax(maxLatency, latency);
+		totalLatency += latency;
+		++searches;
+	}
+	updater.wait();
+	QVERIFY(updater.succeeded());
+	QVERIFY(searches > 0);
+	if (wal) DatabaseWriter::stop();
+	QVERIFY(search.exec("select count(*) from training"));
+	QVERIFY(search.next());
+	QCOMPARE(search.valueInt(0), LATENCY_BATCHES * LATENCY_BATCH_SIZE);
+	qDebug("%d searches during the update, max latency: %d ms, average latency: %.2f ms", searches, maxLatency, (double)totalLatency / searches);
+	search.clear();
+	QVERIFY(connection.close());
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	if (argc == 3 && !strcmp(argv[1], "--writer-child")) return writerChild(argv[2]);
+	DatabaseWriterTests tests;
+	return QTest::qExec(&tests, argc, argv);
+}
@@ -0,0 +1,211 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DeinflectionTests.h"
+#include "core/jmdict/JMdictTextAnalyzer.h"
+
+#include <QTime>
+
+/// An inflected form of a dictionary word
+struct InflectedForm
+{
+	QString inflected;
+	QString dictionary;
+	int classes;
+};
+
+/// Applies all the rules backwards to word, returning the inflected forms along with their classes
+static QList<QPair<QString, int> > inflect(const QString &word, int classes)
+{
+	QList<QPair<QString, int> > ret;
+	for (const JMdictDeinflector::Rule *rule = JMdictDeinflector::rules(); rule->from; rule++) {
+		QString to(QString::fromUtf8(rule->to));
+		if (!(rule->toClasses & classes) || !word.endsWith(to)) continue;
+		ret << QPair<QString, int>(word.left(word.size() - to.size()) + QString::fromUtf8(rule->from), rule->fromClasses);
+	}
+	return ret;
+}
+
+static QChar randomKanji()
+{
+	return QChar(0x4e00 + qrand() % 3000);
+}
+
+/**
+ * Returns the forms obtained by inflecting random dictionary words of
+ * every class once and twice.
+ */
+static QList<InflectedForm> inflectedCorpus(int nbStems)
+{
+	static const char *ichidanEndings[] = { "べる", "ける", "める", "きる", "みる", "いる" };
+	static const char *godanEndings[] = { "う", "く", "ぐ", "す", "つ", "ぬ", "ぶ", "む", "る" };
+	static const char *adjectiveEndings[] = { "い", "しい" };
+
+	QList<QPair<QString, int> > words;
+	words << QPair<QString, int>(QString::fromUtf8("来る"), JMdictDeinflector::Kuru);
+	words << QPair<QString, int>(QString::fromUtf8("くる"), JMdictDeinflector::Kuru);
+	words << QPair<QString, int>(QString::fromUtf8("行く"), JMdictDeinflector::Godan);
+	for (int i = 0; i < nbStems; i++) {
+		QString stem(randomKanji());
+		words << QPair<QString, int>(stem + QString::fromUtf8(ichidanEndings[qrand() % 6]), JMdictDeinflector::Ichidan);
+		words << QPair<QString, int>(stem + QString::fromUtf8(godanEndings[qrand() % 9]), JMdictDeinflector::Godan);
+		words << QPair<QString, int>(stem + QString::fromUtf8(adjectiveEndings[qrand() % 2]), JMdictDeinflector::AdjectiveI);
+		stem += randomKanji();
+		words << QPair<QString, int>(stem + QString::fromUtf8("する"), JMdictDeinflector::Suru);
+		words << QPair<QString, int>(stem, JMdictDeinflector::SuruNoun);
+	}
+
+	QList<InflectedForm> ret;
+	for (int i = 0; i < words.size(); i++) {
+		InflectedForm form;
+		form.dictionary = words[i].first;
+		form.classes = words[i].second;
+		QList<QPair<QString, int> > inflected(inflect(words[i].first, words[i].second));
+		for (int j = 0; j < inflected.size(); j++) {
+			form.inflected = inflected[j].first;
+			ret << form;
+			QList<QPair<QString, int> > inflected2(inflect(inflected[j].first, inflected[j].second));
+			for (int k = 0; k < inflected2.size(); k++) {
+				form.inflected = inflected2[k].first;
+				ret << form;
+			}
+		}
+	}
+	return ret;
+}
+
+/// Returns the candidate of candidates matching word, or 0
+static const JMdictDeinflector::Candidate *findCandidate(const QList<JMdictDeinflector::Candidate> &candidates, const QString &word)
+{
+	foreach (const JMdictDeinflector::Candidate &candidate, candidates)
+		if (candidate.word == word) return &candidate;
+	return 0;
+}
+
+void DeinflectionTests::initTestCase()
+{
+	const char *entities[] = { "n", "v1", "v1-s", "v5u", "v5u-s", "v5k", "v5k-s", "v5g", "v5s", "v5t", "v5n", "v5b", "v5m", "v5r", "v5r-i", "v5aru", "adj-i", "adj-ix", "vk", "vs", "vs-i", "vs-s", 0 };
+	for (int i = 0; entities[i]; i++) posBitShifts[entities[i]] = i;
+	deinflector = new JMdictDeinflector(posBitShifts);
+	qsrand(1);
+}
+
+void DeinflectionTests::cleanupTestCase()
+{
+	delete deinflector;
+}
+
+void DeinflectionTests::deinflect_data()
+{
+	QTest::addColumn<QString>("inflected");
+	QTest::addColumn<QString>("dictionary");
+	QTest::addColumn<QString>("entity");
+
+	QTest::newRow("Ichidan, passive negative past") << QString::fromUtf8("食べられなかった") << QString::fromUtf8("食べる") << "v1";
+	QTest::newRow("Godan, polite") << QString::fromUtf8("いきます") << QString::fromUtf8("いく") << "v5k-s";
+	QTest::newRow("Godan, te form") << QString::fromUtf8("行って") << QString::fromUtf8("行く") << "v5k-s";
+	QTest::newRow("Godan, progressive polite") << QString::fromUtf8("読んでいます") << QString::fromUtf8("読む") << "v5m";
+	QTest::newRow("Godan, causative passive") << QString::fromUtf8("書かせられた") << QString::fromUtf8("書く") << "v5k";
+	QTest::newRow("Godan, conditional") << QString::fromUtf8("読めば") << QString::fromUtf8("読む") << "v5m";
+	QTest::newRow("Adjective, negative past") << QString::fromUtf8("高くなかった") << QString::fromUtf8("高い") << "adj-i";
+	QTest::newRow("Adjective, past conditional") << QString::fromUtf8("寒かったら") << QString::fromUtf8("寒い") << "adj-i";
+	QTest::newRow("Desire, negative") << QString::fromUtf8("飲みたくない") << QString::fromUtf8("飲む") << "v5m";
+	QTest::newRow("Kuru, negative past") << QString::fromUtf8("こなかった") << QString::fromUtf8("くる") << "vk";
+	QTest::newRow("Kuru, kanji") << QString::fromUtf8("来ない") << QString::fromUtf8("来る") << "vk";
+	QTest::newRow("Suru verb") << QString::fromUtf8("勉強しなかった") << QString::fromUtf8("勉強する") << "vs-s";
+	QTest::newRow("Suru noun") << QString::fromUtf8("勉強させられた") << QString::fromUtf8("勉強") << "vs";
+}
+
+void DeinflectionTests::deinflect()
+{
+	QFETCH(QString, inflected);
+	QFETCH(QString, dictionary);
+	QFETCH(QString, entity);
+
+	QList<JMdictDeinflector::Candidate> candidates(deinflector->deinflect(inflected));
+	const JMdictDeinflector::Candidate *candidate = findCandidate(candidates, dictionary);
+	QVERIFY(candidate);
+	QVERIFY(candidate->posMask & pos(entity));
+	// Intermediate forms are not dictionary forms
+	foreach (const JMdictDeinflector::Candidate &c, candidates) {
+		QVERIFY(c.posMask);
+		QVERIFY(c.word != inflected);
+		QVERIFY(!(c.posMask & pos("n")));
+	}
+}
+
+void DeinflectionTests::analyzeInflected()
+{
+	QMap<QString, QList<quint32> > words;
+	words[QString::fromUtf8("食べる")] << 1;
+	words[QString::fromUtf8("食")] << 2;
+	words[QString::fromUtf8("を")] << 3;
+	words[QString::fromUtf8("本")] << 4;
+	words[QString::fromUtf8("読む")] << 5;
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(words));
+
+	QString text(QString::fromUtf8("食べられなかった本を読んだ"));
+	// Without deinflector, only the words written as in the dictionary are found
+	QVector<JMdictTextAnalyzer::Word> found(JMdictTextAnalyzer(trie).analyze(text));
+	QCOMPARE(found.size(), 3);
+	QCOMPARE(found[0].id, (EntryId)2);
+
+	found = JMdictTextAnalyzer(trie, deinflector).analyze(text);
+	QCOMPARE(found.size(), 4);
+	QCOMPARE(found[0].id, (EntryId)1);
+	QCOMPARE(found[0].length, 8);
+	QCOMPARE(found[1].id, (EntryId)4);
+	QCOMPARE(found[2].id, (EntryId)3);
+	QCOMPARE(found[3].id, (EntryId)5);
+	QCOMPARE(found[3].position, 10);
+	QCOMPARE(found[3].length, 3);
+
+	// Inflected words come first, followed by the dictionary words they start with
+	found = JMdictTextAnalyzer(trie, deinflector).analyze(text, JMdictTextAnalyzer::AllMatches);
+	QCOMPARE(found[0].id, (EntryId)1);
+	QCOMPARE(found[1].id, (EntryId)2);
+	QCOMPARE(found[1].length, 1);
+}
+
+void DeinflectionTests::corpus()
+{
+	QList<InflectedForm> forms(inflectedCorpus(100));
+	QVERIFY(forms.size() > 10000);
+	foreach (const InflectedForm &form, forms) {
+		QList<JMdictDeinflector::Candidate> candidates(deinflector->deinflect(form.inflected));
+		const JMdictDeinflector::Candidate *candidate = findCandidate(candidates, form.dictionary);
+		if (!candidate || !(candidate->classes & form.classes))
+			QFAIL(qPrintable(QString("%1 not found as a form of %2").arg(form.inflected).arg(form.dictionary)));
+	}
+}
+
+void DeinflectionTests::deinflectBenchmark()
+{
+	QList<InflectedForm> forms(inflectedCorpus(1000));
+	int nbCandidates = 0;
+	int elapsed = 0;
+	QBENCHMARK_ONCE {
+		QTime time;
+		time.start();
+		foreach (const InflectedForm &form, forms) nbCandidates += deinflector->deinflect(form.inflected).size();
+		elapsed = time.elapsed();
+	}
+	qDebug("%d inflected forms deinflected into %d candidates, %.0f words/s", forms.size(), nbCandidates, forms.size() * 1000.0 / qMax(elapsed, 1));
+}
+
+QTEST_MAIN(DeinflectionTests)
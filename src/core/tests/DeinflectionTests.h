@@ -0,0 +1,48 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include "core/jmdict/JMdictDeinflector.h"
+
+/**
+ * Checks the deinflection of conjugated words, and benchmarks it over a
+ * corpus of inflected forms.
+ */
+class DeinflectionTests : public QObject
+{
+	Q_OBJECT
+private:
+	QMap<QString, quint8> posBitShifts;
+	JMdictDeinflector *deinflector;
+
+	quint64 pos(const QString &entity) const { return 1ULL << posBitShifts[entity]; }
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void deinflect_data();
+	void deinflect();
+	void analyzeInflected();
+	void corpus();
+	void deinflectBenchmark();
+
+public:
+	DeinflectionTests() : deinflector(0) {}
+};
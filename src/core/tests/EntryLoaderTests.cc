@@ -0,0 +1,158 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "EntryLoaderTests.h"
+#include "core/Database.h"
+#include "core/Tag.h"
+#include "sqlite/Query.h"
+
+/// Entry type that does not clash with the ones of the plugins
+#define TEST_ENTRY_TYPE 100
+/// Number of entries loaded by the benchmark
+#define LOADED_ENTRIES 1000
+
+/**
+ * Entry that is not backed by any dictionary.
+ */
+class TestEntry : public Entry
+{
+public:
+	TestEntry(EntryId id) : Entry(TEST_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString::number(id()); }
+	virtual QStringList readings() const { return QStringList(); }
+	virtual QStringList meanings() const { return QStringList(); }
+};
+
+class TestEntryLoader : public EntryLoader
+{
+public:
+	virtual Entry *loadEntry(EntryId id)
+	{
+		Entry *ret = new TestEntry(id);
+		loadMiscData(ret);
+		return ret;
+	}
+};
+
+QList<EntryId> EntryLoaderTests::ids() const
+{
+	QList<EntryId> ret;
+	for (int i = 1; i <= LOADED_ENTRIES; i++) ret << i;
+	return ret;
+}
+
+void EntryLoaderTests::initTestCase()
+{
+	QStringList errors;
+	QVERIFY(Database::init(QString(), true, errors));
+
+	// Half of the entries are trained, a third of them tagged, and a fifth
+	// of them have notes
+	SQLite::Query query(Database::connection());
+	QVERIFY(Database::connection()->transaction());
+	QVERIFY(query.exec("insert into tags values('tag1')"));
+	QVERIFY(query.exec("insert into tags values('tag2')"));
+	for (int i = 1; i <= LOADED_ENTRIES; i++) {
+		if (i % 2 == 0) QVERIFY(query.exec(QString("insert into training values(%1, %2, %3, 1000, 2000, 10, %4, null)").arg(TEST_ENTRY_TYPE).arg(i).arg(i % 100).arg(i % 10)));
+		if (i % 3 == 0) {
+			QVERIFY(query.exec(QString("insert into taggedEntries values(%1, %2, 1, %3)").arg(TEST_ENTRY_TYPE).arg(i).arg(i)));
+			QVERIFY(query.exec(QString("insert into taggedEntries values(%1, %2, 2, %3)").arg(TEST_ENTRY_TYPE).arg(i).arg(i + 1)));
+		}
+		if (i % 5 == 0) {
+			for (int j = 0; j < 2; j++) {
+				QVERIFY(query.exec(QString("insert into notes(type, id, dateAdded, dateLastChange) values(%1, %2, %3, %3)").arg(TEST_ENTRY_TYPE).arg(i).arg(1000 + j)));
+				QVERIFY(query.exec(QString("insert into notesText(docid, note) values(%1, 'note %2 of %3')").arg(query.lastInsertId()).arg(j).arg(i)));
+			}
+		}
+	}
+	QVERIFY(Database::connection()->commit());
+
+	Tag::init();
+	loader = new TestEntryLoader();
+}
+
+void EntryLoaderTests::cleanupTestCase()
+{
+	delete loader;
+	Tag::cleanup();
+	Database::stop();
+}
+
+void EntryLoaderTests::prefetch()
+{
+	QList<EntryId> entryIds(ids());
+	loader->prefetchMiscData(TEST_ENTRY_TYPE, entryIds);
+	foreach (EntryId id, entryIds) QVERIFY(loader->isPrefetched(TEST_ENTRY_TYPE, id));
+	foreach (EntryId id, entryIds) {
+		quint32 statements = loader->statementsCount();
+		Entry *prefetched = loader->loadEntry(id);
+		// Prefetched data is used only once
+		QCOMPARE(loader->statementsCount(), statements);
+		QVERIFY(!loader->isPrefetched(TEST_ENTRY_TYPE, id));
+		Entry *loaded = loader->loadEntry(id);
+		QVERIFY(loader->statementsCount() > statements);
+
+		QCOMPARE(prefetched->trained(), id % 2 == 0);
+		QCOMPARE(prefetched->trained(), loaded->trained());
+		QCOMPARE(prefetched->dateAdded(), loaded->dateAdded());
+		QCOMPARE(prefetched->dateLastTrain(), loaded->dateLastTrain());
+		QCOMPARE(prefetched->dateLastMistake(), loaded->dateLastMistake());
+		QCOMPARE(prefetched->nbTrained(), loaded->nbTrained());
+		QCOMPARE(prefetched->nbSuccess(), loaded->nbSuccess());
+		QCOMPARE(prefetched->score(), loaded->score());
+		QCOMPARE(prefetched->tags().size(), id % 3 == 0 ? 2 : 0);
+		QVERIFY(prefetched->tags() == loaded->tags());
+		QCOMPARE(prefetched->notes().size(), id % 5 == 0 ? 2 : 0);
+		QCOMPARE(prefetched->notes().size(), loaded->notes().size());
+		for (int i = 0; i < prefetched->notes().size(); i++) {
+			QCOMPARE(prefetched->notes()[i].note(), loaded->notes()[i].note());
+			QCOMPARE(prefetched->notes()[i].dateAdded(), loaded->notes()[i].dateAdded());
+		}
+		delete prefetched;
+		delete loaded;
+	}
+}
+
+void EntryLoaderTests::loadBenchmark_data()
+{
+	QTest::addColumn<int>("pageSize");
+
+	QTest::newRow("One by one") << 0;
+	QTest::newRow("Pages of 50") << 50;
+	QTest::newRow("All at once") << LOADED_ENTRIES;
+}
+
+void EntryLoaderTests::loadBenchmark()
+{
+	QFETCH(int, pageSize);
+
+	QList<EntryId> entryIds(ids());
+	quint32 statements = loader->statementsCount();
+	QBENCHMARK_ONCE {
+		for (int i = 0; i < entryIds.size(); i++) {
+			if (pageSize && i % pageSize == 0) loader->prefetchMiscData(TEST_ENTRY_TYPE, entryIds.mid(i, pageSize));
+			delete loader->loadEntry(entryIds[i]);
+		}
+	}
+	statements = loader->statementsCount() - statements;
+	qDebug("%d statements executed for %d entries", statements, LOADED_ENTRIES);
+	// Each way of fetching user data uses 3 statements
+	QCOMPARE(statements, (quint32)(pageSize ? 3 * LOADED_ENTRIES / pageSize : 3 * LOADED_ENTRIES));
+}
+
+QTEST_MAIN(EntryLoaderTests)
@@ -29,10 +29,15 @@ void ListsTests::initTestCase()
 	QVERIFY(query.exec("CREATE INDEX idx_lists_parent ON lists(parent)"));
 	QVERIFY(query.exec("CREATE INDEX idx_lists_entry ON lists(type, id)"));
 	QVERIFY(query.exec("CREATE VIRTUAL TABLE listsLabels using fts3(label)"));
+
+	QVERIFY(listDB.createTables(&connection));
+	QVERIFY(listDB.createDataIndexes(&connection));
+	QVERIFY(listDB.prepareForConnection(&connection));
 }
 
 void ListsTests::cleanupTestCase()
 {
+	listDB.prepareForConnection(0);
 	QVERIFY(connection.close());
 }
 
@@ -54,4 +59,220 @@ void ListsTests::entryListCachedEntry()
 
 }
 
+/**
+ * Checks that the membership index of listDB matches both the database and
+ * the content of lists for all the entries of refs.
+ */
+bool ListsTests::checkMembership(const QList<EntryList *> &lists, const QList<EntryRef> &refs)
+{
+	QHash<EntryRef, QSet<quint32> > expected;
+	foreach (EntryList *list, lists)
+		for (unsigned int i = 0; i < list->size(); i++) expected[(*list)[i].entryRef()] << list->listId();
+
+	SQLite::Query query(&connection);
+	query.prepare("select rowid from benchLists where type = ? and id = ?");
+	foreach (const EntryRef &ref, refs) {
+		QSet<quint64> rowids;
+		query.bindValue(ref.type());
+		query.bindValue(ref.id());
+		if (!query.exec()) return false;
+		while (query.next()) rowids << query.valueUInt64(0);
+		query.reset();
+		if (listDB.membership().nodes(ref) != rowids) return false;
+		if (listDB.membership().lists(ref) != expected.value(ref)) return false;
+		foreach (EntryList *list, lists)
+			if (listDB.membership().contains(ref, list->listId()) != expected.value(ref).contains(list->listId())) return false;
+	}
+	return true;
+}
+
+void ListsTests::membershipIndex()
+{
+	// There is no undo stack for lists - undoing an operation means performing
+	// its inverse, and redoing it performing it again. Use another entry type
+	// than the benchmarks so their lists do not interfere.
+	QList<EntryListData> values;
+	QList<EntryRef> refs;
+	for (int i = 1; i <= 10; i++) {
+		EntryListData data = { 2, i };
+		values << data;
+		refs << data.entryRef();
+	}
+	EntryList list1(&listDB, 0);
+	list1.tree()->newList();
+	EntryList list2(&listDB, 0);
+	list2.tree()->newList();
+	QList<EntryList *> lists;
+	lists << &list1 << &list2;
+
+	// Load the index before any change so it has to be maintained incrementally
+	QVERIFY(listDB.membership().lists(refs[0]).isEmpty());
+
+	// Batch insert, undo, redo
+	QVERIFY(list1.insertBatch(values, 0));
+	QVERIFY(checkMembership(lists, refs));
+	for (int i = 0; i < values.size(); i++) QVERIFY(list1.remove(0));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(list1.insertBatch(values, 0));
+	QVERIFY(checkMembership(lists, refs));
+	QCOMPARE(listDB.membership().entries(2, QSet<quint32>() << list1.listId()).size(), values.size());
+
+	// The same entry in both lists, and twice in the same list
+	QVERIFY(list2.insert(values[3], 0));
+	QVERIFY(list2.insert(values[3], 1));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(list2.remove(1));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(list2.remove(0));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(!listDB.membership().contains(refs[3], list2.listId()));
+	QVERIFY(list2.insert(values[3], 0));
+	QVERIFY(checkMembership(lists, refs));
+
+	// Move a node from list1 to list2, undo, redo
+	EntryList::TreeType::Node *node = list1.getNode(5);
+	QVERIFY(list1.removeNode(node));
+	QVERIFY(list2.insertNode(node, 1));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(list2.removeNode(node));
+	QVERIFY(list1.insertNode(node, 5));
+	QVERIFY(checkMembership(lists, refs));
+	QVERIFY(list1.removeNode(node));
+	QVERIFY(list2.insertNode(node, 1));
+	QVERIFY(checkMembership(lists, refs));
+	QCOMPARE(listDB.membership().lists(refs[5]), QSet<quint32>() << list2.listId());
+
+	// Changes rolled back by an outer transaction invalidate the index
+	QVERIFY(connection.transaction());
+	QVERIFY(list2.insert(values[7], 0));
+	QVERIFY(connection.rollback());
+	listDB.membership().invalidate();
+	EntryList list2Reloaded(&listDB, list2.listId());
+	lists.replace(1, &list2Reloaded);
+	QVERIFY(checkMembership(lists, refs));
+
+	QVERIFY(list1.clear());
+	QVERIFY(list2Reloaded.clear());
+	lists.clear();
+	QVERIFY(checkMembership(lists, refs));
+	list1.tree()->removeList();
+	list2Reloaded.tree()->removeList();
+}
+
+static QList<EntryListData> benchmarkValues(int size)
+{
+	QList<EntryListData> ret;
+	for (int i = 0; i < size; i++) {
+		EntryListData data = { 1, i + 1 };
+		ret << data;
+	}
+	return ret;
+}
+
+void ListsTests::insertBenchmark_data()
+{
+	QTest::addColumn<int>("size");
+
+	QTest::newRow("10k entries") << 10000;
+}
+
+void ListsTests::insertBenchmark()
+{
+	QFETCH(int, size);
+	QList<EntryListData> values(benchmarkValues(size));
+	EntryList list(&listDB, 0);
+	list.tree()->newList();
+
+	// Entries are inserted one by one within a single transaction, like
+	// EntryListModel used to do.
+	QBENCHMARK_ONCE {
+		QVERIFY(connection.transaction());
+		for (int i = 0; i < size; i++) QVERIFY(list.insert(values[i], i));
+		QVERIFY(connection.commit());
+	}
+	QCOMPARE(list.size(), (unsigned int)size);
+	list.checkValid();
+	QVERIFY(list.clear());
+	list.tree()->removeList();
+}
+
+void ListsTests::insertBatchBenchmark_data()
+{
+	QTest::addColumn<int>("size");
+
+	QTest::newRow("10k entries") << 10000;
+	QTest::newRow("100k entries") << 100000;
+}
+
+void ListsTests::insertBatchBenchmark()
+{
+	QFETCH(int, size);
+	QList<EntryListData> values(benchmarkValues(size));
+	EntryList list(&listDB, 0);
+	list.tree()->newList();
+
+	QBENCHMARK_ONCE {
+		QVERIFY(list.insertBatch(values, 0));
+	}
+	QCOMPARE(list.size(), (unsigned int)size);
+	list.checkValid();
+
+	// Insert another batch in the middle of the list
+	QList<EntryListData> values2(benchmarkValues(size / 10));
+	QVERIFY(list.insertBatch(values2, size / 2));
+	QCOMPARE(list.size(), (unsigned int)(size + size / 10));
+	list.checkValid();
+	QCOMPARE(list[size / 2].id, (quint32)1);
+	QCOMPARE(list[size / 2 + size / 10].id, (quint32)(size / 2 + 1));
+
+	// Make sure the DB contains the same tree
+	EntryList list2(&listDB, list.listId());
+	QCOMPARE(list2.size(), list.size());
+	list2.checkValid();
+	for (unsigned int i = 0; i < list.size(); i += 97) QCOMPARE(list2[i].id, list[i].id);
+
+	QVERIFY(list.clear());
+	list.tree()->removeList();
+}
+
+void ListsTests::randomAccessBenchmark_data()
+{
+	QTest::addColumn<bool>("warm");
+	QTest::addColumn<int>("maxNodes");
+
+	QTest::newRow("Cold") << false << 0;
+	QTest::newRow("Warm") << true << 0;
+	QTest::newRow("Warm, 10k nodes cache") << true << 10000;
+}
+
+#define ACCESS_LIST_SIZE 100000
+#define ACCESS_COUNT 10000
+void ListsTests::randomAccessBenchmark()
+{
+	QFETCH(bool, warm);
+	QFETCH(int, maxNodes);
+
+	if (!accessListId) {
+		EntryList list(&listDB, 0);
+		list.tree()->newList();
+		QVERIFY(list.insertBatch(benchmarkValues(ACCESS_LIST_SIZE), 0));
+		accessListId = list.listId();
+	}
+
+	QList<int> indexes;
+	for (int i = 0; i < ACCESS_COUNT; i++) indexes << qrand() % ACCESS_LIST_SIZE;
+
+	EntryList list(&listDB, accessListId);
+	if (warm) {
+		for (int i = 0; i < ACCESS_LIST_SIZE; i++) QCOMPARE(list[i].id, (quint32)i + 1);
+		QCOMPARE(list.tree()->loadedNodes(), (quint32)ACCESS_LIST_SIZE);
+		if (maxNodes) list.tree()->trimMemCache(maxNodes);
+	}
+
+	QBENCHMARK_ONCE {
+		foreach (int idx, indexes) QCOMPARE(list[idx].id, (quint32)idx + 1);
+	}
+	list.checkValid();
+}
+
 QTEST_MAIN(ListsTests)
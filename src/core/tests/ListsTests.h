@@ -19,6 +19,7 @@
 #include <QTest>
 
 #include "sqlite/Connection.h"
+#include "core/EntryListDB.h"
 #include <QTemporaryFile>
 
 /**
@@ -30,6 +31,11 @@ Q_OBJECT
 private:
 	SQLite::Connection connection;
 	QTemporaryFile dbFile;
+	// For insertion benchmarks
+	EntryListDBAccess listDB;
+	bool checkMembership(const QList<EntryList *> &lists, const QList<EntryRef> &refs);
+	// List used by the random access benchmark
+	quint32 accessListId;
 
 private slots:
 	void initTestCase();
@@ -37,4 +43,16 @@ private slots:
 
 	void entryListCachedEntry_data();
 	void entryListCachedEntry();
+
+	void membershipIndex();
+
+	void insertBenchmark_data();
+	void insertBenchmark();
+	void insertBatchBenchmark_data();
+	void insertBatchBenchmark();
+	void randomAccessBenchmark_data();
+	void randomAccessBenchmark();
+
+public:
+	ListsTests() : listDB("benchLists"), accessListId(0) {}
 };
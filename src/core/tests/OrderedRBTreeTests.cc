@@ -153,6 +153,36 @@ void OrderedRBTreeTests::massInsertRandom()
 
 }
 
+void OrderedRBTreeTests::batchInsert()
+{
+	OrderedRBTree<OrderedRBMemTree<QString > > bTree;
+	QList<int> bTreePos;
+	QVERIFY(bTree.insertBatch(QList<QString>(), 0));
+	QCOMPARE(bTree.size(), (unsigned int)0);
+
+	for (int i = 0; i < TEST_SIZE; ) {
+		int batchSize = qrand() % 100;
+		int pos = qrand() % (bTree.size() + 1);
+		QList<QString> batch;
+		for (int j = 0; j < batchSize; j++) {
+			batch << QString(VSTRING).arg(i);
+			bTreePos.insert(pos + j, i++);
+		}
+		QVERIFY(bTree.insertBatch(batch, pos));
+		QCOMPARE(bTree.size(), (unsigned int)bTreePos.size());
+		bTree.checkValid();
+		for (int j = 0; j < bTreePos.size(); j++)
+			QCOMPARE(bTree[j], QString(VSTRING).arg(bTreePos[j]));
+	}
+
+	// Out-of-bounds insertions must fail
+	QList<QString> batch;
+	batch << "Out-of-bounds string";
+	QVERIFY(!bTree.insertBatch(batch, -1));
+	QVERIFY(!bTree.insertBatch(batch, bTree.size() + 1));
+	QCOMPARE(bTree.size(), (unsigned int)bTreePos.size());
+}
+
 void OrderedRBTreeTests::massRemoveEnd()
 {
 	QCOMPARE(treeEnd.size(), (unsigned int)TEST_SIZE);
@@ -39,6 +39,7 @@ private slots:
 	void massInsertEnd();
 	void massInsertBegin();
 	void massInsertRandom();
+	void batchInsert();
 
 	void massRemoveEnd();
 	void massRemoveBegin();
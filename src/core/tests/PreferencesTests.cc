@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PreferencesTests.h"
+#include "core/Preferences.h"
+
+#include <QCoreApplication>
+
+#define UPDATES_COUNT 10000
+
+void PreferencesTests::coalescing()
+{
+	PreferenceItem<int> pref("tests", "coalescing", 0);
+	_relayouts = 0;
+	connect(&pref, SIGNAL(valueChanged(QVariant)), this, SLOT(onValueChanged()));
+	int writes = PreferencesStore::instance().writesCount();
+	for (int i = 1; i <= 100; i++) pref.set(i);
+	QCOMPARE(pref.value(), 100);
+	// Notifications are delivered by the event loop
+	QCOMPARE(_relayouts, 0);
+	QCoreApplication::processEvents();
+	QCOMPARE(_relayouts, 1);
+
+	// Unwritten values are visible to new items
+	PreferenceItem<int> pref2("tests", "coalescing", 0);
+	QCOMPARE(pref2.value(), 100);
+	QVERIFY(!pref2.isDefault());
+
+	PreferencesStore::instance().flush();
+	QCOMPARE(PreferencesStore::instance().writesCount(), writes + 1);
+	PreferenceItem<int> pref3("tests", "coalescing", 0);
+	QCOMPARE(pref3.value(), 100);
+
+	pref.reset();
+	PreferencesStore::instance().flush();
+}
+
+void PreferencesTests::reset()
+{
+	PreferenceItem<QString> pref("tests", "reset", "default");
+	pref.set("value");
+	pref.reset();
+	PreferenceItem<QString> pref2("tests", "reset", "default");
+	QVERIFY(pref2.isDefault());
+	QCOMPARE(pref2.value(), QString("default"));
+	PreferencesStore::instance().flush();
+	PreferenceItem<QString> pref3("tests", "reset", "default");
+	QVERIFY(pref3.isDefault());
+}
+
+/**
+ * Simulates a slider moved over a preference, e.g. the font size.
+ */
+void PreferencesTests::updatesBenchmark()
+{
+	PreferenceItem<int> pref("tests", "updatesBenchmark", 0);
+	_relayouts = 0;
+	connect(&pref, SIGNAL(valueChanged(QVariant)), this, SLOT(onValueChanged()));
+	int writes = PreferencesStore::instance().writesCount();
+	QBENCHMARK_ONCE {
+		for (int i = 1; i <= UPDATES_COUNT; i++) pref.set(i);
+		QCoreApplication::processEvents();
+	}
+	// Wait for the delayed write
+	QTest::qWait(PreferencesStore::WriteDelay * 2);
+	PreferencesStore::instance().flush();
+	writes = PreferencesStore::instance().writesCount() - writes;
+	qDebug("%d updates: %d relayouts, %d settings writes", UPDATES_COUNT, _relayouts, writes);
+	QCOMPARE(_relayouts, 1);
+	QCOMPARE(writes, 1);
+	pref.reset();
+	PreferencesStore::instance().flush();
+}
+
+QTEST_MAIN(PreferencesTests)
@@ -0,0 +1,135 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResultsCacheTests.h"
+#include "core/ResultsCache.h"
+
+/// Entry type that does not clash with the ones of the plugins
+#define TEST_ENTRY_TYPE 100
+
+/**
+ * Entry that is not backed by any dictionary.
+ */
+class TestEntry : public Entry
+{
+public:
+	TestEntry(EntryId id) : Entry(TEST_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString::number(id()); }
+	virtual QStringList readings() const { return QStringList(); }
+	virtual QStringList meanings() const { return QStringList(); }
+};
+
+static QVector<EntryRef> results(int size, EntryId first = 1)
+{
+	QVector<EntryRef> ret;
+	for (int i = 0; i < size; i++) ret << EntryRef(TEST_ENTRY_TYPE, first + i);
+	return ret;
+}
+
+void ResultsCacheTests::lookup()
+{
+	ResultsCache cache;
+	QVector<EntryRef> refs;
+	int position = -1;
+	QVERIFY(!cache.lookup("select type, id from jmdict", refs, position));
+	cache.insert("select type, id from jmdict", results(10), Entry::changesCount());
+	// Statements differing only by their spacing share their results
+	QVERIFY(cache.lookup("select  type, id\n\tfrom jmdict ", refs, position));
+	QCOMPARE(refs, results(10));
+	QCOMPARE(position, 0);
+
+	cache.setPosition("select type, id from jmdict", 5);
+	QVERIFY(cache.lookup("select type, id from jmdict", refs, position));
+	QCOMPARE(position, 5);
+	// Positions of unknown statements are ignored
+	cache.setPosition("select type, id from kanjidic2", 3);
+	QVERIFY(!cache.lookup("select type, id from kanjidic2", refs, position));
+
+	QCOMPARE(cache.hits(), 2);
+	QCOMPARE(cache.misses(), 2);
+	cache.clear();
+	QCOMPARE(cache.size(), 0);
+	QCOMPARE(cache.refsCount(), 0);
+	QVERIFY(!cache.lookup("select type, id from jmdict", refs, position));
+}
+
+void ResultsCacheTests::eviction()
+{
+	ResultsCache cache(3, 100);
+	QVector<EntryRef> refs;
+	int position;
+	cache.insert("1", results(10), Entry::changesCount());
+	cache.insert("2", results(10), Entry::changesCount());
+	cache.insert("3", results(10), Entry::changesCount());
+	// Using 1 makes 2 the least recently used set
+	QVERIFY(cache.lookup("1", refs, position));
+	cache.insert("4", results(10), Entry::changesCount());
+	QCOMPARE(cache.size(), 3);
+	QVERIFY(!cache.lookup("2", refs, position));
+	QVERIFY(cache.lookup("1", refs, position));
+	QVERIFY(cache.lookup("3", refs, position));
+	QVERIFY(cache.lookup("4", refs, position));
+
+	// The total number of results is bounded too
+	cache.insert("5", results(45), Entry::changesCount());
+	QCOMPARE(cache.size(), 3);
+	QCOMPARE(cache.refsCount(), 65);
+	cache.insert("6", results(45), Entry::changesCount());
+	QCOMPARE(cache.size(), 3);
+	QCOMPARE(cache.refsCount(), 100);
+	QVERIFY(!cache.lookup("3", refs, position));
+	// Sets larger than half the cache are not stored
+	cache.insert("7", results(51), Entry::changesCount());
+	QVERIFY(!cache.lookup("7", refs, position));
+	QCOMPARE(cache.size(), 3);
+}
+
+void ResultsCacheTests::invalidation()
+{
+	ResultsCache cache;
+	QVector<EntryRef> refs;
+	int position;
+	QString dictSql("select type, id from jmdict where id < 10");
+	QString userSql("select training.type, training.id from training where score > 10");
+	QVERIFY(!ResultsCache::dependsOnUserData(dictSql));
+	QVERIFY(ResultsCache::dependsOnUserData(userSql));
+
+	cache.insert(dictSql, results(10), Entry::changesCount());
+	cache.insert(userSql, results(5), Entry::changesCount());
+	TestEntry entry(1);
+	entry.emitChanged();
+	// Only the results that use user data are dropped
+	QVERIFY(cache.lookup(dictSql, refs, position));
+	QVERIFY(!cache.lookup(userSql, refs, position));
+	QCOMPARE(cache.invalidations(), 1);
+	QCOMPARE(cache.size(), 1);
+
+	cache.insert(userSql, results(5), Entry::changesCount());
+	QVERIFY(cache.lookup(userSql, refs, position));
+
+	// Results of a query that was running while an entry changed are
+	// not used
+	int issued = Entry::changesCount();
+	entry.emitChanged();
+	cache.insert(userSql, results(5), issued);
+	QVERIFY(!cache.lookup(userSql, refs, position));
+	cache.insert(dictSql, results(10), issued);
+	QVERIFY(cache.lookup(dictSql, refs, position));
+}
+
+QTEST_MAIN(ResultsCacheTests)
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ResultsListTests.h"
+#include "core/ResultsList.h"
+#include "core/Database.h"
+
+/// Entry type that does not clash with the ones of the plugins
+#define TEST_ENTRY_TYPE 100
+
+/**
+ * Entry that is not backed by any dictionary.
+ */
+class TestEntry : public Entry
+{
+public:
+	TestEntry(EntryId id) : Entry(TEST_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString::number(id()); }
+	virtual QStringList readings() const { return QStringList(); }
+	virtual QStringList meanings() const { return QStringList(); }
+};
+
+/// Fills list with size results, as if a query returned them
+static void fill(ResultsList &list, int size)
+{
+	list.startReceive();
+	for (int i = 0; i < size; i++) list.addResult(EntryRef(TEST_ENTRY_TYPE, i + 1));
+	list.endReceive();
+}
+
+void ResultsListTests::initTestCase()
+{
+	QStringList errors;
+	QVERIFY(Database::init(QString(), true, errors));
+}
+
+void ResultsListTests::cleanupTestCase()
+{
+	Database::stop();
+}
+
+void ResultsListTests::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+	changedRanges << QPair<int, int>(topLeft.row(), bottomRight.row());
+}
+
+void ResultsListTests::changes()
+{
+	ResultsList list;
+	fill(list, 100);
+	QCOMPARE(list.rowCount(), 100);
+	connect(&list, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(onDataChanged(QModelIndex, QModelIndex)));
+	changedRanges.clear();
+
+	// Rows 10 to 12 and 50 change, and so does an entry that is not part
+	// of the results
+	QList<TestEntry *> changed;
+	changed << new TestEntry(12) << new TestEntry(51) << new TestEntry(11) << new TestEntry(13) << new TestEntry(12) << new TestEntry(1000);
+	foreach (TestEntry *entry, changed) list.onEntryChanged(entry);
+	QCOMPARE(changedRanges.size(), 0);
+	QCoreApplication::processEvents();
+	QCOMPARE(changedRanges.size(), 2);
+	QCOMPARE(changedRanges[0].first, 10);
+	QCOMPARE(changedRanges[0].second, 12);
+	QCOMPARE(changedRanges[1].first, 50);
+	QCOMPARE(changedRanges[1].second, 50);
+
+	// The row index follows new results and clearing
+	list.startReceive();
+	list.addResult(EntryRef(TEST_ENTRY_TYPE, 1001));
+	list.endReceive();
+	changedRanges.clear();
+	TestEntry newEntry(1001);
+	list.onEntryChanged(&newEntry);
+	QCoreApplication::processEvents();
+	QCOMPARE(changedRanges.size(), 1);
+	QCOMPARE(changedRanges[0].first, 100);
+	list.clear();
+	QCOMPARE(list.rowCount(), 0);
+	fill(list, 5);
+	changedRanges.clear();
+	list.onEntryChanged(&newEntry);
+	list.onEntryChanged(changed.first());
+	QCoreApplication::processEvents();
+	QCOMPARE(changedRanges.size(), 0);
+
+	qDeleteAll(changed);
+}
+
+void ResultsListTests::changesBenchmark_data()
+{
+	QTest::addColumn<int>("size");
+	QTest::addColumn<int>("step");
+
+	QTest::newRow("50k results, all changed") << 50000 << 1;
+	QTest::newRow("50k results, every 10th changed") << 50000 << 10;
+}
+
+/**
+ * Changes a large number of entries at once, like marking a whole results
+ * set as known does.
+ */
+void ResultsListTests::changesBenchmark()
+{
+	QFETCH(int, size);
+	QFETCH(int, step);
+
+	ResultsList list;
+	fill(list, size);
+	QList<TestEntry *> changed;
+	for (int i = 0; i < size; i += step) changed << new TestEntry(i + 1);
+	connect(&list, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(onDataChanged(QModelIndex, QModelIndex)));
+	changedRanges.clear();
+
+	QBENCHMARK_ONCE {
+		foreach (TestEntry *entry, changed) list.onEntryChanged(entry);
+		QCoreApplication::processEvents();
+	}
+	// Adjacent rows are notified together
+	QCOMPARE(changedRanges.size(), step == 1 ? 1 : changed.size());
+	qDeleteAll(changed);
+}
+
+QTEST_MAIN(ResultsListTests)
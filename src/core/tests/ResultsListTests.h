@@ -0,0 +1,43 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+#include <QModelIndex>
+#include <QPair>
+
+/**
+ * Checks the change notifications of ResultsList and benchmarks them on
+ * large results sets.
+ */
+class ResultsListTests : public QObject
+{
+	Q_OBJECT
+private:
+	/// First and last rows of the dataChanged() signals received
+	QList<QPair<int, int> > changedRanges;
+
+private slots:
+	void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+	void initTestCase();
+	void cleanupTestCase();
+
+	void changes();
+	void changesBenchmark_data();
+	void changesBenchmark();
+};
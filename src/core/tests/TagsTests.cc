@@ -0,0 +1,245 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TagsTests.h"
+#include "core/Tag.h"
+#include "core/IdBitmap.h"
+#include "sqlite/Query.h"
+
+#include <QSet>
+
+/// Number of tagged entries used by the benchmarks
+#define BENCH_ENTRIES 10000
+/// Number of tags used by the benchmarks
+#define BENCH_TAGS 50
+
+void TagsTests::initTestCase()
+{
+	QVERIFY(dbFile.open());
+	QVERIFY(connection.connect(dbFile.fileName()));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("CREATE VIRTUAL TABLE tags USING fts4(tag)"));
+	QVERIFY(query.exec("CREATE TABLE taggedEntries(type INT, id INTEGER SECONDARY KEY, tagId INTEGER SECONDARY KEY REFERENCES tags, date UNSIGNED INT)"));
+	QVERIFY(query.exec("CREATE INDEX taggedEntriesIndex ON taggedEntries(type, id)"));
+	QVERIFY(query.exec("CREATE INDEX taggedEntriesTagIdIndex ON taggedEntries(tagId)"));
+
+	// Entry i of type 1 is tagged with every tag j such that i is a multiple
+	// of j + 1. Entry ids are spread like JMdict ones.
+	QVERIFY(connection.transaction());
+	for (int j = 0; j < BENCH_TAGS; j++) QVERIFY(query.exec(QString("insert into tags values('bench%1')").arg(j)));
+	QVERIFY(query.prepare("insert into taggedEntries values(1, ?, ?, 0)"));
+	for (int i = 1; i <= BENCH_ENTRIES; i++) {
+		for (int j = 0; j < BENCH_TAGS; j++) {
+			if (i % (j + 1)) continue;
+			query.bindValue(1000000 + i * 17);
+			query.bindValue(j + 1);
+			QVERIFY(query.exec());
+		}
+	}
+	QVERIFY(connection.commit());
+}
+
+void TagsTests::cleanupTestCase()
+{
+	QVERIFY(connection.close());
+}
+
+void TagsTests::idBitmap_data()
+{
+	QTest::addColumn<int>("count");
+	QTest::addColumn<int>("range");
+
+	QTest::newRow("Sparse") << 1000 << 3000000;
+	QTest::newRow("Dense") << 20000 << 70000;
+	QTest::newRow("Mixed") << 10000 << 200000;
+}
+
+void TagsTests::idBitmap()
+{
+	QFETCH(int, count);
+	QFETCH(int, range);
+
+	QSet<quint32> set1, set2;
+	IdBitmap bitmap1, bitmap2;
+	for (int i = 0; i < count; i++) {
+		quint32 id = qrand() % range;
+		set1 << id;
+		bitmap1.insert(id);
+		id = qrand() % range;
+		set2 << id;
+		bitmap2.insert(id);
+	}
+	// Remove some ids, enough to convert dense chunks back to arrays
+	for (int i = 0; i < count / 2; i++) {
+		quint32 id = qrand() % range;
+		set1.remove(id);
+		bitmap1.remove(id);
+	}
+	QCOMPARE(bitmap1.size(), set1.size());
+	for (int i = 0; i < 1000; i++) {
+		quint32 id = qrand() % range;
+		QCOMPARE(bitmap1.contains(id), set1.contains(id));
+	}
+	QList<quint32> expected(set1.toList());
+	qSort(expected);
+	QCOMPARE(bitmap1.toList(), expected);
+
+	IdBitmap intersection(bitmap1);
+	intersection &= bitmap2;
+	expected = (QSet<quint32>(set1) & set2).toList();
+	qSort(expected);
+	QCOMPARE(intersection.toList(), expected);
+	QCOMPARE(intersection.size(), expected.size());
+
+	IdBitmap unionBitmap(bitmap1);
+	unionBitmap |= bitmap2;
+	expected = (QSet<quint32>(set1) | set2).toList();
+	qSort(expected);
+	QCOMPARE(unionBitmap.toList(), expected);
+	QCOMPARE(unionBitmap.size(), expected.size());
+	// The original bitmaps are left untouched
+	QCOMPARE(bitmap1.size(), set1.size());
+	QCOMPARE(bitmap2.size(), set2.size());
+}
+
+void TagsTests::tagsIndex()
+{
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("insert into tags values('Verb')"));
+	quint32 verb = query.lastInsertId();
+	QVERIFY(query.exec("insert into tags values('verbose')"));
+	quint32 verbose = query.lastInsertId();
+	QVERIFY(query.exec(QString("insert into taggedEntries values(2, 10, %1, 0)").arg(verb)));
+	QVERIFY(query.exec(QString("insert into taggedEntries values(2, 20, %1, 0)").arg(verb)));
+	QVERIFY(query.exec(QString("insert into taggedEntries values(2, 20, %1, 0)").arg(verbose)));
+
+	TagsIndex index(&connection);
+	QCOMPARE(index.name(verb), QString("Verb"));
+	QCOMPARE(index.id("verb"), verb);
+	QCOMPARE(index.id("VERBOSE"), verbose);
+	QCOMPARE(index.id("nonexistent"), (quint32)0);
+	QVERIFY(index.name(0).isNull());
+
+	QCOMPARE(index.entries(2, QStringList() << "verb").toList(), QList<quint32>() << 10 << 20);
+	QCOMPARE(index.entries(2, QStringList() << "verb" << "verbose").toList(), QList<quint32>() << 20);
+	QCOMPARE(index.entries(2, QStringList() << "verb*").toList(), QList<quint32>() << 10 << 20);
+	QCOMPARE(index.entries(2).toList(), QList<quint32>() << 10 << 20);
+	QVERIFY(index.entries(2, QStringList() << "verb" << "nonexistent").isEmpty());
+	QVERIFY(index.entries(3, QStringList() << "verb").isEmpty());
+
+	// Incremental updates
+	QVERIFY(query.exec("insert into tags values('noun')"));
+	quint32 noun = query.lastInsertId();
+	index.tagCreated(noun, "noun");
+	index.entryTagged(2, 30, noun);
+	index.entryTagged(2, 10, verbose);
+	QCOMPARE(index.id("Noun"), noun);
+	QCOMPARE(index.entries(2, QStringList() << "noun").toList(), QList<quint32>() << 30);
+	QCOMPARE(index.entries(2, QStringList() << "verb" << "verbose").toList(), QList<quint32>() << 10 << 20);
+	index.entryUntagged(2, 20);
+	QCOMPARE(index.entries(2, QStringList() << "verb*").toList(), QList<quint32>() << 10);
+	index.entryUntagged(2, 30);
+	index.tagsRemoved(QList<quint32>() << noun);
+	QCOMPARE(index.id("noun"), (quint32)0);
+	QVERIFY(index.name(noun).isNull());
+
+	// A reloaded index matches the database, which was not updated
+	index.invalidate();
+	QCOMPARE(index.entries(2, QStringList() << "verb" << "verbose").toList(), QList<quint32>() << 20);
+
+	QVERIFY(query.exec("delete from taggedEntries where type = 2"));
+	QVERIFY(query.exec(QString("delete from tags where docid in (%1, %2, %3)").arg(verb).arg(verbose).arg(noun)));
+}
+
+void TagsTests::loadBenchmark_data()
+{
+	QTest::addColumn<bool>("useIndex");
+
+	QTest::newRow("SQL") << false;
+	QTest::newRow("Index") << true;
+}
+
+/**
+ * Loads the tags of all the tagged entries, like EntryLoader does.
+ */
+void TagsTests::loadBenchmark()
+{
+	QFETCH(bool, useIndex);
+
+	SQLite::Query tagsQuery(&connection);
+	QVERIFY(tagsQuery.prepare("select tagId from taggedEntries where type = 1 and id = ?"));
+	TagsIndex index(&connection);
+	int count = 0;
+	QBENCHMARK_ONCE {
+		for (int i = 1; i <= BENCH_ENTRIES; i++) {
+			tagsQuery.bindValue(1000000 + i * 17);
+			QVERIFY(tagsQuery.exec());
+			while (tagsQuery.next()) {
+				quint32 tagId = tagsQuery.valueUInt(0);
+				QString name;
+				if (useIndex) name = index.name(tagId);
+				else {
+					SQLite::Query query(&connection);
+					query.exec(QString("select docid, tag from tags where docid = %1").arg(tagId));
+					if (query.next()) name = query.valueString(1);
+				}
+				if (!name.isEmpty()) count++;
+			}
+		}
+	}
+	QVERIFY(count > BENCH_ENTRIES);
+}
+
+void TagsTests::searchBenchmark_data()
+{
+	QTest::addColumn<bool>("useIndex");
+	QTest::addColumn<QStringList>("tags");
+
+	QStringList twoTags(QStringList() << "bench1" << "bench2");
+	QStringList fourTags(QStringList() << "bench1" << "bench2" << "bench4" << "bench6");
+	QTest::newRow("SQL, 2 tags") << false << twoTags;
+	QTest::newRow("Index, 2 tags") << true << twoTags;
+	QTest::newRow("SQL, 4 tags") << false << fourTags;
+	QTest::newRow("Index, 4 tags") << true << fourTags;
+}
+
+void TagsTests::searchBenchmark()
+{
+	QFETCH(bool, useIndex);
+	QFETCH(QStringList, tags);
+
+	TagsIndex index(&connection);
+	index.preload();
+	QStringList tagSearch;
+	foreach (const QString &tag, tags) tagSearch << "\"" + tag + "\"";
+	QList<quint32> result;
+	QBENCHMARK {
+		result.clear();
+		if (useIndex) result = index.entries(1, tags).toList();
+		else {
+			SQLite::Query query(&connection);
+			QVERIFY(query.exec(QString("select id from taggedEntries where type = 1 and tagId in (select docid from tags where tag match '%1') group by id having count(id) == %2 order by id").arg(tagSearch.join(" OR ")).arg(tags.size())));
+			while (query.next()) result << query.valueUInt(0);
+		}
+	}
+	// Tags are applied to multiples of their number + 1
+	int lcm = tags.size() == 2 ? 6 : 210;
+	QCOMPARE(result.size(), BENCH_ENTRIES / lcm);
+	foreach (quint32 id, result) QCOMPARE(((id - 1000000) / 17) % lcm, (quint32)0);
+}
+
+QTEST_MAIN(TagsTests)
@@ -0,0 +1,47 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+#include <QTemporaryFile>
+
+#include "sqlite/Connection.h"
+
+/**
+ * Checks the tags index and the bitmaps it uses, and compares them against
+ * the SQL queries they replace.
+ */
+class TagsTests : public QObject
+{
+	Q_OBJECT
+private:
+	QTemporaryFile dbFile;
+	SQLite::Connection connection;
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void idBitmap_data();
+	void idBitmap();
+	void tagsIndex();
+
+	void loadBenchmark_data();
+	void loadBenchmark();
+	void searchBenchmark_data();
+	void searchBenchmark();
+};
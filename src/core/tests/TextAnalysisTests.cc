@@ -0,0 +1,364 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TextAnalysisTests.h"
+#include "core/jmdict/JMdictTextAnalyzer.h"
+#include "core/TextTools.h"
+
+#include <QTemporaryFile>
+#include <QFileInfo>
+#include <QTime>
+
+/// Returns a random character, kana being more frequent than kanji
+static QChar randomChar()
+{
+	return qrand() % 3 ? QChar(0x3041 + qrand() % 80) : QChar(0x4e00 + qrand() % 3000);
+}
+
+static QString randomString(int maxLength)
+{
+	QString ret;
+	int length = 1 + qrand() % maxLength;
+	for (int i = 0; i < length; i++) ret += randomChar();
+	return ret;
+}
+
+static QMap<QString, QList<quint32> > sampleWords()
+{
+	QMap<QString, QList<quint32> > words;
+	words[QString::fromUtf8("日")] << 1 << 2;
+	words[QString::fromUtf8("日本")] << 3;
+	words[QString::fromUtf8("日本語")] << 4;
+	words[QString::fromUtf8("本")] << 5;
+	words[QString::fromUtf8("語")] << 6;
+	words[QString::fromUtf8("を")] << 7;
+	words[QString::fromUtf8("話す")] << 8;
+	words[QString::fromUtf8("にほんご")] << 4;
+	return words;
+}
+
+/// Checks the common prefix search of text against a plain lookup into words
+static bool checkPrefixes(const DoubleArrayTrie &trie, const QMap<QString, QList<quint32> > &words, const QString &text)
+{
+	DoubleArrayTrie::Match matches[JMdictTextAnalyzer::MaxWordLength];
+	int nbMatches = trie.commonPrefixSearch(text.constData(), text.size(), matches, JMdictTextAnalyzer::MaxWordLength);
+	int cpt = 0;
+	for (int length = 1; length <= text.size(); length++) {
+		QMap<QString, QList<quint32> >::const_iterator it(words.constFind(text.left(length)));
+		if (it == words.constEnd()) continue;
+		if (cpt >= nbMatches || matches[cpt].length != length || matches[cpt].valuesCount != it->size()) return false;
+		for (int i = 0; i < it->size(); i++)
+			if (matches[cpt].values[i] != it->at(i)) return false;
+		++cpt;
+	}
+	return cpt == nbMatches;
+}
+
+void TextAnalysisTests::initTestCase()
+{
+	qsrand(1);
+	for (int i = 0; i < 200000; i++) randomWords[randomString(6)] << i;
+}
+
+void TextAnalysisTests::trieLookup()
+{
+	DoubleArrayTrie trie;
+	QVERIFY(trie.isEmpty());
+	QMap<QString, QList<quint32> > words(sampleWords());
+	// Empty keys are ignored
+	words[QString()] << 100;
+	QVERIFY(trie.build(words));
+	QCOMPARE(trie.size(), words.size() - 1);
+
+	QString text(QString::fromUtf8("日本語を話す"));
+	DoubleArrayTrie::Match matches[10];
+	QCOMPARE(trie.commonPrefixSearch(text.constData(), text.size(), matches, 10), 3);
+	QCOMPARE(matches[0].length, 1);
+	QCOMPARE(matches[0].valuesCount, 2);
+	QCOMPARE(matches[0].values[1], (quint32)2);
+	QCOMPARE(matches[1].length, 2);
+	QCOMPARE(matches[2].length, 3);
+	QCOMPARE(matches[2].values[0], (quint32)4);
+	// The number of results is bounded
+	QCOMPARE(trie.commonPrefixSearch(text.constData(), text.size(), matches, 2), 2);
+	QVERIFY(trie.longestPrefixSearch(text.constData(), text.size(), matches[0]));
+	QCOMPARE(matches[0].length, 3);
+	QVERIFY(trie.longestPrefixSearch(text.constData() + 4, 2, matches[0]));
+	QCOMPARE(matches[0].length, 2);
+
+	QCOMPARE(trie.values(QString::fromUtf8("にほんご")), QList<quint32>() << 4);
+	QVERIFY(trie.values(QString::fromUtf8("にほん")).isEmpty());
+	QVERIFY(trie.values(QString::fromUtf8("話")).isEmpty());
+	QVERIFY(trie.values(QString::fromUtf8("日本語を")).isEmpty());
+	// Characters that are not part of any key
+	QVERIFY(trie.values("abc").isEmpty());
+	QVERIFY(!trie.longestPrefixSearch(QString("abc").constData(), 3, matches[0]));
+	QVERIFY(trie.values(QString()).isEmpty());
+}
+
+void TextAnalysisTests::trieRandom()
+{
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(randomWords));
+	QCOMPARE(trie.size(), randomWords.size());
+	for (QMap<QString, QList<quint32> >::const_iterator it = randomWords.constBegin(); it != randomWords.constEnd(); ++it) {
+		if (trie.values(it.key()) != it.value()) QFAIL(qPrintable(QString("Wrong values for %1").arg(it.key())));
+		if (!checkPrefixes(trie, randomWords, it.key())) QFAIL(qPrintable(QString("Wrong prefixes for %1").arg(it.key())));
+	}
+	for (int i = 0; i < 100000; i++) {
+		QString text(randomString(8));
+		if (!checkPrefixes(trie, randomWords, text)) QFAIL(qPrintable(QString("Wrong prefixes for %1").arg(text)));
+	}
+}
+
+void TextAnalysisTests::trieSaveLoad()
+{
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(sampleWords(), 7, 20120101));
+	QTemporaryFile file;
+	QVERIFY(file.open());
+	file.close();
+	QVERIFY(trie.save(file.fileName()));
+
+	DoubleArrayTrie loaded;
+	// Tries built from other data are rejected
+	QVERIFY(!loaded.load(file.fileName()));
+	QVERIFY(loaded.isEmpty());
+	QVERIFY(!loaded.load(file.fileName(), 6, 20120101));
+	QVERIFY(!loaded.load(file.fileName(), 7, 20130101));
+	QVERIFY(loaded.load(file.fileName(), 7, 20120101));
+	QCOMPARE(loaded.revision(), (quint32)7);
+	QCOMPARE(loaded.sourceVersion(), (quint32)20120101);
+	QCOMPARE(loaded.size(), trie.size());
+	QCOMPARE(loaded.dataSize(), trie.dataSize());
+	QCOMPARE(QFileInfo(file.fileName()).size(), trie.dataSize());
+	QMap<QString, QList<quint32> > words(sampleWords());
+	foreach (const QString &key, words.keys()) QCOMPARE(loaded.values(key), words[key]);
+	QVERIFY(checkPrefixes(loaded, words, QString::fromUtf8("日本語を話す")));
+
+	// Truncated and invalid files are rejected
+	QVERIFY(file.open());
+	QVERIFY(file.resize(trie.dataSize() - 4));
+	file.close();
+	QVERIFY(!loaded.load(file.fileName()));
+	QVERIFY(loaded.isEmpty());
+	QVERIFY(file.open());
+	QVERIFY(file.resize(0));
+	QVERIFY(file.write(QByteArray(trie.dataSize(), 'x')) == trie.dataSize());
+	file.close();
+	QVERIFY(!loaded.load(file.fileName()));
+	QVERIFY(!loaded.load(file.fileName() + ".missing"));
+}
+
+void TextAnalysisTests::analyze()
+{
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(sampleWords()));
+	JMdictTextAnalyzer analyzer(trie);
+	// The last character is not part of the dictionary
+	QString text(QString::fromUtf8("日本語を話すx"));
+
+	QVector<JMdictTextAnalyzer::Word> words(analyzer.analyze(text, JMdictTextAnalyzer::LongestMatch));
+	QCOMPARE(words.size(), 3);
+	QCOMPARE(words[0].position, 0);
+	QCOMPARE(words[0].length, 3);
+	QCOMPARE(words[0].id, (EntryId)4);
+	QCOMPARE(words[1].position, 3);
+	QCOMPARE(words[1].id, (EntryId)7);
+	QCOMPARE(words[2].position, 4);
+	QCOMPARE(words[2].length, 2);
+	QCOMPARE(words[2].id, (EntryId)8);
+
+	// Every position is looked up, longest words first
+	words = analyzer.analyze(text, JMdictTextAnalyzer::AllMatches);
+	QList<EntryId> ids;
+	foreach (const JMdictTextAnalyzer::Word &word, words) ids << word.id;
+	QCOMPARE(ids, QList<EntryId>() << 4 << 3 << 1 << 2 << 5 << 6 << 7 << 8);
+	QCOMPARE(words[5].position, 2);
+
+	// The entries are given in order of appearance
+	QList<EntryRef> entries(JMdictTextAnalyzer::entries(words));
+	QCOMPARE(entries.size(), 8);
+	QCOMPARE(entries[0].id(), (EntryId)4);
+	words << words[0];
+	QCOMPARE(JMdictTextAnalyzer::entries(words).size(), 8);
+
+	QVERIFY(analyzer.analyze(QString()).isEmpty());
+}
+
+void TextAnalysisTests::analyzeBenchmark_data()
+{
+	QTest::addColumn<int>("mode");
+
+	QTest::newRow("Longest match") << (int)JMdictTextAnalyzer::LongestMatch;
+	QTest::newRow("All matches") << (int)JMdictTextAnalyzer::AllMatches;
+}
+
+void TextAnalysisTests::analyzeBenchmark()
+{
+	QFETCH(int, mode);
+
+	DoubleArrayTrie trie;
+	QTime time;
+	time.start();
+	QVERIFY(trie.build(randomWords));
+	qDebug("Trie of %d keys built in %d ms, %lld bytes", trie.size(), time.elapsed(), trie.dataSize());
+
+	// A text made of dictionary words, with some noise between them
+	QStringList keys(randomWords.keys());
+	QString text;
+	text.reserve(5000000);
+	while (text.size() < 5000000) {
+		text += keys[qrand() % keys.size()];
+		if (qrand() % 4 == 0) text += randomChar();
+	}
+
+	JMdictTextAnalyzer analyzer(trie);
+	QVector<JMdictTextAnalyzer::Word> words;
+	int elapsed = 0;
+	QBENCHMARK_ONCE {
+		time.start();
+		words = analyzer.analyze(text, (JMdictTextAnalyzer::Mode)mode);
+		elapsed = time.elapsed();
+	}
+	QVERIFY(!words.isEmpty());
+	qDebug("%d words found in %d characters, %.1f MB/s", words.size(), text.size(), text.size() * sizeof(QChar) / 1000.0 / qMax(elapsed, 1));
+}
+
+static QString randomLatinWord()
+{
+	QString ret;
+	int length = 3 + qrand() % 8;
+	for (int i = 0; i < length; i++) ret += QChar('a' + qrand() % 26);
+	return ret;
+}
+
+static int levenshtein(const QString &s1, const QString &s2)
+{
+	QVector<int> prev(s2.size() + 1), cur(s2.size() + 1);
+	for (int j = 0; j <= s2.size(); j++) prev[j] = j;
+	for (int i = 1; i <= s1.size(); i++) {
+		cur[0] = i;
+		for (int j = 1; j <= s2.size(); j++)
+			cur[j] = qMin(qMin(prev[j] + 1, cur[j - 1] + 1), prev[j - 1] + (s1[i - 1] == s2[j - 1] ? 0 : 1));
+		prev = cur;
+	}
+	return prev[s2.size()];
+}
+
+static const QString latinAlphabet("abcdefghijklmnopqrstuvwxyz");
+
+void TextAnalysisTests::fuzzySearch()
+{
+	QMap<QString, QList<quint32> > words;
+	for (int i = 0; i < 20000; i++) words[randomLatinWord()] << i;
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(words));
+
+	QStringList keys(words.keys());
+	for (int i = 0; i < 200; i++) {
+		// Existing words with a random typo
+		QString key(keys[qrand() % keys.size()]);
+		if (i % 2) key[qrand() % key.size()] = QChar('a' + qrand() % 26);
+		int maxDistance = 1 + i % 2;
+		QMap<QString, int> expected;
+		foreach (const QString &k, keys) {
+			int distance = levenshtein(k, key);
+			if (distance <= maxDistance) expected[k] = distance;
+		}
+		QMap<QString, int> found;
+		foreach (const DoubleArrayTrie::FuzzyMatch &match, trie.fuzzySearch(key, maxDistance, latinAlphabet)) {
+			QVERIFY(!found.contains(match.key));
+			found[match.key] = match.distance;
+			QCOMPARE(match.valuesCount, words[match.key].size());
+			QCOMPARE(match.values[0], words[match.key][0]);
+		}
+		if (found != expected) QFAIL(qPrintable(QString("Wrong fuzzy matches for %1").arg(key)));
+	}
+
+	// Characters out of the alphabet are not followed, and results are bounded
+	QMap<QString, QList<quint32> > small;
+	small["tabemono"] << 1;
+	small["tabemonó"] << 2;
+	small["tabemno"] << 3;
+	QVERIFY(trie.build(small));
+	QCOMPARE(trie.fuzzySearch("tabemono", 1, latinAlphabet).size(), 2);
+	QCOMPARE(trie.fuzzySearch("tabemono", 1, latinAlphabet + QString::fromUtf8("ó")).size(), 3);
+	QCOMPARE(trie.fuzzySearch("tabemono", 1, latinAlphabet, 1).size(), 1);
+	// The closest keys are kept, although tabemno comes first in the trie
+	QCOMPARE(trie.fuzzySearch("tabemono", 1, latinAlphabet, 1)[0].key, QString("tabemono"));
+	QList<DoubleArrayTrie::FuzzyMatch> matches(trie.fuzzySearch("tabemono", 1, trie.alphabet()));
+	QCOMPARE(matches.size(), 3);
+	for (int i = 1; i < matches.size(); i++) QVERIFY(matches[i - 1].distance <= matches[i].distance);
+	QCOMPARE(trie.alphabet(), QString::fromUtf8("abemnotó"));
+	QVERIFY(trie.fuzzySearch("xyz", 1, latinAlphabet).isEmpty());
+	QVERIFY(trie.fuzzySearch(QString(), 1, latinAlphabet).isEmpty());
+}
+
+void TextAnalysisTests::fuzzyBenchmark_data()
+{
+	QTest::addColumn<bool>("automaton");
+
+	QTest::newRow("Levenshtein automaton") << true;
+	QTest::newRow("Regexp scan") << false;
+}
+
+void TextAnalysisTests::fuzzyBenchmark()
+{
+	QFETCH(bool, automaton);
+
+	// Glosses made of a vocabulary of 50k words
+	QStringList vocabulary;
+	for (int i = 0; i < 50000; i++) vocabulary << randomLatinWord();
+	QStringList glosses;
+	QMap<QString, QList<quint32> > terms;
+	for (int i = 0; i < 200000; i++) {
+		QString gloss(vocabulary[qrand() % vocabulary.size()] + " " + vocabulary[qrand() % vocabulary.size()]);
+		glosses << gloss;
+		foreach (const QString &term, TextTools::ftsTokens(gloss)) {
+			QList<quint32> &count = terms[term];
+			if (count.isEmpty()) count << 0;
+			++count[0];
+		}
+	}
+	DoubleArrayTrie trie;
+	QVERIFY(trie.build(terms));
+
+	// Misspelled words, dropping one character
+	QStringList queries;
+	for (int i = 0; i < 100; i++) {
+		QString word(vocabulary[qrand() % vocabulary.size()]);
+		queries << word.remove(1 + qrand() % (word.size() - 1), 1);
+	}
+
+	int found = 0;
+	QTime time;
+	QBENCHMARK_ONCE {
+		time.start();
+		foreach (const QString &query, queries) {
+			// Without fuzzy search, the best one can do is a regexp on the end of the word
+			if (automaton) found += trie.fuzzySearch(query, 2, latinAlphabet).size();
+			else {
+				QRegExp regExp(".*" + QRegExp::escape(query.mid(query.size() / 2)) + ".*");
+				foreach (const QString &gloss, glosses) if (regExp.exactMatch(gloss)) ++found;
+			}
+		}
+	}
+	qDebug("%d results for %d queries, %.1f ms per query", found, queries.size(), time.elapsed() / (double)queries.size());
+}
+
+QTEST_MAIN(TextAnalysisTests)
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include "core/DoubleArrayTrie.h"
+
+/**
+ * Checks the double-array trie and the text analyzer built on top of it,
+ * and benchmarks the analysis of a large text.
+ */
+class TextAnalysisTests : public QObject
+{
+	Q_OBJECT
+private:
+	/// Dictionary of random words used by the random and benchmark tests
+	QMap<QString, QList<quint32> > randomWords;
+
+private slots:
+	void initTestCase();
+
+	void trieLookup();
+	void trieRandom();
+	void trieSaveLoad();
+	void analyze();
+	void analyzeBenchmark_data();
+	void analyzeBenchmark();
+	void fuzzySearch();
+	void fuzzyBenchmark_data();
+	void fuzzyBenchmark();
+};
@@ -52,6 +52,8 @@ PreferenceItem<QString> DetailedViewFonts::kanaHeaderFont("mainWindow/detailedVi
 
 PreferenceItem<bool> DetailedView::smoothScrolling("mainWindow/detailedView", "smoothScrolling", true);
 PreferenceItem<int> DetailedView::historySize("mainWindow/detailedView", "historySize", 1000);
+PreferenceItem<int> DetailedViewCache::fragmentsCacheSize("mainWindow/detailedView", "fragmentsCacheSize", 50);
+PreferenceItem<int> DetailedViewCache::jobsCacheSize("mainWindow/detailedView", "jobsCacheSize", 200);
 EntryMenuHandler DetailedView::_entryHandler;
 TagsLinkHandler DetailedView::_tagsLinkHandler;
 ListLinkHandler DetailedView::_listLinkHandler;
@@ -119,6 +121,10 @@ DetailedView::~DetailedView()
 
 void DetailedView::_display(const EntryPointer &entry, bool update)
 {
+#ifdef DEBUG_DETAILED_VIEW
+	QTime displayTime;
+	displayTime.start();
+#endif
 	clear();
 	_entryView.setEntry(entry);
 	if (_historyEnabled) {
@@ -138,8 +144,14 @@ void DetailedView::_display(const EntryPointer &entry, bool update)
 		css += QString("\n%1 {\n%2}\n").arg(".mainwriting").arg(DetailedViewFonts::CSS(DetailedViewFonts::KanjiHeader));
 		css += QString("\n%1 {\n%2}\n").arg(".kanji").arg(DetailedViewFonts::CSS(DetailedViewFonts::Kanji));
 		css += QString("\n%1 {\n%2}\n").arg(".kana").arg(DetailedViewFonts::CSS(DetailedViewFonts::Kana));
-		// Fill the HTML template with the immediate information
-		QString html(filler.fill(formatter->htmlTemplate(), formatter, entry));
+		// Fill the HTML template with the immediate information, unless we
+		// did it recently
+		QString html;
+		DetailedViewCache &cache(DetailedViewCache::instance());
+		if (update || !cache.html(entry, html)) {
+			html = filler.fill(formatter->htmlTemplate(), formatter, entry);
+			cache.setHtml(entry, html);
+		}
 #ifdef DEBUG_DETAILED_VIEW
 		qDebug() << css;
 		qDebug() << html;
@@ -165,6 +177,9 @@ void DetailedView::_display(const EntryPointer &entry, bool update)
 		}
 		// Start running background jobs
 		_jobsRunner.runAllJobs();
+#ifdef DEBUG_DETAILED_VIEW
+		qDebug("Entry displayed in %d ms", displayTime.elapsed());
+#endif
 		
 		emit entryDisplayed(entry);
 	}
@@ -318,7 +333,77 @@ void DetailedView::mouseReleaseEvent(QMouseEvent *e)
 	QTextBrowser::mouseReleaseEvent(e);
 }
 
-DetailedViewJobRunner::DetailedViewJobRunner(DetailedView * view, QObject *parent) : QObject(parent), _view(view), _currentJob(0), _ignoreJobs(false)
+DetailedViewCache *DetailedViewCache::_instance = 0;
+
+DetailedViewCache::DetailedViewCache() : QObject(0), _fragments(fragmentsCacheSize.value()), _jobResults(jobsCacheSize.value())
+{
+}
+
+DetailedViewCache &DetailedViewCache::instance()
+{
+	if (!_instance) _instance = new DetailedViewCache();
+	return *_instance;
+}
+
+bool DetailedViewCache::html(const EntryPointer &entry, QString &html)
+{
+	Fragment *fragment = _fragments.object(EntryRef(entry));
+	if (!fragment) return false;
+	// A fragment generated from another instance of the entry may not have
+	// seen its changes
+	if (fragment->entry.toStrongRef() != entry || fragment->prefsStamp != PreferenceRoot::changesCount() || fragment->entriesStamp != Entry::changesCount()) {
+		_fragments.remove(EntryRef(entry));
+		return false;
+	}
+	html = fragment->html;
+	return true;
+}
+
+void DetailedViewCache::setHtml(const EntryPointer &entry, const QString &html)
+{
+	Fragment *fragment = new Fragment;
+	fragment->entry = entry;
+	fragment->html = html;
+	fragment->prefsStamp = PreferenceRoot::changesCount();
+	fragment->entriesStamp = Entry::changesCount();
+	_fragments.insert(EntryRef(entry), fragment);
+	connect(entry.data(), SIGNAL(entryChanged(Entry *)), this, SLOT(onEntryChanged(Entry *)), Qt::UniqueConnection);
+}
+
+void DetailedViewCache::onEntryChanged(Entry *entry)
+{
+	_fragments.remove(EntryRef(entry->type(), entry->id()));
+}
+
+bool DetailedViewCache::jobResults(const QString &sql, QList<EntryRef> &results)
+{
+	JobResults *cached = _jobResults.object(sql);
+	if (!cached) return false;
+	if (cached->stamp != jobsStamp()) {
+		_jobResults.remove(sql);
+		return false;
+	}
+	results = cached->results;
+	return true;
+}
+
+void DetailedViewCache::setJobResults(const QString &sql, const QList<EntryRef> &results, int stamp)
+{
+	// Do not keep results that have been invalidated while being fetched
+	if (stamp != jobsStamp()) return;
+	JobResults *cached = new JobResults;
+	cached->results = results;
+	cached->stamp = stamp;
+	_jobResults.insert(sql, cached);
+}
+
+void DetailedViewCache::clear()
+{
+	_fragments.clear();
+	_jobResults.clear();
+}
+
+DetailedViewJobRunner::DetailedViewJobRunner(DetailedView * view, QObject *parent) : QObject(parent), _view(view), _currentJob(0), _ignoreJobs(false), _currentStamp(0)
 {
 	_dbThread = new DatabaseThread();
 
@@ -347,26 +432,46 @@ void DetailedViewJobRunner::addJob(DetailedViewJob *job)
 
 void DetailedViewJobRunner::runNextJob()
 {
+#ifdef DEBUG_DETAILED_VIEW
+	if (_currentJob && _jobs.isEmpty()) qDebug("Background jobs completed in %d ms", _jobsTime.elapsed());
+#endif
 	// Delete the current job, if any
 	if (_currentJob) delete _currentJob;
+	_currentJob = 0;
 	// No more job to run?
-	if (_jobs.isEmpty()) {
-		_currentJob = 0;
-		return;
-	}
+	if (_jobs.isEmpty()) return;
 	_currentJob = _jobs.dequeue();
 	// Since we are only using the Query from here, it should always be available!
-	if (_currentJob->sql().isEmpty()) runNextJob();
+	if (_currentJob->sql().isEmpty() || replayCurrentJob()) runNextJob();
 	else {
+		_currentResults.clear();
+		_currentStamp = DetailedViewCache::jobsStamp();
 		if (!_aQuery->exec(_currentJob->sql()))
 			qWarning("%s %d: %s", __FILE__, __LINE__, "Unable to start background job");
 	}
 }
 
+bool DetailedViewJobRunner::replayCurrentJob()
+{
+	QList<EntryRef> results;
+	if (!DetailedViewCache::instance().jobResults(_currentJob->sql(), results)) return false;
+	// Behave like the query would have
+	if (!results.isEmpty()) _currentJob->firstResult();
+	foreach (const EntryRef &ref, results) {
+		EntryPointer entry(ref.get());
+		if (!entry) continue;
+		_currentJob->result(entry);
+		_view->addWatchEntry(entry);
+	}
+	_currentJob->completed();
+	return true;
+}
+
 void DetailedViewJobRunner::runAllJobs()
 {
 	// Are jobs already running?
 	if (_currentJob) return;
+	_jobsTime.start();
 	runNextJob();
 }
 
@@ -420,6 +525,7 @@ void DetailedViewJobRunner::onResult(EntryPointer entry)
 
 	Q_ASSERT(_currentJob != 0);
 	_currentJob->result(entry);
+	_currentResults << EntryRef(entry);
 	_view->addWatchEntry(entry);
 	// Workaround for the fact QTextEdit does not seem to like when we change the
 	// displayed text document so often - without this scheduled repaint graphical
@@ -434,6 +540,7 @@ void DetailedViewJobRunner::onCompleted()
 
 	Q_ASSERT(_currentJob != 0);
 	_currentJob->completed();
+	DetailedViewCache::instance().setJobResults(_currentJob->sql(), _currentResults, _currentStamp);
 
 	runNextJob();
 }
@@ -32,6 +32,9 @@
 #include <QMouseEvent>
 #include <QQueue>
 #include <QSet>
+#include <QCache>
+#include <QTime>
+#include <QWeakPointer>
 
 class DetailedView;
 
@@ -63,6 +66,67 @@ public:
 	virtual void completed() { }
 };
 
+/**
+ * Keeps the HTML of recently displayed entries and the results of the jobs
+ * run to display them, so going back and forth through the history does not
+ * require to fill templates and to run queries again.
+ *
+ * The HTML of an entry is dropped when that entry changes. Job results
+ * depend on other entries (e.g. whether they are studied), so they are only
+ * valid until any entry changes. Everything is dropped when a preference
+ * changes.
+ */
+class DetailedViewCache : public QObject
+{
+	Q_OBJECT
+private:
+	struct Fragment
+	{
+		/// Instance the HTML has been generated from
+		QWeakPointer<Entry> entry;
+		QString html;
+		int prefsStamp;
+		/// The HTML also shows the state of other entries (e.g. the kanji of
+		/// a word), so any entry change invalidates it
+		int entriesStamp;
+	};
+	struct JobResults
+	{
+		QList<EntryRef> results;
+		int stamp;
+	};
+
+	static DetailedViewCache *_instance;
+	QCache<EntryRef, Fragment> _fragments;
+	QCache<QString, JobResults> _jobResults;
+
+	DetailedViewCache();
+
+private slots:
+	void onEntryChanged(Entry *entry);
+
+public:
+	static DetailedViewCache &instance();
+
+	/**
+	 * Returns the current validity stamp of job results. Results recorded
+	 * with a stamp different from the current one are discarded.
+	 */
+	static int jobsStamp() { return Entry::changesCount() + PreferenceRoot::changesCount(); }
+
+	/// Sets html to the cached HTML of entry and returns true if it is available
+	bool html(const EntryPointer &entry, QString &html);
+	void setHtml(const EntryPointer &entry, const QString &html);
+	/// Sets results to the cached results of the job query sql and returns true if they are available
+	bool jobResults(const QString &sql, QList<EntryRef> &results);
+	/// Caches the results of sql, obtained when jobsStamp() was equal to stamp
+	void setJobResults(const QString &sql, const QList<EntryRef> &results, int stamp);
+	void clear();
+
+	static PreferenceItem<int> fragmentsCacheSize;
+	static PreferenceItem<int> jobsCacheSize;
+};
+
 class DetailedViewJobRunner : public QObject
 {
 	Q_OBJECT
@@ -74,6 +138,14 @@ protected:
 	QQueue<DetailedViewJob *> _jobs;
 	DetailedViewJob *_currentJob;
 	bool _ignoreJobs;
+	/// Results of the current job, to be cached once it completes
+	QList<EntryRef> _currentResults;
+	int _currentStamp;
+	/// Time since the jobs started running
+	QTime _jobsTime;
+
+	/// Gives the cached results of the current job to it, if available
+	bool replayCurrentJob();
 
 protected slots:
 	void onFirstResult();
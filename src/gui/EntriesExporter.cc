@@ -0,0 +1,262 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "core/Paths.h"
+#include "gui/EntriesExporter.h"
+
+#include <QFile>
+
+/// Size from which the writer buffer is written to the device
+#define EXPORT_BUFFER_SIZE (64 * 1024)
+/// Number of entries loaded at once by the export thread
+#define EXPORT_BATCH_SIZE 500
+
+ExportWriter::ExportWriter(QIODevice *device) : _device(device), _error(false)
+{
+	_buffer.reserve(EXPORT_BUFFER_SIZE * 2);
+}
+
+ExportWriter::~ExportWriter()
+{
+	flush();
+}
+
+ExportWriter &ExportWriter::operator<<(const QString &str)
+{
+	_buffer += str.toUtf8();
+	if (_buffer.size() >= EXPORT_BUFFER_SIZE) flush();
+	return *this;
+}
+
+ExportWriter &ExportWriter::operator<<(const char *str)
+{
+	_buffer += str;
+	if (_buffer.size() >= EXPORT_BUFFER_SIZE) flush();
+	return *this;
+}
+
+bool ExportWriter::flush()
+{
+	if (!_buffer.isEmpty() && !_error && _device->write(_buffer) != _buffer.size()) _error = true;
+	_buffer.clear();
+	return !_error;
+}
+
+QList<ExportFormat *> EntriesExporter::_formats;
+bool EntriesExporter::_defaultFormatsRegistered = false;
+
+EntriesExporter::EntriesExporter(ExportFormat *format, const QList<EntryRef> &entries, const QString &fileName, QObject *parent) : QThread(parent), _format(format), _entries(entries), _fileName(fileName), _canceled(0), _success(false)
+{
+}
+
+const QList<ExportFormat *> &EntriesExporter::formats()
+{
+	if (!_defaultFormatsRegistered) {
+		static TSVExportFormat tsvFormat;
+		static HTMLExportFormat htmlFormat;
+		static AnkiExportFormat ankiFormat;
+		static JSONLinesExportFormat jsonLinesFormat;
+		_formats.insert(0, &jsonLinesFormat);
+		_formats.insert(0, &ankiFormat);
+		_formats.insert(0, &htmlFormat);
+		_formats.insert(0, &tsvFormat);
+		_defaultFormatsRegistered = true;
+	}
+	return _formats;
+}
+
+bool EntriesExporter::registerFormat(ExportFormat *format)
+{
+	if (_formats.contains(format)) return false;
+	_formats << format;
+	return true;
+}
+
+bool EntriesExporter::removeFormat(ExportFormat *format)
+{
+	return _formats.removeOne(format);
+}
+
+void EntriesExporter::cancel()
+{
+	_canceled = 1;
+}
+
+void EntriesExporter::run()
+{
+	_success = false;
+	_errorString.clear();
+
+	QFile outFile(_fileName);
+	if (!outFile.open(QIODevice::WriteOnly)) {
+		_errorString = tr("Unable to write file %1.").arg(_fileName);
+		return;
+	}
+
+	{
+		ExportWriter writer(&outFile);
+		if (!_format->begin(writer, _errorString)) {
+			outFile.remove();
+			return;
+		}
+		for (int i = 0; i < _entries.size() && !_canceled && !writer.error(); i += EXPORT_BATCH_SIZE) {
+			// Load the whole batch first, so the entries cache is not locked
+			// and unlocked between every entry we write
+			QList<ConstEntryPointer> batch;
+			int batchEnd = qMin(i + EXPORT_BATCH_SIZE, _entries.size());
+			for (int j = i; j < batchEnd; j++) batch << _entries[j].get();
+			foreach (const ConstEntryPointer &entry, batch) {
+				if (entry) _format->writeEntry(writer, entry);
+			}
+			emit progress(batchEnd);
+		}
+		if (!_canceled) _format->end(writer);
+		writer.flush();
+		if (writer.error()) _errorString = tr("Error while writing file %1.").arg(_fileName);
+	}
+
+	if (_canceled || !_errorString.isEmpty()) {
+		outFile.remove();
+		return;
+	}
+	outFile.close();
+	_success = true;
+}
+
+void TSVExportFormat::writeEntry(ExportWriter &writer, const ConstEntryPointer &entry)
+{
+	QStringList writings = entry->writings();
+	QString writing;
+	if (writings.size() > 0) writing = writings[0];
+	writer << QString("%1\t%2\t%3\n").arg(writing, entry->readings().join(", "), entry->meanings().join(", "));
+}
+
+static QString escapeQuotes(const QString &str)
+{
+	QString ret(str);
+	return ret.replace('"', "&quot;");
+}
+
+bool HTMLExportFormat::begin(ExportWriter &writer, QString &error)
+{
+	QFile tmplFile(lookForFile("export_template.html"));
+	if (!tmplFile.open(QIODevice::ReadOnly)) {
+		error = tr("Unable to open template file!");
+		return false;
+	}
+	QString tmpl(QString::fromUtf8(tmplFile.readAll()));
+	int dataPos = tmpl.indexOf("__DATA__");
+	if (dataPos == -1) {
+		error = tr("Invalid template file!");
+		return false;
+	}
+	_tmplEnd = tmpl.mid(dataPos + QString("__DATA__").size());
+	writer << tmpl.left(dataPos) << "var entries = Array();\n";
+	return true;
+}
+
+void HTMLExportFormat::writeEntry(ExportWriter &writer, const ConstEntryPointer &entry)
+{
+	QStringList readings = entry->readings();
+	QStringList meanings = entry->meanings();
+	QString mainRepr(escapeQuotes(entry->mainRepr()));
+	readings.removeAll(mainRepr);
+	QString reading;
+	QString meaning;
+	if (readings.size() > 0) reading = escapeQuotes(readings.join(", "));
+	if (meanings.size() == 1) meaning = escapeQuotes(meanings[0]);
+	else {
+		int cpt = 1;
+		foreach (const QString &str, meanings)
+			meaning += QString(" (%1) %2").arg(cpt++).arg(escapeQuotes(str));
+	}
+	writer << QString("entries.push(Array(\"%1\", \"%2\", \"%3\"));\n").arg(mainRepr, reading, meaning);
+}
+
+void HTMLExportFormat::end(ExportWriter &writer)
+{
+	writer << _tmplEnd;
+	_tmplEnd.clear();
+}
+
+static QString csvField(const QString &str)
+{
+	QString ret(str);
+	return "\"" + ret.replace('"', "\"\"") + "\"";
+}
+
+void AnkiExportFormat::writeEntry(ExportWriter &writer, const ConstEntryPointer &entry)
+{
+	QStringList readings = entry->readings();
+	QString mainRepr(entry->mainRepr());
+	readings.removeAll(mainRepr);
+	QStringList meanings = entry->meanings();
+	QString back;
+	if (!readings.isEmpty()) back = readings.join(", ") + "<br/>";
+	if (meanings.size() == 1) back += meanings[0];
+	else {
+		int cpt = 1;
+		foreach (const QString &str, meanings)
+			back += QString(" (%1) %2").arg(cpt++).arg(str);
+	}
+	// Anki tags cannot contain spaces
+	QStringList tags;
+	foreach (const Tag &tag, entry->tags()) tags << tag.name();
+	writer << csvField(mainRepr) << "," << csvField(back) << "," << csvField(tags.join(" ")) << "\n";
+}
+
+static QString jsonString(const QString &str)
+{
+	QString ret("\"");
+	foreach (const QChar &c, str) {
+		switch (c.unicode()) {
+			case '"':
+				ret += "\\\"";
+				break;
+			case '\\':
+				ret += "\\\\";
+				break;
+			case '\n':
+				ret += "\\n";
+				break;
+			case '\t':
+				ret += "\\t";
+				break;
+			default:
+				if (c.unicode() < 0x20) ret += QString("\\u%1").arg(c.unicode(), 4, 16, QChar('0'));
+				else ret += c;
+				break;
+		}
+	}
+	ret += "\"";
+	return ret;
+}
+
+static QString jsonArray(const QStringList &list)
+{
+	QStringList values;
+	foreach (const QString &str, list) values << jsonString(str);
+	return "[" + values.join(",") + "]";
+}
+
+void JSONLinesExportFormat::writeEntry(ExportWriter &writer, const ConstEntryPointer &entry)
+{
+	QStringList tags;
+	foreach (const Tag &tag, entry->tags()) tags << tag.name();
+	writer << QString("{\"type\":%1,\"id\":%2,\"writings\":%3,\"readings\":%4,\"meanings\":%5,\"tags\":%6}\n").arg(QString::number(entry->type()), QString::number(entry->id()), jsonArray(entry->writings()), jsonArray(entry->readings()), jsonArray(entry->meanings()), jsonArray(tags));
+}
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __GUI_ENTRIES_EXPORTER_H
+#define __GUI_ENTRIES_EXPORTER_H
+
+#include "core/EntriesCache.h"
+
+#include <QThread>
+#include <QIODevice>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QCoreApplication>
+
+/**
+ * Buffered writer for exports. Strings are encoded into UTF-8 and written
+ * to the device by large chunks.
+ */
+class ExportWriter
+{
+private:
+	QIODevice *_device;
+	QByteArray _buffer;
+	bool _error;
+
+public:
+	ExportWriter(QIODevice *device);
+	~ExportWriter();
+
+	ExportWriter &operator<<(const QString &str);
+	ExportWriter &operator<<(const char *str);
+	/// Writes the buffered data to the device
+	bool flush();
+	/// Returns true if writing to the device failed at some point
+	bool error() const { return _error; }
+};
+
+/**
+ * A format entries can be exported to. Formats are registered to
+ * EntriesExporter and are used by a single export at a time.
+ */
+class ExportFormat
+{
+public:
+	virtual ~ExportFormat() {}
+
+	/// Name of the format, as displayed in menus
+	virtual QString name() const = 0;
+	/// File name proposed by default to the user
+	virtual QString defaultFileName() const = 0;
+
+	/**
+	 * Writes the header of the file. Returns false and sets error if the
+	 * export cannot be performed.
+	 */
+	virtual bool begin(ExportWriter &writer, QString &error) { Q_UNUSED(writer); Q_UNUSED(error); return true; }
+	virtual void writeEntry(ExportWriter &writer, const ConstEntryPointer &entry) = 0;
+	/// Writes the footer of the file
+	virtual void end(ExportWriter &writer) { Q_UNUSED(writer); }
+};
+
+/**
+ * Exports a list of entries to a file in a separate thread.
+ *
+ * Entries are loaded by batches from the export thread, so the caller
+ * only has to provide references to them. The progress() signal is
+ * emitted after every batch, and cancel() can be called at any time to
+ * stop the export. Incomplete files are removed.
+ */
+class EntriesExporter : public QThread
+{
+	Q_OBJECT
+private:
+	static QList<ExportFormat *> _formats;
+	static bool _defaultFormatsRegistered;
+
+	ExportFormat *_format;
+	QList<EntryRef> _entries;
+	QString _fileName;
+	QAtomicInt _canceled;
+	bool _success;
+	QString _errorString;
+
+protected:
+	virtual void run();
+
+public:
+	EntriesExporter(ExportFormat *format, const QList<EntryRef> &entries, const QString &fileName, QObject *parent = 0);
+
+	/// Returns true if the last export completed successfully
+	bool success() const { return _success; }
+	bool canceled() const { return _canceled; }
+	const QString &errorString() const { return _errorString; }
+
+	/**
+	 * Returns all the available export formats, the default ones
+	 * being first.
+	 */
+	static const QList<ExportFormat *> &formats();
+	/**
+	 * Register a new export format. The caller remains the owner of the
+	 * format.
+	 *
+	 * @return true if the format has been registered successfully, false if
+	 * it was already registered.
+	 */
+	static bool registerFormat(ExportFormat *format);
+	/**
+	 * Remove a previously registered format.
+	 *
+	 * @return true if the format has been removed successfully, false if it
+	 * was not registered.
+	 */
+	static bool removeFormat(ExportFormat *format);
+
+public slots:
+	void cancel();
+
+signals:
+	/// Emitted after each batch of entries with the number of processed entries
+	void progress(int processed);
+};
+
+/**
+ * Tab-separated values, with the first writing, the readings and the
+ * meanings of each entry.
+ */
+class TSVExportFormat : public ExportFormat
+{
+	Q_DECLARE_TR_FUNCTIONS(TSVExportFormat)
+public:
+	virtual QString name() const { return tr("&TSV"); }
+	virtual QString defaultFileName() const { return "export.tsv"; }
+	virtual void writeEntry(ExportWriter &writer, const ConstEntryPointer &entry);
+};
+
+/**
+ * HTML flashcards, using the export_template.html file.
+ */
+class HTMLExportFormat : public ExportFormat
+{
+	Q_DECLARE_TR_FUNCTIONS(HTMLExportFormat)
+private:
+	/// Part of the template that follows the data
+	QString _tmplEnd;
+
+public:
+	virtual QString name() const { return tr("&HTML"); }
+	virtual QString defaultFileName() const { return "flashcard.html"; }
+	virtual bool begin(ExportWriter &writer, QString &error);
+	virtual void writeEntry(ExportWriter &writer, const ConstEntryPointer &entry);
+	virtual void end(ExportWriter &writer);
+};
+
+/**
+ * Comma-separated values that can be imported into Anki: front, back and
+ * tags of the card.
+ */
+class AnkiExportFormat : public ExportFormat
+{
+	Q_DECLARE_TR_FUNCTIONS(AnkiExportFormat)
+public:
+	virtual QString name() const { return tr("&Anki CSV"); }
+	virtual QString defaultFileName() const { return "anki.csv"; }
+	virtual void writeEntry(ExportWriter &writer, const ConstEntryPointer &entry);
+};
+
+/**
+ * One JSON object per line and per entry.
+ */
+class JSONLinesExportFormat : public ExportFormat
+{
+	Q_DECLARE_TR_FUNCTIONS(JSONLinesExportFormat)
+public:
+	virtual QString name() const { return tr("&JSON Lines"); }
+	virtual QString defaultFileName() const { return "export.jsonl"; }
+	virtual void writeEntry(ExportWriter &writer, const ConstEntryPointer &entry);
+};
+
+#endif
@@ -19,15 +19,24 @@
 
 #include "gui/EntryFormatter.h"
 #include "gui/BookletPrinter.h"
+#include "core/EntriesCache.h"
 
 #include <QPrintPreviewDialog>
 #include <QProgressDialog>
+#include <QFontDatabase>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QCoreApplication>
+#include <QtConcurrentMap>
+#include <QtDebug>
 
 EntriesPrinter::EntriesPrinter(QWidget* parent) : QObject(parent)
 {
 }
 
 #define PRINT_MINIMAL_SPACING 10.0
+/// Number of entries loaded between two updates of the progress dialog
+#define PRINT_LOAD_BATCH 100
 
 void EntriesPrinter::printPageOfEntries(const QList<QPicture> &entries, QPainter *painter, qreal height)
 {
@@ -53,6 +62,69 @@ void EntriesPrinter::printPageOfEntries(const QList<QPicture> &entries, QPainter
 	}
 }
 
+/**
+ * An entry or a label to print, resolved from the model.
+ */
+struct PrintItem
+{
+	ConstEntryPointer entry;
+	/// Entries displayed along with entry, loaded from the GUI thread
+	QList<ConstEntryPointer> dependencies;
+	QString label;
+};
+
+/**
+ * Records the items to print into pictures, whose bounding rectangle is
+ * the space they use. Items that cannot be printed give a null picture.
+ *
+ * Items are recorded from worker threads, so formatters must be reentrant.
+ */
+class PrintItemRecorder
+{
+private:
+	QRectF _pageRect;
+	QFont _baseFont;
+
+public:
+	typedef QPicture result_type;
+
+	PrintItemRecorder(const QRectF &pageRect, const QFont &baseFont) : _pageRect(pageRect), _baseFont(baseFont) {}
+	QPicture operator()(const PrintItem &item) const;
+};
+
+QPicture PrintItemRecorder::operator()(const PrintItem &item) const
+{
+	QRectF usedSpace;
+	QPicture tPicture;
+	QPainter picPainter(&tPicture);
+	// An entry, print it
+	if (item.entry) {
+		const EntryFormatter *formatter(EntryFormatter::getFormatter(item.entry));
+		if (!formatter) return QPicture();
+		formatter->draw(item.entry, item.dependencies, picPainter, _pageRect, usedSpace, _baseFont);
+		if (!_pageRect.contains(usedSpace)) {
+			qDebug() << "Warning: entry does not fit on whole page, giving up this one...";
+			return QPicture();
+		}
+	}
+	// Not an entry, print the text role
+	else {
+		picPainter.save();
+		QFont font;
+		font.setPointSize(font.pointSize() + 10);
+		font.setItalic(true);
+		picPainter.setFont(font);
+		picPainter.drawText(_pageRect, Qt::TextWordWrap | Qt::TextExpandTabs, item.label);
+		usedSpace = picPainter.boundingRect(_pageRect, Qt::TextWordWrap | Qt::TextExpandTabs, item.label);
+		picPainter.drawLine(usedSpace.bottomLeft(), QPointF(_pageRect.right(), usedSpace.bottomRight().y()));
+		usedSpace.moveBottom(usedSpace.bottom() + 3);
+		picPainter.restore();
+	}
+	picPainter.end();
+	tPicture.setBoundingRect(usedSpace.toRect());
+	return tPicture;
+}
+
 void EntriesPrinter::prepareAndPrintJob(QPrinter* printer)
 {
 	int fromPage = -1, toPage = -1;
@@ -67,48 +139,74 @@ void EntriesPrinter::prepareAndPrintJob(QPrinter* printer)
 	progressDialog.setMinimumDuration(50);
 	progressDialog.setWindowTitle(tr("Printing..."));
 	progressDialog.setWindowModality(Qt::WindowModal);
+	// The dialog goes through the entries twice, loading then printing them
+	progressDialog.setAutoReset(false);
+	progressDialog.setAutoClose(false);
 	progressDialog.show();
 
-	// Print entries page by page
-	int pageNbr = 1;
-	QList<QPicture> waitingEntries;
+	// Get all the entries to print first, along with the entries they
+	// display - the model and the database can only be used from the GUI
+	// thread. They are loaded by batches, between which the dialog is
+	// updated.
+	progressDialog.setLabelText(tr("Loading entries..."));
+	QList<PrintItem> items;
+	for (int batch = 0; batch < _entries.size(); batch += PRINT_LOAD_BATCH) {
+		int batchEnd = qMin(batch + PRINT_LOAD_BATCH, _entries.size());
+		QList<EntryRef> refs;
+		for (int i = batch; i < batchEnd; i++) {
+			QVariant ref(_entries[i].data(Entry::EntryRefRole));
+			if (ref.isValid()) refs << ref.value<EntryRef>();
+		}
+		EntriesCache::instance().prefetch(refs);
+		for (int i = batch; i < batchEnd; i++) {
+			const QModelIndex &index(_entries[i]);
+			PrintItem item;
+			item.entry = index.data(Entry::EntryRole).value<EntryPointer>();
+			if (item.entry) {
+				const EntryFormatter *formatter(EntryFormatter::getFormatter(item.entry));
+				if (formatter) item.dependencies = formatter->drawDependencies(item.entry);
+			}
+			else item.label = index.data(Qt::DisplayRole).toString();
+			items << item;
+		}
+		progressDialog.setValue(batchEnd);
+		QCoreApplication::processEvents();
+		if (progressDialog.wasCanceled()) return;
+	}
+	progressDialog.setLabelText(tr("Preparing print job..."));
+	progressDialog.setValue(0);
+
 	QPainter painter(printer);
 	QRectF pageRect = painter.window();
+
+	// Record the entries in parallel if the platform can render text outside
+	// of the GUI thread, otherwise record them one by one as we go.
+	PrintItemRecorder recorder(pageRect, _baseFont);
+	bool threaded = QFontDatabase::supportsThreadedFontRendering();
+	QFutureWatcher<QPicture> watcher;
+	QEventLoop waitLoop;
+	connect(&watcher, SIGNAL(resultReadyAt(int)), &waitLoop, SLOT(quit()));
+	connect(&watcher, SIGNAL(finished()), &waitLoop, SLOT(quit()));
+	connect(&progressDialog, SIGNAL(canceled()), &waitLoop, SLOT(quit()));
+	if (threaded) watcher.setFuture(QtConcurrent::mapped(items, recorder));
+
+	// Lay out the recorded entries in order, printing each page as soon as
+	// it is complete
+	int pageNbr = 1;
+	bool stoppedEarly = false;
+	QList<QPicture> waitingEntries;
 	QRectF remainingSpace = pageRect;
-	for (int i = 0; i < _entries.size(); i++) {
-		if (progressDialog.wasCanceled()) return;
-		QRectF usedSpace;
-		QPicture tPicture;
-		QPainter picPainter(&tPicture);
-		ConstEntryPointer entry = _entries[i].data(Entry::EntryRole).value<EntryPointer>();
-		// An entry, print it
-		if (entry) {
-			const EntryFormatter *formatter(EntryFormatter::getFormatter(entry));
-			if (!formatter) continue;
-			formatter->draw(entry, picPainter, pageRect, usedSpace, _baseFont);
-			if (!pageRect.contains(usedSpace)) {
-				qDebug() << "Warning: entry does not fit on whole page, giving up this one...";
-				continue;
-			}
+	for (int i = 0; i < items.size(); i++) {
+		while (threaded && !watcher.future().isResultReadyAt(i) && !progressDialog.wasCanceled()) waitLoop.exec();
+		if (progressDialog.wasCanceled()) {
+			stoppedEarly = true;
+			break;
 		}
-		// Not an entry, print the text role
-		else {
-			QString label(_entries[i].data(Qt::DisplayRole).toString());
-			picPainter.save();
-			QFont font;
-			font.setPointSize(font.pointSize() + 10);
-			font.setItalic(true);
-			picPainter.setFont(font);
-			picPainter.drawText(pageRect, Qt::TextWordWrap | Qt::TextExpandTabs, label);
-			usedSpace = picPainter.boundingRect(pageRect, Qt::TextWordWrap | Qt::TextExpandTabs, label);
-			picPainter.drawLine(usedSpace.bottomLeft(), QPointF(pageRect.right(), usedSpace.bottomRight().y()));
-			usedSpace.moveBottom(usedSpace.bottom() + 3);
-			picPainter.restore();
-		}
-		picPainter.end();
-		tPicture.setBoundingRect(usedSpace.toRect());
+		QPicture tPicture(threaded ? watcher.resultAt(i) : recorder(items[i]));
+		if (tPicture.isNull()) continue;
+		qreal height = tPicture.boundingRect().height();
 		// Do we need a new page here?
-		if (remainingSpace.height() < usedSpace.height()) {
+		if (remainingSpace.height() < height) {
 			// Print the current page
 			if (fromPage == -1 || (pageNbr >= fromPage && pageNbr <= toPage)) {
 				// If not on the first page, get a new page
@@ -119,14 +217,23 @@ void EntriesPrinter::prepareAndPrintJob(QPrinter* printer)
 			waitingEntries.clear();
 			++pageNbr;
 			// Optimize if we already reached the last page
-			if (fromPage != -1 && pageNbr > toPage) return;
+			if (fromPage != -1 && pageNbr > toPage) {
+				stoppedEarly = true;
+				break;
+			}
 		}
 		waitingEntries << tPicture;
 		// Update remaining space, taking care to keep some white between entries
-		remainingSpace.setTop(remainingSpace.top() + usedSpace.height() + PRINT_MINIMAL_SPACING);
+		remainingSpace.setTop(remainingSpace.top() + height + PRINT_MINIMAL_SPACING);
 
 		progressDialog.setValue(i);
 	}
+	// Do not leave workers running on entries we do not need anymore. The
+	// future may still be running after its last result has been consumed,
+	// so only cancel it if we did not go through all the items.
+	if (stoppedEarly) watcher.cancel();
+	watcher.waitForFinished();
+	if (stoppedEarly) return;
 
 	if (fromPage == -1 || (pageNbr >= fromPage && pageNbr <= toPage)) {
 		if (pageNbr > 1 && pageNbr > fromPage) printer->newPage();
@@ -22,6 +22,7 @@
 #include "gui/EditEntryNotesDialog.h"
 #include "gui/TagsDialogs.h"
 #include "gui/EntriesPrinter.h"
+#include "gui/EntriesExporter.h"
 #include "gui/BatchHandler.h"
 
 #include <QAction>
@@ -37,8 +38,9 @@
 #include <QToolButton>
 #include <QApplication>
 #include <QClipboard>
+#include <QEventLoop>
 
-EntriesViewHelper::EntriesViewHelper(QAbstractItemView* client, EntryDelegateLayout* delegateLayout, bool workOnSelection, bool viewOnly) : EntryMenu(client), _client(client), _entriesMenu(), _workOnSelection(workOnSelection), _actionPrint(QIcon(":/images/icons/print.png"), tr("&Print..."), 0), _actionPrintPreview(QIcon(":/images/icons/print.png"), tr("Print p&review..."), 0), _actionPrintBooklet(QIcon(":/images/icons/print.png"), tr("Print &booklet..."), 0), _actionPrintBookletPreview(QIcon(":/images/icons/print.png"), tr("Booklet pre&view..."), 0), _actionExportTab(QIcon(":/images/icons/document-export.png"), tr("Export as &TSV..."), 0), _actionExportJs(QIcon(":/images/icons/document-export.png"), tr("Export as &HTML..."), 0), prefRefs(MAX_PREF), _contextMenu()
+EntriesViewHelper::EntriesViewHelper(QAbstractItemView* client, EntryDelegateLayout* delegateLayout, bool workOnSelection, bool viewOnly) : EntryMenu(client), _client(client), _entriesMenu(), _workOnSelection(workOnSelection), _actionPrint(QIcon(":/images/icons/print.png"), tr("&Print..."), 0), _actionPrintPreview(QIcon(":/images/icons/print.png"), tr("Print p&review..."), 0), _actionPrintBooklet(QIcon(":/images/icons/print.png"), tr("Print &booklet..."), 0), _actionPrintBookletPreview(QIcon(":/images/icons/print.png"), tr("Booklet pre&view..."), 0), prefRefs(MAX_PREF), _contextMenu()
 {
 	client->installEventFilter(this);
 	client->viewport()->installEventFilter(this);
@@ -63,16 +65,18 @@ EntriesViewHelper::EntriesViewHelper(QAbstractItemView* client, EntryDelegateLay
 	connect(&_actionPrintBooklet, SIGNAL(triggered()), this, SLOT(printBooklet()));
 	connect(&_actionPrintPreview, SIGNAL(triggered()), this, SLOT(printPreview()));
 	connect(&_actionPrintBookletPreview, SIGNAL(triggered()), this, SLOT(printBookletPreview()));
-	connect(&_actionExportTab, SIGNAL(triggered()), this, SLOT(tabExport()));
-	connect(&_actionExportJs, SIGNAL(triggered()), this, SLOT(jsExport()));
 		
 	_entriesMenu.addAction(&_actionPrint);
 	_entriesMenu.addAction(&_actionPrintPreview);
 	_entriesMenu.addAction(&_actionPrintBooklet);
 	_entriesMenu.addAction(&_actionPrintBookletPreview);
 	_entriesMenu.addSeparator();
-	_entriesMenu.addAction(&_actionExportTab);
-	_entriesMenu.addAction(&_actionExportJs);
+	const QList<ExportFormat *> &exportFormats(EntriesExporter::formats());
+	for (int i = 0; i < exportFormats.size(); i++) {
+		QAction *action = _entriesMenu.addAction(QIcon(":/images/icons/document-export.png"), tr("Export as %1...").arg(exportFormats[i]->name()));
+		action->setProperty("TJexportFormatIndex", i);
+		connect(action, SIGNAL(triggered()), this, SLOT(exportEntries()));
+	}
 	
 	// If the view is editable, the helper menu shall be enabled
 	if (!viewOnly) {
@@ -318,9 +322,9 @@ QModelIndexList EntriesViewHelper::getAllIndexes(const QModelIndexList& indexes,
 		if (alreadyIn.contains(idx)) continue;
 		ret << idx;
 		alreadyIn << idx;
-		// Entries can be put directly into the return list
-		ConstEntryPointer entry(idx.data(Entry::EntryRole).value<EntryPointer>());
-		if (!entry) {
+		// Entries can be put directly into the return list. Only look at
+		// their reference so they do not need to be loaded.
+		if (!idx.data(Entry::EntryRefRole).isValid()) {
 			// Non entries indexes must be list - see if they have children
 			QModelIndexList childs;
 			int childsCount = idx.model()->rowCount(idx);
@@ -374,104 +378,39 @@ void EntriesViewHelper::printBookletPreview()
 	EntriesPrinter(client()).printBookletPreview(getEntriesToProcess(printer.printRange() & QPrinter::Selection), &printer);
 }
 
-void EntriesViewHelper::tabExport()
-{
-	QString exportFile = QFileDialog::getSaveFileName(0, tr("Export to tab-separated file..."), "export.tsv");
-	if (exportFile.isEmpty()) return;
-	QFile outFile(exportFile);
-	if (!outFile.open(QIODevice::WriteOnly)) {
-		QMessageBox::warning(0, tr("Cannot write file"), QString(tr("Unable to write file %1.")).arg(exportFile));
-		return;
-	}
-
-	QModelIndexList entries(getEntriesToProcess());
-
-	// Dummy entry to notify Anki that tab is our delimiter
-	//outFile.write("\t\t\n");
-	foreach (const QModelIndex &idx, entries) {
-		ConstEntryPointer entry(idx.data(Entry::EntryRole).value<EntryPointer>());
-		// We cannot "export" lists due to the file purpose
-		if (!entry) continue;
-		QStringList writings = entry->writings();
-		QStringList readings = entry->readings();
-		QStringList meanings = entry->meanings();
-		QString writing;
-		QString reading;
-		QString meaning;
-		if (writings.size() > 0) writing = writings[0];
-		if (readings.size() > 0) reading = readings[0];
-		if (meanings.size() == 1) meaning += " " + meanings[0];
-		else {
-			int cpt = 1;
-			foreach (const QString &str, meanings)
-				meaning += QString(" (%1) %2").arg(cpt++).arg(str);
-		}
-		if (outFile.write(QString("%1\t%2\t%3\n").arg(writing).arg(readings.join(", ")).arg(meanings.join(", ")).toUtf8()) == -1) {
-			QMessageBox::warning(0, tr("Error writing file"), QString(tr("Error while writing file %1.")).arg(exportFile));
-			return;
-		}
-	}
-
-	outFile.close();
-}
-
-static QString escapeQuotes(const QString &str)
+void EntriesViewHelper::exportEntries()
 {
-	QString ret(str);
-	return ret.replace('"', "&quot;");
-}
-
-void EntriesViewHelper::jsExport()
-{
-	QString exportFile = QFileDialog::getSaveFileName(0, tr("Export to HTML flashcard file..."), "flashcard.html");
+	int formatIndex = qobject_cast<QAction *>(sender())->property("TJexportFormatIndex").toInt();
+	ExportFormat *format = EntriesExporter::formats().value(formatIndex);
+	if (!format) return;
+	QString formatName(format->name().remove('&'));
+	QString exportFile = QFileDialog::getSaveFileName(0, tr("Export as %1...").arg(formatName), format->defaultFileName());
 	if (exportFile.isEmpty()) return;
-	QFile outFile(exportFile);
-	if (!outFile.open(QIODevice::WriteOnly)) {
-		QMessageBox::warning(0, tr("Cannot write file"), QString(tr("Unable to write file %1!")).arg(exportFile));
-		return;
-	}
 
-	QModelIndexList entries(getEntriesToProcess());
-	QList<ConstEntryPointer> realEntries;
-
-	foreach (const QModelIndex &idx, entries) {
-		ConstEntryPointer entry(idx.data(Entry::EntryRole).value<EntryPointer>());
+	// Only collect the references here, entries are loaded by the export thread
+	QList<EntryRef> entries;
+	foreach (const QModelIndex &idx, getEntriesToProcess()) {
+		EntryRef ref(idx.data(Entry::EntryRefRole).value<EntryRef>());
 		// We cannot "export" lists due to the file purpose
-		if (!entry) continue;
-		realEntries << entry;
-	}
-	
-	QFile tmplFile(lookForFile("export_template.html"));
-	if (!tmplFile.open(QIODevice::ReadOnly)) {
-		QMessageBox::warning(0, tr("Cannot open template file"), QString(tr("Unable to open template file!")).arg(exportFile));
-		return;
+		if (!ref.isValid()) continue;
+		entries << ref;
 	}
-	
-	QString tmpl(QString::fromUtf8(tmplFile.readAll()));
-	
-	int idx = 0;
-	QString data(QString("var entries = Array();\nfor (var i = 0; i < %1; i++) entries[i] = Array();\n").arg(realEntries.size()).toUtf8());
-	foreach (const ConstEntryPointer &entry, realEntries) {
-		QStringList readings = entry->readings();
-		QStringList meanings = entry->meanings();
-		QString mainRepr(escapeQuotes(entry->mainRepr()));
-		readings.removeAll(mainRepr);
-		QString reading;
-		QString meaning;
-		if (readings.size() > 0) reading = escapeQuotes(readings.join(", "));
-		if (meanings.size() == 1) meaning = escapeQuotes(meanings[0]);
-		else {
-			int cpt = 1;
-			foreach (const QString &str, meanings)
-				meaning += QString(" (%1) %2").arg(cpt++).arg(escapeQuotes(str));
-		}
-		data += QString("entries[%1][0]=\"%2\";\nentries[%1][1]=\"%3\";\nentries[%1][2]=\"%4\";\n").arg(idx++).arg(mainRepr).arg(reading).arg(meaning);
-	}
-	
-	tmpl.replace("__DATA__", data);
-	outFile.write(tmpl.toUtf8());
 
-	outFile.close();
+	EntriesExporter exporter(format, entries, exportFile);
+	QProgressDialog progressDialog(tr("Exporting entries..."), tr("Abort"), 0, entries.size(), client());
+	progressDialog.setMinimumDuration(500);
+	progressDialog.setWindowTitle(tr("Please wait..."));
+	progressDialog.setWindowModality(Qt::WindowModal);
+	connect(&exporter, SIGNAL(progress(int)), &progressDialog, SLOT(setValue(int)));
+	connect(&progressDialog, SIGNAL(canceled()), &exporter, SLOT(cancel()), Qt::DirectConnection);
+	QEventLoop waitLoop;
+	connect(&exporter, SIGNAL(finished()), &waitLoop, SLOT(quit()));
+	exporter.start();
+	waitLoop.exec();
+	exporter.wait();
+
+	if (!exporter.success() && !exporter.canceled())
+		QMessageBox::warning(0, tr("Error writing file"), exporter.errorString());
 }
 
 bool EntriesViewHelper::eventFilter(QObject *obj, QEvent *ev)
@@ -42,7 +42,7 @@ private:
 	EntryDelegateLayout *_delegateLayout;
 	QMenu _entriesMenu;
 	bool _workOnSelection;
-	QAction _actionPrint, _actionPrintPreview, _actionPrintBooklet, _actionPrintBookletPreview, _actionExportTab, _actionExportJs;
+	QAction _actionPrint, _actionPrintPreview, _actionPrintBooklet, _actionPrintBookletPreview;
 	QVector<PreferenceRoot *> prefRefs;
 	QMenu _contextMenu;
 
@@ -146,8 +146,11 @@ public slots:
 	void printBooklet();
 	void printBookletPreview();
 
-	void jsExport();
-	void tabExport();
+	/**
+	 * Exports the entries using the format of the action that
+	 * sent the signal.
+	 */
+	void exportEntries();
 };
 
 #endif
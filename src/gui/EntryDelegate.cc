@@ -20,25 +20,81 @@
 #include <QPainter>
 #include <QApplication>
 
-EntryDelegateLayout::EntryDelegateLayout(QObject* parent, EntryDelegateLayout::DisplayMode displayMode, const QString& textFont, const QString& kanjiFont, const QString& kanaFont) : QObject(parent), _displayMode(displayMode)
+/// Maximum number of entry texts kept by a layout
+#define TEXT_LAYOUTS_CACHE_SIZE 10000
+
+EntryDelegateLayout::EntryDelegateLayout(QObject* parent, EntryDelegateLayout::DisplayMode displayMode, const QString& textFont, const QString& kanjiFont, const QString& kanaFont) : QObject(parent), _displayMode(displayMode), _textLayouts(TEXT_LAYOUTS_CACHE_SIZE)
 {
 	_font[DefaultText].fromString(textFont);
 	_font[Kanji].fromString(kanjiFont);
 	_font[Kana].fromString(kanaFont);
+	updateMetrics();
+}
+
+void EntryDelegateLayout::updateMetrics()
+{
+	QFontMetrics kanjiMetrics(kanjiFont()), kanaMetrics(kanaFont()), textMetrics(textFont());
+	int japaneseHeight = qMax(kanjiMetrics.height(), kanaMetrics.height());
+	_topLineAscent = qMax(kanjiMetrics.ascent(), kanaMetrics.ascent());
+	_bottomLineBaseline = japaneseHeight + textMetrics.ascent();
+	if (_displayMode == OneLine) {
+		_topLineAscent = qMax(_topLineAscent, textMetrics.ascent());
+		_rowHeight = qMax(japaneseHeight, textMetrics.height());
+	}
+	else _rowHeight = japaneseHeight + textMetrics.height();
+	_textLayouts.clear();
 }
 
 void EntryDelegateLayout::setFont(FontRole role, const QFont &font)
 {
 	_font[role] = font;
+	updateMetrics();
 	emit layoutHasChanged();
 }
 
 void EntryDelegateLayout::setDisplayMode(DisplayMode mode)
 {
 	_displayMode = mode;
+	updateMetrics();
 	emit layoutHasChanged();
 }
 
+const EntryDelegateLayout::TextLayout *EntryDelegateLayout::textLayout(const EntryPointer &entry, int width) const
+{
+	EntryRef ref(entry);
+	EntryTextLayouts *layouts = _textLayouts.object(ref);
+	if (!layouts) return 0;
+	TextLayout *layout = layouts->widths.value(width);
+	if (!layout) return 0;
+	// Texts computed from another instance of the entry may not have seen
+	// its changes, and neither have its texts for other widths
+	if (layout->entry.toStrongRef() != entry || layout->prefsStamp != PreferenceRoot::changesCount()) {
+		_textLayouts.remove(ref);
+		return 0;
+	}
+	return layout;
+}
+
+void EntryDelegateLayout::setTextLayout(const EntryPointer &entry, int width, TextLayout *layout) const
+{
+	layout->entry = entry;
+	layout->prefsStamp = PreferenceRoot::changesCount();
+	EntryRef ref(entry);
+	// Take the texts out of the cache so that they can be inserted again
+	// with their new cost
+	EntryTextLayouts *layouts = _textLayouts.take(ref);
+	if (!layouts) layouts = new EntryTextLayouts;
+	delete layouts->widths.value(width);
+	layouts->widths[width] = layout;
+	_textLayouts.insert(ref, layouts, layouts->widths.size());
+	connect(entry.data(), SIGNAL(entryChanged(Entry *)), const_cast<EntryDelegateLayout *>(this), SLOT(onEntryChanged(Entry *)), Qt::UniqueConnection);
+}
+
+void EntryDelegateLayout::onEntryChanged(Entry *entry)
+{
+	_textLayouts.remove(EntryRef(entry->type(), entry->id()));
+}
+
 void EntryDelegateLayout::updateConfig(const QVariant &value)
 {
 	PreferenceRoot *from = qobject_cast<PreferenceRoot *>(sender());
@@ -63,57 +119,21 @@ QSize EntryDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIn
 		QVariant sizeHint(index.model()->data(index, Qt::SizeHintRole));
 		if (!sizeHint.isNull() && sizeHint.type() == QVariant::Size) maxHeight = sizeHint.toSize().height();
 	}
-	if (maxHeight < 0) {
-		if (layout->displayMode() == EntryDelegateLayout::OneLine) maxHeight = qMax(QFontMetrics(layout->kanjiFont()).height(), qMax(QFontMetrics(layout->kanaFont()).height(), QFontMetrics(layout->textFont()).height()));
-		else maxHeight = qMax(QFontMetrics(layout->kanjiFont()).height(), QFontMetrics(layout->kanaFont()).height()) + QFontMetrics(layout->textFont()).height();
-	}
+	if (maxHeight < 0) maxHeight = layout->rowHeight();
 	// This margin is added by the paint method
 	maxHeight += 4;
 	return QSize(300, maxHeight);
 }
 
-void EntryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+void EntryDelegate::layoutTexts(QPainter *painter, const EntryPointer &entry, const QRect &rect, EntryDelegateLayout::TextLayout &texts) const
 {
-	EntryPointer entry = index.data(Entry::EntryRole).value<EntryPointer>();
-	if (!entry) { QStyledItemDelegate::paint(painter, option, index); return; }
-
-	QRect rect = option.rect.adjusted(2, 2, -2, 2);
-	//QRect rect = option.rect.adjusted(2, 0, -2, 0);
-	painter->save();
-
-	QColor textColor;
-	if (option.state & QStyle::State_Selected) {
-		if (QApplication::style()->styleHint(QStyle::SH_ItemView_ChangeHighlightOnFocus, &option) && !(option.state & QStyle::State_HasFocus)) textColor = option.palette.color(QPalette::Inactive, QPalette::Text);
-		else if (!(option.state & QStyle::State_HasFocus)) textColor = option.palette.color(QPalette::Inactive, QPalette::HighlightedText);
-		else textColor = option.palette.color(QPalette::Active, QPalette::HighlightedText);
-	}
-	else {
-		// If the entry is trained, the background color is fixed because we know the background color
-		if (entry->trained()) textColor = Qt::black;
-		else textColor = option.palette.color(QPalette::Text);
-	}
-
-	// Draw the background
-	QStyleOptionViewItemV4 opt = option;
-	initStyleOption(&opt, index);
-	QStyle *style = QApplication::style();
-	style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter);
-
-	int topLineAscent;
-	if (layout->displayMode() == EntryDelegateLayout::OneLine) {
-		topLineAscent = qMax(qMax(QFontMetrics(layout->kanjiFont()).ascent(), QFontMetrics(layout->kanaFont()).ascent()), QFontMetrics(layout->textFont()).ascent());
-	} else {
-		topLineAscent = qMax(QFontMetrics(layout->kanjiFont()).ascent(), QFontMetrics(layout->kanaFont()).ascent());
-	}
 	QRect bbox;
-	painter->setPen(textColor);
 	painter->setFont(layout->kanjiFont());
 	QString mainRepr(entry->mainRepr());
 	QStringList writings(entry->writings());
 	QStringList readings(entry->readings());
 	bbox = painter->boundingRect(rect, 0, mainRepr);
-	painter->drawText(QPoint(rect.left(), rect.top() + topLineAscent),
-	          mainRepr);
+	texts.mainRepr = mainRepr;
 	// Used for alternate writings and readings
 	QString s = " ";
 	if (layout->displayMode() == EntryDelegateLayout::OneLine) {
@@ -133,7 +153,8 @@ void EntryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
 	QRect rect2(rect);
 	rect2.setLeft(bbox.right());
 	QRect bbox2 = painter->boundingRect(rect2, 0, s);
-	painter->drawText(QPoint(bbox.right(), rect.top() + topLineAscent), s);
+	texts.readings = s;
+	texts.readingsPos = bbox.right() - rect.left();
 
 	s.clear();
 	if (entry->meanings().size() == 1) {
@@ -144,15 +165,61 @@ void EntryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
 		s += QString("(%1) %2 ").arg(i + 1).arg(entry->meanings()[i]);
 	}
 	painter->setFont(layout->textFont());
-	if (layout->displayMode() == EntryDelegateLayout::OneLine) {
-		s = QFontMetrics(layout->textFont()).elidedText(s, Qt::ElideRight, rect.width() - (bbox.width() + bbox2.width()));
-		painter->drawText(QPoint(bbox2.right(), rect.top() + topLineAscent), s);
-	} else {
-		s = QFontMetrics(layout->textFont()).elidedText(s, Qt::ElideRight, rect.width());
-		painter->drawText(QPoint(rect.left(), rect.top() +
-				qMax(QFontMetrics(layout->kanjiFont()).height(), QFontMetrics(layout->kanaFont()).height()) + QFontMetrics(layout->textFont()).ascent()), s);
+	if (layout->displayMode() == EntryDelegateLayout::OneLine) s = QFontMetrics(layout->textFont()).elidedText(s, Qt::ElideRight, rect.width() - (bbox.width() + bbox2.width()));
+	else s = QFontMetrics(layout->textFont()).elidedText(s, Qt::ElideRight, rect.width());
+	texts.meanings = s;
+	texts.meaningsPos = bbox2.right() - rect.left();
+}
+
+void EntryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	EntryPointer entry = index.data(Entry::EntryRole).value<EntryPointer>();
+	if (!entry) { QStyledItemDelegate::paint(painter, option, index); return; }
+
+	QRect rect = option.rect.adjusted(2, 2, -2, 2);
+	//QRect rect = option.rect.adjusted(2, 0, -2, 0);
+	painter->save();
+
+	QColor textColor;
+	if (option.state & QStyle::State_Selected) {
+		if (QApplication::style()->styleHint(QStyle::SH_ItemView_ChangeHighlightOnFocus, &option) && !(option.state & QStyle::State_HasFocus)) textColor = option.palette.color(QPalette::Inactive, QPalette::Text);
+		else if (!(option.state & QStyle::State_HasFocus)) textColor = option.palette.color(QPalette::Inactive, QPalette::HighlightedText);
+		else textColor = option.palette.color(QPalette::Active, QPalette::HighlightedText);
+	}
+	else {
+		// If the entry is trained, the background color is fixed because we know the background color
+		if (entry->trained()) textColor = Qt::black;
+		else textColor = option.palette.color(QPalette::Text);
+	}
+
+	// Draw the background
+	QStyleOptionViewItemV4 opt = option;
+	initStyleOption(&opt, index);
+	QStyle *style = QApplication::style();
+	style->drawPrimitive(QStyle::PE_PanelItemViewItem, &opt, painter);
+
+	// Eliding and measuring the texts is costly, so it is only done once
+	// per entry and width
+	const EntryDelegateLayout::TextLayout *texts = layout->textLayout(entry, rect.width());
+	if (!texts) {
+		EntryDelegateLayout::TextLayout *newTexts = new EntryDelegateLayout::TextLayout;
+		layoutTexts(painter, entry, rect, *newTexts);
+		layout->setTextLayout(entry, rect.width(), newTexts);
+		texts = newTexts;
 	}
 
+	int topLineAscent = layout->topLineAscent();
+	painter->setPen(textColor);
+	painter->setFont(layout->kanjiFont());
+	painter->drawText(QPoint(rect.left(), rect.top() + topLineAscent), texts->mainRepr);
+	painter->setFont(layout->kanaFont());
+	painter->drawText(QPoint(rect.left() + texts->readingsPos, rect.top() + topLineAscent), texts->readings);
+	painter->setFont(layout->textFont());
+	if (layout->displayMode() == EntryDelegateLayout::OneLine)
+		painter->drawText(QPoint(rect.left() + texts->meaningsPos, rect.top() + topLineAscent), texts->meanings);
+	else
+		painter->drawText(QPoint(rect.left(), rect.top() + layout->bottomLineBaseline()), texts->meanings);
+
 	// Now display property icons if the entry has any.
 	int iconPos = rect.right() - 5;
 	if (!entry->notes().isEmpty() && !isHidden(NOTES_ICON)) {
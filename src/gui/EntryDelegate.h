@@ -20,6 +20,8 @@
 
 #include "core/EntriesCache.h"
 #include <QStyledItemDelegate>
+#include <QCache>
+#include <QHash>
 
 class EntryDelegateLayout : public QObject
 {
@@ -27,13 +29,46 @@ class EntryDelegateLayout : public QObject
 public:
 	typedef enum { DefaultText = 0, Kana, Kanji, MAX_FONTS } FontRole;
 	typedef enum { OneLine = 0, TwoLines, MAX_MODES } DisplayMode;
-	
+
+	/**
+	 * Texts of an entry as painted by EntryDelegate, already elided to fit
+	 * a given width. Positions are relative to the left of the row.
+	 */
+	struct TextLayout
+	{
+		/// Instance the texts have been computed from
+		QWeakPointer<Entry> entry;
+		int prefsStamp;
+		QString mainRepr;
+		QString readings;
+		QString meanings;
+		int readingsPos;
+		int meaningsPos;
+	};
+
 private:
 	QFont _font[MAX_FONTS];
 	DisplayMode _displayMode;
+	int _topLineAscent;
+	int _bottomLineBaseline;
+	int _rowHeight;
+	/// Texts of an entry, by width
+	struct EntryTextLayouts
+	{
+		QHash<int, TextLayout *> widths;
+		~EntryTextLayouts() { qDeleteAll(widths); }
+	};
+	/// Keyed by entry so that the texts of a changed entry are dropped at
+	/// once. The cost of an entry is its number of widths.
+	mutable QCache<EntryRef, EntryTextLayouts> _textLayouts;
 
 	void _fontsChanged();
 	QFont _defaultFont(FontRole role) const;
+	/// Updates the font metrics and drops the cached layouts
+	void updateMetrics();
+
+private slots:
+	void onEntryChanged(Entry *entry);
 
 public:
 	EntryDelegateLayout(QObject* parent = 0, EntryDelegateLayout::DisplayMode displayMode = OneLine, const QString& textFont = "", const QString& kanjiFont = "", const QString& kanaFont = "");
@@ -42,6 +77,18 @@ public:
 	const QFont &kanaFont() const { return _font[Kana]; }
 	const QFont &kanjiFont() const { return _font[Kanji]; }
 	DisplayMode displayMode() const { return _displayMode; }
+	/// Baseline of the writings, and of the meanings in one line mode
+	int topLineAscent() const { return _topLineAscent; }
+	/// Baseline of the meanings in two lines mode
+	int bottomLineBaseline() const { return _bottomLineBaseline; }
+	/// Height of a row, without margins
+	int rowHeight() const { return _rowHeight; }
+
+	/// Returns the cached texts of entry for the given width, or 0 if they are not available
+	const TextLayout *textLayout(const EntryPointer &entry, int width) const;
+	/// Caches the texts of entry for the given width. The cache takes ownership of layout.
+	void setTextLayout(const EntryPointer &entry, int width, TextLayout *layout) const;
+	void clearTextLayouts() { _textLayouts.clear(); }
 
 	void setFont(FontRole role, const QFont &font);
 	void setDisplayMode(DisplayMode mode);
@@ -74,6 +121,8 @@ protected:
 	 * Used to prevent displaying some icons in views where they are implicit, e.g. list views
 	 */
 	quint8 _hiddenIcons;
+	/// Computes the texts of entry as they are painted into rect
+	void layoutTexts(QPainter *painter, const EntryPointer &entry, const QRect &rect, EntryDelegateLayout::TextLayout &texts) const;
 
 public:
 	EntryDelegate(EntryDelegateLayout *dLayout, QObject *parent = 0);
@@ -91,7 +91,12 @@ void EntryFormatter::drawInfo(const ConstEntryPointer &entry, QPainter &painter,
 	}
 }
 
-void EntryFormatter::draw(const ConstEntryPointer& entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont) const
+QList<ConstEntryPointer> EntryFormatter::drawDependencies(const ConstEntryPointer &entry) const
+{
+	return QList<ConstEntryPointer>();
+}
+
+void EntryFormatter::draw(const ConstEntryPointer& entry, const QList<ConstEntryPointer> &dependencies, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont) const
 {
 	painter.save();
 
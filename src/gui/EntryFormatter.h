@@ -72,12 +72,27 @@ public:
 	 */
 	static QString buildSubInfoBlock(const QString &title, const QString &content);
 
+	/**
+	 * Returns the entries that draw() displays along with entry, e.g. the
+	 * kanji of a word. This may access the database, and must therefore be
+	 * called from the GUI thread.
+	 *
+	 * The default version returns no entry.
+	 */
+	virtual QList<ConstEntryPointer> drawDependencies(const ConstEntryPointer &entry) const;
+
 	/**
 	 * Paints this entry using the given painter into the given rectangle.
+	 * dependencies must be the result of drawDependencies() for entry.
 	 *
 	 * The default version just paints the short version.
+	 *
+	 * This method is called from printing worker threads and must be
+	 * reentrant. It must not access the database: everything it needs is
+	 * in dependencies, which also keep the entries it displays in the
+	 * entries cache.
 	 */
-	virtual void draw(const ConstEntryPointer &entry, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const;
+	virtual void draw(const ConstEntryPointer &entry, const QList<ConstEntryPointer> &dependencies, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const;
 
 	static PreferenceItem<bool> shortDescShowJLPT;
 
@@ -29,6 +29,7 @@
 #include "gui/YesNoTrainer.h"
 #include "gui/ScrollBarSmoothScroller.h"
 #include "gui/TextFilterWidget.h"
+#include "gui/QueryLogDialog.h"
 #include "gui/MainWindow.h"
 #include "gui/ui_AboutDialog.h"
 
@@ -113,6 +114,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), _clipboardEnabled
 	_searchMenu->addSeparator();
 	setupSearchWidget();
 	setupListWidget();
+
+	// Debugging tool to find the queries that slow the program down
+	_helpMenu->addSeparator();
+	_helpMenu->addAction(tr("&Slow queries..."), this, SLOT(showQueryLog()));
 	
 	// Updates checker
 	_updateChecker = new UpdateChecker("/updates/latestversion.php", this);
@@ -271,6 +276,12 @@ void MainWindow::donate()
 	QDesktopServices::openUrl(QUrl("http://www.tagaini.net/donate"));
 }
 
+void MainWindow::showQueryLog()
+{
+	QueryLogDialog dialog(this);
+	dialog.exec();
+}
+
 void MainWindow::about()
 {
 #ifndef VERSION
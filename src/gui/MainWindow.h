@@ -99,6 +99,8 @@ protected slots:
 
 	void organizeSavedSearches();
 
+	void showQueryLog();
+
 	void about();
 	void donate();
 	void manual();
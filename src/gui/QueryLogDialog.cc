@@ -0,0 +1,148 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gui/QueryLogDialog.h"
+#include "core/Paths.h"
+#include "core/ResultsCache.h"
+
+#include <QDir>
+#include <QPushButton>
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QSplitter>
+
+PreferenceItem<QByteArray> QueryLogDialog::windowGeometry("queryLogWindow", "geometry", "");
+PreferenceItem<bool> QueryLogDialog::enabled("debug/queryLog", "enabled", false);
+PreferenceItem<int> QueryLogDialog::threshold("debug/queryLog", "threshold", 100);
+PreferenceItem<bool> QueryLogDialog::explain("debug/queryLog", "explain", true);
+
+void QueryLogDialog::applyPreferences()
+{
+	SQLite::QueryProfiler::setLogFile(QDir(userProfile()).absoluteFilePath("queries.log"));
+	SQLite::QueryProfiler::setThreshold(threshold.value());
+	SQLite::QueryProfiler::setExplain(explain.value());
+	SQLite::QueryProfiler::setEnabled(enabled.value());
+}
+
+QueryLogDialog::QueryLogDialog(QWidget *parent) : QDialog(parent)
+{
+	restoreGeometry(windowGeometry.value());
+	setWindowTitle(tr("Slow queries"));
+
+	_enabled = new QCheckBox(tr("&Record queries slower than"), this);
+	_enabled->setChecked(SQLite::QueryProfiler::enabled());
+	_threshold = new QSpinBox(this);
+	_threshold->setRange(0, 60000);
+	_threshold->setSuffix(tr(" ms"));
+	_threshold->setValue(SQLite::QueryProfiler::threshold());
+	_explain = new QCheckBox(tr("&Explain query plans"), this);
+	_explain->setChecked(SQLite::QueryProfiler::explain());
+	connect(_enabled, SIGNAL(toggled(bool)), this, SLOT(onSettingsChanged()));
+	connect(_threshold, SIGNAL(valueChanged(int)), this, SLOT(onSettingsChanged()));
+	connect(_explain, SIGNAL(toggled(bool)), this, SLOT(onSettingsChanged()));
+
+	_queries = new QTreeWidget(this);
+	_queries->setRootIsDecorated(false);
+	_queries->setHeaderLabels(QStringList() << tr("Date") << tr("Time (ms)") << tr("Rows") << tr("Fullscan steps") << tr("Sorts") << tr("Autoindexes") << tr("VM steps") << tr("Query"));
+	connect(_queries, SIGNAL(currentItemChanged(QTreeWidgetItem *, QTreeWidgetItem *)), this, SLOT(onCurrentItemChanged(QTreeWidgetItem *)));
+	_details = new QPlainTextEdit(this);
+	_details->setReadOnly(true);
+	_details->setLineWrapMode(QPlainTextEdit::WidgetWidth);
+	QSplitter *splitter = new QSplitter(Qt::Vertical, this);
+	splitter->addWidget(_queries);
+	splitter->addWidget(_details);
+
+	QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, this);
+	connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+	QPushButton *button = buttonBox->addButton(tr("R&efresh"), QDialogButtonBox::ActionRole);
+	connect(button, SIGNAL(clicked()), this, SLOT(refresh()));
+	button = buttonBox->addButton(tr("&Clear"), QDialogButtonBox::ActionRole);
+	connect(button, SIGNAL(clicked()), this, SLOT(clearLog()));
+
+	QHBoxLayout *settingsLayout = new QHBoxLayout();
+	settingsLayout->addWidget(_enabled);
+	settingsLayout->addWidget(_threshold);
+	settingsLayout->addWidget(_explain);
+	settingsLayout->addStretch();
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	layout->addLayout(settingsLayout);
+	layout->addWidget(splitter, 1);
+	_resultsCacheStats = new QLabel(this);
+	layout->addWidget(_resultsCacheStats);
+	if (!SQLite::QueryProfiler::logFile().isEmpty())
+		layout->addWidget(new QLabel(tr("Slow queries are also written to %1").arg(QDir::toNativeSeparators(SQLite::QueryProfiler::logFile())), this));
+	layout->addWidget(buttonBox);
+
+	refresh();
+}
+
+QueryLogDialog::~QueryLogDialog()
+{
+	windowGeometry.set(saveGeometry());
+}
+
+void QueryLogDialog::onSettingsChanged()
+{
+	enabled.set(_enabled->isChecked());
+	threshold.set(_threshold->value());
+	explain.set(_explain->isChecked());
+	applyPreferences();
+}
+
+void QueryLogDialog::refresh()
+{
+	_profiles = SQLite::QueryProfiler::recent();
+	_queries->clear();
+	_details->clear();
+	// Most recent first
+	for (int i = _profiles.size() - 1; i >= 0; i--) {
+		const SQLite::QueryProfile &profile = _profiles[i];
+		QTreeWidgetItem *item = new QTreeWidgetItem(_queries);
+		item->setText(0, profile.date.toString(Qt::ISODate));
+		item->setText(1, QString::number(profile.elapsed));
+		item->setText(2, QString::number(profile.rows));
+		item->setText(3, QString::number(profile.fullscanSteps));
+		item->setText(4, QString::number(profile.sorts));
+		item->setText(5, QString::number(profile.autoindexes));
+		item->setText(6, QString::number(profile.vmSteps));
+		item->setText(7, profile.sql.simplified());
+		item->setData(0, Qt::UserRole, i);
+	}
+	for (int i = 0; i < _queries->columnCount() - 1; i++) _queries->resizeColumnToContents(i);
+
+	const ResultsCache &cache = ResultsCache::instance();
+	int lookups = cache.hits() + cache.misses();
+	_resultsCacheStats->setText(tr("Cached results: %1 searches, %2 hits out of %3 (%4%), %5 invalidated, %6 ms average restore time")
+		.arg(cache.size()).arg(cache.hits()).arg(lookups).arg(lookups ? cache.hits() * 100 / lookups : 0)
+		.arg(cache.invalidations()).arg(cache.averageRestoreTime(), 0, 'f', 1));
+}
+
+void QueryLogDialog::onCurrentItemChanged(QTreeWidgetItem *current)
+{
+	if (!current) {
+		_details->clear();
+		return;
+	}
+	_details->setPlainText(_profiles[current->data(0, Qt::UserRole).toInt()].toString());
+}
+
+void QueryLogDialog::clearLog()
+{
+	SQLite::QueryProfiler::clear();
+	refresh();
+}
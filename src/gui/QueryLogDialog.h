@@ -0,0 +1,73 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GUI_QUERYLOGDIALOG_H
+#define __GUI_QUERYLOGDIALOG_H
+
+#include "core/Preferences.h"
+#include "sqlite/QueryProfiler.h"
+
+#include <QDialog>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QTreeWidget>
+#include <QPlainTextEdit>
+#include <QLabel>
+
+/**
+ * Debug dialog displaying the slow queries recorded by
+ * SQLite::QueryProfiler, and allowing to change its settings. The hit
+ * rate of ResultsCache is displayed too.
+ */
+class QueryLogDialog : public QDialog
+{
+	Q_OBJECT
+private:
+	static PreferenceItem<QByteArray> windowGeometry;
+
+	QCheckBox *_enabled;
+	QSpinBox *_threshold;
+	QCheckBox *_explain;
+	QTreeWidget *_queries;
+	QPlainTextEdit *_details;
+	QLabel *_resultsCacheStats;
+	QList<SQLite::QueryProfile> _profiles;
+
+private slots:
+	void onSettingsChanged();
+	void onCurrentItemChanged(QTreeWidgetItem *current);
+	void clearLog();
+
+public slots:
+	void refresh();
+
+public:
+	static PreferenceItem<bool> enabled;
+	static PreferenceItem<int> threshold;
+	static PreferenceItem<bool> explain;
+
+	/**
+	 * Configures the profiler from the preferences. The log is written into
+	 * the user profile directory, which must be known at this point.
+	 */
+	static void applyPreferences();
+
+	QueryLogDialog(QWidget *parent = 0);
+	~QueryLogDialog();
+};
+
+#endif
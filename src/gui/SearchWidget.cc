@@ -49,6 +49,7 @@ SearchWidget::SearchWidget(QWidget *parent) : QWidget(parent), _history(historyS
 	// Setup the results model and view
 	_results = new ResultsList(this);
 	_resultsView->setModel(_results);
+	connect(_results, SIGNAL(resultsRestored(int)), this, SLOT(onResultsRestored(int)));
 	
 	// Search builder
 	connect(&_searchBuilder, SIGNAL(queryRequested(QString)), this, SLOT(search(QString)));
@@ -80,6 +81,7 @@ SearchWidget::SearchWidget(QWidget *parent) : QWidget(parent), _history(historyS
 void SearchWidget::search(const QString &commands)
 {
 	QString localCommands(commands.trimmed());
+	saveResultsPosition();
 	if (!(localCommands.isEmpty() || localCommands == ":jmdict" || localCommands == ":kanjidic")) {
 		_history.add(_searchBuilder.getState());
 		_search(localCommands);
@@ -112,6 +114,7 @@ void SearchWidget::goPrev()
 	QMap<QString, QVariant> q;
 	bool ok = _history.previous(q);
 	if (ok) {
+		saveResultsPosition();
 		_searchBuilder.restoreState(q);
 		_search(_searchBuilder.commands());
 	}
@@ -122,11 +125,23 @@ void SearchWidget::goNext()
 	QMap<QString, QVariant> q;
 	bool ok = _history.next(q);
 	if (ok) {
+		saveResultsPosition();
 		_searchBuilder.restoreState(q);
 		_search(_searchBuilder.commands());
 	}
 }
 
+void SearchWidget::saveResultsPosition()
+{
+	_results->setPosition(resultsView()->indexAt(QPoint(0, 0)).row());
+}
+
+void SearchWidget::onResultsRestored(int position)
+{
+	if (position > 0 && position < _results->rowCount()) resultsView()->scrollTo(_results->index(position), QAbstractItemView::PositionAtTop);
+	else resultsView()->scrollToTop();
+}
+
 void SearchWidget::resetSearch()
 {
 	_searchBuilder.reset();
@@ -55,10 +55,14 @@ protected:
 
 	/// Run the search without touching the history.
 	void _search(const QString &commands);
+	/// Remembers the scrolling position of the current results before they are replaced
+	void saveResultsPosition();
 
 protected slots:
 	/// Start a search with the given commands
 	void search(const QString &commands);
+	/// Scrolls the results view to where it was when restored results were left
+	void onResultsRestored(int position);
 
 public:
 	SearchWidget(QWidget *parent = 0);
@@ -38,7 +38,7 @@ TagsLineInput::TagsLineInput(QWidget *parent) : TJLineEdit(parent)
 	tagsCompleter = new QCompleter(this);
 	tagsCompleter->setModel(Tag::knownTagsModel());
 	tagsCompleter->setCaseSensitivity(Qt::CaseInsensitive);
-//	tagsCompleter->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
+	tagsCompleter->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
 	tagsCompleter->setWidget(this);
 	connect(this, SIGNAL(cursorPositionChanged(int, int)),
 		this, SLOT(checkCompletion()));
@@ -17,6 +17,7 @@
 
 #include "core/EntriesCache.h"
 #include "core/Database.h"
+#include "core/DatabaseWriter.h"
 #include "gui/EntryFormatter.h"
 #include "gui/YesNoTrainer.h"
 #include "gui/TemplateFiller.h"
@@ -88,6 +89,8 @@ void YesNoTrainer::setQuery(QString queryString)
 {
 	// Run the query
 	_queryString = queryString;
+	// Do not pick entries whose training is still waiting to be written
+	DatabaseWriter::flushFor(queryString);
 	if (!_query.exec(queryString)) qDebug() << "Error executing query:" << _query.lastError().message();
 }
 
@@ -116,6 +116,20 @@ JMdictEntryFormatter::JMdictEntryFormatter(QObject* parent) : EntryFormatter("de
 	_exampleSentencesServices["Jisho.org"] = jishoTemplate;
 }
 
+QList<ConstEntryPointer> JMdictEntryFormatter::drawDependencies(const ConstEntryPointer &entry) const
+{
+	QList<ConstEntryPointer> ret;
+	if (!printKanjis.defaultValue()) return ret;
+	QString writing;
+	if (!entry->writings().isEmpty()) writing = entry->writings()[0];
+	foreach (const QChar &c, writing) {
+		if (!TextTools::isKanjiChar(c)) continue;
+		ConstEntryPointer kanji(KanjiEntryRef(c.unicode()).get());
+		if (kanji) ret << kanji;
+	}
+	return ret;
+}
+
 void JMdictEntryFormatter::drawCustom(const ConstEntryPointer& _entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont, int headerPrintSize, bool printKanjis, bool printOnlyStudiedKanjis, int maxDefinitionsToPrint) const
 {
 	ConstJMdictEntryPointer entry(_entry.staticCast<const JMdictEntry>());
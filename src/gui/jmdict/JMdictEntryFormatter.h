@@ -40,7 +40,9 @@ public:
 	
 	virtual QString shortDesc(const ConstEntryPointer &entry) const;
 
-	virtual void draw(const ConstEntryPointer &entry, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const { drawCustom(entry, painter, rectangle, usedSpace, textFont); }
+	/// Returns the kanji of the writing of entry
+	virtual QList<ConstEntryPointer> drawDependencies(const ConstEntryPointer &entry) const;
+	virtual void draw(const ConstEntryPointer &entry, const QList<ConstEntryPointer> &dependencies, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const { drawCustom(entry, painter, rectangle, usedSpace, textFont); }
 	void drawCustom(const ConstEntryPointer &entry, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont(), int _headerPrintSize = headerPrintSize.defaultValue(), bool _printKanjis = printKanjis.defaultValue(), bool _printOnlyStudiedKanjis = printOnlyStudiedKanjis.defaultValue(), int _maxDefinitionsToPrint = maxDefinitionsToPrint.defaultValue()) const;
 
 	static QString getVerbBuddySql(const QString &matchPattern, quint64 pos, int id);
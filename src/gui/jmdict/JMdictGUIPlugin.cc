@@ -24,6 +24,7 @@
 #include "gui/jmdict/JMdictEntryFormatter.h"
 #include "gui/jmdict/JMdictPreferences.h"
 #include "gui/jmdict/JMdictGUIPlugin.h"
+#include "gui/jmdict/JMdictReaderDialog.h"
 #include "gui/TrainSettings.h"
 #include "gui/MainWindow.h"
 
@@ -37,7 +38,7 @@
 
 PreferenceItem<bool> JMdictGUIPlugin::furiganasForTraining("jmdict", "furiganasForTraining", true);
 
-JMdictGUIPlugin::JMdictGUIPlugin() : Plugin("JMdictGUI"), _flashJL(0), _flashJS(0), _flashTL(0), _flashTS(0), _linkhandler(0), _filter(0), _trainer(0)
+JMdictGUIPlugin::JMdictGUIPlugin() : Plugin("JMdictGUI"), _flashJL(0), _flashJS(0), _flashTL(0), _flashTS(0), _reader(0), _linkhandler(0), _filter(0), _trainer(0)
 {
 }
 
@@ -68,6 +69,8 @@ bool JMdictGUIPlugin::onRegister()
 	_flashTS = menu2->addAction(tr("From &translation, current set"));
 	connect(_flashTL, SIGNAL(triggered()), this, SLOT(trainingTranslationList()));
 	connect(_flashTS, SIGNAL(triggered()), this, SLOT(trainingTranslationSet()));
+	_reader = mainWindow->searchMenu()->addAction(tr("&Analyze text..."));
+	connect(_reader, SIGNAL(triggered()), this, SLOT(openReader()));
 
 	// Add the search extender
 	_filter = new JMdictFilterWidget(0);
@@ -93,6 +96,7 @@ bool JMdictGUIPlugin::onUnregister()
 	delete _flashJL; _flashJL = 0;
 	delete _flashTL; _flashTL = 0;
 	delete _flashTS; _flashTS = 0;
+	delete _reader; _reader = 0;
 	// Remove the link handler
 	DetailedViewLinkManager::removeHandler(_linkhandler);
 	delete _linkhandler; _linkhandler = 0;
@@ -219,6 +223,13 @@ void JMdictGUIPlugin::trainingTranslationSet()
 	training(YesNoTrainer::Translation, queryString);
 }
 
+void JMdictGUIPlugin::openReader()
+{
+	JMdictReaderDialog *dialog = new JMdictReaderDialog(MainWindow::instance());
+	dialog->setAttribute(Qt::WA_DeleteOnClose);
+	dialog->show();
+}
+
 void JMdictGUIPlugin::trainerDeleted()
 {
 	_trainer = 0;
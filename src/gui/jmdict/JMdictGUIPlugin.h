@@ -30,6 +30,7 @@ class JMdictGUIPlugin : public QObject, public Plugin
 	Q_OBJECT
 private:
 	QAction *_flashJL, *_flashJS, *_flashTL, *_flashTS;
+	QAction *_reader;
 	JMdictLinkHandler *_linkhandler;
 	JMdictFilterWidget *_filter;
 	JMdictYesNoTrainer *_trainer;
@@ -44,6 +45,7 @@ protected slots:
 	void trainingJapaneseSet();
 	void trainingTranslationList();
 	void trainingTranslationSet();
+	void openReader();
 
 public:
 	static PreferenceItem<bool> furiganasForTraining;
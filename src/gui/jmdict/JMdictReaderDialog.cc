@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gui/jmdict/JMdictReaderDialog.h"
+
+#include <QVBoxLayout>
+#include <QSplitter>
+#include <QDialogButtonBox>
+#include <QTime>
+
+/// Time to wait after the text has been modified before analyzing it, in milliseconds
+#define ANALYZE_DELAY 300
+
+PreferenceItem<QByteArray> JMdictReaderDialog::windowGeometry("readerWindow", "geometry", "");
+PreferenceItem<bool> JMdictReaderDialog::allMatches("jmdict/reader", "allMatches", false);
+
+JMdictReaderDialog::JMdictReaderDialog(QWidget *parent) : QDialog(parent)
+{
+	restoreGeometry(windowGeometry.value());
+	setWindowTitle(tr("Text analysis"));
+
+	_text = new QPlainTextEdit(this);
+	_text->setToolTip(tr("Paste a Japanese text here to list the words it contains"));
+	_allMatches = new QCheckBox(tr("Show &all possible words"), this);
+	_allMatches->setChecked(allMatches.value());
+	_status = new QLabel(this);
+
+	_results = new ResultsList(this);
+	_view = new ResultsView(this, 0, true);
+	_view->setModel(_results);
+	_detailedView = new DetailedView(this);
+
+	QSplitter *resultsSplitter = new QSplitter(Qt::Horizontal, this);
+	resultsSplitter->addWidget(_view);
+	resultsSplitter->addWidget(_detailedView);
+	QSplitter *splitter = new QSplitter(Qt::Vertical, this);
+	splitter->addWidget(_text);
+	splitter->addWidget(resultsSplitter);
+	splitter->setStretchFactor(1, 1);
+
+	QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, this);
+	connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+	QVBoxLayout *layout = new QVBoxLayout(this);
+	layout->addWidget(splitter, 1);
+	layout->addWidget(_allMatches);
+	layout->addWidget(_status);
+	layout->addWidget(buttonBox);
+
+	_timer.setSingleShot(true);
+	_timer.setInterval(ANALYZE_DELAY);
+	connect(&_timer, SIGNAL(timeout()), this, SLOT(analyze()));
+	connect(_text, SIGNAL(textChanged()), &_timer, SLOT(start()));
+	connect(_allMatches, SIGNAL(toggled(bool)), this, SLOT(analyze()));
+	connect(_view, SIGNAL(entrySelected(EntryPointer)), this, SLOT(onEntrySelected(EntryPointer)));
+}
+
+JMdictReaderDialog::~JMdictReaderDialog()
+{
+	windowGeometry.set(saveGeometry());
+	allMatches.set(_allMatches->isChecked());
+}
+
+void JMdictReaderDialog::analyze()
+{
+	_timer.stop();
+	QTime time;
+	time.start();
+	JMdictTextAnalyzer analyzer;
+	_words = analyzer.analyze(_text->toPlainText(), _allMatches->isChecked() ? JMdictTextAnalyzer::AllMatches : JMdictTextAnalyzer::LongestMatch);
+	QList<EntryRef> entries(JMdictTextAnalyzer::entries(_words));
+	int elapsed = time.elapsed();
+
+	_text->setExtraSelections(QList<QTextEdit::ExtraSelection>());
+	_results->clear();
+	_results->startReceive();
+	foreach (const EntryRef &ref, entries) _results->addResult(ref);
+	_results->endReceive();
+	_status->setText(tr("%1 words found in %2 ms").arg(entries.size()).arg(elapsed));
+}
+
+void JMdictReaderDialog::onEntrySelected(const EntryPointer &entry)
+{
+	_detailedView->display(entry);
+
+	// Highlight the occurences of the entry in the text
+	QList<QTextEdit::ExtraSelection> selections;
+	QTextCharFormat format;
+	format.setBackground(palette().highlight());
+	format.setForeground(palette().highlightedText());
+	foreach (const JMdictTextAnalyzer::Word &word, _words) {
+		if (!entry || word.id != entry->id()) continue;
+		QTextEdit::ExtraSelection selection;
+		selection.cursor = QTextCursor(_text->document());
+		selection.cursor.setPosition(word.position);
+		selection.cursor.setPosition(word.position + word.length, QTextCursor::KeepAnchor);
+		selection.format = format;
+		if (selections.isEmpty()) _text->setTextCursor(QTextCursor(selection.cursor.block()));
+		selections << selection;
+	}
+	_text->setExtraSelections(selections);
+	_text->ensureCursorVisible();
+}
@@ -0,0 +1,64 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GUI_JMDICT_READERDIALOG_H
+#define __GUI_JMDICT_READERDIALOG_H
+
+#include "core/Preferences.h"
+#include "core/ResultsList.h"
+#include "core/jmdict/JMdictTextAnalyzer.h"
+#include "gui/ResultsView.h"
+#include "gui/DetailedView.h"
+
+#include <QDialog>
+#include <QPlainTextEdit>
+#include <QCheckBox>
+#include <QLabel>
+#include <QTimer>
+
+/**
+ * Reader mode: displays all the JMdict words found in a pasted Japanese
+ * text. Selecting a word displays it and highlights where it appears in
+ * the text.
+ */
+class JMdictReaderDialog : public QDialog
+{
+	Q_OBJECT
+private:
+	static PreferenceItem<QByteArray> windowGeometry;
+
+	QPlainTextEdit *_text;
+	QCheckBox *_allMatches;
+	QLabel *_status;
+	ResultsList *_results;
+	ResultsView *_view;
+	DetailedView *_detailedView;
+	QTimer _timer;
+	QVector<JMdictTextAnalyzer::Word> _words;
+
+private slots:
+	void analyze();
+	void onEntrySelected(const EntryPointer &entry);
+
+public:
+	static PreferenceItem<bool> allMatches;
+
+	JMdictReaderDialog(QWidget *parent = 0);
+	~JMdictReaderDialog();
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gui/kanjidic2/KanjiGlyphAtlas.h"
+
+#include <QPainter>
+#include <QFontMetrics>
+
+QHash<QString, KanjiGlyphAtlas *> KanjiGlyphAtlas::_atlases;
+
+KanjiGlyphAtlas::KanjiGlyphAtlas(const QFont &font, const QColor &color) : _font(font), _color(color)
+{
+	int height = QFontMetrics(font).height();
+	_cellSize = QSize(height, height);
+}
+
+KanjiGlyphAtlas &KanjiGlyphAtlas::instance(const QFont &font, const QColor &color)
+{
+	QString key(QString("%1:%2").arg(font.key()).arg(color.rgba()));
+	KanjiGlyphAtlas *&atlas = _atlases[key];
+	if (!atlas) atlas = new KanjiGlyphAtlas(font, color);
+	return *atlas;
+}
+
+void KanjiGlyphAtlas::clear()
+{
+	foreach (KanjiGlyphAtlas *atlas, _atlases) {
+		atlas->_pages.clear();
+		atlas->_slots.clear();
+	}
+}
+
+QRect KanjiGlyphAtlas::cellRect(int slot) const
+{
+	int cell = slot % (PageCells * PageCells);
+	return QRect(QPoint((cell % PageCells) * _cellSize.width(), (cell / PageCells) * _cellSize.height()), _cellSize);
+}
+
+int KanjiGlyphAtlas::slot(const QString &character)
+{
+	QHash<QString, int>::const_iterator it(_slots.constFind(character));
+	if (it != _slots.constEnd()) return it.value();
+
+	if (_slots.size() >= MaxGlyphs) {
+		_pages.clear();
+		_slots.clear();
+	}
+	int ret = _slots.size();
+	if (ret / (PageCells * PageCells) >= _pages.size()) {
+		QPixmap page(_cellSize * PageCells);
+		page.fill(Qt::transparent);
+		_pages << page;
+	}
+	QPainter painter(&_pages[ret / (PageCells * PageCells)]);
+	painter.setFont(_font);
+	painter.setPen(_color);
+	painter.drawText(cellRect(ret), Qt::AlignCenter, character);
+	painter.end();
+	_slots[character] = ret;
+	return ret;
+}
+
+void KanjiGlyphAtlas::draw(QPainter *painter, const QRect &rect, const QString &character)
+{
+	int s = slot(character);
+	QRect target(QPoint(0, 0), _cellSize);
+	target.moveCenter(rect.center());
+	painter->drawPixmap(target, _pages[s / (PageCells * PageCells)], cellRect(s));
+}
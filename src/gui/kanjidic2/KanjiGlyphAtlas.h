@@ -0,0 +1,68 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GUI_KANJIGLYPHATLAS_H
+#define __GUI_KANJIGLYPHATLAS_H
+
+#include <QFont>
+#include <QColor>
+#include <QPixmap>
+#include <QHash>
+#include <QList>
+
+class QPainter;
+
+/**
+ * Characters of a given font and color rendered once into shared pixmaps,
+ * so that views displaying many characters only blit the cells they show.
+ *
+ * Glyphs are rendered on demand into pages of PageCells x PageCells cells.
+ * An atlas holds at most MaxGlyphs glyphs, after which it is emptied and
+ * filled again as characters are drawn.
+ */
+class KanjiGlyphAtlas
+{
+private:
+	static QHash<QString, KanjiGlyphAtlas *> _atlases;
+	QFont _font;
+	QColor _color;
+	QSize _cellSize;
+	QList<QPixmap> _pages;
+	QHash<QString, int> _slots;
+
+	KanjiGlyphAtlas(const QFont &font, const QColor &color);
+	/// Returns the slot of character, rendering it if needed
+	int slot(const QString &character);
+	/// Position of a slot within its page
+	QRect cellRect(int slot) const;
+
+public:
+	static const int PageCells = 16;
+	static const int MaxGlyphs = 1024;
+
+	/// Returns the atlas shared by everyone drawing with font and color
+	static KanjiGlyphAtlas &instance(const QFont &font, const QColor &color);
+	/// Empties all the atlases
+	static void clear();
+
+	const QSize &cellSize() const { return _cellSize; }
+	int glyphsCount() const { return _slots.size(); }
+	/// Draws character centered into rect
+	void draw(QPainter *painter, const QRect &rect, const QString &character);
+};
+
+#endif
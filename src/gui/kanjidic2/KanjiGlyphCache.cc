@@ -0,0 +1,98 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gui/kanjidic2/KanjiGlyphCache.h"
+
+#include <QPixmapCache>
+#include <QPainter>
+
+QString KanjiGlyphCache::key(const QString &layer, const Kanjidic2Entry *kanji, int size, int count, const QString &style)
+{
+	return QString("kanjiglyph:%1:%2:%3:%4:%5").arg(layer).arg(kanji ? kanji->id() : 0).arg(size).arg(count).arg(style);
+}
+
+QString KanjiGlyphCache::penStyle(const QPen &pen)
+{
+	return QString("%1-%2-%3").arg(pen.color().rgba()).arg(pen.widthF()).arg((int)pen.capStyle());
+}
+
+QPixmap KanjiGlyphCache::emptyLayer(int size)
+{
+	QPixmap ret(size, size);
+	ret.fill(Qt::transparent);
+	return ret;
+}
+
+void KanjiGlyphCache::setupPainter(QPainter &painter, int size)
+{
+	painter.scale(size / KANJI_AREA_WIDTH, size / KANJI_AREA_HEIGHT);
+	painter.setRenderHint(QPainter::Antialiasing);
+}
+
+QPixmap KanjiGlyphCache::grid(int size, const QPen &pen)
+{
+	QString k(key("grid", 0, size, 0, penStyle(pen)));
+	QPixmap ret;
+	if (QPixmapCache::find(k, ret)) return ret;
+
+	ret = emptyLayer(size);
+	QPainter painter(&ret);
+	setupPainter(painter, size);
+	painter.setPen(pen);
+	KanjiRenderer().renderGrid(&painter);
+	painter.end();
+	QPixmapCache::insert(k, ret);
+	return ret;
+}
+
+QPixmap KanjiGlyphCache::strokes(const ConstKanjidic2EntryPointer &kanji, int size, const QPen &pen, int count)
+{
+	if (count < 0 || count > kanji->strokes().size()) count = kanji->strokes().size();
+	QString k(key("strokes", kanji.data(), size, count, penStyle(pen)));
+	QPixmap ret;
+	if (QPixmapCache::find(k, ret)) return ret;
+
+	KanjiRenderer renderer(kanji);
+	const QList<KanjiRenderer::Stroke> &strokes(renderer.strokes());
+	ret = emptyLayer(size);
+	QPainter painter(&ret);
+	setupPainter(painter, size);
+	painter.setPen(pen);
+	painter.setBrush(QBrush());
+	for (int i = 0; i < count; i++) strokes[i].render(&painter);
+	painter.end();
+	QPixmapCache::insert(k, ret);
+	return ret;
+}
+
+QPixmap KanjiGlyphCache::strokesNumbers(const ConstKanjidic2EntryPointer &kanji, int size, int count, int numbersSize)
+{
+	const QList<KanjiStroke> &kStrokes(kanji->strokes());
+	if (count < 0 || count > kStrokes.size()) count = kStrokes.size();
+	QString k(key("numbers", kanji.data(), size, count, QString::number(numbersSize)));
+	QPixmap ret;
+	if (QPixmapCache::find(k, ret)) return ret;
+
+	KanjiRenderer renderer(kanji);
+	ret = emptyLayer(size);
+	QPainter painter(&ret);
+	setupPainter(painter, size);
+	for (int i = 0; i < count; i++) renderer.renderStrokeNumber(kStrokes[i], &painter, numbersSize);
+	painter.end();
+	QPixmapCache::insert(k, ret);
+	return ret;
+}
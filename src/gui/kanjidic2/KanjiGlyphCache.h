@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GUI_KANJIGLYPHCACHE_H
+#define __GUI_KANJIGLYPHCACHE_H
+
+#include "gui/kanjidic2/KanjiRenderer.h"
+
+#include <QPixmap>
+#include <QPen>
+
+/**
+ * Pre-rasterized layers of kanji drawings, shared between all the widgets
+ * that display kanji strokes.
+ *
+ * Layers are stored into QPixmapCache and are keyed by kanji, size, number
+ * of strokes and a style string that identifies everything else the layer
+ * depends on (colors, pen...), so that redrawing a kanji that has already
+ * been seen only costs a pixmap blit.
+ */
+class KanjiGlyphCache
+{
+public:
+	/**
+	 * Returns the key under which the layer of the given kind is stored.
+	 * Widgets building their own layers must use this method to avoid
+	 * clashes with other layers.
+	 */
+	static QString key(const QString &layer, const Kanjidic2Entry *kanji, int size, int count, const QString &style);
+	/// Returns a style string identifying pen
+	static QString penStyle(const QPen &pen);
+	/// Returns a fully transparent pixmap of size x size pixels
+	static QPixmap emptyLayer(int size);
+	/// Prepares painter to paint into a layer of size x size pixels using the strokes coordinates
+	static void setupPainter(QPainter &painter, int size);
+
+	/// Returns the kanji grid drawn with pen
+	static QPixmap grid(int size, const QPen &pen);
+	/// Returns the count first strokes of kanji (all strokes if count is negative)
+	static QPixmap strokes(const ConstKanjidic2EntryPointer &kanji, int size, const QPen &pen, int count = -1);
+	/// Returns the numbers of the count first strokes of kanji
+	static QPixmap strokesNumbers(const ConstKanjidic2EntryPointer &kanji, int size, int count, int numbersSize);
+};
+
+#endif
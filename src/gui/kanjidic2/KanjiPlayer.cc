@@ -24,6 +24,7 @@
 #include <QMouseEvent>
 #include <QToolButton>
 #include <QPainterPathStroker>
+#include <QPixmapCache>
 
 #define TIMER_INTERVAL 20
 
@@ -41,7 +42,7 @@ PreferenceItem<int> KanjiPlayer::strokesNumbersSizePref("kanjidic", "strokesNumb
 
 static QList<QColor> colList(QList<QColor>() << Qt::black << QColor(0x0d, 0x5b, 0xa6) << QColor(0xce, 0x34, 0x34) << QColor(0x04, 0x9a,0x40) << QColor(0xe6, 0xa6, 0x00) << QColor(0xd2, 0x7d, 0x8e) << Qt::blue << Qt::red << Qt::green << Qt::cyan << Qt::magenta << Qt::yellow);
 
-KanjiPlayer::KanjiPlayer(QWidget *parent) : QWidget(parent), _timer(), _kanji(0), renderer(), _picture(), _state(STATE_STROKE), _showGrid(showGridPref.value()), _showStrokesNumbers(showStrokesNumbersPref.value()), _strokesNumbersSize(strokesNumbersSizePref.value()), _highlightedComponent(0)
+KanjiPlayer::KanjiPlayer(QWidget *parent) : QWidget(parent), _timer(), _kanji(0), renderer(), _frame(), _state(STATE_STROKE), _showGrid(showGridPref.value()), _showStrokesNumbers(showStrokesNumbersPref.value()), _strokesNumbersSize(strokesNumbersSizePref.value()), _highlightedComponent(0)
 {
 	setAnimationSpeed(animationSpeed.value());
 	setDelayBetweenStrokes(delayBetweenStrokes.value());
@@ -72,7 +73,6 @@ KanjiPlayer::KanjiPlayer(QWidget *parent) : QWidget(parent), _timer(), _kanji(0)
 	kanjiView = new QLabel(this);
 	kanjiView->setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
 	kanjiView->setFocusPolicy(Qt::NoFocus);
-	kanjiView->setPicture(_picture);
 	kanjiView->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
 	kanjiView->setMouseTracking(true);
 	kanjiView->installEventFilter(this);
@@ -144,9 +144,7 @@ void KanjiPlayer::setKanji(const ConstKanjidic2EntryPointer &entry)
 void KanjiPlayer::setPictureSize(int newSize)
 {
 	_pictureSize = newSize;
-	_picture.setBoundingRect(QRect(0, 0, newSize, newSize));
 	kanjiView->clear();
-	kanjiView->setPicture(_picture);
 	kanjiView->setMinimumSize(newSize, newSize);
 }
 
@@ -204,26 +202,40 @@ void KanjiPlayer::unHighlightComponent()
 	highlightComponent(0);
 }
 
-void KanjiPlayer::renderCurrentState()
+static const int strokes_size = 4;
+static const int outline_size = strokes_size + 3;
+static const Qt::PenCapStyle strokeCapStyle = Qt::RoundCap;
+static const uchar HIGHLIGHT_RATIO = 135;
+
+QString KanjiPlayer::layersStyle() const
 {
-	static const int strokes_size = 4;
-	static const int outline_size = strokes_size + 3;
-	static const Qt::PenCapStyle strokeCapStyle = Qt::RoundCap;
+	// Identify the highlighted component by its position, as pointers may be reused
+	int highlighted = -1;
+	if (highlightedComponent()) {
+		const QList<KanjiComponent> &components(_kanji->components());
+		for (int i = 0; i < components.size(); i++) if (&components[i] == highlightedComponent()) { highlighted = i; break; }
+	}
+	const QPalette &pal(palette());
+	return QString("player-%1-%2-%3-%4-%5").arg(showGrid()).arg(highlighted).arg(pal.color(QPalette::Mid).rgba()).arg(pal.color(QPalette::Dark).rgba()).arg(pal.color(QPalette::Window).rgba());
+}
 
-	QPainter painter(&_picture);
-	painter.scale(pictureSize() / KANJI_AREA_WIDTH, pictureSize() / KANJI_AREA_HEIGHT);
-	painter.setRenderHint(QPainter::Antialiasing);
+QPixmap KanjiPlayer::backgroundLayer()
+{
+	QString k(KanjiGlyphCache::key("playerbackground", _kanji.data(), pictureSize(), 0, layersStyle()));
+	QPixmap ret;
+	if (QPixmapCache::find(k, ret)) return ret;
 
+	ret = KanjiGlyphCache::emptyLayer(pictureSize());
+	QPainter painter(&ret);
 	// Render the grid, if relevant
 	if (showGrid()) {
 		QPen gridPen;
 		gridPen.setWidth(strokes_size / 2);
 		gridPen.setColor(palette().color(QPalette::Mid));
-		painter.setPen(gridPen);
-
-		renderer.renderGrid(&painter);
+		painter.drawPixmap(0, 0, KanjiGlyphCache::grid(pictureSize(), gridPen));
 	}
-	
+
+	KanjiGlyphCache::setupPainter(painter, pictureSize());
 	// Render the outline
 	QPen outLinePen;
 	outLinePen.setColor(palette().color(QPalette::Dark));
@@ -241,52 +253,76 @@ void KanjiPlayer::renderCurrentState()
 	outLinePen.setColor(palette().color(QPalette::Window));
 	painter.setPen(outLinePen);
 	renderer.renderStrokes(&painter);
+	painter.end();
+
+	QPixmapCache::insert(k, ret);
+	return ret;
+}
+
+QPixmap KanjiPlayer::strokesLayer(int count)
+{
+	if (count <= 0) return backgroundLayer();
+	QString style(layersStyle());
+	QPixmap ret;
+	if (QPixmapCache::find(KanjiGlyphCache::key("playerstrokes", _kanji.data(), pictureSize(), count, style), ret)) return ret;
+
+	// Start from the most complete layer available - during an animation,
+	// this is the one of the previous stroke.
+	int from = count - 1;
+	while (from > 0 && !QPixmapCache::find(KanjiGlyphCache::key("playerstrokes", _kanji.data(), pictureSize(), from, style), ret)) --from;
+	if (from == 0) ret = backgroundLayer();
+
+	QPainter painter(&ret);
+	KanjiGlyphCache::setupPainter(painter, pictureSize());
+	const QList<KanjiRenderer::Stroke> &strokes(renderer.strokes());
+	for (int i = from; i < count; i++) {
+		painter.setPen(strokePen(strokes[i].stroke()));
+		strokes[i].render(&painter);
+	}
+	painter.end();
+
+	QPixmapCache::insert(KanjiGlyphCache::key("playerstrokes", _kanji.data(), pictureSize(), count, style), ret);
+	return ret;
+}
 
-	// Render the strokes
+QPen KanjiPlayer::strokePen(const KanjiStroke *stroke) const
+{
+	const QList<const KanjiComponent *> &kComponents(_kanji->rootComponents());
 	QPen strokesPen;
 	strokesPen.setWidth(strokes_size);
 	strokesPen.setCapStyle(strokeCapStyle);
-	painter.setPen(strokesPen);
 
-	const QList<const KanjiComponent *> &kComponents(_kanji->rootComponents());
-	const QList<KanjiStroke> &kStrokes(_kanji->strokes());
-
-	if (renderer.strokes().isEmpty()) return;
-
-	static const uchar HIGHLIGHT_RATIO = 135;
-	// Render full strokes
-	for (int i = 0; i < _strokesCpt; i++) {
-		const KanjiComponent *parent(0);
-		if (highlightedComponent() && highlightedComponent()->strokes().contains(&kStrokes[i])) { parent = highlightedComponent(); }
-		else foreach (const KanjiComponent *comp, kComponents) if (comp->strokes().contains(&kStrokes[i])) { parent = comp; break; }
-		if (!parent) strokesPen.setColor(colList[0]);
-		else strokesPen.setColor(colList[kComponents.indexOf(parent) + 1]);
-		if (highlightedComponent() && parent == highlightedComponent()) strokesPen.setColor(strokesPen.color().lighter(HIGHLIGHT_RATIO));
-		painter.setPen(strokesPen);
-		renderer.strokes()[i].render(&painter);
-	}
-	// Render partial stroke
+	const KanjiComponent *parent(0);
+	if (highlightedComponent() && highlightedComponent()->strokes().contains(stroke)) { parent = highlightedComponent(); }
+	else foreach (const KanjiComponent *comp, kComponents) if (comp->strokes().contains(stroke)) { parent = comp; break; }
+	if (!parent) strokesPen.setColor(colList[0]);
+	else strokesPen.setColor(colList[kComponents.indexOf(parent) + 1]);
+	if (highlightedComponent() && parent == highlightedComponent()) strokesPen.setColor(strokesPen.color().lighter(HIGHLIGHT_RATIO));
+	return strokesPen;
+}
+
+void KanjiPlayer::renderCurrentState()
+{
+	if (!_kanji) return;
+
+	// Completed strokes come pre-rasterized, only the partial stroke needs to be drawn
+	_frame = strokesLayer(_strokesCpt);
 	if (_state == STATE_STROKE && _strokesCpt < renderer.strokes().size()) {
 		const KanjiRenderer::Stroke &currentStroke(renderer.strokes()[_strokesCpt]);
-		const KanjiComponent *parent(0);
-		if (highlightedComponent() && highlightedComponent()->strokes().contains(currentStroke.stroke())) { parent = highlightedComponent(); }
-		else foreach (const KanjiComponent *comp, kComponents) if (comp->strokes().contains(currentStroke.stroke())) { parent = comp; break; }
-		if (!parent) strokesPen.setColor(colList[0]);
-		else strokesPen.setColor(colList[kComponents.indexOf(parent) + 1]);
-		if (highlightedComponent() && parent == highlightedComponent()) strokesPen.setColor(strokesPen.color().lighter(HIGHLIGHT_RATIO));
-		painter.setPen(strokesPen);
+		QPainter painter(&_frame);
+		KanjiGlyphCache::setupPainter(painter, pictureSize());
+		painter.setPen(strokePen(currentStroke.stroke()));
 		currentStroke.render(&painter, _lengthCpt);
 	}
 
 	// Render stroke numbers
 	if (showStrokesNumbers()) {
 		int strokesMax = _strokesCpt + (_state == STATE_STROKE && _strokesCpt < renderer.strokes().size() ? 1 : 0);
-		for (int i = 0; i < strokesMax; i++) {
-			renderer.renderStrokeNumber(kStrokes[i], &painter, strokesNumbersSize());
-		}
+		QPainter painter(&_frame);
+		painter.drawPixmap(0, 0, KanjiGlyphCache::strokesNumbers(_kanji, pictureSize(), strokesMax, strokesNumbersSize()));
 	}
 
-	painter.end();
+	kanjiView->setPixmap(_frame);
 }
 
 void KanjiPlayer::paintEvent(QPaintEvent * event)
@@ -373,10 +409,6 @@ void KanjiPlayer::reset()
 {
 	stop();
 	setPosition(0);
-	// Reset the picture
-	QPainter painter;
-	painter.begin(&_picture);
-	painter.end();
 	emit animationReset();
 }
 
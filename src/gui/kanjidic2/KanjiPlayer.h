@@ -30,6 +30,7 @@
 
 #include "core/kanjidic2/Kanjidic2Entry.h"
 #include "gui/kanjidic2/KanjiRenderer.h"
+#include "gui/kanjidic2/KanjiGlyphCache.h"
 
 class KanjiPlayer : public QWidget {
 	Q_OBJECT
@@ -40,7 +41,7 @@ private:
 	QLabel *strokeCountLabel;
 	KanjiRenderer renderer;
 	// Off-screen rendering of the kanji
-	QPicture _picture;
+	QPixmap _frame;
 	// Actual display of the kanji
 	QLabel *kanjiView;
 	int _pictureSize;
@@ -63,9 +64,18 @@ private:
 
 protected:
 	/**
-	 * Render the state of the animation into _picture
+	 * Render the state of the animation into _frame. Only the stroke being
+	 * drawn is rendered, the rest comes from pre-rasterized layers.
 	 */
 	void renderCurrentState();
+	/// Identifies everything but the kanji and size the layers depend on
+	QString layersStyle() const;
+	/// Grid and outline of the kanji
+	QPixmap backgroundLayer();
+	/// Background with the count first strokes completed
+	QPixmap strokesLayer(int count);
+	/// Pen used to render the given stroke
+	QPen strokePen(const KanjiStroke *stroke) const;
 	virtual void paintEvent(QPaintEvent * event);
 	virtual bool eventFilter(QObject *obj, QEvent *event);
 	void updateStrokesCountLabel();
@@ -84,6 +94,8 @@ public:
 
 	void setKanji(const ConstKanjidic2EntryPointer &entry);
 	void setPosition(int strokeNbr);
+	/// Number of strokes completed so far
+	int position() const { return _strokesCpt; }
 	
 	bool showGrid() const { return _showGrid; }
 	bool showStrokesNumbers() const { return _showStrokesNumbers; }
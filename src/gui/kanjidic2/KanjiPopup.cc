@@ -23,6 +23,7 @@
 #include "gui/SingleEntryView.h"
 #include "gui/kanjidic2/Kanjidic2EntryFormatter.h"
 #include "gui/kanjidic2/Kanjidic2GUIPlugin.h"
+#include "gui/kanjidic2/KanjiGlyphCache.h"
 
 #include <QtDebug>
 
@@ -65,16 +66,10 @@ void KanjiComponentWidget::paintEvent(QPaintEvent *event)
 	// First draw the shape
 	ConstKanjidic2EntryPointer kEntry(kanji());
 	if (kEntry && !kEntry->strokes().isEmpty()) {
-		KanjiRenderer renderer(kEntry);
 		QPen pen(painter.pen());
 		pen.setStyle(Qt::SolidLine);
 		pen.setWidth(5);
-		painter.setPen(pen);
-		painter.setBrush(QBrush());
-		painter.save();
-		painter.scale(kanjiSize / 109.0, kanjiSize / 109.0);
-		renderer.renderStrokes(&painter);
-		painter.restore();
+		painter.drawPixmap(0, 0, KanjiGlyphCache::strokes(kEntry, kanjiSize, pen));
 	} else {
 		QString k(component()->element());
 		painter.save();
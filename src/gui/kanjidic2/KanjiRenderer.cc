@@ -26,99 +26,36 @@ KanjiRenderer::Stroke::Stroke()
 {
 }
 
-KanjiRenderer::Stroke::Stroke(const KanjiStroke *const stroke) : _stroke(stroke), _painterPath(pathFromSVG(stroke->path()))
+KanjiRenderer::Stroke::Stroke(const KanjiStroke *const stroke) : _stroke(stroke), _painterPath(painterPathFromGeometry(stroke->path())), _numberLine(stroke->path().numberLine())
 {
 }
 
-QPainterPath KanjiRenderer::Stroke::pathFromSVG(QString svgPath)
+QPainterPath KanjiRenderer::Stroke::painterPathFromGeometry(const KanjiStrokePath &path)
 {
-	enum SVGPathCommand { None = 0, Movepath, movepath, Closepath, Lineto, lineto, HLineto, Hlineto, VLineto, vLineto, Curveto, curveto, sCurveto, scurveto, Ellipse };
 	QPainterPath retPath;
 	retPath.setFillRule(Qt::WindingFill);
 
-	// Process the string - add spaces between unseparated tokens
-	int idx;
-	while ((idx = svgPath.indexOf(QRegExp("[a-zA-Z]\\d|\\d[a-zA-Z]|\\w-"))) != -1) svgPath.insert(idx + 1, ' ');
-
-	QStringList tokens = svgPath.split(QRegExp(" +|,"), QString::SkipEmptyParts);
-
-	SVGPathCommand curAction = None;
-	QPointF dest;
-	QPointF p1;
-	QPointF p2;
-	QPointF lastControl;
-	for (int tokenPos = 0; tokenPos < tokens.count(); tokenPos++) {
-		// Check if a new action is available
-		bool gotCommand = true;
-		do {
-			QString token = tokens[tokenPos];
-			if (token == "M") curAction = Movepath;
-			else if (token == "m") curAction = movepath;
-			else if (token == "L") curAction = Lineto;
-			else if (token == "l") curAction = lineto;
-			else if (token == "C") curAction = Curveto;
-			else if (token == "c") curAction = curveto;
-			else if (token == "S") curAction = sCurveto;
-			else if (token == "s") curAction = scurveto;
-			else if (token == "z" || token == "Z") curAction = Closepath;
-			else gotCommand = false;
-			if (gotCommand) { tokenPos++; if (tokenPos >= tokens.count()) break; }
-		} while (gotCommand);
-		// Now execute the action
-		switch (curAction) {
-			case None:
-				qWarning("Invalid kanji drawing path!");
+	const QByteArray &commands(path.commands());
+	int c = 0;
+	for (int i = 0; i < commands.size(); i++) {
+		switch (commands[i]) {
+			case KanjiStrokePath::MoveTo:
+				retPath.moveTo(path.coord(c), path.coord(c + 1));
+				c += 2;
 				break;
-			case Movepath:
-			case movepath:
-				dest = QPointF(tokens[tokenPos].toFloat(), tokens[tokenPos + 1].toFloat());
-				if (curAction == movepath) dest += retPath.currentPosition();
-				retPath.moveTo(dest);
-				tokenPos++;
-				lastControl = retPath.currentPosition();
+			case KanjiStrokePath::LineTo:
+				retPath.lineTo(path.coord(c), path.coord(c + 1));
+				c += 2;
 				break;
-			case Lineto:
-			case lineto:
-				dest = QPointF(tokens[tokenPos].toFloat(), tokens[tokenPos + 1].toFloat());
-				if (curAction == lineto) dest += retPath.currentPosition();
-				retPath.lineTo(dest);
-				tokenPos++;
-				lastControl = retPath.currentPosition();
+			case KanjiStrokePath::CubicTo:
+				retPath.cubicTo(path.coord(c), path.coord(c + 1), path.coord(c + 2), path.coord(c + 3), path.coord(c + 4), path.coord(c + 5));
+				c += 6;
 				break;
-			case Curveto:
-			case curveto:
-				p1 = QPointF(tokens[tokenPos].toFloat(), tokens[tokenPos + 1].toFloat());
-				p2 = QPointF(tokens[tokenPos + 2].toFloat(), tokens[tokenPos + 3].toFloat());
-				dest = QPointF(tokens[tokenPos + 4].toFloat(), tokens[tokenPos + 5].toFloat());
-				if (curAction == curveto) {
-					p1 += retPath.currentPosition();
-					p2 += retPath.currentPosition();
-					dest += retPath.currentPosition();
-				}
-				retPath.cubicTo(p1, p2, dest);
-				tokenPos += 5;
-				lastControl = p2;
-				break;
-			case sCurveto:
-			case scurveto:
-				p1 = retPath.currentPosition() * 2 - lastControl;
-				p2 = QPointF(tokens[tokenPos].toFloat(), tokens[tokenPos + 1].toFloat());
-				dest = QPointF(tokens[tokenPos + 2].toFloat(), tokens[tokenPos + 3].toFloat());
-				if (curAction == scurveto) {
-					p2 += retPath.currentPosition();
-					dest += retPath.currentPosition();
-				}
-				retPath.cubicTo(p1, p2, dest);
-				tokenPos += 3;
-				lastControl = p2;
-				break;
-			case Closepath:
+			case KanjiStrokePath::Close:
 				retPath.closeSubpath();
-				lastControl = retPath.currentPosition();
 				break;
 			default:
 				qWarning("Unknown command while drawing kanji path!");
-				lastControl = retPath.currentPosition();
 				break;
 		}
 	}
@@ -171,6 +108,7 @@ void KanjiRenderer::setKanji(ConstKanjidic2EntryPointer kanji)
 
 		for (QList<Stroke>::iterator stroke = _strokes.begin(); stroke != _strokes.end(); ++stroke) {
 			stroke->_painterPath.translate(translatePoint.x(), 0);
+			stroke->_numberLine.translate(translatePoint.x(), 0);
 		}
 	}
 #endif
@@ -203,8 +141,7 @@ void KanjiRenderer::renderStrokeNumber(const KanjiStroke &stroke, QPainter *pain
 	pen.setWidth(1);
 	painter->setPen(Qt::NoPen);
 	// Find the position where the number is to be rendered
-	const QPainterPath &path = _strokesMap[&stroke]->painterPath();
-	QLineF line(QLineF(path.pointAtPercent(0.0), path.pointAtPercent(0.1)));
+	QLineF line(_strokesMap[&stroke]->numberLine());
 	//line = line.normalVector();
 	line.setLength(-baseSize * 1.5);
 	//line.setAngle(path.angleAtPercent(0.05));
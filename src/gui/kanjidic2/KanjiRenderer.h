@@ -44,15 +44,18 @@ public:
 	private:
 		const KanjiStroke *_stroke;
 		QPainterPath _painterPath;
+		QLineF _numberLine;
 
-		QPainterPath pathFromSVG(QString svgPath);
+		static QPainterPath painterPathFromGeometry(const KanjiStrokePath &path);
 
 	public:
 		Stroke();
 		Stroke(const KanjiStroke *const stroke);
 		const KanjiStroke *stroke() const { return _stroke; }
 		const QPainterPath &painterPath() const { return _painterPath; }
-		qreal length() const { return _painterPath.length(); }
+		qreal length() const { return _stroke->path().length(); }
+		/// Line along which the number of the stroke is drawn
+		const QLineF &numberLine() const { return _numberLine; }
 
 		/**
 		 * Render a part of the stroke (if length >= 0) or the complete
@@ -20,52 +20,29 @@
 
 #include "core/kanjidic2/Kanjidic2Entry.h"
 #include "gui/kanjidic2/KanjiResultsView.h"
+#include "gui/kanjidic2/KanjiGlyphAtlas.h"
 #include "gui/kanjidic2/Kanjidic2EntryFormatter.h"
 
 #include <QCoreApplication>
-#include <QGraphicsSimpleTextItem>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
 #include <QToolTip>
 
 #define KANJI_SIZE 50
 #define PADDING 5
 
-class QGraphicsSceneHoverEvent;
-
-class KanjiGraphicsItem : public QGraphicsSimpleTextItem
-{
-public:
-	KanjiGraphicsItem(const QString &chr, QGraphicsItem *parent) : QGraphicsSimpleTextItem(chr, parent)
-	{
-		setAcceptHoverEvents(true);
-	}
-
-	virtual ~KanjiGraphicsItem() {}
-
-protected:
-	virtual void hoverEnterEvent(QGraphicsSceneHoverEvent *event)
-	{
-		Kanjidic2EntryFormatter::instance().showToolTip(KanjiEntryRef(text()).get(), QCursor::pos());
-	}
-
-	virtual void hoverLeaveEvent(QGraphicsSceneHoverEvent *event)
-	{
-		QToolTip::hideText();
-	}
-};
+#define ITEM_POSITION(x) (4 * PADDING + (x) * (KANJI_SIZE + PADDING))
 
-KanjiResultsView::KanjiResultsView(QWidget *parent) : QGraphicsView(parent), _scene()
+KanjiResultsView::KanjiResultsView(QWidget *parent) : QAbstractScrollArea(parent), _selected(-1), _hovered(-1)
 {
 	kanjiFont.setPixelSize(KANJI_SIZE);
-	setScene(&_scene);
 	setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::Minimum);
 	setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 	setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
-
-//	setSceneRect(-0xfffff, -0xfffff, 2 * 0xfffff, 2 * 0xfffff);
-	setResizeAnchor(QGraphicsView::AnchorViewCenter);
+	viewport()->setMouseTracking(true);
+	viewport()->setBackgroundRole(QPalette::Base);
 	_smoothScroller.setScrollBar(horizontalScrollBar());
-
-	connect(&_scene, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
 }
 
 QSize KanjiResultsView::sizeHint() const
@@ -75,14 +52,88 @@ QSize KanjiResultsView::sizeHint() const
 	return QSize(QWidget::sizeHint().width(), QFontMetrics(font).height() + horizontalScrollBar()->height());
 }
 
-#define ITEM_CENTER(item) (item->pos() + item->boundingRect().center())
-#define ITEM_POSITION(x) (4 * PADDING + (x) * (KANJI_SIZE + PADDING))
+QRect KanjiResultsView::cellRect(int idx) const
+{
+	return QRect(ITEM_POSITION(idx) - horizontalScrollBar()->value(), 0, KANJI_SIZE, viewport()->height());
+}
+
+int KanjiResultsView::indexAt(const QPoint &pos) const
+{
+	int x = pos.x() + horizontalScrollBar()->value() - ITEM_POSITION(0);
+	if (x < 0) return -1;
+	int idx = x / (KANJI_SIZE + PADDING);
+	// Clicks between two cells do not select anything
+	if (idx >= _kanji.size() || x % (KANJI_SIZE + PADDING) >= KANJI_SIZE) return -1;
+	return idx;
+}
+
+void KanjiResultsView::updateScrollBar()
+{
+	int width = _kanji.isEmpty() ? 0 : ITEM_POSITION(_kanji.size()) + 3 * PADDING;
+	QScrollBar *bar = horizontalScrollBar();
+	bar->setRange(0, qMax(0, width - viewport()->width()));
+	bar->setPageStep(viewport()->width());
+	bar->setSingleStep(KANJI_SIZE + PADDING);
+}
 
-void KanjiResultsView::onSelectionChanged()
+void KanjiResultsView::paintEvent(QPaintEvent *event)
 {
-	QList<QGraphicsItem *> selection(_scene.selectedItems());
-	if (selection.isEmpty()) return;
-	emit kanjiSelected(static_cast<QGraphicsSimpleTextItem *>(selection[selection.size() - 1])->text());
+	if (_kanji.isEmpty()) return;
+	QPainter painter(viewport());
+	const QRect &area = event->rect();
+	int offset = horizontalScrollBar()->value() - ITEM_POSITION(0);
+	int first = qMax(0, (area.left() + offset) / (KANJI_SIZE + PADDING));
+	int last = qMin(_kanji.size() - 1, (area.right() + offset) / (KANJI_SIZE + PADDING));
+	KanjiGlyphAtlas &atlas = KanjiGlyphAtlas::instance(kanjiFont, palette().color(QPalette::Text));
+	for (int i = first; i <= last; i++) {
+		QRect rect(cellRect(i));
+		if (i == _selected) {
+			painter.fillRect(rect, palette().highlight());
+			KanjiGlyphAtlas::instance(kanjiFont, palette().color(QPalette::HighlightedText)).draw(&painter, rect, _kanji[i]);
+		}
+		else atlas.draw(&painter, rect, _kanji[i]);
+	}
+}
+
+void KanjiResultsView::resizeEvent(QResizeEvent *event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	updateScrollBar();
+}
+
+void KanjiResultsView::scrollContentsBy(int dx, int dy)
+{
+	viewport()->scroll(dx, dy);
+}
+
+void KanjiResultsView::mouseMoveEvent(QMouseEvent *event)
+{
+	int idx = indexAt(event->pos());
+	if (idx == _hovered) return;
+	_hovered = idx;
+	if (idx == -1) QToolTip::hideText();
+	else Kanjidic2EntryFormatter::instance().showToolTip(KanjiEntryRef(_kanji[idx]).get(), QCursor::pos());
+}
+
+void KanjiResultsView::mousePressEvent(QMouseEvent *event)
+{
+	if (event->button() != Qt::LeftButton) return;
+	int idx = indexAt(event->pos());
+	if (idx == _selected) return;
+	if (_selected != -1) viewport()->update(cellRect(_selected));
+	_selected = idx;
+	if (idx == -1) return;
+	viewport()->update(cellRect(idx));
+	emit kanjiSelected(_kanji[idx]);
+}
+
+bool KanjiResultsView::viewportEvent(QEvent *event)
+{
+	if (event->type() == QEvent::Leave) {
+		_hovered = -1;
+		QToolTip::hideText();
+	}
+	return QAbstractScrollArea::viewportEvent(event);
 }
 
 void KanjiResultsView::startReceive()
@@ -92,27 +143,31 @@ void KanjiResultsView::startReceive()
 
 void KanjiResultsView::addItem(const QString &kanji)
 {
-	QGraphicsSimpleTextItem *item = new KanjiGraphicsItem(kanji, 0);
-	item->setFont(kanjiFont);
-	_scene.addItem(item);
-	item->setPos(ITEM_POSITION(items.size()), 0);
-	item->setFlags(QGraphicsItem::ItemIsSelectable);
-	items << item;
+	addItems(QStringList() << kanji);
+}
+
+void KanjiResultsView::addItems(const QStringList &kanji)
+{
+	if (kanji.isEmpty()) return;
+	QRect newCells(cellRect(_kanji.size()));
+	_kanji << kanji;
+	updateScrollBar();
+	// Only the new cells need to be painted, if they are visible at all
+	newCells.setRight(viewport()->width());
+	if (newCells.isValid()) viewport()->update(newCells);
 }
 
 void KanjiResultsView::endReceive()
 {
-	_scene.setSceneRect(_scene.itemsBoundingRect());
-	setSceneRect(_scene.itemsBoundingRect());
-	if (!items.isEmpty()) centerOn(0.0, ITEM_CENTER(items[0]).y());
+	horizontalScrollBar()->setValue(0);
 }
 
 void KanjiResultsView::clear()
 {
-	_scene.clear();
-	items.clear();
-	// Used to reset the scrollbar
-	setSceneRect(0, 0, 1, 1);
+	_kanji.clear();
+	_selected = _hovered = -1;
+	updateScrollBar();
+	viewport()->update();
 }
 
 void KanjiResultsView::wheelEvent(QWheelEvent *event)
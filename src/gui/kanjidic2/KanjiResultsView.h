@@ -20,37 +20,58 @@
 
 #include "gui/ScrollBarSmoothScroller.h"
 
-#include <QGraphicsView>
-#include <QGraphicsScene>
+#include <QAbstractScrollArea>
+#include <QStringList>
 #include <QWheelEvent>
 
-class QGraphicsSimpleTextItem;
-
 /**
  * A horizontally-scrollable results view designed to display kanji
  * in an easily selectable way.
+ *
+ * Only the kanji that are visible are painted, using glyphs from the
+ * shared KanjiGlyphAtlas, so the view remains fast even with thousands
+ * of results.
  */
-class KanjiResultsView : public QGraphicsView
+class KanjiResultsView : public QAbstractScrollArea
 {
 	Q_OBJECT
 private:
-	QGraphicsScene _scene;
-	QList<QGraphicsSimpleTextItem *> items;
+	QStringList _kanji;
+	int _selected;
+	int _hovered;
 	ScrollBarSmoothScroller _smoothScroller;
 	QFont kanjiFont;
 
+	/// Returns the index of the kanji at pos of the viewport, or -1 if there is none
+	int indexAt(const QPoint &pos) const;
+	/// Returns the cell of the kanji at index idx, in viewport coordinates
+	QRect cellRect(int idx) const;
+	void updateScrollBar();
+
+protected:
+	virtual void paintEvent(QPaintEvent *event);
+	virtual void resizeEvent(QResizeEvent *event);
+	virtual void mouseMoveEvent(QMouseEvent *event);
+	virtual void mousePressEvent(QMouseEvent *event);
+	virtual bool viewportEvent(QEvent *event);
+	virtual void scrollContentsBy(int dx, int dy);
+
 protected slots:
-	void onSelectionChanged();
 	void wheelEvent(QWheelEvent *event);
 
 public:
 	KanjiResultsView(QWidget *parent = 0);
 	virtual QSize sizeHint() const;
-	void clear();
-	QGraphicsScene *scene() { return &_scene; }
+	int count() const { return _kanji.size(); }
+	const QString &kanji(int idx) const { return _kanji[idx]; }
+	/// Index of the selected kanji, or -1 if none is selected
+	int selectedIndex() const { return _selected; }
 
 public slots:
+	void clear();
 	void addItem(const QString &kanji);
+	/// Appends a batch of results, repainting only once
+	void addItems(const QStringList &kanji);
 	void startReceive();
 	void endReceive();
 
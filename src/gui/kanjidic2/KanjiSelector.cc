@@ -31,14 +31,65 @@
 #include <QComboBox>
 #include <QDesktopWidget>
 
-ComplementsList::ComplementsList(QWidget *parent) : QListWidget(parent), baseFont(font()), labelFont(baseFont), _sscroll(verticalScrollBar())
+ComplementsModel::ComplementsModel(QObject *parent) : QAbstractListModel(parent)
+{
+}
+
+void ComplementsModel::setItems(const QVector<Item> &items)
+{
+	_items = items;
+	reset();
+}
+
+int ComplementsModel::rowCount(const QModelIndex &parent) const
+{
+	if (parent.isValid()) return 0;
+	return _items.size();
+}
+
+QVariant ComplementsModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || index.row() >= _items.size()) return QVariant();
+	const Item &item = _items[index.row()];
+	switch (role) {
+		case Qt::DisplayRole:
+			return item.repr;
+		case Qt::UserRole:
+			return item.kanji;
+		case Qt::FontRole:
+			if (!item.kanji) return _labelFont;
+			break;
+		case Qt::BackgroundRole:
+			if (!item.kanji) return QBrush(Qt::yellow);
+			break;
+		default:
+			break;
+	}
+	return QVariant();
+}
+
+Qt::ItemFlags ComplementsModel::flags(const QModelIndex &index) const
+{
+	if (!index.isValid()) return 0;
+	// Stroke number labels cannot be selected
+	if (!_items[index.row()].kanji) return Qt::ItemIsEnabled;
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+ComplementsList::ComplementsList(QWidget *parent) : QListView(parent), _model(this), baseFont(font()), labelFont(baseFont), _sscroll(verticalScrollBar())
 {
 	// Setup the fonts and size of the grid
 	baseFont.setPointSize(baseFont.pointSize() + 2);
 	setFont(baseFont);
 	setupGridSize();
+	_model.setLabelFont(labelFont);
+	// All the cells have the same size, which spares a layout pass over all the items
+	setUniformItemSizes(true);
+	setLayoutMode(QListView::Batched);
+	setModel(&_model);
 	setMouseTracking(true);
-	connect(this, SIGNAL(itemEntered(QListWidgetItem*)), this, SLOT(onItemEntered(QListWidgetItem*)));
+	connect(selectionModel(), SIGNAL(selectionChanged(QItemSelection, QItemSelection)), this, SIGNAL(itemSelectionChanged()));
+	connect(this, SIGNAL(entered(QModelIndex)), this, SLOT(onItemEntered(QModelIndex)));
 }
 
 void ComplementsList::setupGridSize()
@@ -60,33 +111,48 @@ void ComplementsList::setupGridSize()
 QSet<uint> ComplementsList::currentSelection() const
 {
 	QSet<uint> ret;
-	QList<QListWidgetItem *> selection(selectedItems());
-	foreach (const QListWidgetItem *item, selection)
-		ret << item->data(Qt::UserRole).toInt();
+	foreach (const QModelIndex &index, selectionModel()->selectedIndexes())
+		ret << _model.items()[index.row()].kanji;
 	return ret;
 }
 
-QListWidgetItem *ComplementsList::addComplement(const QString &repr, uint kanji)
+void ComplementsList::clear()
 {
-	QListWidgetItem *item = new QListWidgetItem(repr, this);
-	item->setData(Qt::UserRole, kanji);
-	return item;
+	_model.setItems(QVector<ComplementsModel::Item>());
 }
 
-QListWidgetItem *ComplementsList::setCurrentStrokeNbr(int strokeNbr)
+void ComplementsList::setComplements(const QList<QPair<uint, int> > &complements, const QSet<uint> &selection)
 {
-	QListWidgetItem *item = new QListWidgetItem(QString::number(strokeNbr), this);
-	item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
-	item->setBackground(Qt::yellow);
-	item->setFont(labelFont);
-	return item;
+	QVector<ComplementsModel::Item> items;
+	QList<int> selected;
+	int curStrokes = 0;
+	for (int i = 0; i < complements.size(); i++) {
+		const QPair<uint, int> &complement = complements[i];
+		ComplementsModel::Item item;
+		if (complement.second > curStrokes) {
+			curStrokes = complement.second;
+			item.kanji = 0;
+			item.repr = QString::number(curStrokes);
+			items << item;
+		}
+		if (selection.contains(complement.first)) selected << items.size();
+		item.kanji = complement.first;
+		item.repr = TextTools::unicodeToSingleChar(complement.first);
+		items << item;
+	}
+	_model.setItems(items);
+
+	// Select everything at once instead of one signal per item
+	QItemSelection itemSelection;
+	foreach (int row, selected) itemSelection.select(_model.index(row), _model.index(row));
+	selectionModel()->select(itemSelection, QItemSelectionModel::Select);
 }
 
-void ComplementsList::onItemEntered(QListWidgetItem *item)
+void ComplementsList::onItemEntered(const QModelIndex &index)
 {
 	// Disable tooltip for now. It just gets in the way.
-	//if (!(item->flags() & Qt::ItemIsSelectable)) return;
-	//Kanjidic2EntryFormatter::instance().showToolTip(KanjiEntryRef(item->text()).get(), QCursor::pos());
+	//if (!(index.flags() & Qt::ItemIsSelectable)) return;
+	//Kanjidic2EntryFormatter::instance().showToolTip(KanjiEntryRef(index.data().toString()).get(), QCursor::pos());
 }
 
 KanjiSelector::KanjiSelector(QWidget *parent) : QFrame(parent), _associate(0), _outOfSyncWithAssociate(false), _ignoreAssociateSignals(false)
@@ -180,6 +246,9 @@ uint KanjiSelector::complementCode(const QString &repr) const
 	return TextTools::singleCharToUnicode(repr);
 }
 
+/// Number of results sent to the results view at once
+#define RESULTS_BATCH_SIZE 256
+
 QSet<uint> KanjiSelector::getCandidates(const QSet<uint> &selection)
 {
 	QSet<uint> res;
@@ -191,12 +260,17 @@ QSet<uint> KanjiSelector::getCandidates(const QSet<uint> &selection)
 	if (!resQuery.isEmpty()) {
 		SQLite::Query query(Database::connection());
 		if (!query.exec(resQuery)) qDebug() << query.lastError().message();
+		QStringList batch;
 		while (query.next()) {
 			int ch(query.valueInt(0));
 			res << ch;
-			QString c(TextTools::unicodeToSingleChar(ch));
-			emit foundResult(c);
+			batch << TextTools::unicodeToSingleChar(ch);
+			if (batch.size() == RESULTS_BATCH_SIZE) {
+				emit foundResults(batch);
+				batch.clear();
+			}
 		}
+		if (!batch.isEmpty()) emit foundResults(batch);
 	}
 	emit endQuery();
 	return res;
@@ -205,13 +279,12 @@ QSet<uint> KanjiSelector::getCandidates(const QSet<uint> &selection)
 void KanjiSelector::updateComplementsList(const QSet<uint> &selection, const QSet<uint> &candidates)
 {
 	_complementsList->blockSignals(true);
-	_complementsList->clear();
 	_currentComplements = QSet<QPair<uint, QString> >();
+	QList<QPair<uint, int> > complements;
 	QString compQuery(getComplementsQuery(selection, candidates));
 	if (!compQuery.isEmpty()) {
 		SQLite::Query query(Database::connection());
 		if (!query.exec(compQuery)) qDebug() << query.lastError().message();
-		int curStrokes = 0;
 		uint curKanji = 0;
 		while (query.next()) {
 			uint kanji = query.valueUInt(0);
@@ -221,17 +294,11 @@ void KanjiSelector::updateComplementsList(const QSet<uint> &selection, const QSe
 			// Do not display kanji that are already in candidates, excepted if they
 			// are part of the current selection
 			if (candidates.contains(kanji) && !selection.contains(kanji)) continue;
-			int strokeNbr = query.valueUInt(1);
-			if (strokeNbr > curStrokes) {
-				_complementsList->setCurrentStrokeNbr(strokeNbr);
-				curStrokes = strokeNbr;
-			}
-			QString repr(TextTools::unicodeToSingleChar(kanji));
-			QListWidgetItem *item = _complementsList->addComplement(repr, kanji);
-			if (selection.contains(kanji)) item->setSelected(true);
-			_currentComplements << QPair<uint, QString>(kanji, repr);
+			complements << QPair<uint, int>(kanji, query.valueUInt(1));
+			_currentComplements << QPair<uint, QString>(kanji, TextTools::unicodeToSingleChar(kanji));
 		}
 	}
+	_complementsList->setComplements(complements, selection);
 	_complementsList->blockSignals(false);
 }
 
@@ -379,7 +446,7 @@ KanjiInputter::KanjiInputter(KanjiSelector *selector, bool useLineEdit, QWidget
 	layout->addWidget(_selector);
 	connect(selector, SIGNAL(startQuery()), _results, SLOT(startReceive()));
 	connect(selector, SIGNAL(endQuery()), _results, SLOT(endReceive()));
-	connect(selector, SIGNAL(foundResult(QString)), _results, SLOT(addItem(QString)));
+	connect(selector, SIGNAL(foundResults(QStringList)), _results, SLOT(addItems(QStringList)));
 	connect(_results, SIGNAL(kanjiSelected(QString)), this, SIGNAL(kanjiSelected(QString)));
 	resize(_selector->complementsList()->gridSize().width() * 10 + _selector->complementsList()->verticalScrollBar()->width(), _selector->complementsList()->gridSize().height() * 7 + _results->sizeHint().height());
 }
@@ -23,32 +23,74 @@
 
 #include <QHash>
 #include <QValidator>
-#include <QListWidget>
+#include <QListView>
+#include <QAbstractListModel>
+#include <QVector>
+#include <QSet>
+#include <QPair>
+
+/**
+ * Model holding the complements of the current selection, along with
+ * the stroke number labels that separate them.
+ */
+class ComplementsModel : public QAbstractListModel
+{
+	Q_OBJECT
+public:
+	/// A complement character, or a stroke number label if kanji is 0
+	struct Item {
+		uint kanji;
+		QString repr;
+	};
+
+private:
+	QVector<Item> _items;
+	QFont _labelFont;
+
+public:
+	ComplementsModel(QObject *parent = 0);
+	void setLabelFont(const QFont &font) { _labelFont = font; }
+	/// Replaces all the items of the model at once
+	void setItems(const QVector<Item> &items);
+	const QVector<Item> &items() const { return _items; }
+
+	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+	virtual Qt::ItemFlags flags(const QModelIndex &index) const;
+};
 
 /**
  * A List view designed to display the complements of the current selection.
  */
-class ComplementsList : public QListWidget
+class ComplementsList : public QListView
 {
 	Q_OBJECT
 private:
+	ComplementsModel _model;
 	QFont baseFont;
 	QFont labelFont;
 	ScrollBarSmoothScroller _sscroll;
 	void setupGridSize();
 
 protected slots:
-	void onItemEntered(QListWidgetItem *item);
+	void onItemEntered(const QModelIndex &index);
 
 public:
 	ComplementsList(QWidget *parent = 0);
 	QSet<uint> currentSelection() const;
+	int count() const { return _model.rowCount(); }
 
 public slots:
-	/// Add a complement character to the list
-	QListWidgetItem *addComplement(const QString &repr, uint kanji);
-	/// Start a new series of characters with the given stroke number
-	QListWidgetItem *setCurrentStrokeNbr(int strokeNbr);
+	void clear();
+	/**
+	 * Replaces the displayed complements by the given (kanji, stroke number)
+	 * pairs, and selects the ones that are part of selection. A label is
+	 * inserted every time the stroke number increases.
+	 */
+	void setComplements(const QList<QPair<uint, int> > &complements, const QSet<uint> &selection);
+
+signals:
+	void itemSelectionChanged();
 };
 
 #include "gui/kanjidic2/ui_KanjiSelector.h"
@@ -92,7 +134,7 @@ protected:
 	
 	/**
 	 * Returns the list of candidates corresponding to the given selection. Also
-	 * emits the startQuery, foundResult and endQuery signals as results are found.
+	 * emits the startQuery, foundResults and endQuery signals as results are found.
 	 */
 	virtual QSet<uint> getCandidates(const QSet<uint> &selection);
 	virtual void updateComplementsList(const QSet<uint> &selection, const QSet<uint> &candidates);
@@ -127,7 +169,8 @@ signals:
 	void selectionChanged(const QSet<uint> &selection);
 
 	void startQuery();
-	void foundResult(const QString &kanji);
+	/// Emitted with batches of results as they are found
+	void foundResults(const QStringList &kanji);
 	void endQuery();
 };
 
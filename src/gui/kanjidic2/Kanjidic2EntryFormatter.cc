@@ -80,16 +80,12 @@ PreferenceItem<bool> Kanjidic2EntryFormatter::printGrid("kanjidic", "printStroke
 
 QString Kanjidic2EntryFormatter::getQueryUsedInWordsSql(int kanji, int limit, bool onlyStudied)
 {
-	const QString queryUsedInWordsSql("select distinct " QUOTEMACRO(JMDICTENTRY_GLOBALID) ", jmdict.entries.id "
-		"from jmdict.entries "
-		"join jmdict.kanjiChar on jmdict.kanjiChar.id = jmdict.entries.id "
-		"join jmdict.senses as senses on senses.id = jmdict.entries.id "
-			"and senses.priority = 0 "
-			"and senses.misc & %4 = 0 "
-		"%3join training on training.id = jmdict.entries.id and training.type = " QUOTEMACRO(JMDICTENTRY_GLOBALID) " "
-		"left join jmdict.jlpt on jmdict.entries.id = jmdict.jlpt.id "
-		"where jmdict.kanjiChar.kanji = %1 and jmdict.kanjiChar.priority = 0 "
-		"order by training.dateAdded is null ASC, training.score ASC, jmdict.jlpt.level DESC, jmdict.entries.frequency DESC "
+	// Words are ranked by JLPT level and frequency when the database is built
+	const QString queryUsedInWordsSql("select distinct " QUOTEMACRO(JMDICTENTRY_GLOBALID) ", kanjiWords.id "
+		"from jmdict.kanjiWords as kanjiWords "
+		"%3join training on training.id = kanjiWords.id and training.type = " QUOTEMACRO(JMDICTENTRY_GLOBALID) " "
+		"where kanjiWords.kanji = %1 and kanjiWords.misc & %4 = 0 "
+		"order by training.dateAdded is null ASC, training.score ASC, kanjiWords.rank ASC "
 		"limit %2");
 
 	return queryUsedInWordsSql.arg(kanji).arg(limit).arg(onlyStudied ? "" : "left ").arg(JMdictEntrySearcher::miscFilterMask() | (1 << JMdictPlugin::miscBitShifts()["uk"]));
@@ -97,13 +93,12 @@ QString Kanjidic2EntryFormatter::getQueryUsedInWordsSql(int kanji, int limit, bo
 
 QString Kanjidic2EntryFormatter::getQueryUsedInKanjiSql(int kanji, int limit, bool onlyStudied)
 {
-	const QString queryUsedInKanjiSql("select distinct " QUOTEMACRO(KANJIDIC2ENTRY_GLOBALID) ", ks1.kanji "
-		"from kanjidic2.strokeGroups as ks1 "
-		"join kanjidic2.entries on ks1.isRoot == 1 and ks1.kanji = entries.id "
-		"%3join training on training.type = " QUOTEMACRO(KANJIDIC2ENTRY_GLOBALID) " and training.id = entries.id "
-		"where (ks1.element = %1 or ks1.original = %1) "
-		"and ks1.kanji != %1 "
-		"order by training.dateAdded is null ASC, training.score ASC, entries.strokeCount, entries.jlpt DESC "
+	// Kanji are ranked by stroke count and JLPT level when the database is built
+	const QString queryUsedInKanjiSql("select distinct " QUOTEMACRO(KANJIDIC2ENTRY_GLOBALID) ", componentKanji.kanji "
+		"from kanjidic2.componentKanji as componentKanji "
+		"%3join training on training.type = " QUOTEMACRO(KANJIDIC2ENTRY_GLOBALID) " and training.id = componentKanji.kanji "
+		"where componentKanji.component = %1 "
+		"order by training.dateAdded is null ASC, training.score ASC, componentKanji.rank ASC "
 		"limit %2");
 
 	return queryUsedInKanjiSql.arg(kanji).arg(limit).arg(onlyStudied ? "" : "left ");
@@ -119,12 +114,36 @@ Kanjidic2EntryFormatter::Kanjidic2EntryFormatter(QObject* parent) : EntryFormatt
 {
 }
 
-void Kanjidic2EntryFormatter::draw(const ConstEntryPointer &entry, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont) const
+QList<ConstEntryPointer> Kanjidic2EntryFormatter::getUsedInWords(int kanji, int limit, bool onlyStudied)
 {
-	drawCustom(entry.staticCast<const Kanjidic2Entry>(), painter, rectangle, usedSpace, textFont);
+	QList<ConstEntryPointer> ret;
+	SQLite::Query query(Database::connection());
+	query.exec(getQueryUsedInWordsSql(kanji, limit, onlyStudied));
+	while (query.next()) {
+		ConstEntryPointer word(JMdictEntryRef(query.valueInt(1)).get());
+		if (word) ret << word;
+	}
+	return ret;
 }
 
-void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont, int printSize, bool printWithFont, bool printMeanings, bool printOnyomi, bool printKunyomi, bool printComponents, bool printOnlyStudiedComponents, int maxWordsToPrint, bool printOnlyStudiedVocab, bool printStrokesNumbers, int printStrokesNumbersSize, bool printGrid) const
+QList<ConstEntryPointer> Kanjidic2EntryFormatter::drawDependencies(const ConstEntryPointer &_entry) const
+{
+	ConstKanjidic2EntryPointer entry(_entry.staticCast<const Kanjidic2Entry>());
+	QList<ConstEntryPointer> ret;
+	if (printComponents.value()) foreach (const KanjiComponent *c, entry->rootComponents()) {
+		ret << getMeaningEntry(c) << getShapeEntry(c);
+	}
+	// Words come last, in the order they are displayed
+	if (maxWordsToPrint.value()) ret << getUsedInWords(entry->id(), maxWordsToPrint.value(), printOnlyStudiedVocab.value());
+	return ret;
+}
+
+void Kanjidic2EntryFormatter::draw(const ConstEntryPointer &entry, const QList<ConstEntryPointer> &dependencies, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont) const
+{
+	drawCustom(entry.staticCast<const Kanjidic2Entry>(), painter, rectangle, usedSpace, textFont, printSize.value(), printWithFont.value(), printMeanings.value(), printOnyomi.value(), printKunyomi.value(), printComponents.value(), printOnlyStudiedComponents.value(), maxWordsToPrint.value(), printOnlyStudiedVocab.value(), printStrokesNumbers.value(), strokesNumbersSize.value(), printGrid.value(), &dependencies);
+}
+
+void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont, int printSize, bool printWithFont, bool printMeanings, bool printOnyomi, bool printKunyomi, bool printComponents, bool printOnlyStudiedComponents, int maxWordsToPrint, bool printOnlyStudiedVocab, bool printStrokesNumbers, int printStrokesNumbersSize, bool printGrid, const QList<ConstEntryPointer> *words) const
 {
 	QFont kanjiFont;
 	kanjiFont.setPointSizeF(textFont.pointSize() * 5);
@@ -140,9 +159,10 @@ void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry
 		kanjiFont.setPointSize(kanjiFont.pointSize() - 1);
 
 	QRectF textBB;
+	// Strokes are printed as vectors, but their paths only need to be built once
+	KanjiRenderer renderer(entry);
 	// Render the grid, if relevant
 	if (printGrid) {
-		KanjiRenderer renderer(entry);
 		painter.save();
 		QPen pen;
 		pen.setWidth(2);
@@ -158,7 +178,6 @@ void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry
 	// Draw the kanji
 	if (!printWithFont) {
 		//painter.setFont(kanjiFont);
-		KanjiRenderer renderer(entry);
 		painter.save();
 		QPen pen(painter.pen());
 		pen.setWidth(5);
@@ -185,7 +204,6 @@ void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry
 	}
 	
 	if (printStrokesNumbers) {
-		KanjiRenderer renderer(entry);
 		painter.save();
 		painter.translate((leftArea.width() - printSize) / 2.0, 0.0);
 		painter.scale(printSize / 109.0, printSize / 109.0);
@@ -274,11 +292,11 @@ void Kanjidic2EntryFormatter::drawCustom(const ConstKanjidic2EntryPointer& entry
 
 	// Now display words using this kanji
 	if (maxWordsToPrint) {
-		SQLite::Query query(Database::connection());
-		query.exec(getQueryUsedInWordsSql(entry->id(), maxWordsToPrint, printOnlyStudiedVocab));
 		painter.setFont(textFont);
-		while (query.next()) {
-			ConstJMdictEntryPointer jmEntry(JMdictEntryRef(query.valueInt(1)).get());
+		QList<ConstEntryPointer> usedInWords(words ? *words : getUsedInWords(entry->id(), maxWordsToPrint, printOnlyStudiedVocab));
+		foreach (const ConstEntryPointer &word, usedInWords) {
+			if (word->type() != JMDICTENTRY_GLOBALID) continue;
+			ConstJMdictEntryPointer jmEntry(word.staticCast<const JMdictEntry>());
 
 			QString str = QFontMetrics(painter.font(), painter.device()).elidedText(jmEntry->shortVersion(Entry::TinyVersion), Qt::ElideRight, (int) rightArea.width());
 			textBB = painter.boundingRect(rightArea, Qt::AlignLeft, str);
@@ -57,8 +57,17 @@ public:
 	static QString getQueryUsedInWordsSql(int kanji, int limit = maxWordsToDisplay.value(), bool onlyStudied = showOnlyStudiedVocab.value());
 	static QString getQueryUsedInKanjiSql(int kanji, int limit = maxCompoundsToDisplay.value(), bool onlyStudied = showOnlyStudiedCompounds.value());
 
-	virtual void draw(const ConstEntryPointer &entry, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const;
-	void drawCustom(const ConstKanjidic2EntryPointer& entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont = QFont(), int _printSize = printSize.value(), bool _printWithFont = printWithFont.value(), bool _printMeanings = printMeanings.value(), bool _printOnyomi = printOnyomi.value(), bool _printKunyomi = printKunyomi.value(), bool _printComponents = printComponents.value(), bool _printOnlyStudiedComponents = printOnlyStudiedComponents.value(), int _maxWordsToPrint = maxWordsToPrint.value(), bool _printOnlyStudiedVocab = printOnlyStudiedVocab.value(), bool _printStrokesNumbers = printStrokesNumbers.value(), int _printStrokesNumbersSize = strokesNumbersSize.value(), bool _printGrid = printGrid.value()) const;
+	/// Returns the entries of the words using kanji, as listed by getQueryUsedInWordsSql()
+	static QList<ConstEntryPointer> getUsedInWords(int kanji, int limit, bool onlyStudied);
+
+	/// Returns the components of entry and the words using it
+	virtual QList<ConstEntryPointer> drawDependencies(const ConstEntryPointer &entry) const;
+	virtual void draw(const ConstEntryPointer &entry, const QList<ConstEntryPointer> &dependencies, QPainter &painter, const QRectF &rectangle, QRectF &usedSpace, const QFont &textFont = QFont()) const;
+	/**
+	 * If words is not null, the words using the kanji are taken from it
+	 * instead of being queried from the database.
+	 */
+	void drawCustom(const ConstKanjidic2EntryPointer& entry, QPainter& painter, const QRectF& rectangle, QRectF& usedSpace, const QFont& textFont = QFont(), int _printSize = printSize.value(), bool _printWithFont = printWithFont.value(), bool _printMeanings = printMeanings.value(), bool _printOnyomi = printOnyomi.value(), bool _printKunyomi = printKunyomi.value(), bool _printComponents = printComponents.value(), bool _printOnlyStudiedComponents = printOnlyStudiedComponents.value(), int _maxWordsToPrint = maxWordsToPrint.value(), bool _printOnlyStudiedVocab = printOnlyStudiedVocab.value(), bool _printStrokesNumbers = printStrokesNumbers.value(), int _printStrokesNumbersSize = strokesNumbersSize.value(), bool _printGrid = printGrid.value(), const QList<ConstEntryPointer> *words = 0) const;
 
 	static PreferenceItem<bool> showReadings;
 	static PreferenceItem<bool> showNanori;
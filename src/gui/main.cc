@@ -21,16 +21,19 @@
 #include "core/Preferences.h"
 #include "core/Lang.h"
 #include "core/Database.h"
+#include "core/DatabaseMaintenance.h"
 #include "core/Tag.h"
 #include "core/EntryListCache.h"
 #include "core/Entry.h"
 #include "core/EntriesCache.h"
 #include "core/Plugin.h"
+#include "core/StartupTrace.h"
 #include "core/jmdict/JMdictPlugin.h"
 #include "core/kanjidic2/Kanjidic2Plugin.h"
 //#include "core/tatoeba/TatoebaPlugin.h"
 #include "gui/PreferencesWindow.h"
 #include "gui/MainWindow.h"
+#include "gui/QueryLogDialog.h"
 
 #include "core/jmdict/JMdictPlugin.h"
 #include "core/kanjidic2/Kanjidic2Plugin.h"
@@ -39,6 +42,8 @@
 
 // Required for exit()
 #include <stdlib.h>
+// Required for strcmp()
+#include <string.h>
 
 #include <QApplication>
 #include <QSettings>
@@ -47,6 +52,10 @@
 #include <QLocale>
 #include <QMessageBox>
 #include <QLibraryInfo>
+#include <QProgressDialog>
+#include <QFutureWatcher>
+#include <QEventLoop>
+#include <QtConcurrentRun>
 
 // The version must be defined by the compiler
 #ifndef VERSION
@@ -111,6 +120,32 @@ void migrateOldData()
 	}
 }
 
+/**
+ * Converts user databases created before incremental vacuum was enabled, so
+ * that the maintenance can reclaim their free pages. This requires a full
+ * VACUUM, which is run in the background while a progress dialog keeps the
+ * program responsive. Must be called before anything else uses the user
+ * database.
+ */
+void convertUserDB()
+{
+	DatabaseMaintenance *maintenance = Database::maintenance();
+	if (!maintenance || !maintenance->needsConversion()) return;
+
+	QProgressDialog progressDialog(QCoreApplication::translate("main.cc", "Compacting user database, please wait..."), QString(), 0, 0);
+	progressDialog.setWindowModality(Qt::ApplicationModal);
+	progressDialog.setMinimumDuration(0);
+	progressDialog.show();
+	// The maintenance slices must not use the connection in the meantime
+	maintenance->stop();
+	QFutureWatcher<bool> watcher;
+	QEventLoop loop;
+	QObject::connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+	watcher.setFuture(QtConcurrent::run(maintenance, &DatabaseMaintenance::convertToIncrementalVacuum));
+	loop.exec();
+	maintenance->start();
+}
+
 void checkConfigurationVersion()
 {
 	// Are we running the program for the first time or updating from a previous version?
@@ -180,9 +215,18 @@ int main(int argc, char *argv[])
 {
 	extern void qt_set_sequence_auto_mnemonic(bool b);
 
+	// Print the time taken by each startup phase
+	bool queryLog = false;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--startup-trace")) StartupTrace::enable();
+		// Record slow queries for this session regardless of the preferences
+		else if (!strcmp(argv[i], "--query-log")) queryLog = true;
+	}
+
 	// Seed the random number generator
 	qsrand(QDateTime::currentDateTime().toTime_t());
 	QApplication app(argc, argv);
+	StartupTrace::phase("Application created");
 
 	// Enable auto-mnemonics for Mac OS X. Ideally this would only
 	// be called on Mac OS X.
@@ -199,6 +243,9 @@ int main(int argc, char *argv[])
 	checkConfigurationVersion();
 
 	checkUserProfileDirectory();
+	QueryLogDialog::applyPreferences();
+	if (queryLog) SQLite::QueryProfiler::setEnabled(true);
+	StartupTrace::phase("Settings and profile checked");
 
 	// Get the default font from the settings, if set
 	if (!MainWindow::applicationFont.value().isEmpty()) {
@@ -225,6 +272,7 @@ int main(int argc, char *argv[])
 	if (appTranslator.load(lookForFile("i18n/tagainijisho_" + locale + ".qm"))) app.installTranslator(&appTranslator);
 	// Load the translations for Qt
 	if (qtTranslator.load(QDir(QLibraryInfo::location(QLibraryInfo::TranslationsPath)).absoluteFilePath(QString("qt_%1.qm").arg(locale))) || qtTranslator.load(lookForFile(QString("i18n/qt_%1.qm").arg(locale)))) app.installTranslator(&qtTranslator);
+	StartupTrace::phase("Translations loaded");
 
 	// Register meta-types
 	qRegisterMetaType<EntryRef>("EntryRef");
@@ -252,8 +300,10 @@ int main(int argc, char *argv[])
 	} else if (!dbErrors.empty()) {
 		QMessageBox::warning(0, "Tagaini Jisho warning", dbErrors.join("<p>"));
 	}
+	StartupTrace::phase("User database opened");
+	convertUserDB();
 
-	// Initialize tags
+	// Start loading the known tags in the background
 	Tag::init();
 
 	// Register core plugins
@@ -266,9 +316,11 @@ int main(int argc, char *argv[])
 		qFatal("Error registering JMdict plugin!");
 	//if (!Plugin::registerPlugin(tatoebaPlugin))
 		//qFatal("Error registering Tatoeba plugin!");
+	StartupTrace::phase("Dictionaries attached");
 
 	// Create the main window
 	MainWindow *mainWindow = new MainWindow();
+	StartupTrace::phase("Main window created");
 
 	// Register GUI plugins
 	Plugin *kanjidic2GUIPlugin = new Kanjidic2GUIPlugin();
@@ -277,11 +329,13 @@ int main(int argc, char *argv[])
 		qFatal("Error registering JMdict GUI plugin!");
 	if (!Plugin::registerPlugin(kanjidic2GUIPlugin))
 		qFatal("Error registering kanjidic2 GUI plugin!");
+	StartupTrace::phase("GUI plugins registered");
 
 	mainWindow->restoreWholeState();
 
 	// Show the main window and run the program
 	mainWindow->show();
+	StartupTrace::phase("Main window shown");
 	int ret = app.exec();
 
 	// Remove GUI plugins
@@ -313,5 +367,8 @@ int main(int argc, char *argv[])
 	// Clean the entries cache
 	EntriesCache::cleanup();
 
+	// Write the preferences changed during the last moments
+	PreferencesStore::instance().flush();
+
 	return ret;
 }
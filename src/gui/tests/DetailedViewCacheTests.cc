@@ -0,0 +1,103 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "gui/tests/DetailedViewCacheTests.h"
+#include "gui/DetailedView.h"
+
+#define CACHED_ENTRY_TYPE 100
+
+class CachedEntry : public Entry
+{
+public:
+	CachedEntry(EntryId id) : Entry(CACHED_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString("entry %1").arg(id()); }
+	virtual QStringList readings() const { return QStringList(); }
+	virtual QStringList meanings() const { return QStringList(); }
+};
+
+void DetailedViewCacheTests::fragments()
+{
+	DetailedViewCache &cache(DetailedViewCache::instance());
+	cache.clear();
+	EntryPointer entry(new CachedEntry(1));
+	QString html;
+	QVERIFY(!cache.html(entry, html));
+	cache.setHtml(entry, "<p>1</p>");
+	QVERIFY(cache.html(entry, html));
+	QCOMPARE(html, QString("<p>1</p>"));
+
+	// Changes of other entries do not matter
+	EntryPointer other(new CachedEntry(2));
+	other->emitChanged();
+	QVERIFY(cache.html(entry, html));
+
+	// Changes of the entry invalidate its fragment
+	entry->emitChanged();
+	QVERIFY(!cache.html(entry, html));
+
+	// Another instance of the same entry may have been modified while not
+	// being watched
+	cache.setHtml(entry, "<p>1</p>");
+	EntryPointer reloaded(new CachedEntry(1));
+	QVERIFY(!cache.html(reloaded, html));
+}
+
+void DetailedViewCacheTests::jobResults()
+{
+	DetailedViewCache &cache(DetailedViewCache::instance());
+	cache.clear();
+	EntryPointer entry(new CachedEntry(1));
+	QList<EntryRef> results, cached;
+	results << EntryRef(CACHED_ENTRY_TYPE, 2) << EntryRef(CACHED_ENTRY_TYPE, 3);
+	QString sql("select 1");
+
+	cache.setJobResults(sql, results, DetailedViewCache::jobsStamp());
+	QVERIFY(cache.jobResults(sql, cached));
+	QCOMPARE(cached, results);
+
+	// Results depend on all the entries
+	entry->emitChanged();
+	QVERIFY(!cache.jobResults(sql, cached));
+
+	// Results invalidated while being fetched are not cached
+	int stamp = DetailedViewCache::jobsStamp();
+	entry->emitChanged();
+	cache.setJobResults(sql, results, stamp);
+	QVERIFY(!cache.jobResults(sql, cached));
+}
+
+void DetailedViewCacheTests::preferences()
+{
+	DetailedViewCache &cache(DetailedViewCache::instance());
+	cache.clear();
+	EntryPointer entry(new CachedEntry(1));
+	QString html;
+	QList<EntryRef> results, cached;
+	QString sql("select 1");
+	cache.setHtml(entry, "<p>1</p>");
+	cache.setJobResults(sql, results, DetailedViewCache::jobsStamp());
+
+	PreferenceItem<int> pref("tests", "detailedViewCacheTest", 0);
+	pref.set(1);
+	QVERIFY(!cache.html(entry, html));
+	QVERIFY(!cache.jobResults(sql, cached));
+	pref.reset();
+}
+
+QTEST_MAIN(DetailedViewCacheTests)
@@ -0,0 +1,178 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "gui/tests/EntriesExporterTests.h"
+#include "gui/EntriesExporter.h"
+#include "core/Database.h"
+
+#include <QTemporaryFile>
+#include <QFile>
+#include <QFileInfo>
+
+/// Entry type that does not clash with the ones of the plugins
+#define EXPORTED_ENTRY_TYPE 100
+
+static const QString kanji(QString::fromUtf8("\xe6\xbc\xa2\xe5\xad\x97"));
+
+/**
+ * Entry that is not backed by any dictionary.
+ */
+class ExportedEntry : public Entry
+{
+public:
+	ExportedEntry(EntryId id) : Entry(EXPORTED_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << kanji + QString::number(id()); }
+	virtual QStringList readings() const { return QStringList() << QString("reading %1").arg(id()); }
+	virtual QStringList meanings() const
+	{
+		QStringList ret;
+		ret << QString("first \"meaning\" of %1").arg(id()) << QString("second meaning\tof %1").arg(id());
+		return ret;
+	}
+};
+
+class ExportedEntryLoader : public EntryLoader
+{
+public:
+	virtual Entry *loadEntry(EntryId id)
+	{
+		Entry *ret = new ExportedEntry(id);
+		loadMiscData(ret);
+		return ret;
+	}
+};
+
+static ExportedEntryLoader *loader = 0;
+
+/**
+ * Returns the maximum memory used by this process so far, in kB, or -1 if
+ * it is unknown.
+ */
+static int peakMemory()
+{
+	QFile status("/proc/self/status");
+	if (!status.open(QIODevice::ReadOnly)) return -1;
+	foreach (const QByteArray &line, status.readAll().split('\n')) {
+		if (line.startsWith("VmHWM:")) return line.mid(6).trimmed().split(' ')[0].toInt();
+	}
+	return -1;
+}
+
+QList<EntryRef> EntriesExporterTests::refs(int count)
+{
+	QList<EntryRef> ret;
+	for (int i = 0; i < count; i++) ret << EntryRef(EXPORTED_ENTRY_TYPE, i + 1);
+	return ret;
+}
+
+void EntriesExporterTests::initTestCase()
+{
+	QStringList errors;
+	QVERIFY(Database::init(QString(), true, errors));
+	EntriesCache::init();
+	loader = new ExportedEntryLoader();
+	QVERIFY(EntriesCache::instance().addLoader(EXPORTED_ENTRY_TYPE, loader));
+}
+
+void EntriesExporterTests::cleanupTestCase()
+{
+	QVERIFY(EntriesCache::instance().removeLoader(EXPORTED_ENTRY_TYPE));
+	EntriesCache::cleanup();
+	delete loader;
+	Database::stop();
+}
+
+void EntriesExporterTests::exportFormats()
+{
+	QTemporaryFile outFile;
+	QVERIFY(outFile.open());
+
+	TSVExportFormat tsv;
+	EntriesExporter tsvExporter(&tsv, refs(2), outFile.fileName());
+	tsvExporter.start();
+	QVERIFY(tsvExporter.wait());
+	QVERIFY(tsvExporter.success());
+	QList<QByteArray> lines(outFile.readAll().split('\n'));
+	QCOMPARE(lines.size(), 3);
+	QCOMPARE(QString::fromUtf8(lines[1]), kanji + QString("2\treading 2\tfirst \"meaning\" of 2, second meaning\tof 2"));
+
+	AnkiExportFormat anki;
+	EntriesExporter ankiExporter(&anki, refs(1), outFile.fileName());
+	ankiExporter.start();
+	QVERIFY(ankiExporter.wait());
+	QVERIFY(ankiExporter.success());
+	outFile.seek(0);
+	QCOMPARE(QString::fromUtf8(outFile.readAll()), QString("\"") + kanji + QString("1\",\"reading 1<br/> (1) first \"\"meaning\"\" of 1 (2) second meaning\tof 1\",\"\"\n"));
+
+	JSONLinesExportFormat json;
+	EntriesExporter jsonExporter(&json, refs(1), outFile.fileName());
+	jsonExporter.start();
+	QVERIFY(jsonExporter.wait());
+	QVERIFY(jsonExporter.success());
+	outFile.seek(0);
+	QCOMPARE(QString::fromUtf8(outFile.readAll()), QString("{\"type\":100,\"id\":1,\"writings\":[\"") + kanji + QString("1\"],\"readings\":[\"reading 1\"],\"meanings\":[\"first \\\"meaning\\\" of 1\",\"second meaning\\tof 1\"],\"tags\":[]}\n"));
+}
+
+void EntriesExporterTests::cancelExport()
+{
+	QString fileName;
+	{
+		QTemporaryFile outFile;
+		QVERIFY(outFile.open());
+		fileName = outFile.fileName();
+	}
+	JSONLinesExportFormat json;
+	EntriesExporter exporter(&json, refs(10000), fileName);
+	exporter.cancel();
+	exporter.start();
+	QVERIFY(exporter.wait());
+	QVERIFY(!exporter.success());
+	QVERIFY(exporter.canceled());
+	// Incomplete exports are removed
+	QVERIFY(!QFile::exists(fileName));
+}
+
+void EntriesExporterTests::exportBenchmark_data()
+{
+	QTest::addColumn<int>("format");
+
+	for (int i = 0; i < EntriesExporter::formats().size(); i++)
+		QTest::newRow(EntriesExporter::formats()[i]->name().remove('&').toUtf8().constData()) << i;
+}
+
+#define EXPORTED_ENTRIES 50000
+void EntriesExporterTests::exportBenchmark()
+{
+	QFETCH(int, format);
+
+	QTemporaryFile outFile;
+	QVERIFY(outFile.open());
+	QList<EntryRef> entries(refs(EXPORTED_ENTRIES));
+	EntriesExporter exporter(EntriesExporter::formats()[format], entries, outFile.fileName());
+	int memBefore = peakMemory();
+	QBENCHMARK_ONCE {
+		exporter.start();
+		QVERIFY(exporter.wait());
+	}
+	QVERIFY(exporter.success());
+	QVERIFY(QFileInfo(outFile.fileName()).size() > 0);
+	if (memBefore != -1) qDebug("Peak memory: %d kB (%d kB before export)", peakMemory(), memBefore);
+}
+
+QTEST_MAIN(EntriesExporterTests)
@@ -0,0 +1,124 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "gui/tests/EntriesPrinterTests.h"
+#include "gui/EntriesPrinter.h"
+#include "gui/EntryFormatter.h"
+
+#include <QPrinter>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QThread>
+#include <QFileInfo>
+
+/// Entry type that does not clash with the ones of the plugins
+#define PRINTED_ENTRY_TYPE 100
+#define PRINTED_ENTRIES 3000
+
+/**
+ * Entry that is not backed by any database, with enough text to fill a
+ * few lines.
+ */
+class PrintedEntry : public Entry
+{
+public:
+	PrintedEntry(EntryId id) : Entry(PRINTED_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString("Entry %1").arg(id()); }
+	virtual QStringList readings() const { return QStringList(); }
+	virtual QStringList meanings() const
+	{
+		QStringList ret;
+		for (unsigned int i = 0; i < 3 + id() % 5; i++) ret << QString("meaning number %1 of entry %2").arg(i + 1).arg(id());
+		return ret;
+	}
+	virtual QString shortVersion(VersionLength length = ShortVersion) const
+	{
+		Q_UNUSED(length);
+		return writings()[0] + ": " + meanings().join(", ");
+	}
+};
+
+class PrintedEntryFormatter : public EntryFormatter
+{
+public:
+	PrintedEntryFormatter() : EntryFormatter() {}
+};
+
+static PrintedEntryFormatter *formatter = 0;
+
+void EntriesPrinterTests::initTestCase()
+{
+	formatter = new PrintedEntryFormatter();
+	QVERIFY(EntryFormatter::registerFormatter(PRINTED_ENTRY_TYPE, formatter));
+	for (int i = 0; i < PRINTED_ENTRIES; i++) {
+		QStandardItem *item;
+		// Insert a label from time to time, like lists with sub-lists
+		if (i % 100 == 0) {
+			item = new QStandardItem(QString("Part %1").arg(i / 100 + 1));
+			model.appendRow(item);
+		}
+		item = new QStandardItem();
+		item->setData(QVariant::fromValue(EntryPointer(new PrintedEntry(i + 1))), Entry::EntryRole);
+		model.appendRow(item);
+	}
+}
+
+void EntriesPrinterTests::cleanupTestCase()
+{
+	model.clear();
+	QVERIFY(EntryFormatter::removeFormatter(PRINTED_ENTRY_TYPE));
+	delete formatter;
+}
+
+void EntriesPrinterTests::printBenchmark_data()
+{
+	QTest::addColumn<bool>("booklet");
+	QTest::addColumn<int>("threads");
+
+	QTest::newRow("Regular, 1 thread") << false << 1;
+	QTest::newRow("Regular, all threads") << false << QThread::idealThreadCount();
+	QTest::newRow("Booklet, all threads") << true << QThread::idealThreadCount();
+}
+
+void EntriesPrinterTests::printBenchmark()
+{
+	QFETCH(bool, booklet);
+	QFETCH(int, threads);
+
+	QModelIndexList indexes;
+	for (int i = 0; i < model.rowCount(); i++) indexes << model.index(i, 0);
+
+	QTemporaryFile pdfFile;
+	QVERIFY(pdfFile.open());
+	QPrinter printer(QPrinter::HighResolution);
+	printer.setOutputFormat(QPrinter::PdfFormat);
+	printer.setOutputFileName(pdfFile.fileName());
+
+	int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+	QThreadPool::globalInstance()->setMaxThreadCount(threads);
+	EntriesPrinter entriesPrinter;
+	QBENCHMARK_ONCE {
+		if (booklet) entriesPrinter.printBooklet(indexes, &printer);
+		else entriesPrinter.print(indexes, &printer);
+	}
+	QThreadPool::globalInstance()->setMaxThreadCount(maxThreads);
+	QVERIFY(QFileInfo(pdfFile.fileName()).size() > 0);
+}
+
+QTEST_MAIN(EntriesPrinterTests)
@@ -0,0 +1,176 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gui/tests/EntryDelegateTests.h"
+#include "gui/EntryDelegate.h"
+
+#include <QAbstractListModel>
+#include <QListView>
+#include <QPainter>
+#include <QScrollBar>
+#include <QPixmap>
+#include <QTime>
+
+#define DELEGATE_ENTRY_TYPE 101
+#define BENCHMARK_ROWS 10000
+
+class DelegateEntry : public Entry
+{
+public:
+	DelegateEntry(EntryId id) : Entry(DELEGATE_ENTRY_TYPE, id) {}
+
+	virtual QStringList writings() const { return QStringList() << QString::fromUtf8("\xe9\xa3\x9f\xe3\x81\xb9\xe3\x82\x8b") << QString::fromUtf8("\xe5\x96\xb0\xe3\x81\xb9\xe3\x82\x8b"); }
+	virtual QStringList readings() const { return QStringList() << QString::fromUtf8("\xe3\x81\x9f\xe3\x81\xb9\xe3\x82\x8b"); }
+	virtual QStringList meanings() const { return QStringList() << QString("to eat (entry %1)").arg(id()) << "to live on (e.g. a salary)" << "to live off"; }
+};
+
+/**
+ * Model returning the same kind of entries as the results list.
+ */
+class DelegateEntriesModel : public QAbstractListModel
+{
+public:
+	QList<EntryPointer> entries;
+
+	DelegateEntriesModel(int count)
+	{
+		for (int i = 0; i < count; i++) entries << EntryPointer(new DelegateEntry(i + 1));
+	}
+
+	virtual int rowCount(const QModelIndex &parent = QModelIndex()) const
+	{
+		return parent.isValid() ? 0 : entries.size();
+	}
+
+	virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const
+	{
+		if (role == Entry::EntryRole) return QVariant::fromValue(entries[index.row()]);
+		return QVariant();
+	}
+};
+
+/// Paints the first row of model into a row of the given width
+static void paintRow(EntryDelegate &delegate, DelegateEntriesModel &model, int width)
+{
+	QPixmap pixmap(width, 50);
+	QPainter painter(&pixmap);
+	QStyleOptionViewItem option;
+	option.rect = QRect(0, 0, width, 50);
+	delegate.paint(&painter, option, model.index(0));
+}
+
+void EntryDelegateTests::textLayouts()
+{
+	EntryDelegateLayout layout(0, EntryDelegateLayout::OneLine);
+	EntryDelegate delegate(&layout);
+	DelegateEntriesModel model(1);
+	EntryPointer entry(model.entries[0]);
+
+	QVERIFY(!layout.textLayout(entry, 296));
+	paintRow(delegate, model, 300);
+	const EntryDelegateLayout::TextLayout *texts = layout.textLayout(entry, 296);
+	QVERIFY(texts);
+	QCOMPARE(texts->mainRepr, entry->mainRepr());
+	QVERIFY(texts->readingsPos > 0);
+	QVERIFY(texts->meaningsPos >= texts->readingsPos);
+	// Texts are elided for each width
+	QVERIFY(!layout.textLayout(entry, 96));
+	paintRow(delegate, model, 100);
+	QVERIFY(layout.textLayout(entry, 96));
+	QVERIFY(layout.textLayout(entry, 96)->meanings.size() < texts->meanings.size());
+}
+
+void EntryDelegateTests::invalidation()
+{
+	EntryDelegateLayout layout(0, EntryDelegateLayout::OneLine);
+	EntryDelegate delegate(&layout);
+	DelegateEntriesModel model(1);
+	EntryPointer entry(model.entries[0]);
+
+	// Changes of the entry
+	paintRow(delegate, model, 300);
+	QVERIFY(layout.textLayout(entry, 296));
+	entry->emitChanged();
+	QVERIFY(!layout.textLayout(entry, 296));
+
+	// Another instance of the same entry
+	paintRow(delegate, model, 300);
+	EntryPointer reloaded(new DelegateEntry(entry->id()));
+	QVERIFY(!layout.textLayout(reloaded, 296));
+
+	// Layout changes
+	paintRow(delegate, model, 300);
+	layout.setDisplayMode(EntryDelegateLayout::TwoLines);
+	QVERIFY(!layout.textLayout(entry, 296));
+	paintRow(delegate, model, 300);
+	layout.setFont(EntryDelegateLayout::Kanji, QFont("Helvetica", 20));
+	QVERIFY(!layout.textLayout(entry, 296));
+
+	// Preferences changes
+	paintRow(delegate, model, 300);
+	PreferenceItem<int> pref("tests", "entryDelegateTest", 0);
+	pref.set(1);
+	QVERIFY(!layout.textLayout(entry, 296));
+	pref.reset();
+}
+
+void EntryDelegateTests::scrollBenchmark_data()
+{
+	QTest::addColumn<int>("displayMode");
+	QTest::addColumn<bool>("cached");
+
+	QTest::newRow("One line, cold") << (int)EntryDelegateLayout::OneLine << false;
+	QTest::newRow("One line, cached") << (int)EntryDelegateLayout::OneLine << true;
+	QTest::newRow("Two lines, cold") << (int)EntryDelegateLayout::TwoLines << false;
+	QTest::newRow("Two lines, cached") << (int)EntryDelegateLayout::TwoLines << true;
+}
+
+void EntryDelegateTests::scrollBenchmark()
+{
+	QFETCH(int, displayMode);
+	QFETCH(bool, cached);
+
+	EntryDelegateLayout layout(0, static_cast<EntryDelegateLayout::DisplayMode>(displayMode));
+	DelegateEntriesModel model(BENCHMARK_ROWS);
+	QListView view;
+	view.setUniformItemSizes(true);
+	view.setItemDelegate(new EntryDelegate(&layout, &view));
+	view.setModel(&model);
+	view.resize(600, 800);
+
+	QPixmap pixmap(view.viewport()->size());
+	QScrollBar *bar = view.verticalScrollBar();
+	// Scrolling through the list once fills the cache with the texts of all the rows
+	if (cached) for (int pos = 0; pos <= bar->maximum(); pos += bar->pageStep()) {
+		bar->setValue(pos);
+		view.viewport()->render(&pixmap);
+	}
+	int frames = 0;
+	QTime time;
+	time.start();
+	QBENCHMARK_ONCE {
+		for (int pos = 0; pos <= bar->maximum(); pos += bar->pageStep()) {
+			bar->setValue(pos);
+			view.viewport()->render(&pixmap);
+			++frames;
+		}
+	}
+	int elapsed = qMax(time.elapsed(), 1);
+	qDebug("%d rows, %d frames, %.1f frames per second", model.rowCount(), frames, frames * 1000.0 / elapsed);
+}
+
+QTEST_MAIN(EntryDelegateTests)
@@ -0,0 +1,146 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/jmdict/JMdictEntry.h"
+#include "core/jmdict/JMdictEntrySearcher.h"
+#include "core/jmdict/JMdictPlugin.h"
+#include "core/kanjidic2/Kanjidic2Entry.h"
+#include "gui/kanjidic2/Kanjidic2EntryFormatter.h"
+#include "gui/tests/KanjiRelationsTests.h"
+#include "sqlite/Query.h"
+
+#include <QFile>
+
+static quint64 wordsMiscMask()
+{
+	return JMdictEntrySearcher::miscFilterMask() | (1 << JMdictPlugin::miscBitShifts()["uk"]);
+}
+
+/// Words using a kanji, as they were computed before being materialized
+static QString runtimeUsedInWordsSql(int kanji, int limit, bool onlyStudied)
+{
+	return QString("select distinct %5, jmdict.entries.id "
+		"from jmdict.entries "
+		"join jmdict.kanjiChar on jmdict.kanjiChar.id = jmdict.entries.id "
+		"join jmdict.senses as senses on senses.id = jmdict.entries.id "
+			"and senses.priority = 0 "
+			"and senses.misc & %4 = 0 "
+		"%3join training on training.id = jmdict.entries.id and training.type = %5 "
+		"left join jmdict.jlpt on jmdict.entries.id = jmdict.jlpt.id "
+		"where jmdict.kanjiChar.kanji = %1 and jmdict.kanjiChar.priority = 0 "
+		"order by training.dateAdded is null ASC, training.score ASC, jmdict.jlpt.level DESC, jmdict.entries.frequency DESC "
+		"limit %2").arg(kanji).arg(limit).arg(onlyStudied ? "" : "left ").arg(wordsMiscMask()).arg(JMDICTENTRY_GLOBALID);
+}
+
+/// Kanji using a component, as they were computed before being materialized
+static QString runtimeUsedInKanjiSql(int kanji, int limit, bool onlyStudied)
+{
+	return QString("select distinct %4, ks1.kanji "
+		"from kanjidic2.strokeGroups as ks1 "
+		"join kanjidic2.entries on ks1.isRoot == 1 and ks1.kanji = entries.id "
+		"%3join training on training.type = %4 and training.id = entries.id "
+		"where (ks1.element = %1 or ks1.original = %1) "
+		"and ks1.kanji != %1 "
+		"order by training.dateAdded is null ASC, training.score ASC, entries.strokeCount, entries.jlpt DESC "
+		"limit %2").arg(kanji).arg(limit).arg(onlyStudied ? "" : "left ").arg(KANJIDIC2ENTRY_GLOBALID);
+}
+
+void KanjiRelationsTests::initTestCase()
+{
+	if (!QFile::exists(KANJIDIC2_DB) || !QFile::exists(JMDICT_DB)) return;
+	QVERIFY(userDBFile.open());
+	QVERIFY(connection.connect(userDBFile.fileName()));
+	QVERIFY(connection.attach(KANJIDIC2_DB, "kanjidic2"));
+	QVERIFY(connection.attach(JMDICT_DB, "jmdict"));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("CREATE TABLE training(type INT NOT NULL, id INTEGER SECONDARY KEY NOT NULL, score INT NOT NULL, dateAdded UNSIGNED INT NOT NULL, dateLastTrain UNSIGNED INT, nbTrained UNSIGNED INT NOT NULL, nbSuccess UNSIGNED INT NOT NULL, dateLastMistake UNSIGNED INT, CONSTRAINT training_unique_ids UNIQUE(type, id))"));
+	// Study some entries so the relations have to be merged with training data
+	QVERIFY(query.exec(QString("insert into training select %1, id, id % 100, 1, null, 0, 0, null from jmdict.entries where id % 10 = 0").arg(JMDICTENTRY_GLOBALID)));
+	QVERIFY(query.exec(QString("insert into training select %1, id, id % 100, 1, null, 0, 0, null from kanjidic2.entries where id % 10 = 0").arg(KANJIDIC2ENTRY_GLOBALID)));
+	QVERIFY(query.exec("select id from kanjidic2.entries order by id"));
+	while (query.next()) kanji << query.valueInt(0);
+	query.clear();
+}
+
+void KanjiRelationsTests::cleanupTestCase()
+{
+	if (connection.connected()) QVERIFY(connection.close());
+}
+
+QList<int> KanjiRelationsTests::queryIds(const QString &sql)
+{
+	QList<int> ret;
+	SQLite::Query query(&connection);
+	if (!query.exec(sql)) return ret;
+	while (query.next()) ret << query.valueInt(1);
+	return ret;
+}
+
+void KanjiRelationsTests::sameRelations()
+{
+	if (kanji.isEmpty()) QSKIP("Dictionary databases not built", SkipAll);
+
+	// Ties in the runtime order are not deterministic, so only the sets of
+	// related entries are compared
+	for (int i = 0; i < 2; i++) {
+		bool onlyStudied = i;
+		foreach (int k, kanji) {
+			QList<int> expected(queryIds(runtimeUsedInWordsSql(k, -1, onlyStudied)));
+			QList<int> got(queryIds(Kanjidic2EntryFormatter::getQueryUsedInWordsSql(k, -1, onlyStudied)));
+			qSort(expected);
+			qSort(got);
+			QCOMPARE(got, expected);
+
+			expected = queryIds(runtimeUsedInKanjiSql(k, -1, onlyStudied));
+			got = queryIds(Kanjidic2EntryFormatter::getQueryUsedInKanjiSql(k, -1, onlyStudied));
+			qSort(expected);
+			qSort(got);
+			QCOMPARE(got, expected);
+		}
+	}
+}
+
+void KanjiRelationsTests::relationsBenchmark_data()
+{
+	QTest::addColumn<bool>("precomputed");
+	QTest::addColumn<bool>("printing");
+
+	QTest::newRow("Detailed view, runtime joins") << false << false;
+	QTest::newRow("Detailed view, precomputed") << true << false;
+	QTest::newRow("Booklet, runtime joins") << false << true;
+	QTest::newRow("Booklet, precomputed") << true << true;
+}
+
+void KanjiRelationsTests::relationsBenchmark()
+{
+	QFETCH(bool, precomputed);
+	QFETCH(bool, printing);
+	if (kanji.isEmpty()) QSKIP("Dictionary databases not built", SkipAll);
+
+	// The detailed view displays both relations, while printing only lists
+	// the words using each kanji
+	int maxWords = printing ? Kanjidic2EntryFormatter::maxWordsToPrint.defaultValue() : Kanjidic2EntryFormatter::maxWordsToDisplay.defaultValue();
+	int maxCompounds = printing ? 0 : Kanjidic2EntryFormatter::maxCompoundsToDisplay.defaultValue();
+	QBENCHMARK_ONCE {
+		foreach (int k, kanji) {
+			queryIds(precomputed ? Kanjidic2EntryFormatter::getQueryUsedInWordsSql(k, maxWords, false) : runtimeUsedInWordsSql(k, maxWords, false));
+			if (maxCompounds) queryIds(precomputed ? Kanjidic2EntryFormatter::getQueryUsedInKanjiSql(k, maxCompounds, false) : runtimeUsedInKanjiSql(k, maxCompounds, false));
+		}
+	}
+}
+
+QTEST_MAIN(KanjiRelationsTests)
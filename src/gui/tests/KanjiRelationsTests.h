@@ -0,0 +1,49 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+#include <QList>
+#include <QTemporaryFile>
+
+#include "sqlite/Connection.h"
+
+/**
+ * Checks that the kanji relations materialized at database build time
+ * match the ones previously computed at runtime, and compares the cost of
+ * both approaches when displaying and printing kanji.
+ */
+class KanjiRelationsTests : public QObject
+{
+	Q_OBJECT
+private:
+	QTemporaryFile userDBFile;
+	SQLite::Connection connection;
+	// All the kanji of the kanjidic2 database
+	QList<int> kanji;
+
+	QList<int> queryIds(const QString &sql);
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void sameRelations();
+
+	void relationsBenchmark_data();
+	void relationsBenchmark();
+};
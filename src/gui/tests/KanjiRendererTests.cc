@@ -0,0 +1,166 @@
+/*
+ *  Copyright (C) 2010  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/TextTools.h"
+#include "gui/kanjidic2/KanjiRenderer.h"
+#include "gui/kanjidic2/KanjiPlayer.h"
+#include "gui/tests/KanjiRendererTests.h"
+#include "sqlite/Connection.h"
+#include "sqlite/Query.h"
+
+#include <QFile>
+#include <QImage>
+#include <QTime>
+#include <QPixmapCache>
+
+/**
+ * Kanji built from the database strokes only.
+ */
+class StrokesOnlyKanji : public Kanjidic2Entry
+{
+public:
+	StrokesOnlyKanji(quint32 id, const QByteArray &paths) : Kanjidic2Entry(TextTools::unicodeToSingleChar(id), true)
+	{
+		foreach (const KanjiStrokePath &path, KanjiStrokePath::decode(qUncompress(paths))) addStroke(0, path);
+	}
+};
+
+/**
+ * Player that can be driven without a timer nor being displayed.
+ */
+class OffscreenKanjiPlayer : public KanjiPlayer
+{
+public:
+	void nextFrame()
+	{
+		updateAnimationState();
+		renderCurrentState();
+	}
+};
+
+void KanjiRendererTests::initTestCase()
+{
+	if (!QFile::exists(KANJIDIC2_DB)) return;
+	SQLite::Connection connection;
+	QVERIFY(connection.connect(KANJIDIC2_DB, SQLite::Connection::ReadOnly));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("select id, paths from entries where paths not null"));
+	while (query.next()) kanjiPaths << QPair<quint32, QByteArray>(query.valueUInt(0), query.valueBlob(1));
+	query.clear();
+	QVERIFY(connection.close());
+}
+
+void KanjiRendererTests::parseSVG()
+{
+	// Relative, smooth and implicit commands must all become absolute ones
+	KanjiStrokePath path(KanjiStrokePath::fromSVG("M10,20c1,2,3,4,5,6s2-2,4.5.5L30 40 50 60z"));
+	QCOMPARE(path.commands().size(), 6);
+	QCOMPARE((int)path.commands()[0], (int)KanjiStrokePath::MoveTo);
+	QCOMPARE((int)path.commands()[1], (int)KanjiStrokePath::CubicTo);
+	QCOMPARE((int)path.commands()[2], (int)KanjiStrokePath::CubicTo);
+	QCOMPARE((int)path.commands()[3], (int)KanjiStrokePath::LineTo);
+	QCOMPARE((int)path.commands()[4], (int)KanjiStrokePath::LineTo);
+	QCOMPARE((int)path.commands()[5], (int)KanjiStrokePath::Close);
+	QCOMPARE(path.coords().size(), 2 + 6 + 6 + 2 + 2);
+	QCOMPARE(path.coord(6), 15.0);
+	QCOMPARE(path.coord(7), 26.0);
+	// Reflection of the previous control point
+	QCOMPARE(path.coord(8), 17.0);
+	QCOMPARE(path.coord(9), 28.0);
+	QCOMPARE(path.coord(12), 19.5);
+	QCOMPARE(path.coord(13), 26.5);
+	QCOMPARE(path.coord(16), 50.0);
+	QCOMPARE(path.coord(17), 60.0);
+
+	KanjiStroke stroke(0, path);
+	KanjiRenderer::Stroke rStroke(&stroke);
+	QCOMPARE(rStroke.painterPath().elementCount(), 1 + 3 + 3 + 1 + 1 + 1);
+	QVERIFY(qAbs(rStroke.length() - rStroke.painterPath().length()) < 0.5);
+	QCOMPARE(rStroke.numberLine().p1(), QPointF(10.0, 20.0));
+}
+
+void KanjiRendererTests::encodeDecode()
+{
+	QList<KanjiStrokePath> paths;
+	paths << KanjiStrokePath::fromSVG("M31.5,24.5c1.12,0.25,2.5,0.28,4.72,0.05");
+	paths << KanjiStrokePath::fromSVG("M52.75,15.5c0.25,1.75,0.39,3.48,0.25,5.5C51.5,46,45.25,75,14,94.25");
+	QList<KanjiStrokePath> decoded(KanjiStrokePath::decode(KanjiStrokePath::encode(paths)));
+	QCOMPARE(decoded.size(), paths.size());
+	for (int i = 0; i < paths.size(); i++) {
+		QCOMPARE(decoded[i].commands(), paths[i].commands());
+		QCOMPARE(decoded[i].coords(), paths[i].coords());
+		QCOMPARE(decoded[i].length(), paths[i].length());
+		QCOMPARE(decoded[i].numberLine(), paths[i].numberLine());
+	}
+	QVERIFY(KanjiStrokePath::decode(QByteArray("\x02\x00", 2)).isEmpty());
+}
+
+void KanjiRendererTests::renderAllBenchmark_data()
+{
+	QTest::addColumn<bool>("render");
+
+	QTest::newRow("Build paths") << false;
+	QTest::newRow("Build paths and render") << true;
+}
+
+void KanjiRendererTests::renderAllBenchmark()
+{
+	QFETCH(bool, render);
+	if (kanjiPaths.isEmpty()) QSKIP("kanjidic2 database not built", SkipAll);
+
+	QImage image(109, 109, QImage::Format_ARGB32_Premultiplied);
+	QBENCHMARK {
+		for (int i = 0; i < kanjiPaths.size(); i++) {
+			QList<KanjiStroke> strokes;
+			foreach (const KanjiStrokePath &path, KanjiStrokePath::decode(qUncompress(kanjiPaths[i].second))) strokes << KanjiStroke(0, path);
+			QPainter painter(&image);
+			foreach (const KanjiStroke &stroke, strokes) {
+				KanjiRenderer::Stroke rStroke(&stroke);
+				if (render) rStroke.render(&painter);
+			}
+		}
+	}
+}
+
+#define ANIMATED_KANJI 500
+void KanjiRendererTests::animationBenchmark()
+{
+	if (kanjiPaths.isEmpty()) QSKIP("kanjidic2 database not built", SkipAll);
+
+	QList<ConstKanjidic2EntryPointer> kanji;
+	for (int i = 0; i < kanjiPaths.size() && i < ANIMATED_KANJI; i++)
+		kanji << ConstKanjidic2EntryPointer(new StrokesOnlyKanji(kanjiPaths[i].first, kanjiPaths[i].second));
+
+	OffscreenKanjiPlayer player;
+	player.setShowStrokesNumbers(true);
+	QPixmapCache::clear();
+	int frames = 0;
+	QTime time;
+	time.start();
+	QBENCHMARK_ONCE {
+		foreach (const ConstKanjidic2EntryPointer &k, kanji) {
+			player.setKanji(k);
+			while (player.position() < k->strokes().size()) {
+				player.nextFrame();
+				++frames;
+			}
+		}
+	}
+	qDebug("%d frames, %.3f ms per frame", frames, time.elapsed() / (double)frames);
+}
+
+QTEST_MAIN(KanjiRendererTests)
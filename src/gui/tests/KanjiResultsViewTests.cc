@@ -0,0 +1,115 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core/TextTools.h"
+#include "gui/kanjidic2/KanjiResultsView.h"
+#include "gui/kanjidic2/KanjiGlyphAtlas.h"
+#include "gui/tests/KanjiResultsViewTests.h"
+
+#include <QScrollBar>
+#include <QSignalSpy>
+#include <QPixmap>
+#include <QTime>
+
+#define BENCHMARK_ITEMS 5000
+
+static QStringList kanjiList(int count)
+{
+	QStringList ret;
+	for (int i = 0; i < count; i++) ret << TextTools::unicodeToSingleChar(0x4e00 + i);
+	return ret;
+}
+
+void KanjiResultsViewTests::batches()
+{
+	KanjiResultsView view;
+	view.resize(400, view.sizeHint().height());
+	view.startReceive();
+	view.addItems(kanjiList(256));
+	view.addItems(kanjiList(44));
+	view.addItem(TextTools::unicodeToSingleChar(0x65e5));
+	view.endReceive();
+	QCOMPARE(view.count(), 301);
+	QCOMPARE(view.kanji(300), TextTools::unicodeToSingleChar(0x65e5));
+	QVERIFY(view.horizontalScrollBar()->maximum() > 0);
+	QCOMPARE(view.horizontalScrollBar()->value(), 0);
+
+	view.clear();
+	QCOMPARE(view.count(), 0);
+	QCOMPARE(view.horizontalScrollBar()->maximum(), 0);
+}
+
+void KanjiResultsViewTests::selection()
+{
+	KanjiResultsView view;
+	view.resize(400, view.sizeHint().height());
+	view.addItems(kanjiList(10));
+	QSignalSpy spy(&view, SIGNAL(kanjiSelected(QString)));
+
+	// Center of the second cell
+	QPoint second(20 + 55 + 25, view.viewport()->height() / 2);
+	QTest::mouseClick(view.viewport(), Qt::LeftButton, 0, second);
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(spy[0][0].toString(), view.kanji(1));
+	QCOMPARE(view.selectedIndex(), 1);
+
+	// Selecting the same kanji again does not emit anything
+	QTest::mouseClick(view.viewport(), Qt::LeftButton, 0, second);
+	QCOMPARE(spy.count(), 1);
+
+	// Clicking outside of the cells clears the selection
+	QTest::mouseClick(view.viewport(), Qt::LeftButton, 0, QPoint(5, second.y()));
+	QCOMPARE(spy.count(), 1);
+	QCOMPARE(view.selectedIndex(), -1);
+}
+
+void KanjiResultsViewTests::paintBenchmark_data()
+{
+	QTest::addColumn<bool>("warmAtlas");
+
+	QTest::newRow("Cold atlas") << false;
+	QTest::newRow("Warm atlas") << true;
+}
+
+void KanjiResultsViewTests::paintBenchmark()
+{
+	QFETCH(bool, warmAtlas);
+
+	KanjiResultsView view;
+	view.resize(800, view.sizeHint().height());
+	view.startReceive();
+	QStringList kanji(kanjiList(BENCHMARK_ITEMS));
+	for (int i = 0; i < kanji.size(); i += 256) view.addItems(kanji.mid(i, 256));
+	view.endReceive();
+
+	QPixmap pixmap(view.viewport()->size());
+	QScrollBar *bar = view.horizontalScrollBar();
+	if (!warmAtlas) KanjiGlyphAtlas::clear();
+	int frames = 0;
+	QTime time;
+	time.start();
+	QBENCHMARK_ONCE {
+		for (int pos = 0; pos <= bar->maximum(); pos += bar->pageStep()) {
+			bar->setValue(pos);
+			view.viewport()->render(&pixmap);
+			++frames;
+		}
+	}
+	qDebug("%d items, %d frames, %.3f ms per frame", view.count(), frames, time.elapsed() / (double)frames);
+}
+
+QTEST_MAIN(KanjiResultsViewTests)
@@ -58,7 +58,8 @@ bool Connection::connect(const QString &dbFile, OpenFlags flags)
 	// Enable shared-cache mode
 	sqlite3_enable_shared_cache(1);
 
-	int res = sqlite3_open_v2(dbFile.toUtf8().data(), &_handler, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, 0);
+	// A shared cache means a shared pager, which would defeat WAL
+	int res = sqlite3_open_v2(dbFile.toUtf8().data(), &_handler, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | (flags & WAL ? SQLITE_OPEN_PRIVATECACHE : 0), 0);
 	updateError();
 	if (res != SQLITE_OK) goto err;
 	// Enable extended error codes
@@ -70,9 +71,15 @@ bool Connection::connect(const QString &dbFile, OpenFlags flags)
 	   sqlite3ext_register_tokenizers(_handler);
 	// Configure the connection
 	exec("pragma encoding=\"UTF-16le\"");
-	if (!flags & JournalInFile) exec("pragma journal_mode=MEMORY");
-	// Set read-uncommited mode so that read queries can not block
-	exec("pragma read_uncommitted=1");
+	if (flags & WAL) {
+		exec("pragma journal_mode=WAL");
+		// Commits remain atomic, only the last ones may be lost on power failure
+		exec("pragma synchronous=NORMAL");
+	} else {
+		if (!flags & JournalInFile) exec("pragma journal_mode=MEMORY");
+		// Set read-uncommited mode so that read queries can not block
+		exec("pragma read_uncommitted=1");
+	}
 
 	_dbFile = dbFile;
 	return true;
@@ -49,7 +49,11 @@ public:
 	Connection();
 	~Connection();
 
-	typedef enum { None = 0, JournalInFile = (1 << 0), ReadOnly = (1 << 1) } OpenFlags;
+	/**
+	 * WAL opens the database with a private cache in write-ahead logging
+	 * mode, so that readers never wait for writers.
+	 */
+	typedef enum { None = 0, JournalInFile = (1 << 0), ReadOnly = (1 << 1), WAL = (1 << 2) } OpenFlags;
 	/**
 	 * Connect to the database file given as parameter. Returns true in case
 	 * of success, false otherwise.
@@ -0,0 +1,304 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlite/DictionaryCodec.h"
+#include "sqlite/Connection.h"
+#include "sqlite/Query.h"
+
+#include <QReadWriteLock>
+#include <QPair>
+#include <QtAlgorithms>
+#include <QtDebug>
+
+using namespace SQLite;
+
+static bool isWordByte(uchar c)
+{
+	// Bytes of multi-byte UTF-8 characters are considered part of words
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+/**
+ * Returns the length of the token starting at str: a word and the space
+ * preceding it if any, or a single byte.
+ */
+static int tokenLength(const uchar *str, const uchar *end)
+{
+	const uchar *p = str;
+	if (*p == ' ' && p + 1 < end && isWordByte(p[1])) ++p;
+	if (!isWordByte(*p)) return 1;
+	while (p < end && isWordByte(*p)) ++p;
+	return p - str;
+}
+
+DictionaryCodec::DictionaryCodec() : _id(0)
+{
+}
+
+void DictionaryCodec::setSymbols(const QList<QByteArray> &symbols)
+{
+	_symbols.clear();
+	_offsets.clear();
+	_codes.clear();
+	_byteCodes.fill(-1, 256);
+	for (int i = 0; i < symbols.size(); i++) {
+		const QByteArray &symbol = symbols[i];
+		_offsets << _symbols.size();
+		_symbols += symbol;
+		if (symbol.size() == 1) _byteCodes[(uchar)symbol[0]] = i;
+		else _codes[symbol] = i;
+	}
+	_offsets << _symbols.size();
+
+	// FNV-1a hash of the serialized dictionary
+	QByteArray serialized(data());
+	_id = 2166136261u;
+	for (int i = 0; i < serialized.size(); i++) {
+		_id ^= (uchar)serialized[i];
+		_id *= 16777619u;
+	}
+}
+
+DictionaryCodec DictionaryCodec::train(const QList<QByteArray> &samples)
+{
+	QHash<QByteArray, int> counts;
+	qint64 byteCounts[256];
+	for (int i = 0; i < 256; i++) byteCounts[i] = 0;
+	foreach (const QByteArray &sample, samples) {
+		const uchar *p = reinterpret_cast<const uchar *>(sample.constData());
+		const uchar *end = p + sample.size();
+		while (p < end) {
+			int len = tokenLength(p, end);
+			if (len > 1 && len <= MaxSymbolLength) ++counts[QByteArray(reinterpret_cast<const char *>(p), len)];
+			for (int i = 0; i < len; i++) ++byteCounts[p[i]];
+			p += len;
+		}
+	}
+
+	// Rank symbols by the number of bytes they save, assuming a one-byte
+	// code. Single bytes save the escape byte.
+	QList<QPair<qint64, QByteArray> > candidates;
+	for (QHash<QByteArray, int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); ++it) {
+		if (it.value() < 2) continue;
+		candidates << qMakePair(-(qint64)it.value() * (it.key().size() - 1), it.key());
+	}
+	for (int i = 0; i < 256; i++) {
+		if (byteCounts[i]) candidates << qMakePair(-byteCounts[i], QByteArray(1, (char)i));
+	}
+	qSort(candidates);
+
+	QList<QByteArray> symbols;
+	for (int i = 0; i < candidates.size() && symbols.size() < MaxSymbols; i++) {
+		const QByteArray &symbol = candidates[i].second;
+		// Two-bytes codes are only worth it for longer symbols
+		if (symbols.size() >= LongCodeStart && symbol.size() < 3) continue;
+		symbols << symbol;
+	}
+
+	DictionaryCodec ret;
+	ret.setSymbols(symbols);
+	return ret;
+}
+
+DictionaryCodec DictionaryCodec::fromData(const QByteArray &data)
+{
+	DictionaryCodec ret;
+	if (data.size() < 2) return ret;
+	const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+	const uchar *end = p + data.size();
+	int count = (p[0] << 8) | p[1];
+	p += 2;
+	if (count > MaxSymbols) return ret;
+	QList<QByteArray> symbols;
+	for (int i = 0; i < count; i++) {
+		if (p >= end) return ret;
+		int len = *p++;
+		if (len == 0 || p + len > end) return ret;
+		symbols << QByteArray(reinterpret_cast<const char *>(p), len);
+		p += len;
+	}
+	if (p != end) return ret;
+	ret.setSymbols(symbols);
+	return ret;
+}
+
+QByteArray DictionaryCodec::data() const
+{
+	QByteArray ret;
+	int count = symbolsCount();
+	ret.reserve(2 + count + _symbols.size());
+	ret.append((char)(count >> 8));
+	ret.append((char)(count & 0xff));
+	for (int i = 0; i < count; i++) {
+		ret.append((char)(_offsets[i + 1] - _offsets[i]));
+		ret.append(_symbols.constData() + _offsets[i], _offsets[i + 1] - _offsets[i]);
+	}
+	return ret;
+}
+
+void DictionaryCodec::appendCode(QByteArray &out, int index) const
+{
+	if (index < LongCodeStart) out.append((char)index);
+	else {
+		index -= LongCodeStart;
+		out.append((char)(LongCodeStart + (index >> 8)));
+		out.append((char)(index & 0xff));
+	}
+}
+
+void DictionaryCodec::appendByte(QByteArray &out, uchar c) const
+{
+	int index = _byteCodes[c];
+	if (index >= 0) appendCode(out, index);
+	else {
+		out.append((char)Escape);
+		out.append((char)c);
+	}
+}
+
+void DictionaryCodec::appendToken(QByteArray &out, const char *token, int len) const
+{
+	if (len > 1) {
+		QHash<QByteArray, int>::const_iterator it = _codes.find(QByteArray::fromRawData(token, len));
+		if (it != _codes.constEnd()) {
+			appendCode(out, it.value());
+			return;
+		}
+		// The word may still be known without its leading space
+		if (token[0] == ' ') {
+			appendByte(out, ' ');
+			appendToken(out, token + 1, len - 1);
+			return;
+		}
+	}
+	for (int i = 0; i < len; i++) appendByte(out, token[i]);
+}
+
+QByteArray DictionaryCodec::compress(const QByteArray &text) const
+{
+	QByteArray ret;
+	ret.reserve(HeaderSize + text.size() / 2);
+	for (int i = HeaderSize - 1; i >= 0; i--) ret.append((char)((_id >> (i * 8)) & 0xff));
+	const uchar *p = reinterpret_cast<const uchar *>(text.constData());
+	const uchar *end = p + text.size();
+	while (p < end) {
+		int len = tokenLength(p, end);
+		appendToken(ret, reinterpret_cast<const char *>(p), len);
+		p += len;
+	}
+	return ret;
+}
+
+static quint32 headerId(const char *data)
+{
+	const uchar *p = reinterpret_cast<const uchar *>(data);
+	return ((quint32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+bool DictionaryCodec::uncompress(const char *data, int size, QByteArray &text) const
+{
+	text.clear();
+	if (size < HeaderSize || headerId(data) != _id) return false;
+	text.reserve(size * 3);
+	const uchar *p = reinterpret_cast<const uchar *>(data) + HeaderSize;
+	const uchar *end = reinterpret_cast<const uchar *>(data) + size;
+	const char *symbols = _symbols.constData();
+	const quint32 *offsets = _offsets.constData();
+	const int count = symbolsCount();
+	while (p < end) {
+		int index = *p++;
+		if (index >= LongCodeStart) {
+			if (p == end) return false;
+			if (index == Escape) {
+				text.append((char)*p++);
+				continue;
+			}
+			index = LongCodeStart + (((index - LongCodeStart) << 8) | *p++);
+		}
+		if (index >= count) return false;
+		text.append(symbols + offsets[index], offsets[index + 1] - offsets[index]);
+	}
+	return true;
+}
+
+bool DictionaryCodec::store(Connection *connection) const
+{
+	Query query(connection);
+	if (!query.exec("create table if not exists compressionDictionaries(id INTEGER PRIMARY KEY, dictionary BLOB)")) return false;
+	if (!query.prepare("insert or replace into compressionDictionaries values(?, ?)")) return false;
+	query.bindValue(_id);
+	query.bindValue(data());
+	return query.exec();
+}
+
+static QReadWriteLock &registryLock()
+{
+	static QReadWriteLock lock;
+	return lock;
+}
+
+static QHash<quint32, DictionaryCodec *> &registry()
+{
+	static QHash<quint32, DictionaryCodec *> dictionaries;
+	return dictionaries;
+}
+
+bool DictionaryCodec::registerDictionary(const QByteArray &data)
+{
+	DictionaryCodec codec(fromData(data));
+	if (!codec.isValid()) return false;
+	QWriteLocker locker(&registryLock());
+	if (!registry().contains(codec.id())) registry()[codec.id()] = new DictionaryCodec(codec);
+	return true;
+}
+
+bool DictionaryCodec::registerDictionaries(Connection *connection, const QString &alias)
+{
+	Query query(connection);
+	if (!query.exec(QString("select count(*) from %1.sqlite_master where type = 'table' and name = 'compressionDictionaries'").arg(alias)) || !query.next()) return false;
+	// Databases without compressed data have no dictionary
+	if (!query.valueInt(0)) return true;
+	if (!query.exec(QString("select dictionary from %1.compressionDictionaries").arg(alias))) return false;
+	while (query.next()) {
+		if (!registerDictionary(query.valueBlob(0))) {
+			qWarning("Invalid compression dictionary in database %s", alias.toUtf8().constData());
+			return false;
+		}
+	}
+	return true;
+}
+
+const DictionaryCodec *DictionaryCodec::dictionary(quint32 id)
+{
+	QReadLocker locker(&registryLock());
+	return registry().value(id, 0);
+}
+
+bool DictionaryCodec::uncompress(const QByteArray &data, QByteArray &text)
+{
+	if (data.size() < HeaderSize) return false;
+	const DictionaryCodec *codec = dictionary(headerId(data.constData()));
+	if (!codec) return false;
+	return codec->uncompress(data.constData(), data.size(), text);
+}
+
+QByteArray DictionaryCodec::uncompress(const QByteArray &data)
+{
+	QByteArray ret;
+	if (!uncompress(data, ret)) ret.clear();
+	return ret;
+}
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SQLITE_DICTIONARYCODEC_H
+#define __SQLITE_DICTIONARYCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+namespace SQLite {
+
+class Connection;
+
+/**
+ * Compresses short texts, such as the glosses of a dictionary entry, using
+ * a table of frequent symbols shared by all the texts of a database.
+ *
+ * Per-row zlib compression performs poorly on short strings as every row
+ * has to carry its own dictionary. Here the symbols (mostly words with
+ * their leading space) are learned once from the whole corpus with train()
+ * and stored in the compressionDictionaries table of the database. Each
+ * compressed text starts with the id of its dictionary, followed by one
+ * code per symbol:
+ *
+ * - bytes below LongCodeStart are the index of a symbol,
+ * - bytes from LongCodeStart to Escape (excluded) form a two-bytes index
+ *   together with the next byte,
+ * - Escape means the next byte is a literal.
+ *
+ * Decoding is therefore a simple table lookup per code. Dictionaries
+ * stored in a database are registered when the database is attached, so
+ * that uncompress() and the dictuncompress() SQL function can find them.
+ */
+class DictionaryCodec
+{
+private:
+	/// All the symbols, one after the other
+	QByteArray _symbols;
+	/// Offset of each symbol in _symbols, plus the end of the last one
+	QVector<quint32> _offsets;
+	/// Symbols of more than one byte to their index, for compression
+	QHash<QByteArray, int> _codes;
+	/// Index of the single-byte symbols, -1 if the byte has none
+	QVector<int> _byteCodes;
+	quint32 _id;
+
+	void setSymbols(const QList<QByteArray> &symbols);
+	void appendCode(QByteArray &out, int index) const;
+	void appendByte(QByteArray &out, uchar c) const;
+	void appendToken(QByteArray &out, const char *token, int len) const;
+
+public:
+	static const int LongCodeStart = 0xc0;
+	static const int Escape = 0xff;
+	static const int MaxSymbols = LongCodeStart + (Escape - LongCodeStart) * 256;
+	static const int MaxSymbolLength = 32;
+	/// Size of the dictionary id at the beginning of compressed data
+	static const int HeaderSize = 4;
+
+	DictionaryCodec();
+
+	/// Builds a dictionary from the most frequent symbols of samples
+	static DictionaryCodec train(const QList<QByteArray> &samples);
+	/// Loads a dictionary serialized by data(). Returns an invalid codec if data is invalid.
+	static DictionaryCodec fromData(const QByteArray &data);
+	QByteArray data() const;
+
+	bool isValid() const { return !_offsets.isEmpty(); }
+	/// Identifier of the dictionary, computed from its content
+	quint32 id() const { return _id; }
+	int symbolsCount() const { return _offsets.size() - 1; }
+
+	QByteArray compress(const QByteArray &text) const;
+	/**
+	 * Decompresses data into text. Returns false if data has not been
+	 * compressed with this dictionary or is corrupted.
+	 */
+	bool uncompress(const char *data, int size, QByteArray &text) const;
+
+	/// Stores the dictionary into the compressionDictionaries table of connection, creating it if needed
+	bool store(Connection *connection) const;
+
+	/**
+	 * Makes the dictionary serialized in data available to uncompress().
+	 * Registered dictionaries are kept until the program exits.
+	 */
+	static bool registerDictionary(const QByteArray &data);
+	/// Registers all the dictionaries stored in the database attached as alias
+	static bool registerDictionaries(Connection *connection, const QString &alias);
+	/// Returns the registered dictionary with the given id, or 0
+	static const DictionaryCodec *dictionary(quint32 id);
+	/// Decompresses data using the registered dictionary it has been compressed with
+	static bool uncompress(const QByteArray &data, QByteArray &text);
+	static QByteArray uncompress(const QByteArray &data);
+};
+
+}
+
+#endif
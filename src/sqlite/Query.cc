@@ -18,17 +18,18 @@
 #include "sqlite3.h"
 #include "sqlite/Query.h"
 #include "sqlite/Connection.h"
+#include "sqlite/QueryProfiler.h"
 #include "tagaini_config.h"
 
 #include <QtDebug>
 
 using namespace SQLite;
 
-Query::Query() : _stmt(0), _connection(0), _state(INVALID), _bindIndex(0)
+Query::Query() : _stmt(0), _connection(0), _state(INVALID), _bindIndex(0), _profiling(false), _profileElapsed(0), _profileRows(0)
 {
 }
 
-Query::Query(Connection *connection) : _stmt(0)
+Query::Query(Connection *connection) : _stmt(0), _profiling(false), _profileElapsed(0), _profileRows(0)
 {
 	useWith(connection);
 }
@@ -155,26 +156,97 @@ bool Query::bindNullValue(int col)
 	return checkBindRes();
 }
 
+void Query::startProfiling()
+{
+	_profiling = true;
+	_profileElapsed = 0;
+	_profileRows = 0;
+	sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+	sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_SORT, 1);
+	sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+	sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_VM_STEP, 1);
+#endif
+}
+
+/**
+ * Only the time spent inside SQLite is measured, so statements that stay
+ * active while the caller processes their rows are not reported unless
+ * SQLite itself is slow.
+ */
+void Query::stopProfiling()
+{
+	_profiling = false;
+	int elapsed = _profileElapsed;
+	if (elapsed < QueryProfiler::threshold()) return;
+
+	QueryProfile profile;
+	profile.date = QDateTime::currentDateTime();
+	profile.sql = QString::fromUtf8(sqlite3_sql(_stmt));
+	profile.elapsed = elapsed;
+	profile.rows = _profileRows;
+	profile.fullscanSteps = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+	profile.sorts = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_SORT, 0);
+	profile.autoindexes = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_AUTOINDEX, 0);
+#ifdef SQLITE_STMTSTATUS_VM_STEP
+	profile.vmSteps = sqlite3_stmt_status(_stmt, SQLITE_STMTSTATUS_VM_STEP, 0);
+#endif
+	if (QueryProfiler::explain()) profile.plan = explainPlan();
+	QueryProfiler::record(profile);
+}
+
+QStringList Query::explainPlan() const
+{
+	QStringList ret;
+	if (!_stmt) return ret;
+	sqlite3_stmt *stmt;
+	QByteArray sql("EXPLAIN QUERY PLAN ");
+	sql += sqlite3_sql(_stmt);
+	if (sqlite3_prepare_v2(_connection->_handler, sql.constData(), -1, &stmt, 0) != SQLITE_OK) return ret;
+	// Columns are selectid, order, from and detail
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		ret << QString("%1 %2 %3 %4").arg(sqlite3_column_int(stmt, 0)).arg(sqlite3_column_int(stmt, 1)).arg(sqlite3_column_int(stmt, 2)).arg(QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(stmt, 3))));
+	sqlite3_finalize(stmt);
+	return ret;
+}
+
 void Query::reset()
 {
 	_bindIndex = 0;
 	if (!_stmt) return;
+	if (_profiling) stopProfiling();
 	sqlite3_reset(_stmt);
 	_lastError = _connection->updateError();
 	checkQueryError(*this, queryText());
 	_state = PREPARED;
 }
 
+/**
+ * Steps are usually shorter than the resolution of QTime, but the rounding
+ * errors of their durations cancel out when they are added up.
+ */
+int Query::step()
+{
+	if (!_profiling) return sqlite3_step(_stmt);
+	QTime time;
+	time.start();
+	int res = sqlite3_step(_stmt);
+	_profileElapsed += time.elapsed();
+	return res;
+}
+
 bool Query::exec()
 {
 	if (_state != PREPARED) return false;
+	if (QueryProfiler::enabled()) startProfiling();
 	// Busy-loop while the shared cache is locked. This is ugly.
-	while (sqlite3_step(_stmt) == SQLITE_LOCKED_SHAREDCACHE){};
+	while (step() == SQLITE_LOCKED_SHAREDCACHE){};
 	_lastError = _connection->updateError();
 	checkQueryError(*this, queryText());
 	switch (_lastError.code()) {
 	case SQLITE_ROW:
 		_state = FIRSTRES;
+		++_profileRows;
 		return true;
 	case SQLITE_DONE:
 		reset();
@@ -192,11 +264,12 @@ bool Query::next()
 		_state = RUN;
 		return true;
 	case RUN:
-		sqlite3_step(_stmt);
+		step();
 		_lastError = _connection->updateError();
 		checkQueryError(*this, queryText());
 		switch (_lastError.code()) {
 		case SQLITE_ROW:
+			++_profileRows;
 			return true;
 		case SQLITE_DONE:
 			reset();
@@ -301,6 +374,7 @@ bool Query::valueIsNull(int column) const
 void Query::clear()
 {
 	if (_stmt) {
+		if (_profiling) stopProfiling();
 		sqlite3_finalize(_stmt);
 		_lastError = _connection->updateError();
 		checkQueryError(*this, queryText());
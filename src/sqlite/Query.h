@@ -20,6 +20,9 @@
 
 #include "sqlite/Error.h"
 
+#include <QTime>
+#include <QStringList>
+
 struct sqlite3_stmt;
 
 namespace SQLite {
@@ -40,13 +43,22 @@ private:
 	Connection *_connection;
 	Error _lastError;
 	enum { INVALID, ERROR, BLANK, PREPARED, RUN, FIRSTRES } _state;
-	quint8 _bindIndex;
+	quint16 _bindIndex;
+	/// Set while an execution is measured for QueryProfiler
+	bool _profiling;
+	/// Time spent inside sqlite3_step() since profiling started, in milliseconds
+	int _profileElapsed;
+	quint32 _profileRows;
 
 	/// Copy is forbidden
 	Query &operator =(const Query &query);
 
 	bool checkBind(int &col);
 	bool checkBindRes();
+	void startProfiling();
+	void stopProfiling();
+	/// Steps the statement, measuring the time it takes if profiling
+	int step();
 
 public:
 	/**
@@ -99,6 +111,8 @@ public:
 
 	const Error &lastError() const { return _lastError; }
 	QString queryText() const;
+	/// Returns the output of EXPLAIN QUERY PLAN for the prepared statement
+	QStringList explainPlan() const;
 };
 
 }
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sqlite/QueryProfiler.h"
+
+#include <QFile>
+#include <QTextStream>
+
+using namespace SQLite;
+
+bool QueryProfiler::_enabled = false;
+int QueryProfiler::_threshold = 100;
+bool QueryProfiler::_explain = false;
+QString QueryProfiler::_logFile;
+qint64 QueryProfiler::_maxLogSize = 1024 * 1024;
+QMutex QueryProfiler::_mutex;
+QList<QueryProfile> QueryProfiler::_recent;
+
+QString QueryProfile::toString() const
+{
+	QString ret(QString("%1 %2 ms, %3 rows, %4 fullscan steps, %5 sorts, %6 autoindexes, %7 VM steps\n%8\n").arg(date.toString(Qt::ISODate)).arg(elapsed).arg(rows).arg(fullscanSteps).arg(sorts).arg(autoindexes).arg(vmSteps).arg(sql));
+	foreach (const QString &line, plan) ret += "    " + line + "\n";
+	return ret;
+}
+
+void QueryProfiler::setLogFile(const QString &file, qint64 maxSize)
+{
+	QMutexLocker locker(&_mutex);
+	_logFile = file;
+	_maxLogSize = maxSize;
+}
+
+void QueryProfiler::writeToLog(const QueryProfile &profile)
+{
+	if (_logFile.isEmpty()) return;
+	QFile file(_logFile);
+	if (file.size() > _maxLogSize) {
+		QFile::remove(_logFile + ".1");
+		file.rename(_logFile + ".1");
+		file.setFileName(_logFile);
+	}
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) return;
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out << profile.toString();
+}
+
+void QueryProfiler::record(const QueryProfile &profile)
+{
+	QMutexLocker locker(&_mutex);
+	_recent << profile;
+	while (_recent.size() > MaxRecent) _recent.removeFirst();
+	writeToLog(profile);
+}
+
+QList<QueryProfile> QueryProfiler::recent()
+{
+	QMutexLocker locker(&_mutex);
+	return _recent;
+}
+
+void QueryProfiler::clear()
+{
+	QMutexLocker locker(&_mutex);
+	_recent.clear();
+}
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SQLITE_QUERYPROFILER_H
+#define __SQLITE_QUERYPROFILER_H
+
+#include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QList>
+#include <QMutex>
+
+namespace SQLite {
+
+/// Execution statistics of a query, as recorded by QueryProfiler
+struct QueryProfile
+{
+	QDateTime date;
+	QString sql;
+	/// Time spent stepping the statement, in milliseconds
+	int elapsed;
+	quint32 rows;
+	/// Values of the sqlite3_stmt_status() counters
+	int fullscanSteps;
+	int sorts;
+	int autoindexes;
+	int vmSteps;
+	/// Output of EXPLAIN QUERY PLAN, if enabled
+	QStringList plan;
+
+	QueryProfile() : elapsed(0), rows(0), fullscanSteps(0), sorts(0), autoindexes(0), vmSteps(0) {}
+	QString toString() const;
+};
+
+/**
+ * Records the queries that take longer than a given threshold to run.
+ *
+ * When enabled, Query measures the time spent in each execution of its
+ * statement, and reports it here once the statement is reset. Slow
+ * queries are kept in memory for display and appended to a log file,
+ * which is rotated when it grows too large. Disabled by default, in which
+ * case queries are not measured at all.
+ */
+class QueryProfiler
+{
+private:
+	static bool _enabled;
+	static int _threshold;
+	static bool _explain;
+	static QString _logFile;
+	static qint64 _maxLogSize;
+	static QMutex _mutex;
+	static QList<QueryProfile> _recent;
+
+	static void writeToLog(const QueryProfile &profile);
+
+public:
+	/// Number of slow queries kept in memory
+	static const int MaxRecent = 200;
+
+	static bool enabled() { return _enabled; }
+	static void setEnabled(bool enabled) { _enabled = enabled; }
+	/// Queries taking at least this time, in milliseconds, are recorded
+	static int threshold() { return _threshold; }
+	static void setThreshold(int threshold) { _threshold = threshold; }
+	/// Whether the plan of slow queries is recorded too
+	static bool explain() { return _explain; }
+	static void setExplain(bool explain) { _explain = explain; }
+	/**
+	 * Sets the file slow queries are appended to. When it grows larger than
+	 * maxSize, it is renamed with a .1 suffix and a new file is started.
+	 * No log is written if file is empty.
+	 */
+	static void setLogFile(const QString &file, qint64 maxSize = 1024 * 1024);
+	static const QString &logFile() { return _logFile; }
+
+	static void record(const QueryProfile &profile);
+	/// Returns the last recorded slow queries, most recent last
+	static QList<QueryProfile> recent();
+	static void clear();
+};
+
+}
+
+#endif
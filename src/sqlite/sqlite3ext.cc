@@ -19,11 +19,14 @@
 #include "sqlite/fts3_tokenizer.h"
 #include "core/TextTools.h"
 #include "sqlite/SQLite.h"
+#include "sqlite/DictionaryCodec.h"
 
 #include <QSet>
 #include <QtDebug>
 #include <QRegExp>
 
+#include <math.h>
+
 static QSet<QString> ignoredWords;
 static QByteArray kanasConverted;
 
@@ -90,6 +93,72 @@ static void fts_uncompress(sqlite3_context *context, int argc, sqlite3_value **a
 	sqlite3_result_text(context, text.data(), text.size(), 0);
 }
 
+static void dict_uncompress(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+	QByteArray data(QByteArray::fromRawData(static_cast<const char *>(sqlite3_value_blob(argv[0])), sqlite3_value_bytes(argv[0])));
+	QByteArray text;
+	if (!SQLite::DictionaryCodec::uncompress(data, text)) {
+		sqlite3_result_null(context);
+		return;
+	}
+	sqlite3_result_text(context, text.constData(), text.size(), SQLITE_TRANSIENT);
+}
+
+/// Okapi BM25 term frequency saturation and length normalization parameters
+#define BM25_K1 1.2
+#define BM25_B 0.75
+
+/**
+ * Relevance of a full-text search match:
+ * ftsrank(matchinfo(table, 'pcnalx') [, exact [, priority [, frequency]]])
+ *
+ * The base score is the Okapi BM25 of the row, computed from the FTS
+ * statistics. It is doubled for exact matches - if exact is NULL or
+ * omitted, rows made only of the searched terms are considered exact.
+ * It is then divided by 1 + priority / 4, priority being the position
+ * of the matched reading or sense within its entry, and multiplied by
+ * 1 + ln(1 + frequency) / 4.
+ */
+static void fts_rank(sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+	if (argc < 1 || argc > 4) {
+		sqlite3_result_error(context, "Invalid number of arguments!", -1);
+		return;
+	}
+	const quint32 *info = static_cast<const quint32 *>(sqlite3_value_blob(argv[0]));
+	int size = sqlite3_value_bytes(argv[0]) / sizeof(quint32);
+	if (!info || size < 3 || (quint32)size != 3 + 2 * info[1] + 3 * info[0] * info[1]) {
+		sqlite3_result_error(context, "Invalid matchinfo, format must be 'pcnalx'!", -1);
+		return;
+	}
+	const quint32 nPhrases = info[0], nCols = info[1];
+	const double nDocs = info[2];
+	const quint32 *avgLength = info + 3, *length = avgLength + nCols, *hits = length + nCols;
+
+	double score = 0.0;
+	quint32 rowHits = 0, rowLength = 0;
+	for (quint32 col = 0; col < nCols; col++) {
+		rowLength += length[col];
+		double norm = BM25_K1 * (1.0 - BM25_B + BM25_B * length[col] / qMax(avgLength[col], (quint32)1));
+		for (quint32 phrase = 0; phrase < nPhrases; phrase++) {
+			// Hits in this row, hits in all rows, rows with hits
+			const quint32 *x = hits + 3 * (phrase * nCols + col);
+			if (!x[0]) continue;
+			double idf = log(1.0 + (nDocs - x[2] + 0.5) / (x[2] + 0.5));
+			score += idf * x[0] * (BM25_K1 + 1.0) / (x[0] + norm);
+			rowHits += x[0];
+		}
+	}
+
+	bool exact;
+	if (argc > 1 && sqlite3_value_type(argv[1]) != SQLITE_NULL) exact = sqlite3_value_int(argv[1]) != 0;
+	else exact = rowLength > 0 && rowHits >= rowLength;
+	if (exact) score *= 2.0;
+	if (argc > 2) score /= 1.0 + qMax(sqlite3_value_int(argv[2]), 0) / 4.0;
+	if (argc > 3) score *= 1.0 + log(1.0 + qMax(sqlite3_value_int(argv[3]), 0)) / 4.0;
+	sqlite3_result_double(context, score);
+}
+
 int isToIgnore(const char *token)
 {
 	if (!strcmp(token, "a")) return true;
@@ -573,6 +642,8 @@ int sqlite3ext_register_functions(sqlite3 *handler)
 	sqlite3_create_function(handler, "uniquecount", -1, SQLITE_UTF8, 0, 0, uniquecount_aggr_step, uniquecount_aggr_finalize);
 	sqlite3_create_function(handler, "ftscompress", 1, SQLITE_UTF8, 0, fts_compress, 0, 0);
 	sqlite3_create_function(handler, "ftsuncompress", 1, SQLITE_UTF8, 0, fts_uncompress, 0, 0);
+	sqlite3_create_function(handler, "dictuncompress", 1, SQLITE_UTF8, 0, dict_uncompress, 0, 0);
+	sqlite3_create_function(handler, "ftsrank", -1, SQLITE_UTF8, 0, fts_rank, 0, 0);
 
 	return SQLITE_OK;
 }
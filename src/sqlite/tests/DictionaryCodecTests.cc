@@ -0,0 +1,134 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DictionaryCodecTests.h"
+#include "sqlite/Connection.h"
+#include "sqlite/Query.h"
+
+#include <QFile>
+#include <QTime>
+
+void DictionaryCodecTests::initTestCase()
+{
+	QList<QByteArray> samples;
+	samples << "to eat\nto drink" << "to drink\n\nto eat (in a formal way)" << "water\nwaterfall" << "(n) food, meal" << "to eat\nto live on (e.g. a salary)";
+	codec = SQLite::DictionaryCodec::train(samples);
+	QVERIFY(codec.isValid());
+
+	if (!QFile::exists(JMDICT_EN_DB)) return;
+	SQLite::Connection connection;
+	QVERIFY(connection.connect(JMDICT_EN_DB, SQLite::Connection::ReadOnly));
+	QVERIFY(SQLite::DictionaryCodec::registerDictionaries(&connection, "main"));
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("select glosses from glosses"));
+	while (query.next()) {
+		QByteArray data(query.valueBlob(0));
+		QByteArray text;
+		QVERIFY(SQLite::DictionaryCodec::uncompress(data, text));
+		dictCompressed << data;
+		zlibCompressed << qCompress(text, 9);
+	}
+
+	QVERIFY(query.exec("select sum(length(dictionary)) from compressionDictionaries"));
+	QVERIFY(query.next());
+	qint64 dictSize = query.valueInt(0), zlibSize = 0;
+	foreach (const QByteArray &data, dictCompressed) dictSize += data.size();
+	foreach (const QByteArray &data, zlibCompressed) zlibSize += data.size();
+	qDebug("%d glosses: %lld bytes with shared dictionary (dictionary included), %lld bytes with zlib", dictCompressed.size(), dictSize, zlibSize);
+	query.clear();
+	QVERIFY(connection.close());
+}
+
+void DictionaryCodecTests::roundTrip_data()
+{
+	QTest::addColumn<QByteArray>("text");
+
+	QTest::newRow("Empty") << QByteArray();
+	QTest::newRow("Known words") << QByteArray("to eat\nto drink");
+	QTest::newRow("Known word without space") << QByteArray("eat");
+	QTest::newRow("Unknown words") << QByteArray("to sleep (zzz)");
+	QTest::newRow("Unknown bytes") << QByteArray("~|\t{}");
+	QTest::newRow("UTF-8") << QString::fromUtf8("manger, \xd0\xb5\xd1\x81\xd1\x82\xd1\x8c, \xc3\xa9t\xc3\xa9").toUtf8();
+}
+
+void DictionaryCodecTests::roundTrip()
+{
+	QFETCH(QByteArray, text);
+	QByteArray compressed(codec.compress(text));
+	QByteArray uncompressed;
+	QVERIFY(codec.uncompress(compressed.constData(), compressed.size(), uncompressed));
+	QCOMPARE(uncompressed, text);
+}
+
+void DictionaryCodecTests::serialization()
+{
+	SQLite::DictionaryCodec loaded(SQLite::DictionaryCodec::fromData(codec.data()));
+	QVERIFY(loaded.isValid());
+	QCOMPARE(loaded.id(), codec.id());
+	QCOMPARE(loaded.symbolsCount(), codec.symbolsCount());
+
+	QByteArray text("to eat (in a formal way)");
+	QByteArray compressed(codec.compress(text));
+	QVERIFY(compressed.size() < text.size());
+	QCOMPARE(SQLite::DictionaryCodec::uncompress(compressed), QByteArray());
+	QVERIFY(SQLite::DictionaryCodec::registerDictionary(codec.data()));
+	QCOMPARE(SQLite::DictionaryCodec::uncompress(compressed), text);
+}
+
+void DictionaryCodecTests::invalidData()
+{
+	QByteArray text;
+	QByteArray compressed(codec.compress("to eat"));
+	// Header of another dictionary
+	QByteArray other(compressed);
+	other[0] = (char)(other[0] ^ 0xff);
+	QVERIFY(!codec.uncompress(other.constData(), other.size(), text));
+	// Truncated two-bytes code or escape
+	QByteArray truncated(compressed);
+	truncated.append((char)SQLite::DictionaryCodec::Escape);
+	QVERIFY(!codec.uncompress(truncated.constData(), truncated.size(), text));
+	QVERIFY(!codec.uncompress(compressed.constData(), 2, text));
+	QVERIFY(!SQLite::DictionaryCodec::fromData(QByteArray("\x00\x02\x01", 3)).isValid());
+}
+
+void DictionaryCodecTests::decodeBenchmark_data()
+{
+	QTest::addColumn<bool>("zlib");
+
+	QTest::newRow("zlib") << true;
+	QTest::newRow("Shared dictionary") << false;
+}
+
+void DictionaryCodecTests::decodeBenchmark()
+{
+	if (dictCompressed.isEmpty()) QSKIP("English JMdict database not found", SkipAll);
+	QFETCH(bool, zlib);
+	const QList<QByteArray> &data(zlib ? zlibCompressed : dictCompressed);
+	qint64 decoded = 0;
+	QTime time;
+	time.start();
+	QBENCHMARK_ONCE {
+		foreach (const QByteArray &blob, data) {
+			QByteArray text(zlib ? qUncompress(blob) : SQLite::DictionaryCodec::uncompress(blob));
+			decoded += text.size();
+		}
+	}
+	int elapsed = qMax(time.elapsed(), 1);
+	qDebug("Decoded %lld bytes in %d ms (%.1f MB/s)", decoded, elapsed, decoded / 1048.576 / elapsed);
+}
+
+QTEST_MAIN(DictionaryCodecTests)
@@ -0,0 +1,46 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include "sqlite/DictionaryCodec.h"
+
+/**
+ * Checks the shared-dictionary compression of database texts and compares
+ * it to per-row zlib compression.
+ */
+class DictionaryCodecTests : public QObject
+{
+	Q_OBJECT
+private:
+	SQLite::DictionaryCodec codec;
+	/// Compressed glosses of the english JMdict database, if available
+	QList<QByteArray> dictCompressed;
+	QList<QByteArray> zlibCompressed;
+
+private slots:
+	void initTestCase();
+
+	void roundTrip_data();
+	void roundTrip();
+	void serialization();
+	void invalidData();
+
+	void decodeBenchmark_data();
+	void decodeBenchmark();
+};
@@ -0,0 +1,246 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RelevanceTests.h"
+#include "sqlite/SQLite.h"
+#include "sqlite/Query.h"
+
+#include <QTime>
+
+struct RelevanceEntry {
+	int id;
+	int frequency;
+	const char *senses[3];
+};
+
+/// Small set of JMdict-like entries, with their glosses by sense
+static const RelevanceEntry relevanceSet[] = {
+	{ 1, 150, { "to eat", "to live on (e.g. a salary), to make a living", 0 } },
+	{ 2, 60, { "to eat (vulgar)", "to live, to make a living", "to bite" } },
+	{ 3, 110, { "meal", "to have a meal", 0 } },
+	{ 4, 100, { "to receive, to get", "to eat, to drink (humble)", 0 } },
+	{ 5, 20, { "feed, bait", "food eaten by animals", 0 } },
+	{ 6, 150, { "water (esp. cool, fresh water)", 0, 0 } },
+	{ 7, 30, { "waterfall, cascade", 0, 0 } },
+	{ 8, 5, { "water for irrigation, industrial water", 0, 0 } },
+	{ 9, 150, { "to drink, to gulp, to swallow", "to smoke (tobacco)", 0 } },
+	{ 10, 0, { "drinking in large gulps", 0, 0 } },
+	{ 11, 140, { "alcohol, sake", 0, 0 } },
+	{ 12, 120, { "drink, beverage", 0, 0 } },
+	{ 13, 150, { "book, volume, script", 0, 0 } },
+	{ 14, 20, { "notebook, account book, book", 0, 0 } },
+	{ 15, 100, { "reservation, appointment, booking, advance order", 0, 0 } },
+	{ 16, 5, { "registration, entry (in a book), signature", 0, 0 } },
+	{ 17, 90, { "to read", 0, 0 } },
+	{ 18, 10, { "reading aloud, to read aloud", 0, 0 } },
+	{ 0, 0, { 0, 0, 0 } }
+};
+
+#define BENCHMARK_ENTRIES 30000
+#define BENCHMARK_VOCABULARY 2000
+
+static bool createTables(SQLite::Connection &connection, const QString &prefix)
+{
+	SQLite::Query query(&connection);
+	return query.exec(QString("CREATE TABLE %1entries(id INTEGER PRIMARY KEY, frequency SMALLINT)").arg(prefix)) &&
+		query.exec(QString("CREATE TABLE %1gloss(id INTEGER, priority TINYINT, docid INTEGER PRIMARY KEY)").arg(prefix)) &&
+		query.exec(QString("CREATE INDEX idx_%1gloss ON %1gloss(id)").arg(prefix)) &&
+		query.exec(QString("CREATE VIRTUAL TABLE %1glossText USING fts4(reading)").arg(prefix));
+}
+
+static bool insertEntry(SQLite::Connection &connection, const QString &prefix, int id, int frequency, const QStringList &senses)
+{
+	SQLite::Query query(&connection);
+	if (!query.prepare(QString("INSERT INTO %1entries VALUES(?, ?)").arg(prefix))) return false;
+	query.bindValue(id);
+	query.bindValue(frequency);
+	if (!query.exec()) return false;
+	SQLite::Query textQuery(&connection), glossQuery(&connection);
+	if (!textQuery.prepare(QString("INSERT INTO %1glossText VALUES(?)").arg(prefix))) return false;
+	if (!glossQuery.prepare(QString("INSERT INTO %1gloss VALUES(?, ?, ?)").arg(prefix))) return false;
+	for (int i = 0; i < senses.size(); i++) {
+		textQuery.bindValue(senses[i]);
+		if (!textQuery.exec()) return false;
+		glossQuery.bindValue(id);
+		glossQuery.bindValue(i);
+		glossQuery.bindValue(textQuery.lastInsertId());
+		if (!glossQuery.exec()) return false;
+		textQuery.reset();
+		glossQuery.reset();
+	}
+	return true;
+}
+
+void RelevanceTests::initTestCase()
+{
+	sqlite3ext_init();
+	QVERIFY(dbFile.open());
+	QVERIFY(connection.connect(dbFile.fileName()));
+	QVERIFY(connection.transaction());
+
+	QVERIFY(createTables(connection, ""));
+	for (int i = 0; relevanceSet[i].id; i++) {
+		QStringList senses;
+		for (int j = 0; j < 3 && relevanceSet[i].senses[j]; j++) senses << relevanceSet[i].senses[j];
+		QVERIFY(insertEntry(connection, "", relevanceSet[i].id, relevanceSet[i].frequency, senses));
+	}
+
+	// Random glosses for the benchmark, "to" and the first words of the
+	// vocabulary being the most common ones
+	QVERIFY(createTables(connection, "bench"));
+	QStringList vocabulary;
+	for (int i = 0; i < BENCHMARK_VOCABULARY; i++) vocabulary << QString("w%1").arg(i);
+	for (int i = 1; i <= BENCHMARK_ENTRIES; i++) {
+		QStringList senses;
+		int nbSenses = 1 + qrand() % 3;
+		for (int j = 0; j < nbSenses; j++) {
+			QStringList words;
+			if (qrand() % 3 == 0) words << "to";
+			int nbWords = 1 + qrand() % 4;
+			for (int k = 0; k < nbWords; k++) {
+				int r = qrand() % 100;
+				words << vocabulary[r * r * r * BENCHMARK_VOCABULARY / 1000000];
+			}
+			senses << words.join(" ");
+		}
+		QVERIFY(insertEntry(connection, "bench", i, qrand() % 200, senses));
+	}
+	QVERIFY(connection.commit());
+}
+
+void RelevanceTests::cleanupTestCase()
+{
+	QVERIFY(connection.close());
+}
+
+/**
+ * Returns the ids of the entries which glosses match, ordered like
+ * JMdictEntrySearcher does: by relevance if ranked is true, by frequency
+ * otherwise.
+ */
+QStringList RelevanceTests::search(const QString &tablesPrefix, const QString &match, bool ranked, int limit)
+{
+	static QString rankedSearch("SELECT %1entries.id FROM %1entries "
+		"LEFT JOIN (SELECT %1gloss.id AS id, FTSRANK(matchinfo(%1glossText, 'pcnalx'), NULL, %1gloss.priority, %1entries.frequency) AS score "
+		"FROM %1gloss JOIN %1glossText ON %1gloss.docid = %1glossText.docid JOIN %1entries ON %1entries.id = %1gloss.id "
+		"WHERE %1glossText.reading MATCH ?) AS relevance ON (relevance.id = %1entries.id) "
+		"WHERE %1entries.id IN (SELECT id FROM %1gloss JOIN %1glossText ON %1gloss.docid = %1glossText.docid WHERE %1glossText.reading MATCH ?) "
+		"GROUP BY %1entries.id ORDER BY max(relevance.score) DESC, %1entries.frequency DESC LIMIT %2");
+	static QString frequencySearch("SELECT %1entries.id FROM %1entries "
+		"WHERE %1entries.id IN (SELECT id FROM %1gloss JOIN %1glossText ON %1gloss.docid = %1glossText.docid WHERE %1glossText.reading MATCH ?) "
+		"ORDER BY %1entries.frequency DESC LIMIT %2");
+
+	QStringList ret;
+	SQLite::Query query(&connection);
+	if (!query.prepare((ranked ? rankedSearch : frequencySearch).arg(tablesPrefix).arg(limit))) return ret;
+	query.bindValue(match);
+	if (ranked) query.bindValue(match);
+	if (!query.exec()) return ret;
+	while (query.next()) ret << QString::number(query.valueInt(0));
+	return ret;
+}
+
+void RelevanceTests::boosts()
+{
+	SQLite::Query query(&connection);
+	QVERIFY(query.exec("SELECT FTSRANK(matchinfo(glossText, 'pcnalx')), "
+		"FTSRANK(matchinfo(glossText, 'pcnalx'), 0), "
+		"FTSRANK(matchinfo(glossText, 'pcnalx'), 1), "
+		"FTSRANK(matchinfo(glossText, 'pcnalx'), NULL, 4), "
+		"FTSRANK(matchinfo(glossText, 'pcnalx'), NULL, 0, 100) "
+		"FROM glossText WHERE reading MATCH '\"meal\"' ORDER BY docid"));
+
+	// "meal" only contains the searched term and is an exact match
+	QVERIFY(query.next());
+	double base = query.valueDouble(0);
+	QVERIFY(base > 0.0);
+	QCOMPARE(query.valueDouble(1), base / 2.0);
+	QCOMPARE(query.valueDouble(2), base);
+
+	// "to have a meal" is not
+	QVERIFY(query.next());
+	base = query.valueDouble(0);
+	QVERIFY(base > 0.0);
+	QCOMPARE(query.valueDouble(1), base);
+	QCOMPARE(query.valueDouble(2), base * 2.0);
+	QCOMPARE(query.valueDouble(3), base / 2.0);
+	QVERIFY(query.valueDouble(4) > base);
+	QVERIFY(!query.next());
+}
+
+void RelevanceTests::invalidArguments()
+{
+	SQLite::Query query(&connection);
+	QVERIFY(!query.exec("SELECT FTSRANK()"));
+	QVERIFY(!query.exec("SELECT FTSRANK(x'0100000001000000')"));
+	QVERIFY(!query.exec("SELECT FTSRANK(matchinfo(glossText, 'x')) FROM glossText WHERE reading MATCH '\"meal\"'"));
+}
+
+void RelevanceTests::relevance_data()
+{
+	QTest::addColumn<QString>("match");
+	QTest::addColumn<QString>("expected");
+
+	// Main sense of a common word first, even if less frequent entries
+	// also use it
+	QTest::newRow("eat") << "\"eat\"" << "1,2,4";
+	QTest::newRow("to eat") << "\"to\" \"eat\"" << "1,2,4";
+	// Exact matches before longer glosses of more frequent entries
+	QTest::newRow("drink") << "\"drink\"" << "12,9,4";
+	QTest::newRow("live") << "\"live\"" << "2,1";
+	QTest::newRow("book") << "\"book\"" << "13,14,16";
+	QTest::newRow("water") << "\"water\"" << "6,8";
+	QTest::newRow("wat*") << "\"wat*\"" << "6,7,8";
+	QTest::newRow("read*") << "\"read*\"" << "17,18";
+}
+
+void RelevanceTests::relevance()
+{
+	QFETCH(QString, match);
+	QFETCH(QString, expected);
+
+	QCOMPARE(search("", match, true, 10).join(","), expected);
+}
+
+void RelevanceTests::rankingBenchmark_data()
+{
+	QTest::addColumn<bool>("ranked");
+	QTest::addColumn<QString>("match");
+
+	QTest::newRow("Frequency, common word") << false << "\"to\"";
+	QTest::newRow("Relevance, common word") << true << "\"to\"";
+	QTest::newRow("Frequency, two words") << false << "\"w0\" \"w1\"";
+	QTest::newRow("Relevance, two words") << true << "\"w0\" \"w1\"";
+}
+
+#define BENCHMARK_SEARCHES 20
+void RelevanceTests::rankingBenchmark()
+{
+	QFETCH(bool, ranked);
+	QFETCH(QString, match);
+
+	QStringList results;
+	QTime time;
+	time.start();
+	QBENCHMARK_ONCE {
+		for (int i = 0; i < BENCHMARK_SEARCHES; i++) results = search("bench", match, ranked, 50);
+	}
+	QCOMPARE(results.size(), 50);
+	qDebug("%d top 50 searches in %d ms", BENCHMARK_SEARCHES, time.elapsed());
+}
+
+QTEST_MAIN(RelevanceTests)
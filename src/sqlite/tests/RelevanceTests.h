@@ -0,0 +1,51 @@
+/*
+ *  Copyright (C) 2011  Alexandre Courbot
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QTest>
+
+#include "sqlite/Connection.h"
+
+#include <QTemporaryFile>
+#include <QStringList>
+
+/**
+ * Checks the ranking of full-text search results by the ftsrank() function
+ * on a small set of dictionary-like entries, and compares the cost of
+ * ranking with sorting by frequency.
+ */
+class RelevanceTests : public QObject
+{
+	Q_OBJECT
+private:
+	SQLite::Connection connection;
+	QTemporaryFile dbFile;
+
+	QStringList search(const QString &tablesPrefix, const QString &match, bool ranked, int limit);
+
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+
+	void boosts();
+	void invalidArguments();
+	void relevance_data();
+	void relevance();
+
+	void rankingBenchmark_data();
+	void rankingBenchmark();
+};
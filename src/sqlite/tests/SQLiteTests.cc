@@ -16,6 +16,7 @@
  */
 
 #include "SQLiteTests.h"
+#include "sqlite/QueryProfiler.h"
 
 #include <QtDebug>
 
@@ -193,6 +194,47 @@ void SQLiteTests::queryRetrieveAll()
 	QVERIFY(!query.next());
 }
 
+void SQLiteTests::queryProfile()
+{
+	// Record every query
+	SQLite::QueryProfiler::setThreshold(0);
+	SQLite::QueryProfiler::setExplain(true);
+	SQLite::QueryProfiler::setEnabled(true);
+	SQLite::QueryProfiler::clear();
+	QVERIFY(query.exec("select * from test order by col4"));
+	QVERIFY(query.next());
+	QVERIFY(query.next());
+	QVERIFY(!query.next());
+	SQLite::QueryProfiler::setEnabled(false);
+
+	QList<SQLite::QueryProfile> profiles(SQLite::QueryProfiler::recent());
+	QCOMPARE(profiles.size(), 1);
+	const SQLite::QueryProfile &profile = profiles[0];
+	QCOMPARE(profile.sql, QString("select * from test order by col4"));
+	QCOMPARE(profile.rows, (quint32)2);
+	// No index on test, so the query scans the table and sorts its results
+	QVERIFY(profile.fullscanSteps > 0);
+	QCOMPARE(profile.sorts, 1);
+	QVERIFY(!profile.plan.isEmpty());
+
+	// Disabled profiling does not record anything
+	QVERIFY(query.exec("select * from test"));
+	while (query.next());
+	QCOMPARE(SQLite::QueryProfiler::recent().size(), 1);
+	SQLite::QueryProfiler::clear();
+	QVERIFY(SQLite::QueryProfiler::recent().isEmpty());
+
+	// The time the caller spends between steps is not counted
+	int threshold = SQLite::QueryProfiler::threshold();
+	SQLite::QueryProfiler::setThreshold(50);
+	SQLite::QueryProfiler::setEnabled(true);
+	QVERIFY(query.exec("select * from test"));
+	while (query.next()) QTest::qSleep(100);
+	SQLite::QueryProfiler::setEnabled(false);
+	SQLite::QueryProfiler::setThreshold(threshold);
+	QVERIFY(SQLite::QueryProfiler::recent().isEmpty());
+}
+
 void SQLiteTests::transaction()
 {
 }
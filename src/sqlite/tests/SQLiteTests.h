@@ -50,6 +50,7 @@ private slots:
 	void queryRetrieve_data();
 	void queryRetrieve();
 	void queryRetrieveAll();
+	void queryProfile();
 	void transaction();
 	void queryClean();
 	void connectionDetach();